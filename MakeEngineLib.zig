@@ -9,6 +9,7 @@ const LightBuild = enum {
     Script,
     Full,
     Shader,
+    Headless,
 };
 
 pub fn MakeEngineLib(b: *std.Build, target: std.Build.ResolvedTarget, optimize: std.builtin.OptimizeMode, build_type: LightBuild) *std.Build.Module {
@@ -141,6 +142,14 @@ pub fn MakeEngineLib(b: *std.Build, target: std.Build.ResolvedTarget, optimize:
                 .root_source_file = .{ .src_path = .{ .owner = b, .sub_path = "src/Imaginengion/ImagineShaders.zig" } },
             },
         ),
+        //not exported with addModule since tests and benchmarks each want their own optimize mode
+        .Headless => b.createModule(
+            .{
+                .optimize = optimize,
+                .target = target,
+                .root_source_file = .{ .src_path = .{ .owner = b, .sub_path = "src/Imaginengion/ImagineHeadless.zig" } },
+            },
+        ),
     };
 
     switch (build_type) {
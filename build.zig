@@ -3,6 +3,7 @@ const builtin = @import("builtin");
 const MakeEngineLib = @import("MakeEngineLib.zig").MakeEngineLib;
 const build_shaders = @import("build_shaders.zig");
 const build_script = @import("build_script.zig");
+const build_bench = @import("build_bench.zig");
 
 pub fn build(b: *std.Build) void {
     const target = b.standardTargetOptions(.{});
@@ -15,6 +16,8 @@ pub fn build(b: *std.Build) void {
     const engine_module_eng = MakeEngineLib(b, target, optimize, .Full);
     const engine_module_script = MakeEngineLib(b, target, optimize, .Script);
     const engine_module_shader = MakeEngineLib(b, spirv_target, optimize, .Shader);
+    const engine_module_headless = MakeEngineLib(b, target, .ReleaseFast, .Headless);
+    const engine_module_headless_debug = MakeEngineLib(b, target, .Debug, .Headless);
     //=================================END ENGINE MODULE============================================================
 
     //==================================OPTIONS============================================================
@@ -64,6 +67,10 @@ pub fn build(b: *std.Build) void {
     build_script.BuildScript(b, engine_module_script, target, optimize);
     //=========================================END SCRIPT STEP=====================================
 
+    //=========================================BENCH STEP=========================================
+    build_bench.BuildBench(b, engine_module_headless, target);
+    //=========================================END BENCH STEP=====================================
+
     //================================================RUN STEP=======================================
     const run_cmd = b.addRunArtifact(editor_exe);
     run_cmd.step.dependOn(b.getInstallStep());
@@ -96,6 +103,12 @@ pub fn build(b: *std.Build) void {
 
     test_step.dependOn(&run_math_types_test.step);
 
+    //headless engine tests (physics, workers, etc)
+    const headless_tests = b.addTest(.{ .root_module = engine_module_headless_debug });
+    const run_headless_tests = b.addRunArtifact(headless_tests);
+
+    test_step.dependOn(&run_headless_tests.step);
+
     if (test_build) {
         run_step.dependOn(test_step);
     }
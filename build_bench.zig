@@ -0,0 +1,38 @@
+const std = @import("std");
+
+const benches = .{
+    .{ "bench-solver", "src/Benchmarks/ContactSolverBench.zig", "Benchmark the parallel contact solver" },
+    .{ "bench-integrator", "src/Benchmarks/IntegratorBench.zig", "Benchmark the SoA integrator against the per body loop" },
+    .{ "bench-narrowphase", "src/Benchmarks/NarrowphaseBench.zig", "Benchmark the narrowphase per shape pair and across worker counts" },
+    .{ "bench-physics", "src/Benchmarks/PhysicsBench.zig", "Benchmark the physics step on canonical scenes and write the results as JSON" },
+    .{ "bench-raymarch", "src/Benchmarks/RayMarchBench.zig", "Benchmark the cpu ray marcher on 10k glyphs with and without the object BVH" },
+    .{ "bench-text-shading", "src/Benchmarks/TextShadingBench.zig", "Measure the text buffers on a 50k glyph scene with per glyph and shared shadings" },
+    .{ "bench-replay-frame", "src/Benchmarks/FrameReplayBench.zig", "Replay a captured frame on the cpu ray marcher, pass the file with --capture" },
+};
+
+pub fn BuildBench(b: *std.Build, module: *std.Build.Module, target: std.Build.ResolvedTarget) void {
+    const bench_step = b.step("bench", "Run all benchmarks");
+
+    inline for (benches) |bench| {
+        const bench_exe = b.addExecutable(.{
+            .name = bench[0],
+            .root_module = b.createModule(.{
+                .target = target,
+                .optimize = .ReleaseFast,
+                .root_source_file = b.path(bench[1]),
+                .imports = &.{
+                    .{ .name = "IMHeadless", .module = module },
+                },
+            }),
+        });
+
+        const run_bench = b.addRunArtifact(bench_exe);
+        if (b.args) |args| {
+            run_bench.addArgs(args);
+        }
+        bench_step.dependOn(&run_bench.step);
+
+        const single_step = b.step(bench[0], bench[2]);
+        single_step.dependOn(&run_bench.step);
+    }
+}
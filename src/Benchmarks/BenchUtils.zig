@@ -0,0 +1,64 @@
+//! Small helpers shared by the benchmark executables.
+const std = @import("std");
+
+pub const Timer = struct {
+    mIo: std.Io,
+    mStart: std.Io.Timestamp,
+
+    pub fn Start(io: std.Io) Timer {
+        return .{ .mIo = io, .mStart = .now(io, .awake) };
+    }
+
+    pub fn Reset(self: *Timer) void {
+        self.mStart = .now(self.mIo, .awake);
+    }
+
+    /// Milliseconds elapsed since Start or the last Reset
+    pub fn ReadMs(self: Timer) f64 {
+        const end: std.Io.Timestamp = .now(self.mIo, .awake);
+        const ns = self.mStart.durationTo(end).toNanoseconds();
+        return @as(f64, @floatFromInt(ns)) / @as(f64, std.time.ns_per_ms);
+    }
+};
+
+/// Walks the "--flag value" pairs after the program name. Every flag takes a value, a flag left
+/// without one at the end of the command line is an error instead of being dropped
+pub const FlagIterator = struct {
+    pub const Flag = struct {
+        Name: []const u8,
+        Value: []const u8,
+
+        pub fn Is(self: Flag, name: []const u8) bool {
+            return std.mem.eql(u8, self.Name, name);
+        }
+
+        /// For the flags a bench does not know, prints the flag and fails
+        pub fn Unknown(self: Flag) error{InvalidArgument} {
+            std.debug.print("unknown argument {s}\n", .{self.Name});
+            return error.InvalidArgument;
+        }
+    };
+
+    mArgs: []const [:0]const u8,
+    mIndex: usize,
+
+    pub fn Init(args: []const [:0]const u8) FlagIterator {
+        return .{ .mArgs = args, .mIndex = 1 };
+    }
+
+    pub fn Next(self: *FlagIterator) error{InvalidArgument}!?Flag {
+        if (self.mIndex >= self.mArgs.len) return null;
+        const name = self.mArgs[self.mIndex];
+        if (self.mIndex + 1 == self.mArgs.len) {
+            std.debug.print("missing value for {s}\n", .{name});
+            return error.InvalidArgument;
+        }
+        self.mIndex += 2;
+        return .{ .Name = name, .Value = self.mArgs[self.mIndex - 1] };
+    }
+};
+
+/// Keeps the optimizer from throwing away work whose result is never read
+pub fn DoNotOptimize(value: anytype) void {
+    std.mem.doNotOptimizeAway(value);
+}
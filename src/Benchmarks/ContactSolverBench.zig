@@ -0,0 +1,111 @@
+//! Scales body count and worker count for the graph coloured contact solver.
+//! Bodies are laid out in a grid of columns resting on a static ground body, each body touches
+//! the one below it and its neighbour to the side, similar to a wide stacking scene.
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const ContactSolver = IM.ContactSolver;
+const SolverBody = ContactSolver.SolverBody;
+const SolverContact = ContactSolver.SolverContact;
+const WorkerPool = IM.WorkerPool;
+const Vec3 = IM.Vec3;
+
+const BODY_COUNTS = [_]usize{ 1_000, 10_000, 100_000 };
+const THREAD_COUNTS = [_]usize{ 1, 2, 4, 8 };
+const COLUMN_HEIGHT: usize = 10;
+const STEPS: usize = 30;
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+
+    std.debug.print("{s:>10} {s:>8} {s:>10} {s:>8} {s:>12} {s:>12}\n", .{ "bodies", "threads", "contacts", "batches", "prepare ms", "solve ms" });
+
+    for (BODY_COUNTS) |body_count| {
+        var bodies: std.ArrayList(SolverBody) = .empty;
+        defer bodies.deinit(allocator);
+        var contacts: std.ArrayList(SolverContact) = .empty;
+        defer contacts.deinit(allocator);
+        try BuildScene(allocator, body_count, &bodies, &contacts);
+
+        const initial_bodies = try allocator.dupe(SolverBody, bodies.items);
+        defer allocator.free(initial_bodies);
+
+        for (THREAD_COUNTS) |thread_count| {
+            var pool: WorkerPool = .empty;
+            try pool.Init(allocator, thread_count - 1);
+            defer pool.Deinit(allocator);
+
+            var solver: ContactSolver = .empty;
+            defer solver.Deinit(allocator);
+
+            var prepare_ms: f64 = 0;
+            var solve_ms: f64 = 0;
+            for (0..STEPS) |_| {
+                @memcpy(bodies.items, initial_bodies);
+
+                var timer = BenchUtils.Timer.Start(init.io);
+                try solver.Prepare(allocator, bodies.items, contacts.items);
+                prepare_ms += timer.ReadMs();
+
+                timer.Reset();
+                solver.Solve(&pool, bodies.items, .default);
+                solve_ms += timer.ReadMs();
+
+                BenchUtils.DoNotOptimize(bodies.items[body_count / 2]);
+            }
+
+            std.debug.print("{d:>10} {d:>8} {d:>10} {d:>8} {d:>12.3} {d:>12.3}\n", .{
+                body_count,
+                thread_count,
+                contacts.items.len,
+                solver.GetBatches().len,
+                prepare_ms / @as(f64, STEPS),
+                solve_ms / @as(f64, STEPS),
+            });
+        }
+    }
+}
+
+fn BuildScene(allocator: std.mem.Allocator, body_count: usize, bodies: *std.ArrayList(SolverBody), contacts: *std.ArrayList(SolverContact)) !void {
+    var prng = std.Random.DefaultPrng.init(0x5eed);
+    const random = prng.random();
+    const zero = Vec3(f32){ .x = 0, .y = 0, .z = 0 };
+    const up = Vec3(f32){ .x = 0, .y = 1, .z = 0 };
+    const side = Vec3(f32){ .x = 1, .y = 0, .z = 0 };
+
+    //body 0 is the static ground
+    try bodies.append(allocator, .{ .Velocity = zero, .PositionCorrection = zero, .InvMass = 0 });
+
+    for (0..body_count) |i| {
+        try bodies.append(allocator, .{
+            .Velocity = .{ .x = random.float(f32) - 0.5, .y = -random.float(f32) * 4.0, .z = random.float(f32) - 0.5 },
+            .PositionCorrection = zero,
+            .InvMass = 1.0 / (0.5 + random.float(f32)),
+        });
+
+        const body: u32 = @intCast(i + 1);
+        const row = i % COLUMN_HEIGHT;
+        const below: u32 = if (row == 0) 0 else body - 1;
+        try contacts.append(allocator, .{
+            .BodyA = below,
+            .BodyB = body,
+            .Normal = up,
+            .Penetration = random.float(f32) * 0.05,
+            .AccumImpulse = 0,
+            .Key = (@as(u64, below) << 32) | body,
+        });
+
+        if (i >= COLUMN_HEIGHT) {
+            const left: u32 = body - @as(u32, @intCast(COLUMN_HEIGHT));
+            try contacts.append(allocator, .{
+                .BodyA = left,
+                .BodyB = body,
+                .Normal = side,
+                .Penetration = random.float(f32) * 0.02,
+                .AccumImpulse = 0,
+                .Key = (@as(u64, left) << 32) | body,
+            });
+        }
+    }
+}
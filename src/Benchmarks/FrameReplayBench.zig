@@ -0,0 +1,102 @@
+//! Replays a frame saved with the Capture Next Frame button of the stats panel on the cpu ray marcher.
+//!
+//! The overlay pass is rendered and the game pass blended over it, the way the gpu runs them, as
+//! often as asked, so a slow frame from the editor can be profiled and compared between changes
+//! without the scene that produced it. Textures are captured as handles only, every one of them
+//! samples white here, so the cost of texture fetches differs from the gpu but not the marching.
+//!
+//! Arguments: --capture PATH (the capture file, nothing is run without it), --repeats N (default 5),
+//! --threads N (default one per cpu), --png PATH (writes the replayed image)
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const FrameCapture = IM.FrameCapture;
+const CPURayMarcher = IM.CPURayMarcher;
+const WorkerPool = IM.WorkerPool;
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+
+    var capture_path: ?[]const u8 = null;
+    var png_path: ?[]const u8 = null;
+    var repeats: usize = 5;
+    var thread_count: ?usize = null;
+
+    var flags = BenchUtils.FlagIterator.Init(try init.minimal.args.toSlice(init.arena.allocator()));
+    while (try flags.Next()) |flag| {
+        if (flag.Is("--capture")) {
+            capture_path = flag.Value;
+        } else if (flag.Is("--png")) {
+            png_path = flag.Value;
+        } else if (flag.Is("--repeats")) {
+            repeats = @max(try std.fmt.parseInt(usize, flag.Value, 10), 1);
+        } else if (flag.Is("--threads")) {
+            thread_count = try std.fmt.parseInt(usize, flag.Value, 10);
+        } else {
+            return flag.Unknown();
+        }
+    }
+
+    //the bench step runs every bench without arguments, that is not an error
+    const path = capture_path orelse {
+        std.debug.print("no capture given, pass one with --capture PATH\n", .{});
+        return;
+    };
+
+    var capture = try FrameCapture.Load(init.io, allocator, path);
+    defer capture.Deinit();
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, if (thread_count) |threads| @max(threads, 1) - 1 else null);
+    defer pool.Deinit(allocator);
+
+    const textures: CPURayMarcher.TextureArray = .empty;
+    var image: CPURayMarcher.Image = .empty;
+    try image.Init(allocator, capture.mWidth, capture.mHeight);
+    defer image.Deinit(allocator);
+
+    const overlay = capture.GetPass(.Overlay);
+    const game = capture.GetPass(.Game);
+    std.debug.print("{s}: {d}x{d}, overlay {d} quads {d} glyphs, game {d} quads {d} glyphs, {d} surface shadings, {d} textures\n", .{
+        path,
+        capture.mWidth,
+        capture.mHeight,
+        overlay.Quads.len,
+        overlay.Glyphs.len,
+        game.Quads.len,
+        game.Glyphs.len,
+        capture.mSurfShadings.len,
+        capture.mTextureHandles.len,
+    });
+
+    var timer = BenchUtils.Timer.Start(init.io);
+    var total_ms: f64 = 0;
+    var min_ms: f64 = std.math.inf(f64);
+    var max_ms: f64 = 0;
+    for (0..repeats) |_| {
+        timer.Reset();
+        image.Clear(.{ .x = 0, .y = 0, .z = 0, .w = 0 });
+        CPURayMarcher.Render(&pool, capture.ToFrame(.Overlay, &textures), &image);
+        CPURayMarcher.Render(&pool, capture.ToFrame(.Game, &textures), &image);
+        const ms = timer.ReadMs();
+        BenchUtils.DoNotOptimize(image.GetPixel(capture.mWidth / 2, capture.mHeight / 2));
+
+        total_ms += ms;
+        min_ms = @min(min_ms, ms);
+        max_ms = @max(max_ms, ms);
+    }
+
+    std.debug.print("{d} frames on {d} threads, ms per frame: avg {d:.3}, min {d:.3}, max {d:.3}\n", .{
+        repeats,
+        pool.GetThreadCount(),
+        total_ms / @as(f64, @floatFromInt(repeats)),
+        min_ms,
+        max_ms,
+    });
+
+    if (png_path) |out_path| {
+        try image.WritePNG(init.io, allocator, out_path);
+        std.debug.print("wrote {s}\n", .{out_path});
+    }
+}
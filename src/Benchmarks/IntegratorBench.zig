@@ -0,0 +1,98 @@
+//! Compares the per body integration loop PhysicsManager used to run against the SoA
+//! integrator, both the raw integrate and the full gather -> integrate -> scatter round trip.
+//! The old loop also opened three tracy zones per body which is not counted here.
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const Integrator = IM.Integrator;
+const Vec3 = IM.Vec3;
+
+const BODY_COUNTS = [_]usize{ 1_000, 10_000, 100_000 };
+const STEPS: usize = 120;
+const DT: f32 = 1.0 / 120.0;
+
+//what a body looked like to the old loop, rigid body component plus transform translation
+const AoSBody = struct {
+    Position: Vec3(f32),
+    Velocity: Vec3(f32),
+    Force: Vec3(f32),
+    InvMass: f32,
+    Mass: f32,
+};
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+    const gravity = Vec3(f32){ .x = 0.0, .y = -9.81, .z = 0.0 };
+
+    std.debug.print("lanes: {d}\n", .{Integrator.LANES});
+    std.debug.print("{s:>10} {s:>14} {s:>14} {s:>18}\n", .{ "bodies", "per body ms", "soa ms", "soa+gather ms" });
+
+    for (BODY_COUNTS) |body_count| {
+        const bodies = try allocator.alloc(AoSBody, body_count);
+        defer allocator.free(bodies);
+        ResetBodies(bodies);
+
+        //old per body loop
+        var timer = BenchUtils.Timer.Start(init.io);
+        for (0..STEPS) |_| {
+            for (bodies) |*body| {
+                if (body.InvMass != 0) body.Force.AddEqVec(gravity.MulScalar(body.Mass));
+                body.Velocity.AddEqVec(body.Force.MulScalar(body.InvMass * DT));
+                body.Force = std.mem.zeroes(Vec3(f32));
+                body.Position.AddEqVec(body.Velocity.MulScalar(DT));
+            }
+        }
+        const per_body_ms = timer.ReadMs() / @as(f64, STEPS);
+        BenchUtils.DoNotOptimize(bodies[body_count / 2]);
+
+        //soa integrate only
+        var buffers: Integrator.BodyBuffers = .empty;
+        defer buffers.Deinit(allocator);
+        try buffers.Resize(allocator, body_count);
+        ResetBodies(bodies);
+        for (bodies, 0..) |body, i| {
+            buffers.SetBody(i, body.Position, body.Velocity, gravity.MulScalar(body.Mass), body.InvMass);
+        }
+        timer.Reset();
+        for (0..STEPS) |_| {
+            Integrator.Integrate(&buffers, DT);
+        }
+        const soa_ms = timer.ReadMs() / @as(f64, STEPS);
+        BenchUtils.DoNotOptimize(buffers.GetPosition(body_count / 2));
+
+        //soa with the gather and scatter PhysicsManager does every substep
+        ResetBodies(bodies);
+        timer.Reset();
+        for (0..STEPS) |_| {
+            for (bodies, 0..) |body, i| {
+                const force = if (body.InvMass != 0) body.Force.AddVec(gravity.MulScalar(body.Mass)) else body.Force;
+                buffers.SetBody(i, body.Position, body.Velocity, force, body.InvMass);
+            }
+            Integrator.Integrate(&buffers, DT);
+            for (bodies, 0..) |*body, i| {
+                body.Position = buffers.GetPosition(i);
+                body.Velocity = buffers.GetVelocity(i);
+                body.Force = std.mem.zeroes(Vec3(f32));
+            }
+        }
+        const gather_ms = timer.ReadMs() / @as(f64, STEPS);
+        BenchUtils.DoNotOptimize(bodies[body_count / 2]);
+
+        std.debug.print("{d:>10} {d:>14.4} {d:>14.4} {d:>18.4}\n", .{ body_count, per_body_ms, soa_ms, gather_ms });
+    }
+}
+
+fn ResetBodies(bodies: []AoSBody) void {
+    for (bodies, 0..) |*body, i| {
+        const f: f32 = @floatFromInt(i);
+        const mass: f32 = 1.0 + @as(f32, @floatFromInt(i % 4));
+        body.* = .{
+            .Position = .{ .x = f, .y = 10.0, .z = -f },
+            .Velocity = .{ .x = 0.5, .y = 0.0, .z = -0.5 },
+            .Force = std.mem.zeroes(Vec3(f32)),
+            .InvMass = if (i % 10 == 0) 0.0 else 1.0 / mass,
+            .Mass = mass,
+        };
+    }
+}
@@ -0,0 +1,169 @@
+//! Per shape pair cost of the narrowphase. Closed form pairs are timed through CCD.GetSeparation
+//! like the engine calls them and again through GJK.GetSeparation to show what the fast paths save.
+//! Positions are random so roughly half of the pairs overlap and the EPA path gets exercised too.
+//! The second table runs the parallel pair pass over a stacking scene of about 4000 contacts.
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const CCD = IM.CCD;
+const GJK = IM.GJK;
+const Narrowphase = IM.Narrowphase;
+const WorkerPool = IM.WorkerPool;
+const Shape = IM.Shapes.Shape;
+const Vec3 = IM.Vec3;
+
+const PAIR_COUNT: usize = 100_000;
+const REPEATS: usize = 10;
+
+const THREAD_COUNTS = [_]usize{ 1, 2, 4, 8 };
+const STACK_COLUMNS: usize = 20;
+const STACK_HEIGHT: usize = 10;
+const STEPS: usize = 100;
+
+const StackProxy = struct {
+    mShape: Shape,
+    mPosition: Vec3(f32),
+};
+
+const SeparationFn = fn (Shape, Vec3(f32), Shape, Vec3(f32)) IM.Shapes.Separation;
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+
+    //a small rock like hull, 8 corners of a squashed box plus a few points on the faces
+    const hull_points = [_]Vec3(f32){
+        .{ .x = -1, .y = -0.6, .z = -0.8 }, .{ .x = 1, .y = -0.6, .z = -0.8 },
+        .{ .x = -1, .y = 0.6, .z = -0.8 },  .{ .x = 1, .y = 0.6, .z = -0.8 },
+        .{ .x = -1, .y = -0.6, .z = 0.8 },  .{ .x = 1, .y = -0.6, .z = 0.8 },
+        .{ .x = -1, .y = 0.6, .z = 0.8 },   .{ .x = 1, .y = 0.6, .z = 0.8 },
+        .{ .x = 0, .y = 0.9, .z = 0 },      .{ .x = 0, .y = -0.9, .z = 0 },
+        .{ .x = 1.2, .y = 0, .z = 0 },      .{ .x = -1.2, .y = 0, .z = 0 },
+    };
+
+    const sphere = Shape{ .Sphere = 0.75 };
+    const box = Shape{ .Box = .{ .x = 0.8, .y = 0.5, .z = 0.6 } };
+    const capsule = Shape{ .Capsule = .{ .Radius = 0.4, .HalfHeight = 0.6 } };
+    const hull = Shape{ .Hull = &hull_points };
+
+    const cases = [_]struct { []const u8, Shape, Shape, bool }{
+        .{ "sphere-sphere", sphere, sphere, true },
+        .{ "box-box", box, box, true },
+        .{ "sphere-box", sphere, box, true },
+        .{ "capsule-capsule", capsule, capsule, false },
+        .{ "capsule-sphere", capsule, sphere, false },
+        .{ "capsule-box", capsule, box, false },
+        .{ "hull-sphere", hull, sphere, false },
+        .{ "hull-box", hull, box, false },
+        .{ "hull-hull", hull, hull, false },
+    };
+
+    const offsets = try allocator.alloc(Vec3(f32), PAIR_COUNT);
+    defer allocator.free(offsets);
+    var prng = std.Random.DefaultPrng.init(1234);
+    const random = prng.random();
+    for (offsets) |*offset| {
+        offset.* = .{ .x = random.float(f32) * 4 - 2, .y = random.float(f32) * 4 - 2, .z = random.float(f32) * 4 - 2 };
+    }
+
+    std.debug.print("{s:>16} {s:>14} {s:>14} {s:>10}\n", .{ "pair", "engine ns", "gjk ns", "overlap %" });
+
+    for (cases) |case| {
+        const engine_ns = Run(init.io, CCD.GetSeparation, case[1], case[2], offsets);
+        const gjk_ns = Run(init.io, GJK.GetSeparation, case[1], case[2], offsets);
+
+        var overlaps: usize = 0;
+        for (offsets) |offset| {
+            if (CCD.GetSeparation(case[1], offset, case[2], Vec3(f32).FromScalar(0)).Distance < 0) overlaps += 1;
+        }
+        const overlap_pct = @as(f64, @floatFromInt(overlaps)) * 100.0 / @as(f64, PAIR_COUNT);
+
+        //general pairs have no fast path so both columns are the same code
+        if (case[3]) {
+            std.debug.print("{s:>16} {d:>14.1} {d:>14.1} {d:>10.1}\n", .{ case[0], engine_ns, gjk_ns, overlap_pct });
+        } else {
+            std.debug.print("{s:>16} {d:>14.1} {s:>14} {d:>10.1}\n", .{ case[0], engine_ns, "-", overlap_pct });
+        }
+    }
+
+    try RunStacking(init, allocator);
+}
+
+fn RunStacking(init: std.process.Init, allocator: std.mem.Allocator) !void {
+    var proxies: std.ArrayList(StackProxy) = .empty;
+    defer proxies.deinit(allocator);
+    var pairs: std.ArrayList(Narrowphase.Pair) = .empty;
+    defer pairs.deinit(allocator);
+    try BuildStack(allocator, &proxies, &pairs);
+
+    std.debug.print("\n{s:>8} {s:>8} {s:>10} {s:>14}\n", .{ "threads", "pairs", "contacts", "narrow ms" });
+
+    for (THREAD_COUNTS) |thread_count| {
+        var pool: WorkerPool = .empty;
+        try pool.Init(allocator, thread_count - 1);
+        defer pool.Deinit(allocator);
+
+        var narrowphase: Narrowphase = .empty;
+        defer narrowphase.Deinit(allocator);
+
+        var contact_count: usize = 0;
+        const timer = BenchUtils.Timer.Start(init.io);
+        for (0..STEPS) |_| {
+            const manifolds = try narrowphase.Run(allocator, &pool, StackProxy, proxies.items, pairs.items);
+            contact_count = manifolds.len;
+            BenchUtils.DoNotOptimize(manifolds[manifolds.len / 2]);
+        }
+        const ms = timer.ReadMs();
+
+        std.debug.print("{d:>8} {d:>8} {d:>10} {d:>14.3}\n", .{ thread_count, pairs.items.len, contact_count, ms / @as(f64, STEPS) });
+    }
+}
+
+/// Columns of slightly sunken boxes and capsules on a ground box, every body is paired with the
+/// bodies around it like the broadphase would, about half of the pairs touch
+fn BuildStack(allocator: std.mem.Allocator, proxies: *std.ArrayList(StackProxy), pairs: *std.ArrayList(Narrowphase.Pair)) !void {
+    const size = @as(f32, @floatFromInt(STACK_COLUMNS));
+    try proxies.append(allocator, .{ .mShape = .{ .Box = .{ .x = size, .y = 0.5, .z = size } }, .mPosition = .{ .x = size / 2, .y = -0.5, .z = size / 2 } });
+
+    for (0..STACK_COLUMNS) |x| {
+        for (0..STACK_COLUMNS) |z| {
+            for (0..STACK_HEIGHT) |y| {
+                const shape: Shape = if ((x + y + z) % 3 == 0)
+                    .{ .Capsule = .{ .Radius = 0.5, .HalfHeight = 0.0 } }
+                else
+                    .{ .Box = Vec3(f32).FromScalar(0.5) };
+                try proxies.append(allocator, .{
+                    .mShape = shape,
+                    .mPosition = .{ .x = @floatFromInt(x), .y = @as(f32, @floatFromInt(y)) * 0.98 + 0.49, .z = @floatFromInt(z) },
+                });
+            }
+        }
+    }
+
+    for (1..proxies.items.len) |body| {
+        const index: u32 = @intCast(body);
+        try pairs.append(allocator, .{ .Key = index, .Origin = 0, .Target = index, .Overlap = false });
+
+        for (body + 1..proxies.items.len) |other| {
+            const delta = proxies.items[other].mPosition.SubVec(proxies.items[body].mPosition);
+            if (@abs(delta.x) > 1.01 or @abs(delta.y) > 1.01 or @abs(delta.z) > 1.01) continue;
+            try pairs.append(allocator, .{ .Key = (@as(u64, body) << 32) | other, .Origin = index, .Target = @intCast(other), .Overlap = false });
+        }
+    }
+}
+
+fn Run(io: std.Io, comptime separation_fn: SeparationFn, shape_a: Shape, shape_b: Shape, offsets: []const Vec3(f32)) f64 {
+    const origin = Vec3(f32).FromScalar(0);
+    var checksum: f32 = 0;
+
+    const timer = BenchUtils.Timer.Start(io);
+    for (0..REPEATS) |_| {
+        for (offsets) |offset| {
+            checksum += separation_fn(shape_a, offset, shape_b, origin).Distance;
+        }
+    }
+    const ms = timer.ReadMs();
+    BenchUtils.DoNotOptimize(checksum);
+
+    return ms * std.time.ns_per_ms / @as(f64, @floatFromInt(REPEATS * offsets.len));
+}
@@ -0,0 +1,399 @@
+//! Headless physics benchmark over a set of canonical scenes.
+//!
+//! Each scene is stepped through the real CollisionManager the way PhysicsManager steps it per
+//! substep: BVH broadphase with the layer matrix and collision filters, the parallel narrowphase
+//! with contact recording and collision events, and the graph coloured solver warm started from the
+//! contact cache. Scene queries run against the broadphase after every step.
+//! The SceneManager and EngineContext can not be built without a window, GPU and audio, so the
+//! colliders and bodies are gathered from flat arrays here and handed over with SetProxies. That
+//! gather is timed on its own in place of the ECS one.
+//! Per phase timings are averaged over the fixed steps and written to stdout and to a JSON file.
+//!
+//! Arguments: --steps N (default 300), --threads N (default one per cpu), --json PATH (default bench-physics.json)
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const CollisionManager = IM.CollisionManager;
+const CollisionFilter = CollisionManager.CollisionFilter;
+const ColliderProxy = CollisionManager.ColliderProxy;
+const CollisionLayers = IM.CollisionLayers;
+const SceneQueries = IM.RayCast;
+const ContactSolver = IM.ContactSolver;
+const Integrator = IM.Integrator;
+const WorkerPool = IM.WorkerPool;
+const Shapes = IM.Shapes;
+const Shape = Shapes.Shape;
+const Vec3 = IM.Vec3;
+const Ray = IM.Ray;
+
+const Entity = @FieldType(CollisionManager.CollisionEvent, "mOrigin");
+//there is no scene headless, the entities of contacts and events only carry it along and the bench never reads through it
+const NO_SCENE: @FieldType(Entity, "mSceneManager") = undefined;
+
+//same step layout as PhysicsManager
+const SUB_STEPS: usize = 2;
+const SUB_STEP_DT: f32 = 1.0 / 60.0 / @as(f32, SUB_STEPS);
+const GRAVITY: f32 = -9.81;
+
+const DEFAULT_STEPS: usize = 300;
+const DEFAULT_JSON_PATH = "bench-physics.json";
+
+const GROUND_SHAPE = Shape{ .Box = .{ .x = 60, .y = 0.5, .z = 60 } };
+const GROUND_POSITION = Vec3(f32){ .x = 0, .y = -0.5, .z = 0 };
+
+//layers and categories the scenes use
+const DEBRIS_LAYER: CollisionLayers.Layer = 1;
+const WORLD_CATEGORY: usize = 0;
+const DYNAMIC_CATEGORY: usize = 1;
+
+//a grid of rays cast straight down over the scene after every step
+const QUERY_GRID: usize = 16;
+const QUERY_HEIGHT: f32 = 40;
+
+const Scene = struct {
+    Name: []const u8,
+    BuildFn: *const fn (world: *World) anyerror!void,
+};
+
+const SCENES = [_]Scene{
+    .{ .Name = "box_pyramid", .BuildFn = BuildBoxPyramid },
+    .{ .Name = "sphere_rain", .BuildFn = BuildSphereRain },
+    .{ .Name = "chained_bodies", .BuildFn = BuildChainedBodies },
+};
+
+/// Averages per fixed step, field names are the JSON keys
+const SceneResult = struct {
+    Name: []const u8,
+    Bodies: usize,
+    Steps: usize,
+    GatherMs: f64,
+    BroadphaseMs: f64,
+    NarrowphaseMs: f64,
+    SolverMs: f64,
+    IntegrationMs: f64,
+    QueriesMs: f64,
+    TotalMs: f64,
+    AvgPairs: f64,
+    AvgContacts: f64,
+    MaxContacts: usize,
+    AvgEvents: f64,
+};
+
+const Report = struct {
+    Threads: usize,
+    Scenes: []const SceneResult,
+};
+
+const PhaseTimes = struct {
+    Gather: f64 = 0,
+    Broadphase: f64 = 0,
+    Narrowphase: f64 = 0,
+    Solver: f64 = 0,
+    Integration: f64 = 0,
+    Queries: f64 = 0,
+};
+
+const World = struct {
+    mAllocator: std.mem.Allocator,
+    mFrameArena: std.heap.ArenaAllocator,
+    mShapes: std.ArrayList(Shape) = .empty,
+    mFilters: std.ArrayList(CollisionFilter) = .empty,
+    mBodies: Integrator.BodyBuffers = .empty,
+
+    mProxies: std.ArrayList(ColliderProxy) = .empty,
+    mCollisionManager: CollisionManager = .empty,
+
+    mRays: std.ArrayList(Ray(f32)) = .empty,
+    mHits: std.ArrayList(?SceneQueries.RayHit) = .empty,
+
+    fn Init(allocator: std.mem.Allocator) !World {
+        var world = World{ .mAllocator = allocator, .mFrameArena = .init(allocator) };
+        try world.mCollisionManager.Init(allocator);
+
+        //debris only falls onto the rest of the world, never onto itself
+        world.mCollisionManager.mLayerMatrix.SetCollides(DEBRIS_LAYER, DEBRIS_LAYER, false);
+
+        var ground_filter = MakeFilter(WORLD_CATEGORY, 0);
+        //the ground listens for the dynamic bodies landing on it
+        ground_filter.EventMask.set(DYNAMIC_CATEGORY);
+        try world.AddBody(GROUND_SHAPE, GROUND_POSITION, 0, ground_filter);
+        return world;
+    }
+
+    fn Deinit(self: *World) void {
+        self.mShapes.deinit(self.mAllocator);
+        self.mFilters.deinit(self.mAllocator);
+        self.mBodies.Deinit(self.mAllocator);
+        self.mProxies.deinit(self.mAllocator);
+        self.mCollisionManager.Deinit(self.mAllocator);
+        self.mRays.deinit(self.mAllocator);
+        self.mHits.deinit(self.mAllocator);
+        self.mFrameArena.deinit();
+    }
+
+    fn AddBody(self: *World, shape: Shape, position: Vec3(f32), inv_mass: f32, filter: CollisionFilter) !void {
+        const index = self.mShapes.items.len;
+        try self.mShapes.append(self.mAllocator, shape);
+        try self.mFilters.append(self.mAllocator, filter);
+        try self.mBodies.Resize(self.mAllocator, index + 1);
+        self.mBodies.SetBody(index, position, Vec3(f32).FromScalar(0), Vec3(f32).FromScalar(0), inv_mass);
+    }
+
+    //what SolveBlocking reads and writes, entity ids are body indices
+    pub fn GetBody(self: *World, entity_id: Entity.Type) ?ContactSolver.SolverBody {
+        return .{
+            .Velocity = self.mBodies.GetVelocity(entity_id),
+            .PositionCorrection = Vec3(f32).FromScalar(0),
+            .InvMass = self.mBodies.InvMass.items[entity_id],
+        };
+    }
+
+    pub fn SetBody(self: *World, entity_id: Entity.Type, body: ContactSolver.SolverBody) void {
+        const position = self.mBodies.GetPosition(entity_id).AddVec(body.PositionCorrection);
+        self.mBodies.SetBody(entity_id, position, body.Velocity, Vec3(f32).FromScalar(0), body.InvMass);
+    }
+
+    /// One fixed step of SUB_STEPS substeps followed by the scene queries. Returns the most contacts of a substep
+    fn Step(self: *World, io: std.Io, pool: *WorkerPool, times: *PhaseTimes, total_pairs: *usize, total_contacts: *usize) !usize {
+        self.mCollisionManager.StartFrame();
+
+        var max_contacts: usize = 0;
+        for (0..SUB_STEPS) |_| {
+            defer _ = self.mFrameArena.reset(.retain_capacity);
+            const contacts = try self.Substep(io, pool, times);
+            total_pairs.* += self.mCollisionManager.GetPairCount();
+            total_contacts.* += contacts;
+            max_contacts = @max(max_contacts, contacts);
+            self.mCollisionManager.EndStep();
+        }
+
+        //solid ground and bodies only, debris and triggers are left out like a gameplay ground probe would
+        var timer = BenchUtils.Timer.Start(io);
+        var filter: SceneQueries.QueryFilter = .default;
+        filter.LayerMask.unset(DEBRIS_LAYER);
+        filter.IncludeTriggers = false;
+        SceneQueries.RayCastBatch(&self.mCollisionManager, pool, self.mRays.items, 2 * QUERY_HEIGHT, filter, self.mHits.items);
+        times.Queries += timer.ReadMs();
+
+        return max_contacts;
+    }
+
+    /// One substep, returns the number of contacts
+    fn Substep(self: *World, io: std.Io, pool: *WorkerPool, times: *PhaseTimes) !usize {
+        const count = self.mShapes.items.len;
+
+        //integration
+        var timer = BenchUtils.Timer.Start(io);
+        for (0..count) |i| {
+            const inv_mass = self.mBodies.InvMass.items[i];
+            self.mBodies.ForceY.items[i] = if (inv_mass != 0) GRAVITY / inv_mass else 0;
+        }
+        Integrator.Integrate(&self.mBodies, SUB_STEP_DT);
+        times.Integration += timer.ReadMs();
+
+        //gather, the headless stand in for reading the collider components
+        timer.Reset();
+        try self.mProxies.resize(self.mAllocator, count);
+        for (self.mShapes.items, self.mFilters.items, self.mProxies.items, 0..) |shape, filter, *proxy, i| {
+            proxy.* = .{ .mEntityID = @intCast(i), .mShape = shape, .mPosition = self.mBodies.GetPosition(i), .mFilter = filter };
+        }
+        times.Gather += timer.ReadMs();
+
+        //broadphase, SetProxies builds the BVH the pairs and the scene queries run against
+        timer.Reset();
+        try self.mCollisionManager.SetProxies(self.mAllocator, NO_SCENE, self.mProxies.items);
+        try self.mCollisionManager.FindPairs(self.mAllocator);
+        times.Broadphase += timer.ReadMs();
+
+        //narrowphase, contact recording and the collision events
+        timer.Reset();
+        try self.mCollisionManager.FindContacts(self.mAllocator, pool);
+        times.Narrowphase += timer.ReadMs();
+
+        //solver, including the warm start lookups and writing the results back
+        timer.Reset();
+        try self.mCollisionManager.SolveBlocking(self.mAllocator, self.mFrameArena.allocator(), pool, self);
+        times.Solver += timer.ReadMs();
+
+        return self.mCollisionManager.GetContactCount();
+    }
+
+    fn BuildQueries(self: *World) !void {
+        try self.mRays.resize(self.mAllocator, QUERY_GRID * QUERY_GRID);
+        try self.mHits.resize(self.mAllocator, QUERY_GRID * QUERY_GRID);
+        for (self.mRays.items, 0..) |*ray, i| {
+            ray.* = .{
+                .Origin = .{
+                    .x = @as(f32, @floatFromInt(i % QUERY_GRID)) * 2 - @as(f32, QUERY_GRID),
+                    .y = QUERY_HEIGHT,
+                    .z = @as(f32, @floatFromInt(i / QUERY_GRID)) * 2 - @as(f32, QUERY_GRID),
+                },
+                .Direction = .{ .x = 0, .y = -1, .z = 0 },
+            };
+        }
+    }
+};
+
+fn MakeFilter(category: usize, layer: CollisionLayers.Layer) CollisionFilter {
+    var filter: CollisionFilter = .default;
+    filter.CategoryMask.set(category);
+    filter.RespondMask = .initFull();
+    filter.Layer = layer;
+    return filter;
+}
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+
+    var steps: usize = DEFAULT_STEPS;
+    var thread_count: ?usize = null;
+    var json_path: []const u8 = DEFAULT_JSON_PATH;
+
+    var flags = BenchUtils.FlagIterator.Init(try init.minimal.args.toSlice(init.arena.allocator()));
+    while (try flags.Next()) |flag| {
+        if (flag.Is("--steps")) {
+            steps = try std.fmt.parseInt(usize, flag.Value, 10);
+        } else if (flag.Is("--threads")) {
+            thread_count = try std.fmt.parseInt(usize, flag.Value, 10);
+        } else if (flag.Is("--json")) {
+            json_path = flag.Value;
+        } else {
+            return flag.Unknown();
+        }
+    }
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, if (thread_count) |threads| @max(threads, 1) - 1 else null);
+    defer pool.Deinit(allocator);
+
+    var results: [SCENES.len]SceneResult = undefined;
+
+    std.debug.print("threads: {d}, steps: {d}\n", .{ pool.GetThreadCount(), steps });
+    std.debug.print("{s:>16} {s:>8} {s:>10} {s:>10} {s:>10} {s:>10} {s:>10} {s:>10} {s:>10} {s:>10} {s:>10} {s:>10}\n", .{ "scene", "bodies", "gather ms", "broad ms", "narrow ms", "solver ms", "integ ms", "query ms", "total ms", "pairs", "contacts", "events" });
+
+    for (SCENES, &results) |scene, *result| {
+        var world = try World.Init(allocator);
+        defer world.Deinit();
+
+        try scene.BuildFn(&world);
+        try world.BuildQueries();
+
+        var times: PhaseTimes = .{};
+        var total_pairs: usize = 0;
+        var total_contacts: usize = 0;
+        var total_events: usize = 0;
+        var max_contacts: usize = 0;
+        for (0..steps) |_| {
+            max_contacts = @max(max_contacts, try world.Step(init.io, &pool, &times, &total_pairs, &total_contacts));
+            total_events += world.mCollisionManager.GetCollisionEvents().len;
+        }
+        BenchUtils.DoNotOptimize(world.mBodies.GetPosition(world.mShapes.items.len / 2));
+        BenchUtils.DoNotOptimize(world.mHits.items[world.mHits.items.len / 2]);
+
+        const step_count: f64 = @floatFromInt(steps);
+        const substep_count: f64 = @floatFromInt(steps * SUB_STEPS);
+        result.* = .{
+            .Name = scene.Name,
+            .Bodies = world.mShapes.items.len,
+            .Steps = steps,
+            .GatherMs = times.Gather / step_count,
+            .BroadphaseMs = times.Broadphase / step_count,
+            .NarrowphaseMs = times.Narrowphase / step_count,
+            .SolverMs = times.Solver / step_count,
+            .IntegrationMs = times.Integration / step_count,
+            .QueriesMs = times.Queries / step_count,
+            .TotalMs = (times.Gather + times.Broadphase + times.Narrowphase + times.Solver + times.Integration + times.Queries) / step_count,
+            .AvgPairs = @as(f64, @floatFromInt(total_pairs)) / substep_count,
+            .AvgContacts = @as(f64, @floatFromInt(total_contacts)) / substep_count,
+            .MaxContacts = max_contacts,
+            .AvgEvents = @as(f64, @floatFromInt(total_events)) / step_count,
+        };
+
+        std.debug.print("{s:>16} {d:>8} {d:>10.3} {d:>10.3} {d:>10.3} {d:>10.3} {d:>10.3} {d:>10.3} {d:>10.3} {d:>10.0} {d:>10.0} {d:>10.0}\n", .{
+            result.Name,
+            result.Bodies,
+            result.GatherMs,
+            result.BroadphaseMs,
+            result.NarrowphaseMs,
+            result.SolverMs,
+            result.IntegrationMs,
+            result.QueriesMs,
+            result.TotalMs,
+            result.AvgPairs,
+            result.AvgContacts,
+            result.AvgEvents,
+        });
+    }
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    var write_stream: std.json.Stringify = .{ .writer = &out.writer, .options = .{ .whitespace = .indent_2 } };
+    try write_stream.write(Report{ .Threads = pool.GetThreadCount(), .Scenes = &results });
+
+    const file = try std.Io.Dir.cwd().createFile(init.io, json_path, .{ .read = false, .truncate = true });
+    defer file.close(init.io);
+    try file.writeStreamingAll(init.io, out.written());
+    std.debug.print("wrote {s}\n", .{json_path});
+}
+
+/// 20 boxes wide at the base, one less per row, every box resting on the two below it
+fn BuildBoxPyramid(world: *World) !void {
+    const base: usize = 20;
+    const half = Vec3(f32).FromScalar(0.5);
+    for (0..base) |row| {
+        for (0..base - row) |i| {
+            const x = @as(f32, @floatFromInt(i)) + @as(f32, @floatFromInt(row)) * 0.5 - @as(f32, @floatFromInt(base)) * 0.5;
+            const y = 0.5 + @as(f32, @floatFromInt(row));
+            try world.AddBody(.{ .Box = half }, .{ .x = x, .y = y, .z = 0 }, 1.0, MakeFilter(DYNAMIC_CATEGORY, 0));
+        }
+    }
+}
+
+/// 2000 spheres dropped in layers from a jittered grid so they land over many steps. Every other
+/// layer is debris that the layer matrix keeps from touching other debris, and four trigger zones
+/// on the ground report the spheres passing through them
+fn BuildSphereRain(world: *World) !void {
+    var prng = std.Random.DefaultPrng.init(0x5eed);
+    const random = prng.random();
+    for (0..5) |layer| {
+        const filter = MakeFilter(DYNAMIC_CATEGORY, if (layer % 2 == 1) DEBRIS_LAYER else 0);
+        for (0..20) |x| {
+            for (0..20) |z| {
+                try world.AddBody(.{ .Sphere = 0.3 }, .{
+                    .x = @as(f32, @floatFromInt(x)) - 10 + random.float(f32) * 0.4,
+                    .y = 5 + @as(f32, @floatFromInt(layer)) * 4 + random.float(f32),
+                    .z = @as(f32, @floatFromInt(z)) - 10 + random.float(f32) * 0.4,
+                }, 1.0 / (0.5 + random.float(f32)), filter);
+            }
+        }
+    }
+
+    var trigger_filter = MakeFilter(WORLD_CATEGORY, 0);
+    trigger_filter.IsTrigger = true;
+    trigger_filter.EventMask.set(DYNAMIC_CATEGORY);
+    for (0..4) |quadrant| {
+        try world.AddBody(.{ .Box = .{ .x = 4, .y = 1, .z = 4 } }, .{
+            .x = if (quadrant & 1 != 0) 5 else -5,
+            .y = 1,
+            .z = if (quadrant & 2 != 0) 5 else -5,
+        }, 0, trigger_filter);
+    }
+}
+
+/// 64 chains of 16 capsules stood up end to end. There are no joints so the links are only held
+/// together by their contacts, which is what a ragdoll falling in a heap looks like to the narrowphase
+fn BuildChainedBodies(world: *World) !void {
+    const link = Shape{ .Capsule = .{ .Radius = 0.2, .HalfHeight = 0.3 } };
+    for (0..8) |x| {
+        for (0..8) |z| {
+            for (0..16) |i| {
+                try world.AddBody(link, .{
+                    .x = @as(f32, @floatFromInt(x)) * 2 - 8 + @as(f32, @floatFromInt(i % 2)) * 0.05,
+                    .y = 0.5 + @as(f32, @floatFromInt(i)) * 0.99,
+                    .z = @as(f32, @floatFromInt(z)) * 2 - 8,
+                }, 1.0, MakeFilter(DYNAMIC_CATEGORY, 0));
+            }
+        }
+    }
+}
@@ -0,0 +1,162 @@
+//! Cost of the SDF ray marcher on the cpu backend over a wall of text.
+//!
+//! 10k glyphs are laid out in lines on a plane in front of the camera, about the worst case for
+//! the marcher since every step of every ray used to evaluate every glyph. The frame is rendered
+//! once marching every object, then through the SDFObjectBVH, then with the objects binned into
+//! screen tiles by SDFTileBins. Build times are reported on their own since the renderer pays them
+//! once per frame on the cpu.
+//!
+//! Arguments: --size N (square image side, default 96), --threads N (default one per cpu)
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const BVH = IM.BVH;
+const CPURayMarcher = IM.CPURayMarcher;
+const SDFObjectBVH = IM.SDFObjectBVH;
+const SDFTileBins = IM.SDFTileBins;
+const WorkerPool = IM.WorkerPool;
+const GlyphData = IM.GlyphData;
+const SurfShadingData = IM.SurfShadingData;
+const MedShadingData = IM.MedShadingData;
+
+const GLYPH_COUNT: usize = 10_000;
+const GLYPHS_PER_LINE: usize = 100;
+const GLYPH_ADVANCE: f32 = 0.1;
+const LINE_HEIGHT: f32 = 0.14;
+const TEXT_DEPTH: f32 = -8;
+
+const DEFAULT_SIZE: u32 = 96;
+const BVH_REPEATS: usize = 20;
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+
+    var size: u32 = DEFAULT_SIZE;
+    var thread_count: ?usize = null;
+
+    var flags = BenchUtils.FlagIterator.Init(try init.minimal.args.toSlice(init.arena.allocator()));
+    while (try flags.Next()) |flag| {
+        if (flag.Is("--size")) {
+            size = try std.fmt.parseInt(u32, flag.Value, 10);
+        } else if (flag.Is("--threads")) {
+            thread_count = try std.fmt.parseInt(usize, flag.Value, 10);
+        } else {
+            return flag.Unknown();
+        }
+    }
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, if (thread_count) |threads| @max(threads, 1) - 1 else null);
+    defer pool.Deinit(allocator);
+
+    const glyphs = try allocator.alloc(GlyphData, GLYPH_COUNT);
+    defer allocator.free(glyphs);
+    BuildTextWall(glyphs);
+
+    const surf_shadings = [_]SurfShadingData{.{
+        .Color = .{ 1, 1, 1, 1 },
+        .TextureUV0 = .{ 0, 0 },
+        .TextureUV1 = .{ 1, 1 },
+        .TilingFactor = 1,
+        .Texturehandle = 0,
+        .SiblingShading = 0,
+    }};
+    const med_shadings = [_]MedShadingData{.{ .Absorption = .{ 0, 0, 0 }, .Scattering = .{ 0, 0, 0 } }};
+    const textures: CPURayMarcher.TextureArray = .empty;
+
+    //the text block is 10 units wide, a 90 degree view at this depth sees 16
+    const ray_scale = 2.0 / @as(f32, @floatFromInt(size));
+    var frame = CPURayMarcher.Frame{
+        .Camera = .{
+            .mPosition = .{ 0, 0, 0 },
+            .mPerspectiveFar = 100,
+            .mRotation = .{ 1, 0, 0, 0 },
+            .mRayScale = .{ ray_scale, -ray_scale },
+            .mRayOffset = .{ -1, 1 },
+            .mQuadsCount = 0,
+            .mGlyphsCount = GLYPH_COUNT,
+            .mViewportWidth = @floatFromInt(size),
+            .mViewportHeight = @floatFromInt(size),
+        },
+        .Quads = &.{},
+        .Glyphs = glyphs,
+        .SurfShadings = &surf_shadings,
+        .MedShadings = &med_shadings,
+        .Textures = &textures,
+    };
+
+    var image: CPURayMarcher.Image = .empty;
+    try image.Init(allocator, size, size);
+    defer image.Deinit(allocator);
+
+    var bvh: BVH = .empty;
+    defer bvh.Deinit(allocator);
+
+    var timer = BenchUtils.Timer.Start(init.io);
+    for (0..BVH_REPEATS) |_| {
+        try SDFObjectBVH.Build(&bvh, allocator, allocator, &.{}, glyphs);
+    }
+    const build_ms = timer.ReadMs() / @as(f64, BVH_REPEATS);
+
+    std.debug.print("threads: {d}, glyphs: {d}, image: {d}x{d}, bvh nodes: {d}\n", .{ pool.GetThreadCount(), GLYPH_COUNT, size, size, bvh.GetNodes().len });
+    std.debug.print("{s:>12} {s:>12} {s:>12} {s:>12}\n", .{ "mode", "build ms", "frame ms", "ns / pixel" });
+
+    const pixel_count: f64 = @floatFromInt(@as(usize, size) * size);
+
+    image.Clear(.{ .x = 0, .y = 0, .z = 0, .w = 0 });
+    timer.Reset();
+    CPURayMarcher.Render(&pool, frame, &image);
+    const brute_ms = timer.ReadMs();
+    BenchUtils.DoNotOptimize(image.GetPixel(size / 2, size / 2));
+    std.debug.print("{s:>12} {s:>12} {d:>12.2} {d:>12.1}\n", .{ "every object", "-", brute_ms, brute_ms * std.time.ns_per_ms / pixel_count });
+
+    frame.Nodes = bvh.GetNodes();
+    frame.Items = bvh.GetItems();
+    image.Clear(.{ .x = 0, .y = 0, .z = 0, .w = 0 });
+    timer.Reset();
+    CPURayMarcher.Render(&pool, frame, &image);
+    const bvh_ms = timer.ReadMs();
+    BenchUtils.DoNotOptimize(image.GetPixel(size / 2, size / 2));
+    std.debug.print("{s:>12} {d:>12.3} {d:>12.2} {d:>12.1}\n", .{ "bvh", build_ms, bvh_ms, bvh_ms * std.time.ns_per_ms / pixel_count });
+
+    var bins: SDFTileBins = .empty;
+    defer bins.Deinit(allocator);
+
+    timer.Reset();
+    for (0..BVH_REPEATS) |_| {
+        try bins.Build(allocator, allocator, frame.Camera, size, size, &.{}, glyphs);
+    }
+    const bins_build_ms = timer.ReadMs() / @as(f64, BVH_REPEATS);
+
+    frame.Bins = &bins;
+    image.Clear(.{ .x = 0, .y = 0, .z = 0, .w = 0 });
+    timer.Reset();
+    CPURayMarcher.Render(&pool, frame, &image);
+    const bins_ms = timer.ReadMs();
+    BenchUtils.DoNotOptimize(image.GetPixel(size / 2, size / 2));
+    std.debug.print("{s:>12} {d:>12.3} {d:>12.2} {d:>12.1}\n", .{ "tile bins", bins_build_ms, bins_ms, bins_ms * std.time.ns_per_ms / pixel_count });
+}
+
+/// Lines of glyphs of slightly varying width centered in front of the camera, like a page of HUD text
+fn BuildTextWall(glyphs: []GlyphData) void {
+    const line_count = glyphs.len / GLYPHS_PER_LINE;
+    const left = -@as(f32, @floatFromInt(GLYPHS_PER_LINE)) * GLYPH_ADVANCE * 0.5;
+    const top = @as(f32, @floatFromInt(line_count)) * LINE_HEIGHT * 0.5;
+
+    for (glyphs, 0..) |*glyph, i| {
+        const column: f32 = @floatFromInt(i % GLYPHS_PER_LINE);
+        const line: f32 = @floatFromInt(i / GLYPHS_PER_LINE);
+        const width = GLYPH_ADVANCE * (0.25 + 0.15 * @as(f32, @floatFromInt(i % 3)));
+        glyph.* = .{
+            .Rotation = .{ 1, 0, 0, 0 },
+            .Position = .{ left + column * GLYPH_ADVANCE, top - line * LINE_HEIGHT, TEXT_DEPTH },
+            .HalfExtents = .{ width, LINE_HEIGHT * 0.35, 0.001 },
+            .PlaneCenter = .{ GLYPH_ADVANCE * 0.5, 0 },
+            .AtlasUV0 = .{ 0, 0 },
+            .AtlasUV1 = .{ 1, 1 },
+            .AtlasShadingHandle = 0,
+            .TextureShadingFlags = 0,
+        };
+    }
+}
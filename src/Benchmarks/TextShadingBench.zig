@@ -0,0 +1,193 @@
+//! Size of the text buffers when every glyph carries its own shading against one shared per text.
+//!
+//! 50k glyphs are packed as HUD labels of 20 glyphs, first the old way with an atlas shading per
+//! glyph next to a 64 byte glyph, then the way Renderer2D packs them now with the atlas uvs on an
+//! 80 byte glyph and two shadings for the whole label. Reports the bytes of each buffer, which is
+//! also what a full upload of them costs, and how long packing them takes.
+//!
+//! Arguments: --texts N (number of labels, default 2500), --glyphs N (glyphs per label, default 20)
+const std = @import("std");
+const IM = @import("IMHeadless");
+const BenchUtils = @import("BenchUtils.zig");
+
+const GlyphData = IM.GlyphData;
+const SurfShadingData = IM.SurfShadingData;
+
+const PACK_REPEATS: usize = 20;
+
+/// GlyphData before the atlas uvs moved onto it, each glyph pointed at its own atlas shading
+const PerGlyphShadingGlyph = extern struct {
+    Rotation: @Vector(4, f32),
+    Position: @Vector(3, f32),
+    HalfExtents: @Vector(3, f32),
+    PlaneCenter: @Vector(2, f32),
+    AtlasShadingHandle: u32,
+    TextureShadingFlags: u32,
+};
+
+const Buffers = struct {
+    GlyphBytes: usize,
+    ShadingBytes: usize,
+    PackMs: f64,
+
+    fn Total(self: Buffers) usize {
+        return self.GlyphBytes + self.ShadingBytes;
+    }
+};
+
+pub fn main(init: std.process.Init) !void {
+    const allocator = init.gpa;
+
+    var text_count: usize = 2500;
+    var glyphs_per_text: usize = 20;
+
+    var flags = BenchUtils.FlagIterator.Init(try init.minimal.args.toSlice(init.arena.allocator()));
+    while (try flags.Next()) |flag| {
+        if (flag.Is("--texts")) {
+            text_count = try std.fmt.parseInt(usize, flag.Value, 10);
+        } else if (flag.Is("--glyphs")) {
+            glyphs_per_text = try std.fmt.parseInt(usize, flag.Value, 10);
+        } else {
+            return flag.Unknown();
+        }
+    }
+
+    const glyph_count = text_count * glyphs_per_text;
+    var timer = BenchUtils.Timer.Start(init.io);
+
+    //per glyph shading, the texture shading of the label followed by an atlas shading for every glyph
+    const old_glyphs = try allocator.alloc(PerGlyphShadingGlyph, glyph_count);
+    defer allocator.free(old_glyphs);
+    const old_shadings = try allocator.alloc(SurfShadingData, text_count * (1 + glyphs_per_text));
+    defer allocator.free(old_shadings);
+
+    timer.Reset();
+    for (0..PACK_REPEATS) |_| {
+        for (0..text_count) |text| {
+            const shading_start: u32 = @intCast(text * (1 + glyphs_per_text));
+            old_shadings[shading_start] = TextShading(text);
+            for (0..glyphs_per_text) |g| {
+                const glyph_ind = text * glyphs_per_text + g;
+                const atlas_handle = shading_start + 1 + @as(u32, @intCast(g));
+                old_shadings[atlas_handle] = AtlasShading(shading_start, AtlasUV0(glyph_ind), AtlasUV1(glyph_ind));
+                old_glyphs[glyph_ind] = .{
+                    .Rotation = .{ 1, 0, 0, 0 },
+                    .Position = GlyphPosition(text, g),
+                    .HalfExtents = .{ 0.04, 0.05, 0.001 },
+                    .PlaneCenter = .{ 0.05, 0 },
+                    .AtlasShadingHandle = atlas_handle,
+                    .TextureShadingFlags = 0,
+                };
+            }
+        }
+        BenchUtils.DoNotOptimize(old_glyphs[glyph_count / 2]);
+    }
+    const old = Buffers{
+        .GlyphBytes = std.mem.sliceAsBytes(old_glyphs).len,
+        .ShadingBytes = std.mem.sliceAsBytes(old_shadings).len,
+        .PackMs = timer.ReadMs() / @as(f64, PACK_REPEATS),
+    };
+
+    //shared shading, the texture and atlas shading of the label and the uvs on the glyph
+    const new_glyphs = try allocator.alloc(GlyphData, glyph_count);
+    defer allocator.free(new_glyphs);
+    const new_shadings = try allocator.alloc(SurfShadingData, text_count * 2);
+    defer allocator.free(new_shadings);
+
+    timer.Reset();
+    for (0..PACK_REPEATS) |_| {
+        for (0..text_count) |text| {
+            const shading_start: u32 = @intCast(text * 2);
+            new_shadings[shading_start] = TextShading(text);
+            new_shadings[shading_start + 1] = AtlasShading(shading_start, .{ 0, 0 }, .{ 1, 1 });
+            for (0..glyphs_per_text) |g| {
+                const glyph_ind = text * glyphs_per_text + g;
+                new_glyphs[glyph_ind] = .{
+                    .Rotation = .{ 1, 0, 0, 0 },
+                    .Position = GlyphPosition(text, g),
+                    .HalfExtents = .{ 0.04, 0.05, 0.001 },
+                    .PlaneCenter = .{ 0.05, 0 },
+                    .AtlasUV0 = AtlasUV0(glyph_ind),
+                    .AtlasUV1 = AtlasUV1(glyph_ind),
+                    .AtlasShadingHandle = shading_start + 1,
+                    .TextureShadingFlags = 0,
+                };
+            }
+        }
+        BenchUtils.DoNotOptimize(new_glyphs[glyph_count / 2]);
+    }
+    const shared = Buffers{
+        .GlyphBytes = std.mem.sliceAsBytes(new_glyphs).len,
+        .ShadingBytes = std.mem.sliceAsBytes(new_shadings).len,
+        .PackMs = timer.ReadMs() / @as(f64, PACK_REPEATS),
+    };
+
+    std.debug.print("texts: {d}, glyphs: {d}, glyph record: {d} -> {d} bytes, shading record: {d} bytes\n", .{
+        text_count,
+        glyph_count,
+        @sizeOf(PerGlyphShadingGlyph),
+        @sizeOf(GlyphData),
+        @sizeOf(SurfShadingData),
+    });
+    std.debug.print("{s:>18} {s:>12} {s:>12} {s:>12} {s:>12}\n", .{ "mode", "glyph KiB", "shading KiB", "total KiB", "pack ms" });
+    PrintRow("per glyph shading", old);
+    PrintRow("shared shading", shared);
+
+    const old_total: f64 = @floatFromInt(old.Total());
+    const new_total: f64 = @floatFromInt(shared.Total());
+    const old_shading: f64 = @floatFromInt(old.ShadingBytes);
+    const new_shading: f64 = @floatFromInt(shared.ShadingBytes);
+    std.debug.print("shading buffer {d:.1}% smaller, glyph + shading buffers {d:.1}% smaller\n", .{
+        (1 - new_shading / old_shading) * 100,
+        (1 - new_total / old_total) * 100,
+    });
+}
+
+fn PrintRow(name: []const u8, buffers: Buffers) void {
+    std.debug.print("{s:>18} {d:>12.1} {d:>12.1} {d:>12.1} {d:>12.3}\n", .{
+        name,
+        @as(f64, @floatFromInt(buffers.GlyphBytes)) / 1024,
+        @as(f64, @floatFromInt(buffers.ShadingBytes)) / 1024,
+        @as(f64, @floatFromInt(buffers.Total())) / 1024,
+        buffers.PackMs,
+    });
+}
+
+fn TextShading(text: usize) SurfShadingData {
+    const shade: f32 = @floatFromInt(text % 7);
+    return .{
+        .Color = .{ 1, shade / 7, 1, 1 },
+        .TextureUV0 = .{ 0, 0 },
+        .TextureUV1 = .{ 1, 1 },
+        .TilingFactor = 1,
+        .Texturehandle = 0,
+        .SiblingShading = std.math.maxInt(u32),
+    };
+}
+
+fn AtlasShading(texture_shading: u32, uv0: @Vector(2, f32), uv1: @Vector(2, f32)) SurfShadingData {
+    return .{
+        .Color = .{ 1, 1, 1, 1 },
+        .TextureUV0 = uv0,
+        .TextureUV1 = uv1,
+        .TilingFactor = 1,
+        .Texturehandle = 1,
+        .SiblingShading = texture_shading,
+    };
+}
+
+//a 16x16 atlas of glyph cells
+fn AtlasUV0(glyph_ind: usize) @Vector(2, f32) {
+    const cell = glyph_ind % 256;
+    return .{ @as(f32, @floatFromInt(cell % 16)) / 16, @as(f32, @floatFromInt(cell / 16)) / 16 };
+}
+
+fn AtlasUV1(glyph_ind: usize) @Vector(2, f32) {
+    return AtlasUV0(glyph_ind) + @as(@Vector(2, f32), @splat(1.0 / 16.0));
+}
+
+fn GlyphPosition(text: usize, glyph: usize) @Vector(3, f32) {
+    const row: f32 = @floatFromInt(text / 50);
+    const column: f32 = @floatFromInt(text % 50);
+    return .{ column * 2.5 + @as(f32, @floatFromInt(glyph)) * 0.1, row * 0.2, -8 };
+}
@@ -10,7 +10,7 @@ const TextAsset = @This();
 
 const KerningsT = std.AutoHashMap(u16, f32);
 
-const GlyphInfo = struct {
+pub const GlyphInfo = struct {
     mAtlasTexel0: Vec2(f32) = .{ .x = -1, .y = -1 }, //top-left
     mAtlasTexel1: Vec2(f32) = .{ .x = -1, .y = -1 }, //bottom-right
     mPlaneMin: Vec2(f32) = .{ .x = -1, .y = -1 }, //left,top
@@ -2,13 +2,21 @@ const std = @import("std");
 const EngineContext = @import("EngineContext.zig");
 const AllocType = EngineContext.AllocType;
 
+/// Threads that run engine work across frame boundaries (the physics thread) point this at their own arena.
+/// The main thread resets the frame arena at the end of every frame while they may still be using it
+pub threadlocal var FrameArenaOverride: ?*std.heap.ArenaAllocator = null;
+
+fn GetFrameArena(engine_context: *EngineContext) *std.heap.ArenaAllocator {
+    return FrameArenaOverride orelse &engine_context._Internal.FrameArena;
+}
+
 pub inline fn MakeAllocatorVTable(comptime alloc_type: AllocType) type {
     const fns = struct {
         fn alloc(context: *anyopaque, len: usize, alignment: std.mem.Alignment, ret_addr: usize) ?[*]u8 {
             const engine_context: *EngineContext = @ptrCast(@alignCast(context));
             const allocator = switch (alloc_type) {
                 .Engine => engine_context._Internal.EngineGPA.allocator(),
-                .Frame => engine_context._Internal.FrameArena.allocator(),
+                .Frame => GetFrameArena(engine_context).allocator(),
             };
             return allocator.vtable.alloc(allocator.ptr, len, alignment, ret_addr);
         }
@@ -16,7 +24,7 @@ pub inline fn MakeAllocatorVTable(comptime alloc_type: AllocType) type {
             const engine_context: *EngineContext = @ptrCast(@alignCast(context));
             const allocator = switch (alloc_type) {
                 .Engine => engine_context._Internal.EngineGPA.allocator(),
-                .Frame => engine_context._Internal.FrameArena.allocator(),
+                .Frame => GetFrameArena(engine_context).allocator(),
             };
             return allocator.vtable.resize(allocator.ptr, memory, alignment, new_len, return_address);
         }
@@ -24,7 +32,7 @@ pub inline fn MakeAllocatorVTable(comptime alloc_type: AllocType) type {
             const engine_context: *EngineContext = @ptrCast(@alignCast(context));
             const allocator = switch (alloc_type) {
                 .Engine => engine_context._Internal.EngineGPA.allocator(),
-                .Frame => engine_context._Internal.FrameArena.allocator(),
+                .Frame => GetFrameArena(engine_context).allocator(),
             };
             return allocator.vtable.remap(allocator.ptr, memory, alignment, new_len, return_address);
         }
@@ -32,7 +40,7 @@ pub inline fn MakeAllocatorVTable(comptime alloc_type: AllocType) type {
             const engine_context: *EngineContext = @ptrCast(@alignCast(context));
             const allocator = switch (alloc_type) {
                 .Engine => engine_context._Internal.EngineGPA.allocator(),
-                .Frame => engine_context._Internal.FrameArena.allocator(),
+                .Frame => GetFrameArena(engine_context).allocator(),
             };
             allocator.vtable.free(allocator.ptr, old_memory, alignment, return_address);
         }
@@ -81,6 +81,7 @@ pub fn Run(self: *Application) !void {
     const first_ns = first_duration.toNanoseconds();
     const first_seconds_f64 = @as(f64, @floatFromInt(first_ns)) / @as(f64, std.time.ns_per_s);
     self.mEngineContext.mDT = @floatCast(first_seconds_f64);
+    self.UpdateWorkDT();
 
     while (self.mEngineContext.mIsRunning) {
         defer Tracy.FrameMark();
@@ -98,9 +99,16 @@ pub fn Run(self: *Application) !void {
         const ns = duration.toNanoseconds();
         const seconds_f64 = @as(f64, @floatFromInt(ns)) / @as(f64, std.time.ns_per_s);
         self.mEngineContext.mDT = @floatCast(seconds_f64);
+        self.UpdateWorkDT();
     }
 }
 
+fn UpdateWorkDT(self: *Application) void {
+    const wait_ns = self.mEngineContext.mRenderer.mPlatform.TakeSwapchainWaitNs();
+    const wait_seconds: f32 = @floatCast(@as(f64, @floatFromInt(wait_ns)) / @as(f64, std.time.ns_per_s));
+    self.mEngineContext.mWorkDT = @max(self.mEngineContext.mDT - wait_seconds, 0);
+}
+
 fn SDLLogCallback(_: ?*anyopaque, category: c_int, priority: sdl.SDL_LogPriority, message: [*c]const u8) callconv(.c) void {
     const category_str = switch (category) {
         sdl.SDL_LOG_CATEGORY_GPU => "GPU",
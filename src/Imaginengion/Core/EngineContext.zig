@@ -11,6 +11,7 @@ const PhysicsManager = @import("../Physics/PhysicsManager.zig");
 const SceneManager = @import("../Scene/SceneManager.zig");
 const EngineContext = @This();
 const EngineStats = @import("EngineStats.zig");
+const WorkerPool = @import("WorkerPool.zig");
 const Serializer = @import("../Serializer/Serializer.zig");
 const ImguiManager = @import("../Imgui/Imgui.zig");
 
@@ -53,6 +54,8 @@ pub const WorldType = enum {
 };
 
 mDT: f32 = 1.0 / 60.0,
+/// mDT without the time the frame sat blocked on the swapchain, what its work cost
+mWorkDT: f32 = 1.0 / 60.0,
 
 mAppWindow: Window = .{},
 
@@ -76,6 +79,8 @@ mSerializer: Serializer = .empty,
 
 mEngineStats: EngineStats = .{},
 
+mWorkerPool: WorkerPool = .empty,
+
 mIsRunning: bool = true,
 
 mEnviron: std.process.Environ = undefined,
@@ -93,6 +98,8 @@ pub fn Init(self: *EngineContext, environ: std.process.Environ) !void {
 
     self.mEngineStats.AppTimer = .now(self._Internal.ThreadedIO.io(), .awake);
 
+    try self.mWorkerPool.Init(self.EngineAllocator(), null);
+
     self.mAppWindow.Init(self);
 
     try self.mAssetManager.Init(self);
@@ -112,6 +119,8 @@ pub fn DeInit(self: *EngineContext) !void {
     const zone = Tracy.ZoneInit("EngineContext::Deinit", @src());
     defer zone.Deinit();
 
+    self.mPhysicsManager.StopThread();
+
     try self.mGameWorld.Deinit(self);
     try self.mEditorWorld.Deinit(self);
     try self.mSimulateWorld.Deinit(self);
@@ -129,6 +138,8 @@ pub fn DeInit(self: *EngineContext) !void {
 
     self.mAppWindow.Deinit();
 
+    self.mWorkerPool.Deinit(self.EngineAllocator());
+
     _ = self._Internal.EngineGPA.deinit();
     self._Internal.FrameArena.deinit();
 }
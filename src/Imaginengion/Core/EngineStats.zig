@@ -26,12 +26,20 @@ pub const ShadingStats = struct {
 
 pub const RenderStats = struct {
     TotalObjects: usize = 0,
+    /// Objects outside the view frustum or the draw distance, their slots are kept but left out of the tile lists
+    CulledObjects: usize = 0,
+    SubmittedObjects: usize = 0,
+    /// Submitted objects whose transform, quad or text changed, the rest keep their slots as they are
+    RepackedObjects: usize = 0,
     OutputQuadNum: usize = 0,
     OutputGlyphNum: usize = 0,
     Shadings: ShadingStats = .{},
 
     pub fn ResetStats(self: *RenderStats) void {
         self.TotalObjects = 0;
+        self.CulledObjects = 0;
+        self.SubmittedObjects = 0;
+        self.RepackedObjects = 0;
         self.OutputQuadNum = 0;
         self.OutputGlyphNum = 0;
         self.Shadings.ResetStats();
@@ -41,6 +49,15 @@ pub const RenderStats = struct {
         const total_obj_text = try std.fmt.allocPrintSentinel(frame_allocator, "\t\tTotal Objects: {d}\n", .{self.TotalObjects}, 0);
         ImguiManager.RenderText(total_obj_text);
 
+        const culled_obj_text = try std.fmt.allocPrintSentinel(frame_allocator, "\t\tCulled Objects: {d}\n", .{self.CulledObjects}, 0);
+        ImguiManager.RenderText(culled_obj_text);
+
+        const submitted_obj_text = try std.fmt.allocPrintSentinel(frame_allocator, "\t\tSubmitted Objects: {d}\n", .{self.SubmittedObjects}, 0);
+        ImguiManager.RenderText(submitted_obj_text);
+
+        const repacked_obj_text = try std.fmt.allocPrintSentinel(frame_allocator, "\t\tRepacked Objects: {d}\n", .{self.RepackedObjects}, 0);
+        ImguiManager.RenderText(repacked_obj_text);
+
         const output_quad_text = try std.fmt.allocPrintSentinel(frame_allocator, "\t\tOutput Quad Num: {d}\n", .{self.OutputQuadNum}, 0);
         ImguiManager.RenderText(output_quad_text);
 
@@ -65,13 +82,38 @@ pub const ECSStats = struct {
     }
 };
 
+/// World transform propagation, only transforms under a dirty local transform are recomputed
+pub const TransformStats = struct {
+    Recomputed: usize = 0,
+    Skipped: usize = 0,
+
+    pub fn ResetStats(self: *TransformStats) void {
+        self.Recomputed = 0;
+        self.Skipped = 0;
+    }
+
+    pub fn Add(self: *TransformStats, other: TransformStats) void {
+        self.Recomputed += other.Recomputed;
+        self.Skipped += other.Skipped;
+    }
+
+    pub fn ImguiRender(self: TransformStats, frame_allocator: std.mem.Allocator) void {
+        const recomputed_text = std.fmt.allocPrintSentinel(frame_allocator, "\t\tRecomputed Transforms: {d}\n", .{self.Recomputed}, 0) catch return;
+        ImguiManager.RenderText(recomputed_text);
+        const skipped_text = std.fmt.allocPrintSentinel(frame_allocator, "\t\tSkipped Transforms: {d}\n", .{self.Skipped}, 0) catch return;
+        ImguiManager.RenderText(skipped_text);
+    }
+};
+
 pub const WorldStats = struct {
     mRenderStats: RenderStats = .{},
     mECSStats: ECSStats = .{},
+    mTransformStats: TransformStats = .{},
 
     pub fn ResetStats(self: *WorldStats) void {
         self.mRenderStats.ResetStats();
         self.mECSStats.ResetStats();
+        self.mTransformStats.ResetStats();
     }
 
     pub fn ImguiRender(self: WorldStats, frame_allocator: std.mem.Allocator) void {
@@ -79,6 +121,8 @@ pub const WorldStats = struct {
         self.mRenderStats.ImguiRender(frame_allocator);
         ImguiManager.RenderText("\tECS Data: \n");
         self.mECSStats.ImguiRender(frame_allocator);
+        ImguiManager.RenderText("\tTransform Data: \n");
+        self.mTransformStats.ImguiRender(frame_allocator);
     }
 };
 
@@ -87,6 +131,14 @@ GameWorldStats: WorldStats = .{},
 EditorWorldStats: WorldStats = .{},
 SimulateWorldStats: WorldStats = .{},
 
+pub fn GetWorldStats(self: *EngineStats, world_type: EngineContext.WorldType) *WorldStats {
+    return switch (world_type) {
+        .Game => &self.GameWorldStats,
+        .Editor => &self.EditorWorldStats,
+        .Simulate => &self.SimulateWorldStats,
+    };
+}
+
 pub fn ResetStats(self: *EngineStats) void {
     self.GameWorldStats.ResetStats();
     self.EditorWorldStats.ResetStats();
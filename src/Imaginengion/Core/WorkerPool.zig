@@ -0,0 +1,177 @@
+//! A small fork-join worker pool for splitting data parallel work across threads.
+//!
+//! The pool owns a fixed set of worker threads that sleep on a futex until the
+//! calling thread publishes a job with `ParallelFor`. Work is handed out in chunks
+//! through an atomic cursor and the calling thread helps process chunks, so a pool
+//! with zero workers simply runs the job inline.
+//!
+//! Chunk boundaries only depend on the item count and chunk size, never on which
+//! thread picked up the chunk. Jobs that write only to their own chunk therefore
+//! produce the same results for any thread count.
+const std = @import("std");
+const WorkerPool = @This();
+
+const Job = struct {
+    mContext: *const anyopaque,
+    mRunFn: *const fn (context: *const anyopaque, start: usize, end: usize) void,
+    mCount: usize,
+    mChunkSize: usize,
+};
+
+pub const empty: WorkerPool = .{
+    .mThreads = &.{},
+    .mJob = undefined,
+    .mGeneration = std.atomic.Value(u32).init(0),
+    .mNextChunk = std.atomic.Value(usize).init(0),
+    .mPending = std.atomic.Value(u32).init(0),
+    .mShutdown = std.atomic.Value(bool).init(false),
+};
+
+mThreads: []std.Thread,
+mJob: Job,
+mGeneration: std.atomic.Value(u32),
+mNextChunk: std.atomic.Value(usize),
+mPending: std.atomic.Value(u32),
+mShutdown: std.atomic.Value(bool),
+
+/// Spawns the worker threads. Passing null for worker_count uses one worker
+/// per logical cpu minus the calling thread.
+pub fn Init(self: *WorkerPool, engine_allocator: std.mem.Allocator, worker_count: ?usize) !void {
+    const count = worker_count orelse ((std.Thread.getCpuCount() catch 1) -| 1);
+
+    self.mThreads = try engine_allocator.alloc(std.Thread, count);
+    errdefer engine_allocator.free(self.mThreads);
+
+    //read before any worker runs, a job published before a worker first looks must not become its baseline
+    const start_generation = self.mGeneration.load(.acquire);
+    for (self.mThreads, 0..) |*thread, i| {
+        thread.* = std.Thread.spawn(.{}, WorkerMain, .{ self, start_generation }) catch |err| {
+            self.StopThreads(self.mThreads[0..i]);
+            return err;
+        };
+    }
+}
+
+pub fn Deinit(self: *WorkerPool, engine_allocator: std.mem.Allocator) void {
+    self.StopThreads(self.mThreads);
+    engine_allocator.free(self.mThreads);
+    self.mThreads = &.{};
+}
+
+/// The number of threads that can take part in a job, including the caller.
+pub fn GetThreadCount(self: WorkerPool) usize {
+    return self.mThreads.len + 1;
+}
+
+/// Calls func(context, start, end) over [0, count) in chunks of chunk_size and
+/// blocks until every chunk has been processed.
+pub fn ParallelFor(self: *WorkerPool, count: usize, chunk_size: usize, context: anytype, comptime func: fn (@TypeOf(context), usize, usize) void) void {
+    if (count == 0) return;
+    std.debug.assert(chunk_size > 0);
+
+    const ContextT = @TypeOf(context);
+    const Wrapper = struct {
+        fn Run(ctx: *const anyopaque, start: usize, end: usize) void {
+            func(@as(*const ContextT, @ptrCast(@alignCast(ctx))).*, start, end);
+        }
+    };
+
+    //not worth waking anyone up for a single chunk
+    if (self.mThreads.len == 0 or count <= chunk_size) {
+        func(context, 0, count);
+        return;
+    }
+
+    self.mJob = .{
+        .mContext = @ptrCast(&context),
+        .mRunFn = Wrapper.Run,
+        .mCount = count,
+        .mChunkSize = chunk_size,
+    };
+    self.mNextChunk.store(0, .monotonic);
+    self.mPending.store(@intCast(self.mThreads.len), .monotonic);
+
+    _ = self.mGeneration.fetchAdd(1, .release);
+    std.Thread.Futex.wake(&self.mGeneration, std.math.maxInt(u32));
+
+    self.RunChunks();
+
+    while (self.mPending.load(.acquire) != 0) {
+        std.atomic.spinLoopHint();
+    }
+}
+
+fn RunChunks(self: *WorkerPool) void {
+    const job = self.mJob;
+    while (true) {
+        const chunk = self.mNextChunk.fetchAdd(1, .monotonic);
+        const start = chunk * job.mChunkSize;
+        if (start >= job.mCount) break;
+        job.mRunFn(job.mContext, start, @min(start + job.mChunkSize, job.mCount));
+    }
+}
+
+fn WorkerMain(self: *WorkerPool, start_generation: u32) void {
+    var seen_generation = start_generation;
+    while (true) {
+        while (self.mGeneration.load(.acquire) == seen_generation) {
+            if (self.mShutdown.load(.acquire)) return;
+            std.Thread.Futex.wait(&self.mGeneration, seen_generation);
+        }
+        seen_generation = self.mGeneration.load(.acquire);
+        if (self.mShutdown.load(.acquire)) return;
+
+        self.RunChunks();
+        _ = self.mPending.fetchSub(1, .release);
+    }
+}
+
+fn StopThreads(self: *WorkerPool, threads: []std.Thread) void {
+    self.mShutdown.store(true, .release);
+    _ = self.mGeneration.fetchAdd(1, .release);
+    std.Thread.Futex.wake(&self.mGeneration, std.math.maxInt(u32));
+    for (threads) |thread| {
+        thread.join();
+    }
+    self.mShutdown.store(false, .release);
+}
+
+test "ParallelFor covers every index once" {
+    var pool: WorkerPool = .empty;
+    try pool.Init(std.testing.allocator, 3);
+    defer pool.Deinit(std.testing.allocator);
+
+    var hits = [_]u32{0} ** 1000;
+    const Ctx = struct {
+        mHits: []u32,
+        fn Run(ctx: @This(), start: usize, end: usize) void {
+            for (ctx.mHits[start..end]) |*hit| hit.* += 1;
+        }
+    };
+    pool.ParallelFor(hits.len, 16, Ctx{ .mHits = &hits }, Ctx.Run);
+    pool.ParallelFor(hits.len, 7, Ctx{ .mHits = &hits }, Ctx.Run);
+
+    for (hits) |hit| {
+        try std.testing.expectEqual(@as(u32, 2), hit);
+    }
+}
+
+test "ParallelFor right after Init reaches workers that have not started yet" {
+    const Ctx = struct {
+        mSum: *std.atomic.Value(usize),
+        fn Run(ctx: @This(), start: usize, end: usize) void {
+            _ = ctx.mSum.fetchAdd(end - start, .monotonic);
+        }
+    };
+
+    //fresh pools every time so the job is published while the workers are still spawning
+    for (0..50) |_| {
+        var pool: WorkerPool = .empty;
+        try pool.Init(std.testing.allocator, 4);
+        defer pool.Deinit(std.testing.allocator);
+
+        var sum = std.atomic.Value(usize).init(0);
+        pool.ParallelFor(256, 1, Ctx{ .mSum = &sum }, Ctx.Run);
+        try std.testing.expectEqual(@as(usize, 256), sum.load(.monotonic));
+    }
+}
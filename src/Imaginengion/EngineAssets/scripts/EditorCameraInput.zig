@@ -30,7 +30,7 @@ pub export fn Run(engine_context: *EngineContext, allocator: *const std.mem.Allo
             const up_dir = rotation.GetUpDir();
             translation.SubEqVec(right_dir.MulScalar(mouse_delta.x * PanSpeed));
             translation.AddEqVec(up_dir.MulScalar(mouse_delta.y * PanSpeed));
-            transform_component.Translation = translation;
+            transform_component.SetTranslation(translation);
         } else if (input_context.IsMousePressed(.BUTTON_LEFT) == true) {
             //const up_dir = GetUpDirection(rotation); //yaw
             const up_dir = Vec3(f32){ .x = 0.0, .y = 1.0, .z = 0.0 }; //yaw
@@ -39,11 +39,11 @@ pub export fn Run(engine_context: *EngineContext, allocator: *const std.mem.Allo
             const yaw = Quat(f32).FromAxisAngle(up_dir, -mouse_delta.x * RotateSpeed);
             const pitch = Quat(f32).FromAxisAngle(right_dir, -mouse_delta.y * RotateSpeed);
             rotation = rotation.MulQuat(yaw).MulQuat(pitch);
-            transform_component.Rotation = rotation;
+            transform_component.SetRotation(rotation);
         } else if (input_context.IsMousePressed(.BUTTON_RIGHT) == true) {
             const forward_dir = rotation.GetForwardDir();
             translation.AddEqVec(forward_dir.MulScalar(mouse_delta.y * ZoomSpeed));
-            transform_component.Translation = translation;
+            transform_component.SetTranslation(translation);
         }
     }
 
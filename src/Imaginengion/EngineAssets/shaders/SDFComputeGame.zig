@@ -11,7 +11,10 @@ const RayMarcher = @import("IM").RayMarcher;
 const CameraUBO = SDFShared.CameraUBO;
 const QuadsSSBO = SDFShared.QuadsSSBO;
 const GlyphsSSBO = SDFShared.GlyphsSSBO;
-const ShadingSSBO = SDFShared.ShadingSSBO;
+const NO_NODES = SDFShared.NO_NODES;
+const GetTileItems = SDFShared.GetTileItems;
+const SurfShadingSSBO = SDFShared.SurfShadingSSBO;
+const MedShadingSSBO = SDFShared.MedShadingSSBO;
 const OutTexture = SDFShared.OutTexture;
 const TexturesArray = SDFShared.TexturesArray;
 
@@ -23,6 +26,10 @@ export fn main() callconv(.{ .spirv_kernel = .{ .x = 8, .y = 8, .z = 1 } }) void
     const global = spirv.global_invocation_id;
     if (global[0] >= CameraUBO.mViewportWidth or global[1] >= CameraUBO.mViewportHeight) return;
 
+    //nothing projects onto this tile so no ray of it can hit anything
+    const tile_items = GetTileItems(global[0], global[1]);
+    if (tile_items.len == 0) return;
+
     const sample = imageRead(OutTexture, u32, .{ global[0], global[1] });
     if (sample.w >= 0.999) return;
 
@@ -49,7 +56,7 @@ export fn main() callconv(.{ .spirv_kernel = .{ .x = 8, .y = 8, .z = 1 } }) void
         .FirstEdge = RayMarcher.NO_EDGE,
         .MaterialHandle = 0,
         .AccumColor = default_color,
-        .TextureUV = .{ .x = 0, .y = 0 },
+        .TextureUV = .{ .x = -1, .y = -1, .z = -1 },
         .ShapeT = .None,
     };
     marcher.mNodeCount = 1;
@@ -66,10 +73,10 @@ export fn main() callconv(.{ .spirv_kernel = .{ .x = 8, .y = 8, .z = 1 } }) void
     marcher.mNodes[0].FirstEdge = 0;
     marcher.mEdgeCount = 1;
 
-    marcher.March(QuadsSSBO.ptr, GlyphsSSBO.ptr, CameraUBO.mPerspectiveFar, TexturesArray, std.spirv.imageSampleImplicitLod);
+    marcher.March(QuadsSSBO.ptr, GlyphsSSBO.ptr, NO_NODES, tile_items, SurfShadingSSBO.ptr, CameraUBO.mPerspectiveFar, TexturesArray, std.spirv.imageSampleImplicitLod);
 
     //traverse ray tree backwards to obtain final output color
-    const march_color = marcher.GenerateColor(ShadingSSBO.ptr, TexturesArray, std.spirv.imageSampleImplicitLod);
+    const march_color = marcher.GenerateColor(SurfShadingSSBO.ptr, MedShadingSSBO.ptr, TexturesArray, std.spirv.imageSampleImplicitLod);
 
     const out_a = march_color.w + sample.w * (1.0 - march_color.w);
 
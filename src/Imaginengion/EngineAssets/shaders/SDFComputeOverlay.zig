@@ -10,7 +10,10 @@ const RayMarcher = @import("IM").RayMarcher;
 const CameraUBO = SDFShared.CameraUBO;
 const QuadsSSBO = SDFShared.QuadsSSBO;
 const GlyphsSSBO = SDFShared.GlyphsSSBO;
-const ShadingSSBO = SDFShared.ShadingSSBO;
+const NO_NODES = SDFShared.NO_NODES;
+const GetTileItems = SDFShared.GetTileItems;
+const SurfShadingSSBO = SDFShared.SurfShadingSSBO;
+const MedShadingSSBO = SDFShared.MedShadingSSBO;
 const OutTexture = SDFShared.OutTexture;
 const TexturesArray = SDFShared.TexturesArray;
 
@@ -20,6 +23,13 @@ export fn main() callconv(.{ .spirv_kernel = .{ .x = 8, .y = 8, .z = 1 } }) void
     const global = spirv.global_invocation_id;
     if (global[0] >= CameraUBO.mViewportWidth or global[1] >= CameraUBO.mViewportHeight) return;
 
+    //nothing projects onto this tile so no ray of it can hit anything
+    const tile_items = GetTileItems(global[0], global[1]);
+    if (tile_items.len == 0) {
+        std.spirv.imageWrite(OutTexture, u32, .{ global[0], global[1] }, default_color.ToVector());
+        return;
+    }
+
     const frag: @Vector(2, f32) = @Vector(2, f32){ @as(f32, @floatFromInt(global[0])) + 0.5, @as(f32, @floatFromInt(global[1])) + 0.5 };
 
     const uv = Vec2(f32).FromVector(CameraUBO.mRayScale).MulVec(Vec2(f32){ .x = frag[0], .y = frag[1] }).AddVec(Vec2(f32).FromVector(CameraUBO.mRayOffset));
@@ -43,7 +53,7 @@ export fn main() callconv(.{ .spirv_kernel = .{ .x = 8, .y = 8, .z = 1 } }) void
         .FirstEdge = RayMarcher.NO_EDGE,
         .MaterialHandle = 0,
         .AccumColor = default_color,
-        .TextureUV = .{ .x = 0, .y = 0 },
+        .TextureUV = .{ .x = -1, .y = -1, .z = -1 },
         .ShapeT = .None,
     };
     marcher.mNodeCount = 1;
@@ -59,10 +69,10 @@ export fn main() callconv(.{ .spirv_kernel = .{ .x = 8, .y = 8, .z = 1 } }) void
     marcher.mNodes[0].FirstEdge = 0;
     marcher.mEdgeCount = 1;
 
-    marcher.March(QuadsSSBO.ptr, GlyphsSSBO.ptr, CameraUBO.mPerspectiveFar, std.spirv.imageSampleImplicitLod);
+    marcher.March(QuadsSSBO.ptr, GlyphsSSBO.ptr, NO_NODES, tile_items, SurfShadingSSBO.ptr, CameraUBO.mPerspectiveFar, TexturesArray, std.spirv.imageSampleImplicitLod);
 
     //traverse ray tree backwards to obtain final output color
-    const final_color = marcher.GenerateColor(ShadingSSBO.ptr, TexturesArray, std.spirv.imageSampleImplicitLod);
+    const final_color = marcher.GenerateColor(SurfShadingSSBO.ptr, MedShadingSSBO.ptr, TexturesArray, std.spirv.imageSampleImplicitLod);
 
     std.spirv.imageWrite(OutTexture, u32, .{ global[0], global[1] }, final_color.ToVector());
 }
@@ -6,6 +6,8 @@ const GlyphData = @import("IM").GlyphData;
 const SurfShadingData = @import("IM").SurfShadingData;
 const MedShadingData = @import("IM").MedShadingData;
 const RayMarcher = @import("IM").RayMarcher;
+const BVHNode = @import("IM").BVHNode;
+const TILE_SIZE = @import("IM").TILE_SIZE;
 const Vec2 = @import("IM").Vec2;
 const Vec3 = @import("IM").Vec3;
 const Vec4 = @import("IM").Vec4;
@@ -57,6 +59,12 @@ pub const SurfShadingBuf = extern struct { ptr: SurfShadingArray };
 const MedShadingArray = @SpirvType(.{ .runtime_array = MedShadingData });
 pub const MedShadingBuf = extern struct { ptr: MedShadingArray };
 
+const TileOffsetsArray = @SpirvType(.{ .runtime_array = u32 });
+pub const TileOffsetsBuf = extern struct { ptr: TileOffsetsArray };
+
+const TileItemsArray = @SpirvType(.{ .runtime_array = u32 });
+pub const TileItemsBuf = extern struct { ptr: TileItemsArray };
+
 pub const CameraUBO = @extern(*addrspace(.uniform) PushConstants, .{ .name = "CameraUBO", .decoration = .{ .descriptor = .{ .set = 3, .binding = 0 } } });
 
 //layout(set = 2, binding = 0) uniform sampler2DArray uTextures;
@@ -67,8 +75,8 @@ pub const OutTexture = @extern(*addrspace(.constant) Image2D, .{ .name = "OutTex
 //layout(set = 2, binding = 2) readonly buffer ShadingSSBO { ShadingData data[]; } Shading;
 pub const SurfShadingSSBO = @extern(*addrspace(.storage_buffer) SurfShadingBuf, .{ .name = "ShadingSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 2 } } });
 
-//layout(set = 2, binding = 3) readonly buffer ShadingSSBO { ShadingData data[]; } Shading;
-pub const MedShadingSSBO = @extern(*addrspace(.storage_buffer) SurfShadingBuf, .{ .name = "ShadingSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 3 } } });
+//layout(set = 2, binding = 3) readonly buffer MedShadingSSBO { MedShadingData data[]; } MedShading;
+pub const MedShadingSSBO = @extern(*addrspace(.storage_buffer) MedShadingBuf, .{ .name = "MedShadingSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 3 } } });
 
 //layout(set = 2, binding = 4) readonly buffer QuadsSSBO { QuadData data[]; } Quads;
 pub const QuadsSSBO = @extern(*addrspace(.storage_buffer) QuadsBuf, .{ .name = "QuadsSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 4 } } });
@@ -76,6 +84,33 @@ pub const QuadsSSBO = @extern(*addrspace(.storage_buffer) QuadsBuf, .{ .name = "
 //layout(set = 2, binding = 5) readonly buffer GlyphSSBO { GlyphData data[]; } Glyphs;
 pub const GlyphsSSBO = @extern(*addrspace(.storage_buffer) GlyphsBuf, .{ .name = "GlyphsSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 5 } } });
 
+//layout(set = 2, binding = 6) readonly buffer TileOffsetsSSBO { uint data[]; } TileOffsets;
+pub const TileOffsetsSSBO = @extern(*addrspace(.storage_buffer) TileOffsetsBuf, .{ .name = "TileOffsetsSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 6 } } });
+
+//layout(set = 2, binding = 7) readonly buffer TileItemsSSBO { uint data[]; } TileItems;
+pub const TileItemsSSBO = @extern(*addrspace(.storage_buffer) TileItemsBuf, .{ .name = "TileItemsSSBO", .decoration = .{ .descriptor = .{ .set = 2, .binding = 7 } } });
+
+/// Handed to the marcher in place of the object BVH so it checks the flat list of the tile
+pub const NO_NODES = [0]BVHNode{};
+
+/// The objects binned into one 8x8 tile of the target, a window into TileItemsSSBO
+pub const TileItems = struct {
+    len: u32,
+    mFirst: u32,
+
+    pub fn At(self: TileItems, i: usize) u32 {
+        return TileItemsSSBO.ptr[self.mFirst + @as(u32, @intCast(i))];
+    }
+};
+
+/// Tile of the pixel at x, y. Tiles are laid out in rows over the viewport like SDFTileBins
+pub fn GetTileItems(x: u32, y: u32) TileItems {
+    const tiles_x = (@as(u32, @intFromFloat(CameraUBO.mViewportWidth)) + TILE_SIZE - 1) / TILE_SIZE;
+    const tile = (y / TILE_SIZE) * tiles_x + x / TILE_SIZE;
+    const first = TileOffsetsSSBO.ptr[tile];
+    return .{ .len = TileOffsetsSSBO.ptr[tile + 1] - first, .mFirst = first };
+}
+
 /// Read a texel from an image without a sampler.
 /// The type of `image` must be a pointer to a SPIR-V image.
 pub fn imageRead(
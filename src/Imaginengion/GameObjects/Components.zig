@@ -4,6 +4,7 @@ const EngineContext = @import("../Core/EngineContext.zig");
 pub const AISlotComponent = @import("Components/AISlotComponent.zig");
 pub const AudioComponent = @import("Components/AudioComponent.zig");
 pub const ColliderComponent = @import("Components/ColliderComponent.zig");
+pub const CompoundColliderComponent = @import("Components/CompoundColliderComponent.zig");
 pub const UUIDComponent = @import("Components/UUIDComponent.zig");
 pub const NameComponent = @import("Components/NameComponent.zig");
 pub const PlayerSlotComponent = @import("Components/PlayerSlotComponent.zig");
@@ -28,6 +29,7 @@ pub const ComponentsList = [_]type{
     AISlotComponent,
     AudioComponent,
     ColliderComponent,
+    CompoundColliderComponent,
     UUIDComponent,
     NameComponent,
     MainEntityComponent,
@@ -51,6 +53,7 @@ pub const SerializeList = [_]type{
     AISlotComponent,
     AudioComponent,
     ColliderComponent,
+    CompoundColliderComponent,
     UUIDComponent,
     RenderTargetComponent,
     MainEntityComponent,
@@ -71,6 +74,7 @@ pub const ComponentPanelList = [_]type{
     AISlotComponent,
     AudioComponent,
     ColliderComponent,
+    CompoundColliderComponent,
     UUIDComponent,
     MainEntityComponent,
     RenderTargetComponent,
@@ -93,6 +97,7 @@ pub const EComponents = enum(u16) {
     AISlotComponent = AISlotComponent.Ind,
     AudioComponent = AudioComponent.Ind,
     ColliderComponent = ColliderComponent.Ind,
+    CompoundColliderComponent = CompoundColliderComponent.Ind,
     UUIDComponent = UUIDComponent.Ind,
     NameComponent = NameComponent.Ind,
     MainEntityComponent = MainEntityComponent.Ind,
@@ -5,6 +5,7 @@ const ComponentsList = @import("../Components.zig").ComponentsList;
 const ImguiManager = @import("../../Imgui/Imgui.zig");
 const CollisionFilter = @import("../../Physics/CollisionManager.zig").CollisionFilter;
 const CollisionManager = @import("../../Physics/CollisionManager.zig");
+const CollisionLayers = @import("../../Physics/CollisionLayers.zig");
 const Entity = @import("../Entity.zig");
 
 const ColliderComponent = @This();
@@ -12,6 +13,7 @@ const ColliderComponent = @This();
 pub const Shapes = enum {
     Box,
     Sphere,
+    Capsule,
 };
 
 pub const Editable: bool = true;
@@ -31,6 +33,12 @@ pub fn Deinit(_: *ColliderComponent, _: *EngineContext) !void {}
 
 pub fn EditorRender(self: *ColliderComponent, _: *EngineContext) !void {
     try ImguiManager.RenderUnion(Shapes, &self.mShape, "Collider Type");
-    try ImguiManager.RenderStaticBitSet(std.StaticBitSet(16), &self.mCollisionFilter.CategoryMask, "Category Bits");
-    try ImguiManager.RenderStaticBitSet(std.StaticBitSet(16), &self.mCollisionFilter.RespondMask, "Response Bits");
+    ImguiManager.RenderBool(&self.mCollisionFilter.IsTrigger, "Is Trigger");
+    var layer: u32 = self.mCollisionFilter.Layer;
+    if (ImguiManager.RenderScalerInput(&layer, "Layer", 1, 1)) {
+        self.mCollisionFilter.Layer = @intCast(@min(layer, CollisionLayers.LAYER_COUNT - 1));
+    }
+    ImguiManager.RenderStaticBitSet(@TypeOf(self.mCollisionFilter.CategoryMask), &self.mCollisionFilter.CategoryMask, "Category Bits");
+    ImguiManager.RenderStaticBitSet(@TypeOf(self.mCollisionFilter.RespondMask), &self.mCollisionFilter.RespondMask, "Response Bits");
+    ImguiManager.RenderStaticBitSet(@TypeOf(self.mCollisionFilter.EventMask), &self.mCollisionFilter.EventMask, "Event Bits");
 }
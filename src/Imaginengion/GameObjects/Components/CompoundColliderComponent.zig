@@ -0,0 +1,137 @@
+const std = @import("std");
+const Vec3 = @import("../../Math/MathTypes.zig").Vec3;
+const EngineContext = @import("../../Core/EngineContext.zig");
+const ComponentsList = @import("../Components.zig").ComponentsList;
+const ImguiManager = @import("../../Imgui/Imgui.zig");
+const imgui = @import("../../Core/CImports.zig").imgui;
+const CollisionManager = @import("../../Physics/CollisionManager.zig");
+const CollisionFilter = CollisionManager.CollisionFilter;
+const CollisionLayers = @import("../../Physics/CollisionLayers.zig");
+const Compound = @import("../../Physics/Compound.zig");
+const ColliderComponent = @import("ColliderComponent.zig");
+
+const CompoundColliderComponent = @This();
+
+/// One piece of the compound. Size is read like the world scale of a ColliderComponent:
+/// sphere radius is size x, box half extents are size, capsule radius is size x and half height size y
+pub const SubCollider = struct {
+    mShape: ColliderComponent.Shapes = .Box,
+    mOffset: Vec3(f32) = .{ .x = 0, .y = 0, .z = 0 },
+    mSize: Vec3(f32) = .{ .x = 0.5, .y = 0.5, .z = 0.5 },
+};
+
+pub const Editable: bool = true;
+pub const Name: []const u8 = "CompoundColliderComponent";
+pub const Ind: usize = blk: {
+    for (ComponentsList, 0..) |component_type, i| {
+        if (component_type == CompoundColliderComponent) {
+            break :blk i + 5; // add 2 because 0 is parent component and 1 is child component provided by the ECS
+        }
+    }
+};
+
+/// Call MarkDirty after changing these so the local BVH gets rebuilt
+mSubColliders: std.ArrayList(SubCollider) = .empty,
+mCollisionFilter: CollisionFilter = .default,
+
+_Compound: Compound = .empty,
+_BuiltScale: Vec3(f32) = .{ .x = 0, .y = 0, .z = 0 },
+_Dirty: bool = true,
+
+pub fn Deinit(self: *CompoundColliderComponent, engine_context: *EngineContext) !void {
+    self.mSubColliders.deinit(engine_context.EngineAllocator());
+    self._Compound.Deinit(engine_context.EngineAllocator());
+}
+
+pub fn MarkDirty(self: *CompoundColliderComponent) void {
+    self._Dirty = true;
+}
+
+/// Sub shapes scaled by the world scale of the entity under their local BVH.
+/// Only rebuilt when the sub colliders or the scale changed since the last call
+pub fn GetCompound(self: *CompoundColliderComponent, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, world_scale: Vec3(f32)) !*const Compound {
+    if (!self._Dirty and std.meta.eql(world_scale, self._BuiltScale)) return &self._Compound;
+
+    const sub_shapes = try frame_allocator.alloc(Compound.SubShape, self.mSubColliders.items.len);
+    for (self.mSubColliders.items, sub_shapes) |sub_collider, *sub_shape| {
+        sub_shape.* = .{
+            .Shape = CollisionManager.GetScaledShape(sub_collider.mShape, sub_collider.mSize.MulVec(world_scale)),
+            .Offset = sub_collider.mOffset.MulVec(world_scale),
+        };
+    }
+    try self._Compound.Build(engine_allocator, sub_shapes);
+
+    self._BuiltScale = world_scale;
+    self._Dirty = false;
+    return &self._Compound;
+}
+
+pub fn EditorRender(self: *CompoundColliderComponent, engine_context: *EngineContext) !void {
+    var remove_index: ?usize = null;
+    for (self.mSubColliders.items, 0..) |*sub_collider, i| {
+        imgui.igPushID_Int(@intCast(i));
+        defer imgui.igPopID();
+
+        ImguiManager.RenderEnum(ColliderComponent.Shapes, &sub_collider.mShape, "Shape");
+        ImguiManager.RenderFloat3Input(&sub_collider.mOffset, "Offset");
+        ImguiManager.RenderFloat3Input(&sub_collider.mSize, "Size");
+        if (imgui.igButton("Remove Shape", .{ .x = 0, .y = 0 })) remove_index = i;
+        ImguiManager.ImguiSeparator();
+    }
+    if (remove_index) |i| _ = self.mSubColliders.orderedRemove(i);
+    if (imgui.igButton("Add Shape", .{ .x = 0, .y = 0 })) {
+        try self.mSubColliders.append(engine_context.EngineAllocator(), .{});
+    }
+    //the inputs do not report edits, rebuilding a small tree while the panel is open is cheap
+    self.MarkDirty();
+
+    ImguiManager.RenderBool(&self.mCollisionFilter.IsTrigger, "Is Trigger");
+    var layer: u32 = self.mCollisionFilter.Layer;
+    if (ImguiManager.RenderScalerInput(&layer, "Layer", 1, 1)) {
+        self.mCollisionFilter.Layer = @intCast(@min(layer, CollisionLayers.LAYER_COUNT - 1));
+    }
+    ImguiManager.RenderStaticBitSet(@TypeOf(self.mCollisionFilter.CategoryMask), &self.mCollisionFilter.CategoryMask, "Category Bits");
+    ImguiManager.RenderStaticBitSet(@TypeOf(self.mCollisionFilter.RespondMask), &self.mCollisionFilter.RespondMask, "Response Bits");
+    ImguiManager.RenderStaticBitSet(@TypeOf(self.mCollisionFilter.EventMask), &self.mCollisionFilter.EventMask, "Event Bits");
+}
+
+pub fn jsonStringify(self: *const CompoundColliderComponent, jw: anytype) !void {
+    try jw.beginObject();
+
+    try jw.objectField("SubColliders");
+    try jw.write(self.mSubColliders.items);
+
+    try jw.objectField("CollisionFilter");
+    try jw.write(self.mCollisionFilter);
+
+    try jw.endObject();
+}
+
+pub fn jsonParse(frame_allocator: std.mem.Allocator, reader: anytype, options: std.json.ParseOptions) std.json.ParseError(@TypeOf(reader.*))!CompoundColliderComponent {
+    if (.object_begin != try reader.next()) return error.UnexpectedToken;
+
+    const engine_context: *EngineContext = @ptrCast(@alignCast(frame_allocator.ptr));
+
+    var result: CompoundColliderComponent = .{};
+
+    while (true) {
+        const token = try reader.next();
+
+        const field_name = switch (token) {
+            .object_end => break,
+            .string => |v| v,
+            else => return error.UnexpectedToken,
+        };
+
+        if (std.mem.eql(u8, field_name, "SubColliders")) {
+            const sub_colliders = try std.json.innerParse([]const SubCollider, frame_allocator, reader, options);
+            result.mSubColliders.appendSlice(engine_context.EngineAllocator(), sub_colliders) catch {
+                @panic("error appending slice, error out of memory");
+            };
+        } else if (std.mem.eql(u8, field_name, "CollisionFilter")) {
+            result.mCollisionFilter = try std.json.innerParse(CollisionFilter, frame_allocator, reader, options);
+        }
+    }
+
+    return result;
+}
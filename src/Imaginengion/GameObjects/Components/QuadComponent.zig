@@ -32,12 +32,28 @@ mTexture: AssetHandle = .empty,
 mTexOptions: Texture2D.TexOptions = .{},
 mMaterial: Material.SurfaceRenderMat = .default,
 mEditTexCoords: bool = false,
+//changed since the renderer last packed it, new quads always get packed
+_Dirty: bool = true,
 
 pub fn Deinit(self: *QuadComponent, _: *EngineContext) !void {
     self.mTexture.ReleaseAsset();
 }
 
+/// Code that changes the fields directly must call MarkDirty so the renderer packs the quad again
+pub fn MarkDirty(self: *QuadComponent) void {
+    self._Dirty = true;
+}
+pub fn IsDirty(self: QuadComponent) bool {
+    return self._Dirty;
+}
+pub fn ClearDirty(self: *QuadComponent) void {
+    self._Dirty = false;
+}
+
 pub fn EditorRender(self: *QuadComponent, engine_context: *EngineContext) !void {
+    const before = self.*;
+    defer if (!std.meta.eql(before, self.*)) self.MarkDirty();
+
     ImguiManager.RenderBool(&self.mShouldRender, "Should Render?");
 
     self.mMaterial.ImguiRender();
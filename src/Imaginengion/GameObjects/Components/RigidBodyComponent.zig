@@ -19,6 +19,9 @@ pub const Ind: usize = blk: {
 
 mMass: f32 = 0.0,
 mMaterialData: Material.PhysicsMaterial = .default,
+/// Sweeps the body along its motion each step so it can not pass through thin colliders.
+/// Costs a time of impact query against every collider so only enable it for fast bodies
+mContinuous: bool = false,
 
 _InvMass: f32 = 0.0,
 _Velocity: Vec3(f32) = std.mem.zeroes(Vec3(f32)),
@@ -35,6 +38,7 @@ pub fn EditorRender(self: *RigidBodyComponent, _: *EngineContext) !void {
         }
     }
     ImguiManager.RenderUnion(Material.PhysicsMaterial, &self.mMaterialData, "Material");
+    ImguiManager.RenderBool(&self.mContinuous, "Continuous Collision");
 }
 
 /// Applies continuous force to the rigid body physically accurate
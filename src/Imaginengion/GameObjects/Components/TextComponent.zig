@@ -34,6 +34,8 @@ mFontSize: f32 = 9,
 mBounds: Vec2(f32) = .{ .x = 8, .y = 8 },
 mEngineAllocator: std.mem.Allocator = undefined,
 mShouldEditTexture: bool = false,
+//changed since the renderer last packed it, new texts always get packed
+_Dirty: bool = true,
 
 pub fn Deinit(self: *TextComponent, engine_context: *EngineContext) !void {
     self.mTextAssetHandle.ReleaseAsset();
@@ -41,7 +43,23 @@ pub fn Deinit(self: *TextComponent, engine_context: *EngineContext) !void {
     self.mText.deinit(engine_context.EngineAllocator());
 }
 
+/// Code that changes the fields or the text directly must call MarkDirty so the renderer packs the glyphs again
+pub fn MarkDirty(self: *TextComponent) void {
+    self._Dirty = true;
+}
+pub fn IsDirty(self: TextComponent) bool {
+    return self._Dirty;
+}
+pub fn ClearDirty(self: *TextComponent) void {
+    self._Dirty = false;
+}
+
 pub fn EditorRender(self: *TextComponent, engine_context: *EngineContext) !void {
+    //the text is edited in place, so its bytes are compared on their own
+    const before = self.*;
+    const text_before = try engine_context.FrameAllocator().dupe(u8, self.mText.items);
+    defer if (!std.meta.eql(before, self.*) or !std.mem.eql(u8, text_before, self.mText.items)) self.MarkDirty();
+
     ImguiManager.RenderTextInput(engine_context, &self.mText, "Text");
 
     //font name just as a text that can be drag dropped onto to change the text
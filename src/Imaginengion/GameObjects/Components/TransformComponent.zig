@@ -18,6 +18,8 @@ const InternalData = struct {
     WorldPosition: Vec3(f32) = .{ .x = 0.0, .y = 0.0, .z = 0.0 },
     WorldRotation: Quat(f32) = .{ .w = 1.0, .x = 0.0, .y = 0.0, .z = 0.0 },
     WorldScale: Vec3(f32) = .{ .x = 2.0, .y = 2.0, .z = 2.0 },
+    Dirty: bool = true, //local transform changed since the world transform was last computed
+    RenderDirty: bool = true, //world transform changed since the renderer last packed the entity
 };
 
 pub const Editable: bool = true;
@@ -38,29 +40,72 @@ _InternalData: InternalData = .{},
 
 pub fn Deinit(_: *TransformComponent, _: *EngineContext) !void {}
 
+/// The local setters mark the transform dirty so the next world transform update recomputes it and
+/// everything under it. Code that writes Translation, Rotation or Scale directly must call MarkDirty
+pub fn SetTranslation(self: *TransformComponent, new_translation: Vec3(f32)) void {
+    self.Translation = new_translation;
+    self._InternalData.Dirty = true;
+}
+pub fn SetRotation(self: *TransformComponent, new_rotation: Quat(f32)) void {
+    self.Rotation = new_rotation;
+    self._InternalData.Dirty = true;
+}
+pub fn SetScale(self: *TransformComponent, new_scale: Vec3(f32)) void {
+    self.Scale = new_scale;
+    self._InternalData.Dirty = true;
+}
+pub fn MarkDirty(self: *TransformComponent) void {
+    self._InternalData.Dirty = true;
+}
+pub fn IsDirty(self: TransformComponent) bool {
+    return self._InternalData.Dirty;
+}
+pub fn ClearDirty(self: *TransformComponent) void {
+    self._InternalData.Dirty = false;
+}
+/// Set by every world transform write and cleared by the renderer once it packed the new transform,
+/// so entities that did not move keep their render slots untouched
+pub fn IsRenderDirty(self: TransformComponent) bool {
+    return self._InternalData.RenderDirty;
+}
+pub fn ClearRenderDirty(self: *TransformComponent) void {
+    self._InternalData.RenderDirty = false;
+}
+
 pub fn GetWorldPosition(self: TransformComponent) Vec3(f32) {
     return self._InternalData.WorldPosition;
 }
 pub fn SetWorldPosition(self: *TransformComponent, new_pos: Vec3(f32)) void {
     self._InternalData.WorldPosition = new_pos;
+    self._InternalData.RenderDirty = true;
 }
 pub fn GetWorldRotation(self: TransformComponent) Quat(f32) {
     return self._InternalData.WorldRotation;
 }
 pub fn SetWorldRotation(self: *TransformComponent, new_rot: Quat(f32)) void {
     self._InternalData.WorldRotation = new_rot;
+    self._InternalData.RenderDirty = true;
 }
 pub fn GetWorldScale(self: TransformComponent) Vec3(f32) {
     return self._InternalData.WorldScale;
 }
 pub fn SetWorldScale(self: *TransformComponent, new_scale: Vec3(f32)) void {
     self._InternalData.WorldScale = new_scale;
+    self._InternalData.RenderDirty = true;
 }
 
 pub fn EditorRender(self: *TransformComponent, _: *EngineContext) !void {
+    const translation = self.Translation;
+    const rotation = self.Rotation;
+    const scale = self.Scale;
+
     ImguiManager.RenderVec3(&self.Translation, "Translation", 0.0, 0.075, 100.0);
     ImguiManager.RenderQuat(&self.Rotation, "Rotation", 0, 0.25, 100.0);
     ImguiManager.RenderVec3(&self.Scale, "Scale", 1.0, 0.075, 100.0);
+
+    if (!std.meta.eql(translation, self.Translation) or !std.meta.eql(rotation, self.Rotation) or !std.meta.eql(scale, self.Scale)) {
+        self.MarkDirty();
+    }
 }
 
 pub fn jsonStringify(self: *const TransformComponent, jw: anytype) !void {
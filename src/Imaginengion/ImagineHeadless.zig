@@ -0,0 +1,56 @@
+//! Engine code that does not depend on any windowing, GPU or audio library.
+//! Used by the unit tests and the benchmark executables so they can run headless.
+const std = @import("std");
+
+//Core Stuff -----------------------------------
+pub const WorkerPool = @import("Core/WorkerPool.zig");
+
+//Physics Stuff -----------------------------------
+pub const BVH = @import("Physics/BVH.zig");
+pub const CCD = @import("Physics/CCD.zig");
+pub const CollisionLayers = @import("Physics/CollisionLayers.zig");
+pub const CollisionManager = @import("Physics/CollisionManager.zig");
+pub const Compound = @import("Physics/Compound.zig");
+pub const ContactSolver = @import("Physics/ContactSolver.zig");
+pub const GJK = @import("Physics/GJK.zig");
+pub const Integrator = @import("Physics/Integrator.zig");
+pub const Narrowphase = @import("Physics/Narrowphase.zig");
+pub const Overlap = @import("Physics/Overlap.zig");
+pub const PhysicsSnapshot = @import("Physics/PhysicsSnapshot.zig");
+pub const PhysicsThread = @import("Physics/PhysicsThread.zig");
+pub const RayCast = @import("Physics/RayCast.zig");
+pub const Shapes = @import("Physics/Shapes.zig");
+pub const TransformBuffer = @import("Physics/TransformBuffer.zig");
+
+//Renderer Stuff -----------------------------------
+pub const CPURayMarcher = @import("Renderer/CPURayMarcher.zig");
+pub const SDFObjectBVH = @import("Renderer/SDFObjectBVH.zig");
+pub const SDFTileBins = @import("Renderer/SDFTileBins.zig");
+pub const ViewFrustum = @import("Renderer/ViewFrustum.zig");
+pub const RetainedBuffer = @import("Renderer/RetainedBuffer.zig");
+pub const TextLayoutCache = @import("Renderer/TextLayoutCache.zig");
+pub const FrameCapture = @import("Renderer/FrameCapture.zig");
+pub const DynamicResolution = @import("Renderer/DynamicResolution.zig");
+pub const PushConstants = @import("Renderer/RenderPipeline.zig").SDFPushConstants;
+pub const QuadData = @import("Renderer/Renderer2D.zig").QuadData;
+pub const GlyphData = @import("Renderer/Renderer2D.zig").GlyphData;
+pub const SurfShadingData = @import("Renderer/Renderer.zig").SurfShadingData;
+pub const MedShadingData = @import("Renderer/Renderer.zig").MedShadingData;
+
+//GPU Buffer Stuff -----------------------------------
+pub const GPUStorage = @import("SSBOs/GPUStorage.zig");
+pub const NullGPUDevice = @import("SSBOs/NullGPUDevice.zig");
+
+//LinAlg stuff-------------------------------------
+const MathTypes = @import("Math/MathTypes.zig");
+pub const Vec2 = MathTypes.Vec2;
+pub const Vec3 = MathTypes.Vec3;
+pub const Vec4 = MathTypes.Vec4;
+pub const Mat3 = MathTypes.Mat3;
+pub const Mat4 = MathTypes.Mat4;
+pub const Quat = MathTypes.Quat;
+pub const Ray = MathTypes.Ray;
+
+test {
+    std.testing.refAllDecls(@This());
+}
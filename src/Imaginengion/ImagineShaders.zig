@@ -5,6 +5,8 @@ pub const GlyphData = @import("Renderer/Renderer2D.zig").GlyphData;
 pub const SurfShadingData = @import("Renderer/Renderer.zig").SurfShadingData;
 pub const MedShadingData = @import("Renderer/Renderer.zig").MedShadingData;
 pub const RayMarcher = @import("Renderer/SDFRayMarcher.zig");
+pub const BVHNode = @import("Renderer/SDFObjectBVH.zig").Node;
+pub const TILE_SIZE = @import("Renderer/SDFTileBins.zig").TILE_SIZE;
 
 //LinAlg stuff-------------------------------------
 const MathTypes = @import("Math/MathTypes.zig");
@@ -104,7 +104,9 @@ pub fn End(_: ImguiManager, engine_context: *EngineContext) void {
     const sdl_window: *sdl.SDL_Window = @ptrCast(engine_context.mAppWindow.GetNativeWindow());
 
     var swapchain_texture: ?*sdl.SDL_GPUTexture = null;
+    const wait_start = sdl.SDL_GetTicksNS();
     _ = sdl.SDL_AcquireGPUSwapchainTexture(cmd_buffer, sdl_window, &swapchain_texture, null, null);
+    engine_context.mRenderer.mPlatform.AddSwapchainWait(sdl.SDL_GetTicksNS() - wait_start);
 
     if (swapchain_texture == null or is_minimized) {
         _ = sdl.SDL_CancelGPUCommandBuffer(cmd_buffer);
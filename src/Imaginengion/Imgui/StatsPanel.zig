@@ -5,6 +5,8 @@ const EngineContext = @import("../Core/EngineContext.zig");
 const StatsPanel = @This();
 const EngineStats = @import("../Core/EngineStats.zig");
 
+const CAPTURE_PATH = "frame.imcapture";
+
 _P_Open: bool = false,
 
 pub fn Init(self: StatsPanel) void {
@@ -37,6 +39,26 @@ pub fn OnImguiRender(self: StatsPanel, engine_context: *EngineContext) !void {
     const fps_text = try std.fmt.allocPrint(frame_allocator, "\tFPS: {d:.0}\n", .{fps});
     imgui.igTextUnformatted(fps_text.ptr, fps_text.ptr + fps_text.len);
 
+    //DYNAMIC RESOLUTION
+    const dynamic_resolution = &engine_context.mRenderer.mDynamicResolution;
+    var dynamic_enabled = dynamic_resolution.IsEnabled();
+    if (imgui.igCheckbox("Dynamic Resolution", &dynamic_enabled)) {
+        dynamic_resolution.SetEnabled(dynamic_enabled);
+    }
+    const scale_text = try std.fmt.allocPrint(frame_allocator, "\tRender scale: {d:.2}, smoothed frame time: {d:.2} ms of {d:.2} ms\n", .{
+        dynamic_resolution.GetScale(),
+        dynamic_resolution.GetSmoothedMs(),
+        dynamic_resolution.mSettings.BudgetMs,
+    });
+    imgui.igTextUnformatted(scale_text.ptr, scale_text.ptr + scale_text.len);
+
+    //saves the buffers of the next frame, replay it with the bench-replay-frame tool
+    if (imgui.igButton("Capture Next Frame", .{ .x = 0, .y = 0 })) {
+        try engine_context.mRenderer.RequestCapture(engine_context.EngineAllocator(), CAPTURE_PATH);
+    }
+    const capture_text = try std.fmt.allocPrint(frame_allocator, "\tSaves to {s}\n", .{CAPTURE_PATH});
+    imgui.igTextUnformatted(capture_text.ptr, capture_text.ptr + capture_text.len);
+
     imgui.igSeparator();
 
     //WORLD STATS
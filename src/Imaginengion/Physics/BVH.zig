@@ -0,0 +1,285 @@
+//! Bounding volume hierarchy over axis aligned boxes.
+//!
+//! The tree is rebuilt from scratch with a top down midpoint split, which is cheap enough to
+//! redo every step and keeps the nodes in one flat array. Inner nodes store the index of their
+//! left child with the right child right after it, leaves store a range into the item list.
+//! Items are plain u32 indices into whatever array the caller built the bounds from.
+//! Queries only read the tree so any number of threads can query it at once.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const BVH = @This();
+
+pub const AABB = extern struct {
+    Min: Vec3(f32),
+    Max: Vec3(f32),
+
+    pub const empty: AABB = .{
+        .Min = Vec3(f32).FromScalar(std.math.inf(f32)),
+        .Max = Vec3(f32).FromScalar(-std.math.inf(f32)),
+    };
+
+    pub fn FromCenter(center: Vec3(f32), half_extents: Vec3(f32)) AABB {
+        return .{ .Min = center.SubVec(half_extents), .Max = center.AddVec(half_extents) };
+    }
+
+    pub fn Union(self: AABB, other: AABB) AABB {
+        return .{
+            .Min = Vec3(f32).FromVector(@min(self.Min.ToVector(), other.Min.ToVector())),
+            .Max = Vec3(f32).FromVector(@max(self.Max.ToVector(), other.Max.ToVector())),
+        };
+    }
+
+    pub fn Expand(self: AABB, amount: Vec3(f32)) AABB {
+        return .{ .Min = self.Min.SubVec(amount), .Max = self.Max.AddVec(amount) };
+    }
+
+    pub fn Overlaps(self: AABB, other: AABB) bool {
+        return self.Min.x <= other.Max.x and self.Max.x >= other.Min.x and
+            self.Min.y <= other.Max.y and self.Max.y >= other.Min.y and
+            self.Min.z <= other.Max.z and self.Max.z >= other.Min.z;
+    }
+
+    pub fn GetCenter(self: AABB) Vec3(f32) {
+        return self.Min.AddVec(self.Max).MulScalar(0.5);
+    }
+
+    /// Distance from point to the closest point of the box, 0 inside it
+    pub fn Distance(self: AABB, point: Vec3(f32)) f32 {
+        const p = point.ToVector();
+        const zero: Vec3(f32).VectorT = @splat(0);
+        const outside = @max(@max(self.Min.ToVector() - p, p - self.Max.ToVector()), zero);
+        return @sqrt(@reduce(.Add, outside * outside));
+    }
+
+    /// Distance along the ray where it enters the box, null if it misses within max_t.
+    /// inv_dir is 1 / direction per axis so callers can compute it once per ray
+    pub fn RayEnter(self: AABB, origin: Vec3(f32), inv_dir: Vec3(f32), max_t: f32) ?f32 {
+        const t1 = (self.Min.ToVector() - origin.ToVector()) * inv_dir.ToVector();
+        const t2 = (self.Max.ToVector() - origin.ToVector()) * inv_dir.ToVector();
+        const t_enter = @max(@reduce(.Max, @min(t1, t2)), 0.0);
+        const t_exit = @min(@reduce(.Min, @max(t1, t2)), max_t);
+        return if (t_enter <= t_exit) t_enter else null;
+    }
+};
+
+pub const Node = extern struct {
+    Bounds: AABB,
+    /// Inner node: index of the left child, the right child is First + 1.
+    /// Leaf: index of the first item in the item list
+    First: u32,
+    /// Number of items in a leaf, 0 for inner nodes
+    Count: u32,
+
+    pub fn IsLeaf(self: Node) bool {
+        return self.Count != 0;
+    }
+};
+
+pub const empty: BVH = .{
+    ._Nodes = .empty,
+    ._Items = .empty,
+    ._ItemBounds = .empty,
+};
+
+const MAX_LEAF_ITEMS: u32 = 4;
+/// No path from the root to a leaf is longer than this, so a traversal stack of this size never overflows
+pub const MAX_DEPTH: usize = 64;
+
+_Nodes: std.ArrayList(Node),
+_Items: std.ArrayList(u32),
+_ItemBounds: std.ArrayList(AABB),
+
+pub fn Deinit(self: *BVH, engine_allocator: std.mem.Allocator) void {
+    self._Nodes.deinit(engine_allocator);
+    self._Items.deinit(engine_allocator);
+    self._ItemBounds.deinit(engine_allocator);
+}
+
+/// Rebuilds the tree over bounds, item i of every query refers to bounds[i].
+/// Capacity is kept between builds.
+pub fn Build(self: *BVH, engine_allocator: std.mem.Allocator, bounds: []const AABB) !void {
+    self._Nodes.clearRetainingCapacity();
+    try self._Items.resize(engine_allocator, bounds.len);
+    try self._ItemBounds.resize(engine_allocator, bounds.len);
+    @memcpy(self._ItemBounds.items, bounds);
+    for (self._Items.items, 0..) |*item, i| item.* = @intCast(i);
+
+    if (bounds.len == 0) return;
+
+    //a binary tree with leaves of at least one item never needs more than 2n - 1 nodes
+    try self._Nodes.ensureTotalCapacity(engine_allocator, bounds.len * 2 - 1);
+    self._Nodes.appendAssumeCapacity(undefined);
+    self.BuildNode(0, 0, @intCast(bounds.len), 0);
+}
+
+/// Flat node array, index 0 is the root. Empty if the tree was built over nothing
+pub fn GetNodes(self: BVH) []const Node {
+    return self._Nodes.items;
+}
+
+/// Item indices referenced by the leaf ranges of GetNodes
+pub fn GetItems(self: BVH) []const u32 {
+    return self._Items.items;
+}
+
+pub fn GetItemBounds(self: BVH, item: u32) AABB {
+    return self._ItemBounds.items[item];
+}
+
+/// Calls func(context, item) for every item whose bounds overlap aabb
+pub fn QueryAABB(self: BVH, aabb: AABB, context: anytype, comptime func: fn (@TypeOf(context), u32) void) void {
+    if (self._Nodes.items.len == 0) return;
+
+    var stack: [MAX_DEPTH]u32 = undefined;
+    var stack_len: usize = 1;
+    stack[0] = 0;
+
+    while (stack_len > 0) {
+        stack_len -= 1;
+        const node = self._Nodes.items[stack[stack_len]];
+        if (!node.Bounds.Overlaps(aabb)) continue;
+
+        if (node.IsLeaf()) {
+            for (self._Items.items[node.First .. node.First + node.Count]) |item| {
+                if (self._ItemBounds.items[item].Overlaps(aabb)) func(context, item);
+            }
+        } else {
+            stack[stack_len] = node.First + 1;
+            stack[stack_len + 1] = node.First;
+            stack_len += 2;
+        }
+    }
+}
+
+/// Walks the items whose bounds, grown by extent, are hit by the ray within max_t.
+/// func(context, item, max_t) returns the new max_t so closest hit queries can shrink the ray
+/// as they go. direction does not need to be normalized, max_t is in units of direction.
+pub fn QueryRay(self: BVH, origin: Vec3(f32), direction: Vec3(f32), max_t: f32, extent: Vec3(f32), context: anytype, comptime func: fn (@TypeOf(context), u32, f32) f32) void {
+    if (self._Nodes.items.len == 0) return;
+
+    const inv_dir = Vec3(f32).FromVector(@as(Vec3(f32).VectorT, @splat(1.0)) / direction.ToVector());
+    var ray_max = max_t;
+
+    var stack: [MAX_DEPTH]u32 = undefined;
+    var stack_len: usize = 1;
+    stack[0] = 0;
+
+    while (stack_len > 0) {
+        stack_len -= 1;
+        const node = self._Nodes.items[stack[stack_len]];
+        if (node.Bounds.Expand(extent).RayEnter(origin, inv_dir, ray_max) == null) continue;
+
+        if (node.IsLeaf()) {
+            for (self._Items.items[node.First .. node.First + node.Count]) |item| {
+                if (self._ItemBounds.items[item].Expand(extent).RayEnter(origin, inv_dir, ray_max) == null) continue;
+                ray_max = func(context, item, ray_max);
+            }
+        } else {
+            //visit the nearer child first so closest hit queries shrink the ray sooner
+            const left_t = self._Nodes.items[node.First].Bounds.Expand(extent).RayEnter(origin, inv_dir, ray_max) orelse std.math.inf(f32);
+            const right_t = self._Nodes.items[node.First + 1].Bounds.Expand(extent).RayEnter(origin, inv_dir, ray_max) orelse std.math.inf(f32);
+            const near: u32 = if (left_t <= right_t) node.First else node.First + 1;
+            const far: u32 = if (near == node.First) node.First + 1 else node.First;
+            stack[stack_len] = far;
+            stack[stack_len + 1] = near;
+            stack_len += 2;
+        }
+    }
+}
+
+fn BuildNode(self: *BVH, node_index: u32, first: u32, count: u32, depth: usize) void {
+    const items = self._Items.items[first .. first + count];
+
+    var bounds = AABB.empty;
+    var centroid_bounds = AABB.empty;
+    for (items) |item| {
+        const item_bounds = self._ItemBounds.items[item];
+        bounds = bounds.Union(item_bounds);
+        const center = item_bounds.GetCenter();
+        centroid_bounds = centroid_bounds.Union(.{ .Min = center, .Max = center });
+    }
+
+    //leave room on the stack for the two children pushed by the deepest node
+    if (count <= MAX_LEAF_ITEMS or depth + 2 >= MAX_DEPTH) {
+        self._Nodes.items[node_index] = .{ .Bounds = bounds, .First = first, .Count = count };
+        return;
+    }
+
+    //split at the middle of the longest centroid axis
+    const size = centroid_bounds.Max.SubVec(centroid_bounds.Min);
+    const axis: usize = if (size.x >= size.y and size.x >= size.z) 0 else if (size.y >= size.z) 1 else 2;
+    const split = centroid_bounds.GetCenter().ToVector()[axis];
+
+    var left_count: u32 = 0;
+    for (0..items.len) |i| {
+        if (self._ItemBounds.items[items[i]].GetCenter().ToVector()[axis] < split) {
+            std.mem.swap(u32, &items[i], &items[left_count]);
+            left_count += 1;
+        }
+    }
+    //every centroid landed on one side, just cut the range in half
+    if (left_count == 0 or left_count == count) left_count = count / 2;
+
+    const left_index: u32 = @intCast(self._Nodes.items.len);
+    self._Nodes.appendAssumeCapacity(undefined);
+    self._Nodes.appendAssumeCapacity(undefined);
+    self._Nodes.items[node_index] = .{ .Bounds = bounds, .First = left_index, .Count = 0 };
+
+    self.BuildNode(left_index, first, left_count, depth + 1);
+    self.BuildNode(left_index + 1, first + left_count, count - left_count, depth + 1);
+}
+
+fn RandomBounds(random: std.Random) AABB {
+    const center = Vec3(f32){ .x = random.float(f32) * 100, .y = random.float(f32) * 100, .z = random.float(f32) * 100 };
+    const half = Vec3(f32){ .x = random.float(f32) + 0.1, .y = random.float(f32) + 0.1, .z = random.float(f32) + 0.1 };
+    return AABB.FromCenter(center, half);
+}
+
+test "BVH queries match brute force" {
+    const allocator = std.testing.allocator;
+
+    var prng = std.Random.DefaultPrng.init(7);
+    const random = prng.random();
+
+    var bounds: [500]AABB = undefined;
+    for (&bounds) |*b| b.* = RandomBounds(random);
+
+    var bvh: BVH = .empty;
+    defer bvh.Deinit(allocator);
+    try bvh.Build(allocator, &bounds);
+
+    const Collect = struct {
+        mHits: *std.DynamicBitSetUnmanaged,
+        fn Overlap(ctx: @This(), item: u32) void {
+            ctx.mHits.set(item);
+        }
+        fn Ray(ctx: @This(), item: u32, max_t: f32) f32 {
+            ctx.mHits.set(item);
+            return max_t;
+        }
+    };
+
+    var hits = try std.DynamicBitSetUnmanaged.initEmpty(allocator, bounds.len);
+    defer hits.deinit(allocator);
+
+    for (0..50) |_| {
+        const query = AABB.FromCenter(RandomBounds(random).GetCenter(), Vec3(f32).FromScalar(10));
+        hits.unsetAll();
+        bvh.QueryAABB(query, Collect{ .mHits = &hits }, Collect.Overlap);
+        for (bounds, 0..) |b, i| {
+            try std.testing.expectEqual(b.Overlaps(query), hits.isSet(i));
+        }
+    }
+
+    for (0..50) |_| {
+        const origin = Vec3(f32){ .x = -10, .y = random.float(f32) * 100, .z = random.float(f32) * 100 };
+        const direction = Vec3(f32){ .x = 1, .y = random.float(f32) - 0.5, .z = random.float(f32) - 0.5 };
+        const inv_dir = Vec3(f32).FromVector(@as(Vec3(f32).VectorT, @splat(1.0)) / direction.ToVector());
+        hits.unsetAll();
+        bvh.QueryRay(origin, direction, 200, Vec3(f32).FromScalar(0), Collect{ .mHits = &hits }, Collect.Ray);
+        for (bounds, 0..) |b, i| {
+            try std.testing.expectEqual(b.RayEnter(origin, inv_dir, 200) != null, hits.isSet(i));
+        }
+    }
+}
@@ -0,0 +1,293 @@
+//! Continuous collision detection for fast moving bodies and the swept scene queries.
+//!
+//! Time of impact is found with conservative advancement: the shapes are moved along their
+//! linear motion by the current separation distance divided by the relative speed, which can
+//! never step past the first contact. Only translation is swept, matching the axis aligned
+//! boxes used by the narrowphase.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Shapes = @import("Shapes.zig");
+const GJK = @import("GJK.zig");
+
+pub const Shape = Shapes.Shape;
+pub const Separation = Shapes.Separation;
+
+pub const Impact = struct {
+    /// Fraction of the motion in [0, 1) where the shapes first touch
+    Time: f32,
+    /// Normal at the time of impact, points from shape b towards shape a
+    Normal: Vec3(f32),
+};
+
+pub const RayImpact = struct {
+    /// Distance along the ray to the surface
+    Distance: f32,
+    /// Surface normal at the hit point
+    Normal: Vec3(f32),
+};
+
+/// Shapes closer than this are treated as touching
+pub const TOLERANCE: f32 = 0.005;
+const MAX_ITERATIONS: u32 = 32;
+
+/// Returns the first time shape_a touches shape_b while a moves by motion_a and b moves by motion_b.
+/// Returns null if they never touch or if they are already touching at the start,
+/// resting contacts are left to the discrete narrowphase.
+pub fn TimeOfImpact(shape_a: Shape, start_a: Vec3(f32), motion_a: Vec3(f32), shape_b: Shape, start_b: Vec3(f32), motion_b: Vec3(f32)) ?Impact {
+    const relative_motion = motion_a.SubVec(motion_b);
+    const relative_speed = relative_motion.Len();
+    if (relative_speed <= 0) return null;
+
+    var separation = GetSeparation(shape_a, start_a, shape_b, start_b);
+    if (separation.Distance <= TOLERANCE) return null;
+
+    var t: f32 = 0;
+    for (0..MAX_ITERATIONS) |_| {
+        //the separation can not shrink faster than the relative speed so this step is always safe
+        t += separation.Distance / relative_speed;
+        if (t >= 1.0) return null;
+
+        const pos_a = start_a.AddVec(motion_a.MulScalar(t));
+        const pos_b = start_b.AddVec(motion_b.MulScalar(t));
+        separation = GetSeparation(shape_a, pos_a, shape_b, pos_b);
+
+        if (separation.Distance <= TOLERANCE) {
+            //moving apart at this point means we only grazed past
+            if (relative_motion.Dot(separation.Normal) >= 0) return null;
+            return .{ .Time = t, .Normal = separation.Normal };
+        }
+    }
+
+    //only slow convergence left is a shallow graze along the surface, not worth stopping the body for
+    return null;
+}
+
+/// Ray test against a shape at pos, exact for spheres and boxes. direction must be normalized.
+/// Rays starting inside the shape do not hit it, same as TimeOfImpact.
+pub fn RayCastShape(shape: Shape, pos: Vec3(f32), origin: Vec3(f32), direction: Vec3(f32), max_distance: f32) ?RayImpact {
+    const local = origin.SubVec(pos);
+    switch (shape) {
+        //sweep a point, the other shapes have no cheap closed form
+        .Capsule, .Hull => {
+            const impact = TimeOfImpact(.{ .Sphere = 0 }, origin, direction.MulScalar(max_distance), shape, pos, Vec3(f32).FromScalar(0)) orelse return null;
+            return .{ .Distance = impact.Time * max_distance, .Normal = impact.Normal };
+        },
+        .Sphere => |radius| {
+            const b = local.Dot(direction);
+            const c = local.Dot(local) - radius * radius;
+            //outside and pointing away
+            if (c <= 0 or b > 0) return null;
+            const discriminant = b * b - c;
+            if (discriminant < 0) return null;
+
+            const distance = -b - @sqrt(discriminant);
+            if (distance > max_distance) return null;
+            return .{ .Distance = distance, .Normal = local.AddVec(direction.MulScalar(distance)).DivScalar(radius) };
+        },
+        .Box => |half| {
+            var t_enter: f32 = 0;
+            var t_exit: f32 = max_distance;
+            var enter_axis: ?usize = null;
+
+            const local_arr: [3]f32 = local.ToVector();
+            const dir_arr: [3]f32 = direction.ToVector();
+            const half_arr: [3]f32 = half.ToVector();
+            for (0..3) |axis| {
+                if (@abs(dir_arr[axis]) < 0.000001) {
+                    if (@abs(local_arr[axis]) > half_arr[axis]) return null;
+                    continue;
+                }
+                const inv = 1.0 / dir_arr[axis];
+                const t1 = (-half_arr[axis] - local_arr[axis]) * inv;
+                const t2 = (half_arr[axis] - local_arr[axis]) * inv;
+                const near = @min(t1, t2);
+                if (near > t_enter) {
+                    t_enter = near;
+                    enter_axis = axis;
+                }
+                t_exit = @min(t_exit, @max(t1, t2));
+                if (t_enter > t_exit) return null;
+            }
+
+            //no entering face means the origin is inside the box
+            const axis = enter_axis orelse return null;
+            var normal = [3]f32{ 0, 0, 0 };
+            normal[axis] = -std.math.sign(dir_arr[axis]);
+            return .{ .Distance = t_enter, .Normal = Vec3(f32).FromVector(normal) };
+        },
+    }
+}
+
+/// Signed distance between two shapes and the direction to push a away from b.
+/// Sphere and box pairs have closed forms, everything else goes through GJK/EPA
+pub fn GetSeparation(shape_a: Shape, pos_a: Vec3(f32), shape_b: Shape, pos_b: Vec3(f32)) Separation {
+    switch (shape_a) {
+        .Sphere => |radius_a| switch (shape_b) {
+            .Sphere => |radius_b| return SphereSphere(pos_a, radius_a, pos_b, radius_b),
+            .Box => |half_b| return SphereBox(pos_a, radius_a, pos_b, half_b),
+            else => {},
+        },
+        .Box => |half_a| switch (shape_b) {
+            .Sphere => |radius_b| return Flip(SphereBox(pos_b, radius_b, pos_a, half_a)),
+            .Box => |half_b| return BoxBox(pos_a, half_a, pos_b, half_b),
+            else => {},
+        },
+        else => {},
+    }
+    return GJK.GetSeparation(shape_a, pos_a, shape_b, pos_b);
+}
+
+/// True if the shapes overlap, for trigger pairs that only need a yes or no.
+/// Never builds a normal, the general pairs stop after GJK without running EPA
+pub fn Overlaps(shape_a: Shape, pos_a: Vec3(f32), shape_b: Shape, pos_b: Vec3(f32)) bool {
+    switch (shape_a) {
+        .Sphere => |radius_a| switch (shape_b) {
+            .Sphere => |radius_b| return pos_a.DistanceSquared(pos_b) < (radius_a + radius_b) * (radius_a + radius_b),
+            .Box => |half_b| return SphereBoxOverlap(pos_a, radius_a, pos_b, half_b),
+            else => {},
+        },
+        .Box => |half_a| switch (shape_b) {
+            .Sphere => |radius_b| return SphereBoxOverlap(pos_b, radius_b, pos_a, half_a),
+            .Box => |half_b| {
+                const gap = pos_a.SubVec(pos_b).Abs().SubVec(half_a.AddVec(half_b));
+                return gap.x < 0 and gap.y < 0 and gap.z < 0;
+            },
+            else => {},
+        },
+        else => {},
+    }
+    return GJK.Intersects(shape_a, pos_a, shape_b, pos_b);
+}
+
+pub const GetMinExtent = Shapes.GetMinExtent;
+
+fn SphereSphere(pos_a: Vec3(f32), radius_a: f32, pos_b: Vec3(f32), radius_b: f32) Separation {
+    const delta = pos_a.SubVec(pos_b);
+    const dist = delta.Len();
+    return .{
+        .Distance = dist - radius_a - radius_b,
+        .Normal = if (dist > 0.00001) delta.DivScalar(dist) else .{ .x = 1, .y = 0, .z = 0 },
+    };
+}
+
+fn SphereBox(sphere_pos: Vec3(f32), radius: f32, box_pos: Vec3(f32), half: Vec3(f32)) Separation {
+    const local = sphere_pos.SubVec(box_pos);
+    const closest = Vec3(f32){
+        .x = std.math.clamp(local.x, -half.x, half.x),
+        .y = std.math.clamp(local.y, -half.y, half.y),
+        .z = std.math.clamp(local.z, -half.z, half.z),
+    };
+    const delta = local.SubVec(closest);
+    const dist = delta.Len();
+
+    if (dist > 0.00001) {
+        return .{ .Distance = dist - radius, .Normal = delta.DivScalar(dist) };
+    }
+
+    //center is inside the box, push out through the closest face
+    return Flip(BoxBox(box_pos, half, sphere_pos, Vec3(f32).FromScalar(radius)));
+}
+
+fn SphereBoxOverlap(sphere_pos: Vec3(f32), radius: f32, box_pos: Vec3(f32), half: Vec3(f32)) bool {
+    const local = sphere_pos.SubVec(box_pos);
+    const closest = Vec3(f32){
+        .x = std.math.clamp(local.x, -half.x, half.x),
+        .y = std.math.clamp(local.y, -half.y, half.y),
+        .z = std.math.clamp(local.z, -half.z, half.z),
+    };
+    return local.DistanceSquared(closest) < radius * radius;
+}
+
+fn BoxBox(pos_a: Vec3(f32), half_a: Vec3(f32), pos_b: Vec3(f32), half_b: Vec3(f32)) Separation {
+    const delta = pos_a.SubVec(pos_b);
+    const gap = delta.Abs().SubVec(half_a.AddVec(half_b));
+
+    if (gap.x > 0 or gap.y > 0 or gap.z > 0) {
+        const outside = gap.ClampScalar(0);
+        const dist = outside.Len();
+        const normal = Vec3(f32){
+            .x = std.math.copysign(outside.x, delta.x),
+            .y = std.math.copysign(outside.y, delta.y),
+            .z = std.math.copysign(outside.z, delta.z),
+        };
+        return .{ .Distance = dist, .Normal = normal.DivScalar(dist) };
+    }
+
+    //overlapping, the least negative gap is the axis of least penetration
+    if (gap.x >= gap.y and gap.x >= gap.z) {
+        return .{ .Distance = gap.x, .Normal = .{ .x = std.math.copysign(@as(f32, 1), delta.x), .y = 0, .z = 0 } };
+    } else if (gap.y >= gap.z) {
+        return .{ .Distance = gap.y, .Normal = .{ .x = 0, .y = std.math.copysign(@as(f32, 1), delta.y), .z = 0 } };
+    }
+    return .{ .Distance = gap.z, .Normal = .{ .x = 0, .y = 0, .z = std.math.copysign(@as(f32, 1), delta.z) } };
+}
+
+fn Flip(separation: Separation) Separation {
+    return .{ .Distance = separation.Distance, .Normal = separation.Normal.Neg() };
+}
+
+test "fast sphere does not tunnel through a thin box" {
+    const wall = Shape{ .Box = .{ .x = 0.05, .y = 5, .z = 5 } };
+    const ball = Shape{ .Sphere = 0.1 };
+    const zero = Vec3(f32).FromScalar(0);
+
+    //moves 20 units in one step, a discrete check at the end position would miss the wall
+    const impact = TimeOfImpact(ball, .{ .x = -10, .y = 0, .z = 0 }, .{ .x = 20, .y = 0, .z = 0 }, wall, zero, zero).?;
+
+    try std.testing.expectApproxEqAbs(@as(f32, (10 - 0.15) / 20.0), impact.Time, TOLERANCE);
+    try std.testing.expectApproxEqAbs(@as(f32, -1), impact.Normal.x, 0.0001);
+}
+
+test "ray cast against sphere and box" {
+    const direction = Vec3(f32){ .x = 0, .y = -1, .z = 0 };
+    const origin = Vec3(f32){ .x = 0.2, .y = 10, .z = 0 };
+
+    const box_hit = RayCastShape(.{ .Box = Vec3(f32).FromScalar(1) }, .{ .x = 0, .y = 2, .z = 0 }, origin, direction, 100).?;
+    try std.testing.expectApproxEqAbs(@as(f32, 7), box_hit.Distance, 0.0001);
+    try std.testing.expectEqual(@as(f32, 1), box_hit.Normal.y);
+
+    const sphere_hit = RayCastShape(.{ .Sphere = 1 }, .{ .x = 0, .y = 0, .z = 0 }, .{ .x = 0, .y = 10, .z = 0 }, direction, 100).?;
+    try std.testing.expectApproxEqAbs(@as(f32, 9), sphere_hit.Distance, 0.0001);
+
+    try std.testing.expect(RayCastShape(.{ .Sphere = 1 }, .{ .x = 0, .y = 0, .z = 0 }, .{ .x = 0, .y = 10, .z = 0 }, direction, 5) == null);
+    try std.testing.expect(RayCastShape(.{ .Box = Vec3(f32).FromScalar(1) }, .{ .x = 5, .y = 0, .z = 0 }, origin, direction, 100) == null);
+}
+
+test "time of impact misses and resting contacts" {
+    const ball = Shape{ .Sphere = 0.5 };
+    const zero = Vec3(f32).FromScalar(0);
+
+    //passes beside the other sphere
+    try std.testing.expect(TimeOfImpact(ball, .{ .x = -10, .y = 2, .z = 0 }, .{ .x = 20, .y = 0, .z = 0 }, ball, zero, zero) == null);
+
+    //already touching, the narrowphase owns this contact
+    try std.testing.expect(TimeOfImpact(ball, .{ .x = 1, .y = 0, .z = 0 }, .{ .x = -1, .y = 0, .z = 0 }, ball, zero, zero) == null);
+
+    //both moving, boxes meet half way
+    const box = Shape{ .Box = Vec3(f32).FromScalar(0.5) };
+    const impact = TimeOfImpact(box, .{ .x = -5, .y = 0, .z = 0 }, .{ .x = 10, .y = 0, .z = 0 }, box, .{ .x = 5, .y = 0, .z = 0 }, .{ .x = -10, .y = 0, .z = 0 }).?;
+    try std.testing.expectApproxEqAbs(@as(f32, 0.45), impact.Time, TOLERANCE);
+}
+
+test "overlap test agrees with the separation" {
+    const shapes = [_]Shape{
+        .{ .Sphere = 0.7 },
+        .{ .Box = .{ .x = 0.8, .y = 0.4, .z = 0.6 } },
+        .{ .Capsule = .{ .Radius = 0.3, .HalfHeight = 0.5 } },
+    };
+    const zero = Vec3(f32).FromScalar(0);
+
+    var prng = std.Random.DefaultPrng.init(42);
+    const random = prng.random();
+    for (0..1000) |_| {
+        const shape_a = shapes[random.uintLessThan(usize, shapes.len)];
+        const shape_b = shapes[random.uintLessThan(usize, shapes.len)];
+        const offset = Vec3(f32){ .x = random.float(f32) * 4 - 2, .y = random.float(f32) * 4 - 2, .z = random.float(f32) * 4 - 2 };
+
+        //right at the surface the two tests are allowed to round differently
+        const distance = GetSeparation(shape_a, offset, shape_b, zero).Distance;
+        if (@abs(distance) < 0.001) continue;
+        try std.testing.expectEqual(distance < 0, Overlaps(shape_a, offset, shape_b, zero));
+    }
+}
@@ -0,0 +1,63 @@
+//! Project wide table of which collision layers can touch each other.
+//!
+//! Every collider sits on one layer. The broadphase looks the pair of layers up in the matrix
+//! before a pair is emitted, so pairs gameplay never wants (debris against debris, trigger zones
+//! against each other) cost one bit test instead of a narrowphase test.
+//! The category and respond masks of CollisionFilter still apply to the pairs that get through.
+const std = @import("std");
+
+pub const LAYER_COUNT: usize = 16;
+
+pub const Layer = std.math.IntFittingRange(0, LAYER_COUNT - 1);
+pub const LayerMask = std.StaticBitSet(LAYER_COUNT);
+
+pub const LayerMatrix = struct {
+    /// Every layer collides with every layer
+    pub const default: LayerMatrix = .{
+        ._Rows = @splat(.initFull()),
+    };
+
+    //kept symmetric, row a bit b is always the same as row b bit a
+    _Rows: [LAYER_COUNT]LayerMask,
+
+    pub fn Collides(self: LayerMatrix, layer_a: Layer, layer_b: Layer) bool {
+        return self._Rows[layer_a].isSet(layer_b);
+    }
+
+    pub fn SetCollides(self: *LayerMatrix, layer_a: Layer, layer_b: Layer, collides: bool) void {
+        self._Rows[layer_a].setValue(layer_b, collides);
+        self._Rows[layer_b].setValue(layer_a, collides);
+    }
+
+    /// Layers that collide with layer
+    pub fn GetRow(self: LayerMatrix, layer: Layer) LayerMask {
+        return self._Rows[layer];
+    }
+
+    /// Replaces the layers that collide with layer, the other rows are updated to match
+    pub fn SetRow(self: *LayerMatrix, layer: Layer, row: LayerMask) void {
+        for (0..LAYER_COUNT) |other| {
+            self.SetCollides(layer, @intCast(other), row.isSet(other));
+        }
+    }
+};
+
+test "Layer matrix stays symmetric" {
+    var matrix: LayerMatrix = .default;
+    try std.testing.expect(matrix.Collides(3, 7));
+
+    const debris: Layer = 5;
+    matrix.SetCollides(debris, debris, false);
+    matrix.SetCollides(2, debris, false);
+    try std.testing.expect(!matrix.Collides(debris, debris));
+    try std.testing.expect(!matrix.Collides(debris, 2));
+    try std.testing.expect(matrix.Collides(debris, 0));
+
+    var row: LayerMask = .initEmpty();
+    row.set(1);
+    matrix.SetRow(0, row);
+    try std.testing.expect(matrix.Collides(1, 0));
+    try std.testing.expect(!matrix.Collides(debris, 0));
+    try std.testing.expect(!matrix.Collides(0, 0));
+    try std.testing.expect(matrix.Collides(1, 1));
+}
@@ -5,21 +5,36 @@ const Tracy = @import("../Core/Tracy.zig");
 const Contact = Collisions.Contact;
 const EntityComponents = @import("../GameObjects/Components.zig");
 const ColliderComponent = EntityComponents.ColliderComponent;
+const CompoundColliderComponent = EntityComponents.CompoundColliderComponent;
 const EntityTransformComponent = EntityComponents.TransformComponent;
 const RigidBodyComponent = EntityComponents.RigidBodyComponent;
 const Entity = @import("../GameObjects/Entity.zig");
 const SceneManager = @import("../Scene/SceneManager.zig");
 const SkipField = @import("../Core/SkipField.zig").StaticSkipField;
-const UpdateWorldTransforms = @import("PhysicsManager.zig").UpdateWorldTransforms;
 const CollisionType = @import("Collisions.zig").CollisionType;
 const MathTypes = @import("../Math/MathTypes.zig");
 const Vec3 = MathTypes.Vec3;
 const Set = @import("../Vendor/ziglang-set/src/array_hash_set/unmanaged.zig").ArraySetUnmanaged;
+const ContactSolver = @import("ContactSolver.zig");
+const BVH = @import("BVH.zig");
+const AABB = BVH.AABB;
+const CCD = @import("CCD.zig");
+const WorkerPool = @import("../Core/WorkerPool.zig");
+const Shapes = @import("Shapes.zig");
+const Narrowphase = @import("Narrowphase.zig");
+const Compound = @import("Compound.zig");
+const CollisionLayers = @import("CollisionLayers.zig");
+const LayerMatrix = CollisionLayers.LayerMatrix;
+const BroadPair = Narrowphase.Pair;
+const SolverBody = ContactSolver.SolverBody;
+const SolverContact = ContactSolver.SolverContact;
 
 const SOLVER_ITERS: u32 = 4;
 const PERCENT: f32 = 0.8;
 const SLOP: f32 = 0.01;
 
+const INITIAL_EVENT_CAPACITY: usize = 256;
+
 const CollisionManager = @This();
 
 const CurrCollisionSet = Set(u64);
@@ -29,25 +44,69 @@ pub const CollisionFilter = struct {
         .IsTrigger = false,
         .CategoryMask = .empty,
         .RespondMask = .empty,
+        .EventMask = .empty,
+        .Layer = 0,
     };
+    /// Trigger pairs are only tested for overlap, never solved and only report Begin and End events
     IsTrigger: bool,
     CategoryMask: std.StaticBitSet(32),
     RespondMask: std.StaticBitSet(32),
+    /// Categories this collider wants collision events about, empty means no events
+    EventMask: std.StaticBitSet(32),
+    /// Row of the layer matrix this collider uses, defaulted so scenes saved before layers still load
+    Layer: CollisionLayers.Layer = 0,
+};
+
+pub const CollisionEventType = enum(u8) {
+    Begin,
+    Stay,
+    End,
+};
+
+pub const CollisionEvent = struct {
+    mType: CollisionEventType,
+    mOrigin: Entity,
+    mTarget: Entity,
+    mNormal: Vec3(f32), //zero for End events and trigger pairs
 };
 
 pub const empty: CollisionManager = .{
-    ._Contacts = .empty,
-    ._ContactCache1 = .empty,
-    ._ContactCache2 = .empty,
-    ._LastCache = undefined,
-    ._CurrentCache = undefined,
+    ._LastCache = .empty,
+    ._CurrentCache = .empty,
+    ._BlockingContacts = .empty,
+    ._OverlapContacts = .empty,
+    ._Pairs = .empty,
+    ._Narrowphase = .empty,
+    ._Solver = .empty,
+    ._SolverBodies = .empty,
+    ._SolverContacts = .empty,
+    ._SolverEntities = .empty,
+    ._Proxies = .empty,
+    ._ProxyBounds = .empty,
+    ._ProxySceneManager = null,
+    ._BVH = .empty,
+    ._Events = .empty,
+    .mLayerMatrix = .default,
+};
+
+/// Snapshot of a collider taken by the broadphase, scene queries run against these
+pub const ColliderProxy = struct {
+    mEntityID: Entity.Type,
+    mShape: CCD.Shape,
+    mPosition: Vec3(f32),
+    mFilter: CollisionFilter,
+    /// Set for compound colliders, mShape is unused then. Points into the component so it is only
+    /// valid until the world changes, the same as the rest of the proxies
+    mCompound: ?*const Compound = null,
 };
 
 pub const ContactCache = struct {
     pub const empty: ContactCache = .{
         .AccumImpulse = 0.0,
+        .Events = false,
     };
     AccumImpulse: f32,
+    Events: bool, //so we know whether to send an End event once the pair separates
 };
 
 _LastCache: std.AutoArrayHashMapUnmanaged(u64, ContactCache),
@@ -55,132 +114,304 @@ _CurrentCache: std.AutoArrayHashMapUnmanaged(u64, ContactCache),
 _BlockingContacts: std.ArrayList(Contact),
 _OverlapContacts: std.ArrayList(Contact),
 
-pub fn Init(_: *CollisionManager, _: std.mem.Allocator) !void {}
+//candidate pairs from the broadphase, indices into _Proxies
+_Pairs: std.ArrayList(BroadPair),
+_Narrowphase: Narrowphase,
+
+//solver scratch, kept between steps so we do not reallocate every substep
+_Solver: ContactSolver,
+_SolverBodies: std.ArrayList(SolverBody),
+_SolverContacts: std.ArrayList(SolverContact),
+_SolverEntities: std.ArrayList(Entity.Type),
+
+//broadphase structure, rebuilt every substep and kept around for scene queries
+_Proxies: std.ArrayList(ColliderProxy),
+_ProxyBounds: std.ArrayList(AABB),
+_ProxySceneManager: ?*SceneManager,
+_BVH: BVH,
+
+_Events: std.ArrayList(CollisionEvent),
+
+/// Which layers can touch, read by the broadphase every substep
+mLayerMatrix: LayerMatrix,
+
+pub fn Init(self: *CollisionManager, engine_allocator: std.mem.Allocator) !void {
+    try self._Events.ensureTotalCapacity(engine_allocator, INITIAL_EVENT_CAPACITY);
+}
 
 pub fn Deinit(self: *CollisionManager, engine_allocator: std.mem.Allocator) void {
     self._BlockingContacts.deinit(engine_allocator);
     self._OverlapContacts.deinit(engine_allocator);
+    self._Pairs.deinit(engine_allocator);
+    self._Narrowphase.Deinit(engine_allocator);
+    self._LastCache.deinit(engine_allocator);
+    self._CurrentCache.deinit(engine_allocator);
+    self._Solver.Deinit(engine_allocator);
+    self._SolverBodies.deinit(engine_allocator);
+    self._SolverContacts.deinit(engine_allocator);
+    self._SolverEntities.deinit(engine_allocator);
+    self._Proxies.deinit(engine_allocator);
+    self._ProxyBounds.deinit(engine_allocator);
+    self._BVH.Deinit(engine_allocator);
+    self._Events.deinit(engine_allocator);
+}
+
+/// Clears the event buffer, capacity is kept so steady state frames do not allocate
+pub fn StartFrame(self: *CollisionManager) void {
+    self._Events.clearRetainingCapacity();
 }
 
 pub fn Reset(self: *CollisionManager, engine_allocator: std.mem.Allocator) void {
     self._BlockingContacts.clearAndFree(engine_allocator);
     self._OverlapContacts.clearAndFree(engine_allocator);
+    self._Pairs.clearAndFree(engine_allocator);
 }
 
 ///Checks the whole scene for objects that can possibly collide.
-/// For the contact sets the entity origin, target, and collision type.
+/// Rebuilds the collider BVH and for every collider only tests the colliders whose bounds it overlaps.
+/// Pairs whose layers do not collide in the layer matrix or whose filters ignore each other are dropped here.
+/// Records every candidate pair with its proxy indices, pair key and collision type.
 pub fn BroadPass(self: *CollisionManager, engine_context: *EngineContext, scene_manager: *SceneManager) !void {
-    const zone = Tracy.ZoneInit("CollisionManager::BroadPassf", @src());
+    const zone = Tracy.ZoneInit("CollisionManager::BroadPass", @src());
     defer zone.Deinit();
 
+    try self.GatherProxies(engine_context, scene_manager);
+    try self.FindPairs(engine_context.EngineAllocator());
+}
+
+/// Rebuilds the proxies and their BVH from the colliders of the scene, the first half of BroadPass.
+/// The continuous sweep calls it too so it only tests the colliders a body can reach
+pub fn GatherProxies(self: *CollisionManager, engine_context: *EngineContext, scene_manager: *SceneManager) !void {
     const colliders_arr = try scene_manager.GetEntityGroup(engine_context.FrameAllocator(), .{ .Component = ColliderComponent });
+    const compounds_arr = try scene_manager.GetEntityGroup(engine_context.FrameAllocator(), .{ .Component = CompoundColliderComponent });
+    try self.BuildProxies(engine_context, scene_manager, colliders_arr.items, compounds_arr.items);
+}
 
-    for (0..colliders_arr.items.len) |i| {
-        const entity_origin = scene_manager.GetEntity(colliders_arr.items[i]);
-        for (i + 1..colliders_arr.items.len) |j| {
-            const entity_target = scene_manager.GetEntity(colliders_arr.items[j]);
+/// Pairs up the proxies of the last GatherProxies or SetProxies, the part of BroadPass that does not read the scene
+pub fn FindPairs(self: *CollisionManager, engine_allocator: std.mem.Allocator) !void {
+    const PairCollector = struct {
+        mManager: *CollisionManager,
+        mOrigin: u32,
 
-            const collider_origin = entity_origin.GetComponent(ColliderComponent).?;
-            const collider_target = entity_target.GetComponent(ColliderComponent).?;
+        fn Collect(ctx: @This(), target: u32) void {
+            //each pair is found from both sides, keep the one where origin comes first
+            if (target <= ctx.mOrigin) return;
 
-            const collision_type = GetCollisionType(collider_origin, collider_target);
+            const proxy_origin = ctx.mManager._Proxies.items[ctx.mOrigin];
+            const proxy_target = ctx.mManager._Proxies.items[target];
 
-            if (collision_type == .Ignore) continue;
+            if (!ctx.mManager.mLayerMatrix.Collides(proxy_origin.mFilter.Layer, proxy_target.mFilter.Layer)) return;
 
-            const contact: Contact = .{
-                .mOrigin = entity_origin,
-                .mTarget = entity_target,
-                .mNormal = Vec3(f32){ .x = 0, .y = 0, .z = 0 },
-                .mPenetration = 0,
+            const overlap = switch (GetFilterCollisionType(proxy_origin.mFilter, proxy_target.mFilter)) {
+                .Block => false,
+                .Overlap => true,
+                .Ignore => return,
             };
 
-            switch (collision_type) {
-                .Block => {
-                    try self._BlockingContacts.append(engine_context.EngineAllocator(), contact);
-                },
-                .Overlap => {
-                    try self._OverlapContacts.append(engine_context.EngineAllocator(), contact);
-                },
-                .Ignore => unreachable,
-            }
+            ctx.mManager._Pairs.appendAssumeCapacity(MakePair(ctx.mManager._Proxies.items, ctx.mOrigin, target, overlap));
         }
+    };
+
+    for (self._ProxyBounds.items, 0..) |bounds, i| {
+        //one collider can at most pair with every other collider
+        try self._Pairs.ensureUnusedCapacity(engine_allocator, self._Proxies.items.len);
+
+        self._BVH.QueryAABB(bounds, PairCollector{ .mManager = self, .mOrigin = @intCast(i) }, PairCollector.Collect);
     }
 }
 
-///Checks generated contacts list from broad pass to see if thing actually collided
-/// For the contact sets the penetration, normal, and contact state
-pub fn NarrowPass(self: *CollisionManager, engine_context: *EngineContext) !void {
-    var i: usize = 0;
-    var end: usize = self._OverlapContacts.items.len;
-    while (i < end) {
-        const contact = self._OverlapContacts.items[i];
-        const collider_origin = contact.mOrigin.GetComponent(ColliderComponent).?;
-        const collider_target = contact.mTarget.GetComponent(ColliderComponent).?;
-
-        const origin_transform = contact.mOrigin.GetComponent(EntityTransformComponent).?;
-        const target_transform = contact.mTarget.GetComponent(EntityTransformComponent).?;
-
-        if (std.meta.activeTag(collider_origin.mShape) == .Sphere and std.meta.activeTag(collider_target.mShape) == .Sphere) {
-            Collisions.SphereSphere(contact, origin_transform, target_transform);
-            i += 1;
-        } else if (std.meta.activeTag(collider_origin.mShape) == .Box and std.meta.activeTag(collider_target.mShape) == .Box) {
-            Collisions.BoxBox(contact, origin_transform, target_transform);
-            i += 1;
-        } else {
-            self._OverlapContacts.items[i] = self._OverlapContacts.items[end - 1];
-            end -= 1;
-        }
+/// Contact cache carried into the next step, the accumulated impulses warm start the solver
+pub fn GetContactCache(self: *const CollisionManager) *const std.AutoArrayHashMapUnmanaged(u64, ContactCache) {
+    return &self._LastCache;
+}
+
+pub fn ClearContactCache(self: *CollisionManager) void {
+    self._LastCache.clearRetainingCapacity();
+    self._CurrentCache.clearRetainingCapacity();
+}
+
+pub fn PutContactCache(self: *CollisionManager, engine_allocator: std.mem.Allocator, key: u64, cache: ContactCache) !void {
+    try self._LastCache.put(engine_allocator, key, cache);
+}
+
+/// Colliders as of the last broadphase, the indices match the items of GetBVH
+pub fn GetProxies(self: *const CollisionManager) []const ColliderProxy {
+    return self._Proxies.items;
+}
+
+/// Candidate pairs found by the last broadphase
+pub fn GetPairCount(self: *const CollisionManager) usize {
+    return self._Pairs.items.len;
+}
+
+/// Blocking and overlapping contacts found by the last narrowphase
+pub fn GetContactCount(self: *const CollisionManager) usize {
+    return self._BlockingContacts.items.len + self._OverlapContacts.items.len;
+}
+
+pub fn GetBVH(self: *const CollisionManager) *const BVH {
+    return &self._BVH;
+}
+
+pub fn GetProxyEntity(self: *const CollisionManager, proxy_index: u32) Entity {
+    return .{ .mEntityID = self._Proxies.items[proxy_index].mEntityID, .mSceneManager = self._ProxySceneManager.? };
+}
+
+/// Sphere radius is the world scale x, box half extents are the world scale,
+/// capsule radius is the world scale x and its half height the world scale y
+pub fn GetColliderShape(collider: *const ColliderComponent, transform: *EntityTransformComponent) CCD.Shape {
+    return GetScaledShape(collider.mShape, transform.GetWorldScale());
+}
+
+pub fn GetScaledShape(shape: ColliderComponent.Shapes, scale: Vec3(f32)) CCD.Shape {
+    return switch (shape) {
+        .Sphere => .{ .Sphere = scale.x },
+        .Box => .{ .Box = scale },
+        .Capsule => .{ .Capsule = .{ .Radius = scale.x, .HalfHeight = scale.y } },
+    };
+}
+
+pub fn GetShapeBounds(shape: CCD.Shape, position: Vec3(f32)) AABB {
+    return AABB.FromCenter(position, Shapes.GetHalfExtents(shape));
+}
+
+/// Compound colliders get one proxy each after the plain colliders, their bounds cover every sub shape
+fn BuildProxies(self: *CollisionManager, engine_context: *EngineContext, scene_manager: *SceneManager, collider_ids: []const Entity.Type, compound_ids: []const Entity.Type) !void {
+    const engine_allocator = engine_context.EngineAllocator();
+    try self._Proxies.resize(engine_allocator, collider_ids.len + compound_ids.len);
+    try self._ProxyBounds.resize(engine_allocator, collider_ids.len + compound_ids.len);
+    self._ProxySceneManager = scene_manager;
+
+    for (collider_ids, self._Proxies.items[0..collider_ids.len], self._ProxyBounds.items[0..collider_ids.len]) |entity_id, *proxy, *bounds| {
+        const entity = scene_manager.GetEntity(entity_id);
+        const collider = entity.GetComponent(ColliderComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+
+        proxy.* = .{
+            .mEntityID = entity_id,
+            .mShape = GetColliderShape(collider, transform),
+            .mPosition = transform.GetWorldPosition(),
+            .mFilter = collider.mCollisionFilter,
+        };
+        bounds.* = GetShapeBounds(proxy.mShape, proxy.mPosition);
     }
-    self._OverlapContacts.items.len = end;
-
-    i = 0;
-    end = self._BlockingContacts.item.len;
-    while (i < end) {
-        const contact = self._BlockingContacts.items[i];
-        const collider_origin = contact.mOrigin.GetComponent(ColliderComponent).?;
-        const collider_target = contact.mTarget.GetComponent(ColliderComponent).?;
-
-        const origin_transform = contact.mOrigin.GetComponent(EntityTransformComponent).?;
-        const target_transform = contact.mTarget.GetComponent(EntityTransformComponent).?;
-
-        if (std.meta.activeTag(collider_origin.mShape) == .Sphere and std.meta.activeTag(collider_target.mShape) == .Sphere) {
-            Collisions.SphereSphere(contact, origin_transform, target_transform);
-            i += 1;
-        } else if (std.meta.activeTag(collider_origin.mShape) == .Box and std.meta.activeTag(collider_target.mShape) == .Box) {
-            Collisions.BoxBox(contact, origin_transform, target_transform);
-            i += 1;
-        } else {
-            self._BlockingContacts.items[i] = self._BlockingContacts.items[end - 1];
-            end -= 1;
-        }
+
+    for (compound_ids, self._Proxies.items[collider_ids.len..], self._ProxyBounds.items[collider_ids.len..]) |entity_id, *proxy, *bounds| {
+        const entity = scene_manager.GetEntity(entity_id);
+        const compound_collider = entity.GetComponent(CompoundColliderComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+        const compound = try compound_collider.GetCompound(engine_allocator, engine_context.FrameAllocator(), transform.GetWorldScale());
+
+        proxy.* = .{
+            .mEntityID = entity_id,
+            .mShape = .{ .Sphere = 0 },
+            .mPosition = transform.GetWorldPosition(),
+            .mFilter = compound_collider.mCollisionFilter,
+            .mCompound = compound,
+        };
+        bounds.* = compound.GetBounds(proxy.mPosition);
     }
-    self._BlockingContacts.items.len = end;
 
-    //check for begin collision events
-    for (self._OverlapContacts.items) |contact| {
-        const key: u64 = @as(u64, @intCast(contact.mOrigin.mEntityID)) << 32 | @as(u64, @intCast(contact.mTarget.mEntityID));
-        self._CurrentCache.put(engine_context.FrameAllocator(), key, .empty);
-        if (!self._LastCache.contains(key)) {
-            //create new BeginCollisionEvent
-        }
+    try self._BVH.Build(engine_allocator, self._ProxyBounds.items);
+}
+
+/// Replaces the proxies with colliders gathered by the caller instead of from a scene, like the physics
+/// benchmark does. Entities of the contacts, events and query hits are made with scene_manager
+pub fn SetProxies(self: *CollisionManager, engine_allocator: std.mem.Allocator, scene_manager: *SceneManager, proxies: []const ColliderProxy) !void {
+    try self._Proxies.resize(engine_allocator, proxies.len);
+    try self._ProxyBounds.resize(engine_allocator, proxies.len);
+    self._ProxySceneManager = scene_manager;
+
+    @memcpy(self._Proxies.items, proxies);
+    for (proxies, self._ProxyBounds.items) |proxy, *bounds| {
+        bounds.* = if (proxy.mCompound) |compound| compound.GetBounds(proxy.mPosition) else GetShapeBounds(proxy.mShape, proxy.mPosition);
     }
-    for (self._BlockingContacts.items) |contact| {
-        const key: u64 = @as(u64, @intCast(contact.mOrigin.mEntityID)) << 32 | @as(u64, @intCast(contact.mTarget.mEntityID));
-        self._CurrentCache.put(engine_context.FrameAllocator(), key, .empty);
-        if (!self._LastCache.contains(key)) {
-            //create new BeginCollisionEvent
+
+    try self._BVH.Build(engine_allocator, self._ProxyBounds.items);
+}
+
+///Checks the candidate pairs from broad pass to see if things actually collided.
+/// The pairs are tested in parallel on the worker pool (see Narrowphase.zig) and the touching ones
+/// become the overlap and blocking contacts, ordered by pair key so results do not depend on thread count.
+/// Pairs with a trigger only get a yes or no overlap test and never reach the solver
+pub fn NarrowPass(self: *CollisionManager, engine_context: *EngineContext) !void {
+    const zone = Tracy.ZoneInit("CollisionManager::NarrowPass", @src());
+    defer zone.Deinit();
+
+    try self.FindContacts(engine_context.EngineAllocator(), &engine_context.mWorkerPool);
+}
+
+/// Narrowphase over the pairs of the last broadphase, the part of NarrowPass that does not need the engine
+pub fn FindContacts(self: *CollisionManager, engine_allocator: std.mem.Allocator, worker_pool: *WorkerPool) !void {
+    const scene_manager = self._ProxySceneManager orelse return;
+
+    const manifolds = try self._Narrowphase.Run(engine_allocator, worker_pool, ColliderProxy, self._Proxies.items, self._Pairs.items);
+
+    try self.RecordContacts(engine_allocator, scene_manager, manifolds);
+}
+
+//turns the manifolds of a step into contacts and diffs them against last step's cache for the events
+fn RecordContacts(self: *CollisionManager, engine_allocator: std.mem.Allocator, scene_manager: *SceneManager, manifolds: []const Narrowphase.Manifold) !void {
+    try self._BlockingContacts.ensureUnusedCapacity(engine_allocator, manifolds.len);
+    try self._OverlapContacts.ensureUnusedCapacity(engine_allocator, manifolds.len);
+    try self._CurrentCache.ensureUnusedCapacity(engine_allocator, manifolds.len);
+    //at most a Begin or Stay per manifold and an End per pair of the last step
+    try self._Events.ensureUnusedCapacity(engine_allocator, manifolds.len + self._LastCache.count());
+
+    //diff against last step's cache for the begin/stay events
+    for (manifolds) |manifold| {
+        const proxy_origin = self._Proxies.items[manifold.Origin];
+        const proxy_target = self._Proxies.items[manifold.Target];
+
+        const contact: Contact = .{
+            .mOrigin = .{ .mEntityID = proxy_origin.mEntityID, .mSceneManager = scene_manager },
+            .mTarget = .{ .mEntityID = proxy_target.mEntityID, .mSceneManager = scene_manager },
+            .mNormal = manifold.Normal,
+            .mPenetration = manifold.Penetration,
+        };
+        if (manifold.Overlap) {
+            self._OverlapContacts.appendAssumeCapacity(contact);
+        } else {
+            self._BlockingContacts.appendAssumeCapacity(contact);
+        }
+
+        const wants_events = WantsEvents(proxy_origin.mFilter, proxy_target.mFilter);
+        self._CurrentCache.putAssumeCapacity(manifold.Key, .{ .AccumImpulse = 0.0, .Events = wants_events });
+
+        //trigger pairs only report entering and leaving
+        const was_touching = self._LastCache.contains(manifold.Key);
+        if (wants_events and !(manifold.Overlap and was_touching)) {
+            self._Events.appendAssumeCapacity(.{
+                .mType = if (was_touching) .Stay else .Begin,
+                .mOrigin = contact.mOrigin,
+                .mTarget = contact.mTarget,
+                .mNormal = contact.mNormal,
+            });
         }
     }
 
-    //check for end collision events
-    const prev_iter = self._LastCache.iterator();
+    //pairs that were touching last step but not anymore
+    var prev_iter = self._LastCache.iterator();
     while (prev_iter.next()) |entry| {
-        if (!self._CurrentCache.contains(entry.key_ptr.*)) {
-            //create a new EndCOllisionEvent
-        }
+        if (!entry.value_ptr.Events or self._CurrentCache.contains(entry.key_ptr.*)) continue;
+
+        const key = entry.key_ptr.*;
+        self._Events.appendAssumeCapacity(.{
+            .mType = .End,
+            .mOrigin = .{ .mEntityID = @intCast(key >> 32), .mSceneManager = scene_manager },
+            .mTarget = .{ .mEntityID = @truncate(key), .mSceneManager = scene_manager },
+            .mNormal = .{ .x = 0, .y = 0, .z = 0 },
+        });
     }
 }
 
+/// Every Begin, Stay and End event produced since the start of the frame, in the order the steps produced them.
+/// Only pairs where one collider has a category bit in the other's EventMask show up here.
+/// Pairs with a trigger only get Begin and End, with a zero normal
+pub fn GetCollisionEvents(self: *const CollisionManager) []const CollisionEvent {
+    return self._Events.items;
+}
+
 pub fn PreSolverPass(self: *CollisionManager, engine_context: *EngineContext) !void {
     _ = engine_context;
     for (self._OverlapContacts.items) |contact| {
@@ -193,28 +424,92 @@ pub fn PreSolverPass(self: *CollisionManager, engine_context: *EngineContext) !v
     }
 }
 
-pub fn SolverPass(self: *CollisionManager, comptime world_type: EngineContext.WorldType, engine_context: *EngineContext) !void {
-    for (0..SOLVER_ITERS) |_| {
-        for (self._BlockingContacts.items) |contact| {
-            const entity_origin = contact.mOrigin;
-            const entity_target = contact.mTarget;
+/// Resolves the blocking contacts. Contacts are gathered into flat solver arrays, graph coloured
+/// into batches that share no dynamic body and the batches are solved across the worker pool.
+/// The position corrections only mark the transforms dirty, the next world transform update picks them up.
+pub fn SolverPass(self: *CollisionManager, engine_context: *EngineContext) !void {
+    const zone = Tracy.ZoneInit("CollisionManager::SolverPass", @src());
+    defer zone.Deinit();
+
+    const scene_manager = self._ProxySceneManager orelse return;
+    try self.SolveBlocking(engine_context.EngineAllocator(), engine_context.FrameAllocator(), &engine_context.mWorkerPool, SceneBodies{ .mSceneManager = scene_manager });
+}
 
-            const q_rb_origin = entity_origin.GetComponent(RigidBodyComponent);
-            const q_rb_target = entity_target.GetComponent(RigidBodyComponent);
+/// Solves the blocking contacts of the last narrowphase. bodies is where the rigid bodies live, it needs
+/// GetBody(entity_id) ?SolverBody, null for entities without one, and SetBody(entity_id, body) to write
+/// the solved velocity and position correction back. SolverPass hands it the scene through SceneBodies
+pub fn SolveBlocking(self: *CollisionManager, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, worker_pool: *WorkerPool, bodies: anytype) !void {
+    self._SolverBodies.clearRetainingCapacity();
+    self._SolverContacts.clearRetainingCapacity();
+    self._SolverEntities.clearRetainingCapacity();
 
-            if (q_rb_origin) |rb_origin| {
-                if (q_rb_target) |rb_target| {
-                    if (rb_origin._InvMass == 0 and rb_target._InvMass == 0) continue;
+    var body_lookup: std.AutoHashMapUnmanaged(Entity.Type, u32) = .empty;
 
-                    VelocityCorrection(contact, rb_origin, rb_target);
-                    PositionCorrection(contact, entity_origin, rb_origin, entity_target, rb_target);
-                }
-            }
+    for (self._BlockingContacts.items) |contact| {
+        const body_origin = bodies.GetBody(contact.mOrigin.mEntityID) orelse continue;
+        const body_target = bodies.GetBody(contact.mTarget.mEntityID) orelse continue;
+        if (body_origin.InvMass == 0 and body_target.InvMass == 0) continue;
+
+        const key = GetPairKey(contact);
+        const cache = self._LastCache.get(key) orelse ContactCache.empty;
+
+        try self._SolverContacts.append(engine_allocator, .{
+            .BodyA = try self.GetSolverBody(engine_allocator, frame_allocator, &body_lookup, contact.mOrigin.mEntityID, body_origin),
+            .BodyB = try self.GetSolverBody(engine_allocator, frame_allocator, &body_lookup, contact.mTarget.mEntityID, body_target),
+            .Normal = contact.mNormal,
+            .Penetration = contact.mPenetration,
+            .AccumImpulse = cache.AccumImpulse,
+            .Key = key,
+        });
+    }
+
+    if (self._SolverContacts.items.len == 0) return;
+
+    try self._Solver.Prepare(engine_allocator, self._SolverBodies.items, self._SolverContacts.items);
+    self._Solver.Solve(worker_pool, self._SolverBodies.items, .{
+        .Iterations = SOLVER_ITERS,
+        .Percent = PERCENT,
+        .Slop = SLOP,
+        .Restitution = 0.0,
+    });
+
+    //keep the accumulated impulses around so next step can warm start from them
+    for (self._Solver.GetContacts()) |solver_contact| {
+        if (self._CurrentCache.getPtr(solver_contact.Key)) |cache| {
+            cache.AccumImpulse = solver_contact.AccumImpulse;
         }
-        try UpdateWorldTransforms(world_type, engine_context);
+    }
+
+    for (self._SolverEntities.items, self._SolverBodies.items) |entity_id, body| {
+        if (body.InvMass == 0) continue;
+        bodies.SetBody(entity_id, body);
     }
 }
 
+/// The rigid bodies of a scene as SolveBlocking reads and writes them
+const SceneBodies = struct {
+    mSceneManager: *SceneManager,
+
+    pub fn GetBody(self: SceneBodies, entity_id: Entity.Type) ?SolverBody {
+        const rigid_body = self.mSceneManager.GetEntity(entity_id).GetComponent(RigidBodyComponent) orelse return null;
+        return .{
+            .Velocity = rigid_body._Velocity,
+            .PositionCorrection = .{ .x = 0, .y = 0, .z = 0 },
+            .InvMass = rigid_body._InvMass,
+        };
+    }
+
+    pub fn SetBody(self: SceneBodies, entity_id: Entity.Type, body: SolverBody) void {
+        const entity = self.mSceneManager.GetEntity(entity_id);
+        const rigid_body = entity.GetComponent(RigidBodyComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+        rigid_body._Velocity = body.Velocity;
+        if (!std.meta.eql(body.PositionCorrection, std.mem.zeroes(Vec3(f32)))) {
+            transform.SetTranslation(transform.Translation.AddVec(body.PositionCorrection));
+        }
+    }
+};
+
 pub fn PostsolverPass(self: *CollisionManager, engine_context: *EngineContext) !void {
     _ = engine_context;
     for (self._OverlapContacts.items) |contact| {
@@ -228,56 +523,286 @@ pub fn PostsolverPass(self: *CollisionManager, engine_context: *EngineContext) !
 }
 
 pub fn EndPass(self: *CollisionManager, engine_context: *EngineContext) !void {
-    self._LastCache.deinit(engine_context.EngineAllocator());
-    self._LastCache = self._CurrentCache;
-    self._CurrentCache = .empty;
-    self._BlockingContacts.clearAndFree(engine_context.EngineAllocator());
-    self._OverlapContacts.clearAndFree(engine_context.EngineAllocator());
+    _ = engine_context;
+    self.EndStep();
+}
+
+/// This step's cache becomes the one the next step diffs against, both maps keep their capacity
+pub fn EndStep(self: *CollisionManager) void {
+    std.mem.swap(std.AutoArrayHashMapUnmanaged(u64, ContactCache), &self._LastCache, &self._CurrentCache);
+    self._CurrentCache.clearRetainingCapacity();
+    self._BlockingContacts.clearRetainingCapacity();
+    self._OverlapContacts.clearRetainingCapacity();
+    self._Pairs.clearRetainingCapacity();
 }
 
-fn GetCollisionType(collider_origin: *ColliderComponent, collider_target: *ColliderComponent) CollisionType {
-    const intersection_a = collider_origin.mCollisionFilter.CategoryMask.intersectWith(collider_target.mCollisionFilter.RespondMask);
-    const intersection_b = collider_target.mCollisionFilter.CategoryMask.intersectWith(collider_origin.mCollisionFilter.RespondMask);
-    if (intersection_a.findFirstSet == null or intersection_b.findFirstSet == null) { //if either results in an empty bitset then they do not collide at all
+pub fn GetCollisionType(collider_origin: *ColliderComponent, collider_target: *ColliderComponent) CollisionType {
+    return GetFilterCollisionType(collider_origin.mCollisionFilter, collider_target.mCollisionFilter);
+}
+
+pub fn GetFilterCollisionType(filter_origin: CollisionFilter, filter_target: CollisionFilter) CollisionType {
+    const intersection_a = filter_origin.CategoryMask.intersectWith(filter_target.RespondMask);
+    const intersection_b = filter_target.CategoryMask.intersectWith(filter_origin.RespondMask);
+    if (intersection_a.findFirstSet() == null or intersection_b.findFirstSet() == null) { //if either results in an empty bitset then they do not collide at all
         return .Ignore;
     }
 
     //if we get here we collide but we need to check trigger to see first
 
-    if (collider_origin.mCollisionFilter.IsTrigger or collider_target.mCollisionFilter.IsTrigger) {
+    if (filter_origin.IsTrigger or filter_target.IsTrigger) {
         return .Overlap;
     }
 
     return .Block;
 }
 
-fn VelocityCorrection(contact: Contact, rb_origin: *RigidBodyComponent, rb_target: *RigidBodyComponent) void {
-    const zone = Tracy.ZoneInit("CollisionManager::ResolveCollisions", @src());
-    defer zone.Deinit();
-    const rv = rb_target._Velocity.SubVec(rb_origin._Velocity);
+fn WantsEvents(filter_origin: CollisionFilter, filter_target: CollisionFilter) bool {
+    return filter_origin.EventMask.intersectWith(filter_target.CategoryMask).findFirstSet() != null or
+        filter_target.EventMask.intersectWith(filter_origin.CategoryMask).findFirstSet() != null;
+}
+
+fn GetPairKey(contact: Contact) u64 {
+    return GetEntityPairKey(contact.mOrigin.mEntityID, contact.mTarget.mEntityID);
+}
+
+/// Same key whichever side of the pair comes first, the lower entity id goes in the high bits
+/// so the End events can read origin and target back out of it
+fn GetEntityPairKey(origin_id: Entity.Type, target_id: Entity.Type) u64 {
+    return @as(u64, @min(origin_id, target_id)) << 32 | @as(u64, @max(origin_id, target_id));
+}
+
+//broadphase pairs put the proxy with the lower entity id first whatever order the proxies are in,
+//so a pair keeps its key, its events and the direction of its normal when proxies are reordered
+fn MakePair(proxies: []const ColliderProxy, a: u32, b: u32, overlap: bool) BroadPair {
+    const swap = proxies[a].mEntityID > proxies[b].mEntityID;
+    return .{
+        .Key = GetEntityPairKey(proxies[a].mEntityID, proxies[b].mEntityID),
+        .Origin = if (swap) b else a,
+        .Target = if (swap) a else b,
+        .Overlap = overlap,
+    };
+}
+
+fn GetSolverBody(self: *CollisionManager, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, body_lookup: *std.AutoHashMapUnmanaged(Entity.Type, u32), entity_id: Entity.Type, body: SolverBody) !u32 {
+    const result = try body_lookup.getOrPut(frame_allocator, entity_id);
+    if (!result.found_existing) {
+        result.value_ptr.* = @intCast(self._SolverBodies.items.len);
+        try self._SolverBodies.append(engine_allocator, body);
+        try self._SolverEntities.append(engine_allocator, entity_id);
+    }
+    return result.value_ptr.*;
+}
+
+//proxies and manifolds the way the broadphase and the narrowphase leave them. Entities only carry the
+//scene manager along and RecordContacts never reads it, so the tests go without a scene
+const TestEvents = struct {
+    const Expected = struct {
+        Type: CollisionEventType,
+        Origin: Entity.Type,
+        Target: Entity.Type,
+    };
+    const ENTITY_OFFSET: Entity.Type = 10;
+
+    fn AddProxy(collision_manager: *CollisionManager, allocator: std.mem.Allocator, category: usize, event_category: ?usize, is_trigger: bool) !void {
+        var filter: CollisionFilter = .default;
+        filter.CategoryMask.set(category);
+        if (event_category) |event| filter.EventMask.set(event);
+        filter.IsTrigger = is_trigger;
+        try collision_manager._Proxies.append(allocator, .{
+            .mEntityID = @as(Entity.Type, @intCast(collision_manager._Proxies.items.len)) + ENTITY_OFFSET,
+            .mShape = .{ .Sphere = 0.5 },
+            .mPosition = .{ .x = 0, .y = 0, .z = 0 },
+            .mFilter = filter,
+        });
+    }
+
+    //a and b in whatever order the broadphase happened to find them
+    fn Touching(collision_manager: *const CollisionManager, a: u32, b: u32) Narrowphase.Manifold {
+        const proxies = collision_manager._Proxies.items;
+        const overlap = proxies[a].mFilter.IsTrigger or proxies[b].mFilter.IsTrigger;
+        const pair = MakePair(proxies, a, b, overlap);
+        return .{
+            .Key = pair.Key,
+            .Origin = pair.Origin,
+            .Target = pair.Target,
+            .Overlap = overlap,
+            .Normal = if (overlap) .{ .x = 0, .y = 0, .z = 0 } else .{ .x = 0, .y = 1, .z = 0 },
+            .Penetration = if (overlap) 0 else 0.01,
+        };
+    }
+
+    //one substep in its own frame, the events of the step stay readable until the next one
+    fn Step(collision_manager: *CollisionManager, allocator: std.mem.Allocator, manifolds: []const Narrowphase.Manifold) !void {
+        const scene_manager: *SceneManager = undefined;
+        collision_manager.StartFrame();
+        try collision_manager.RecordContacts(allocator, scene_manager, manifolds);
+        collision_manager.EndStep();
+    }
+
+    //End events come out of the cache in no set order, the rest in manifold order
+    fn ExpectEvents(collision_manager: *const CollisionManager, expected: []const Expected) !void {
+        const events = collision_manager.GetCollisionEvents();
+        try std.testing.expectEqual(expected.len, events.len);
+        for (expected) |want| {
+            const found = for (events) |event| {
+                if (event.mType == want.Type and event.mOrigin.mEntityID == want.Origin and event.mTarget.mEntityID == want.Target) break event;
+            } else return error.TestExpectedEvent;
+            if (want.Type == .End) try std.testing.expectEqual(Vec3(f32){ .x = 0, .y = 0, .z = 0 }, found.mNormal);
+        }
+    }
+};
+
+test "Collision events go Begin, Stay, End and triggers skip Stay" {
+    const allocator = std.testing.allocator;
+    var collision_manager: CollisionManager = .empty;
+    try collision_manager.Init(allocator);
+    defer collision_manager.Deinit(allocator);
 
-    const vel_along_norm = rv.Dot(contact.mNormal);
-    if (vel_along_norm > 0) return; //they are already moving apart
+    //a listener for category 1, a solid body and a trigger in category 1
+    try TestEvents.AddProxy(&collision_manager, allocator, 0, 1, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 1, null, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 1, null, true);
+    const solid = TestEvents.Touching(&collision_manager, 0, 1);
+    const trigger = TestEvents.Touching(&collision_manager, 0, 2);
 
-    const e: f32 = 0.0; //coefficient of restitution
+    try TestEvents.Step(&collision_manager, allocator, &.{ solid, trigger });
+    try TestEvents.ExpectEvents(&collision_manager, &.{ .{ .Type = .Begin, .Origin = 10, .Target = 11 }, .{ .Type = .Begin, .Origin = 10, .Target = 12 } });
 
-    const j = (-(1.0 + e) * vel_along_norm) / (rb_origin._InvMass + rb_target._InvMass); //magnitude of the impulse
+    try TestEvents.Step(&collision_manager, allocator, &.{ solid, trigger });
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .Stay, .Origin = 10, .Target = 11 }});
 
-    const impulse = contact.mNormal.MulScalar(j);
+    //the solid pair separates, the trigger pair is still overlapping
+    try TestEvents.Step(&collision_manager, allocator, &.{trigger});
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .End, .Origin = 10, .Target = 11 }});
 
-    rb_origin.ApplyImpulse(impulse.Neg());
-    rb_target.ApplyImpulse(impulse);
+    try TestEvents.Step(&collision_manager, allocator, &.{});
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .End, .Origin = 10, .Target = 12 }});
+
+    //nothing left touching, nothing to report
+    try TestEvents.Step(&collision_manager, allocator, &.{});
+    try TestEvents.ExpectEvents(&collision_manager, &.{});
+
+    //touching again starts over with Begin
+    try TestEvents.Step(&collision_manager, allocator, &.{solid});
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .Begin, .Origin = 10, .Target = 11 }});
 }
 
-fn PositionCorrection(contact: Contact, entity_origin: Entity, rb_origin: *RigidBodyComponent, entity_target: Entity, rb_target: *RigidBodyComponent) void {
-    const zone = Tracy.ZoneInit("CollisionManager::PositionCorrection", @src());
-    defer zone.Deinit();
-    const correction_mag = (@max(contact.mPenetration - SLOP, 0.0)) / (rb_origin._InvMass + rb_target._InvMass) * PERCENT;
-    const correction = contact.mNormal.MulScalar(correction_mag);
+test "Collision events keep their pair when the proxies are reordered" {
+    const allocator = std.testing.allocator;
+    var collision_manager: CollisionManager = .empty;
+    try collision_manager.Init(allocator);
+    defer collision_manager.Deinit(allocator);
+
+    try TestEvents.AddProxy(&collision_manager, allocator, 0, 1, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 1, null, false);
+
+    try TestEvents.Step(&collision_manager, allocator, &.{TestEvents.Touching(&collision_manager, 0, 1)});
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .Begin, .Origin = 10, .Target = 11 }});
+    try collision_manager.PutContactCache(allocator, GetEntityPairKey(10, 11), .{ .AccumImpulse = 2.5, .Events = true });
 
-    const transform_origin = entity_origin.GetComponent(EntityTransformComponent).?;
-    const transform_target = entity_target.GetComponent(EntityTransformComponent).?;
+    //the next broadphase sees the colliders the other way around, the pair stays and so does its warm start
+    std.mem.swap(ColliderProxy, &collision_manager._Proxies.items[0], &collision_manager._Proxies.items[1]);
+    const reordered = TestEvents.Touching(&collision_manager, 0, 1);
+    try std.testing.expectEqual(GetEntityPairKey(10, 11), reordered.Key);
+    try std.testing.expectEqual(@as(u32, 1), reordered.Origin);
+    try std.testing.expectEqual(@as(f32, 2.5), collision_manager.GetContactCache().get(reordered.Key).?.AccumImpulse);
 
-    transform_origin.Translation.SubEqVec(correction.MulScalar(rb_origin._InvMass));
-    transform_target.Translation.AddEqVec(correction.MulScalar(rb_target._InvMass));
+    try TestEvents.Step(&collision_manager, allocator, &.{reordered});
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .Stay, .Origin = 10, .Target = 11 }});
+
+    try TestEvents.Step(&collision_manager, allocator, &.{});
+    try TestEvents.ExpectEvents(&collision_manager, &.{.{ .Type = .End, .Origin = 10, .Target = 11 }});
+}
+
+test "Collision events only for pairs the EventMask asks about" {
+    const allocator = std.testing.allocator;
+    var collision_manager: CollisionManager = .empty;
+    try collision_manager.Init(allocator);
+    defer collision_manager.Deinit(allocator);
+
+    //0 listens for category 2, 1 to 3 are category 1 to 3 and listen for nothing, 4 is category 2 and listens for 3
+    try TestEvents.AddProxy(&collision_manager, allocator, 0, 2, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 1, null, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 2, null, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 3, null, false);
+    try TestEvents.AddProxy(&collision_manager, allocator, 2, 3, false);
+    const unwatched = TestEvents.Touching(&collision_manager, 0, 1);
+    const watched = TestEvents.Touching(&collision_manager, 0, 2);
+    //the listener is the second entity here, either side of the pair asking is enough
+    const watched_by_target = TestEvents.Touching(&collision_manager, 4, 3);
+    const silent = TestEvents.Touching(&collision_manager, 1, 3);
+    const manifolds = [_]Narrowphase.Manifold{ unwatched, watched, watched_by_target, silent };
+
+    try TestEvents.Step(&collision_manager, allocator, &manifolds);
+    try TestEvents.ExpectEvents(&collision_manager, &.{ .{ .Type = .Begin, .Origin = 10, .Target = 12 }, .{ .Type = .Begin, .Origin = 13, .Target = 14 } });
+    //pairs without events still become contacts
+    try std.testing.expectEqual(@as(usize, 4), collision_manager._LastCache.count());
+    try std.testing.expect(!collision_manager._LastCache.get(unwatched.Key).?.Events);
+    try std.testing.expect(collision_manager._LastCache.get(watched.Key).?.Events);
+
+    try TestEvents.Step(&collision_manager, allocator, &manifolds);
+    try TestEvents.ExpectEvents(&collision_manager, &.{ .{ .Type = .Stay, .Origin = 10, .Target = 12 }, .{ .Type = .Stay, .Origin = 13, .Target = 14 } });
+
+    //separating only ends the pairs that had events
+    try TestEvents.Step(&collision_manager, allocator, &.{});
+    try TestEvents.ExpectEvents(&collision_manager, &.{ .{ .Type = .End, .Origin = 10, .Target = 12 }, .{ .Type = .End, .Origin = 13, .Target = 14 } });
+}
+
+//rigid bodies by entity id, all SolveBlocking needs to know about a scene
+const TestBodies = struct {
+    mBodies: []SolverBody,
+
+    pub fn GetBody(self: TestBodies, entity_id: Entity.Type) ?SolverBody {
+        return if (entity_id < self.mBodies.len) self.mBodies[entity_id] else null;
+    }
+
+    pub fn SetBody(self: TestBodies, entity_id: Entity.Type, body: SolverBody) void {
+        self.mBodies[entity_id] = body;
+    }
+};
+
+test "Stepping set proxies honours the layer matrix and warm starts the solved pairs" {
+    const allocator = std.testing.allocator;
+    var frame_arena = std.heap.ArenaAllocator.init(allocator);
+    defer frame_arena.deinit();
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, 0);
+    defer pool.Deinit(allocator);
+
+    var collision_manager: CollisionManager = .empty;
+    try collision_manager.Init(allocator);
+    defer collision_manager.Deinit(allocator);
+
+    //a static floor, a box sunk into it and a box on a layer the floor's layer does not collide with
+    var filter: CollisionFilter = .default;
+    filter.CategoryMask.set(0);
+    filter.RespondMask.set(0);
+    var ghost_filter = filter;
+    ghost_filter.Layer = 1;
+    collision_manager.mLayerMatrix.SetCollides(0, 1, false);
+
+    const box = CCD.Shape{ .Box = .{ .x = 0.5, .y = 0.5, .z = 0.5 } };
+    const proxies = [_]ColliderProxy{
+        .{ .mEntityID = 0, .mShape = .{ .Box = .{ .x = 5, .y = 0.5, .z = 5 } }, .mPosition = .{ .x = 0, .y = -0.5, .z = 0 }, .mFilter = filter },
+        .{ .mEntityID = 1, .mShape = box, .mPosition = .{ .x = 0, .y = 0.4, .z = 0 }, .mFilter = filter },
+        .{ .mEntityID = 2, .mShape = box, .mPosition = .{ .x = 3, .y = 0.4, .z = 0 }, .mFilter = ghost_filter },
+    };
+    const at_rest = SolverBody{ .Velocity = .{ .x = 0, .y = 0, .z = 0 }, .PositionCorrection = .{ .x = 0, .y = 0, .z = 0 }, .InvMass = 1 };
+    var bodies = [_]SolverBody{ at_rest, at_rest, at_rest };
+    bodies[0].InvMass = 0;
+
+    //nothing here reads through the entities, so the tests go without a scene like TestEvents
+    const scene_manager: *SceneManager = undefined;
+    try collision_manager.SetProxies(allocator, scene_manager, &proxies);
+    try collision_manager.FindPairs(allocator);
+    try std.testing.expectEqual(@as(usize, 1), collision_manager._Pairs.items.len);
+
+    try collision_manager.FindContacts(allocator, &pool);
+    try collision_manager.SolveBlocking(allocator, frame_arena.allocator(), &pool, TestBodies{ .mBodies = &bodies });
+    try std.testing.expect(!std.meta.eql(at_rest, bodies[1]));
+    try std.testing.expectEqual(at_rest, bodies[2]);
+
+    collision_manager.EndStep();
+    try std.testing.expect(collision_manager.GetContactCache().get(GetEntityPairKey(0, 1)).?.AccumImpulse != 0);
 }
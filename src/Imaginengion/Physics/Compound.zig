@@ -0,0 +1,318 @@
+//! Many convex sub shapes that move as one body and share one broadphase proxy.
+//!
+//! The sub shapes sit at offsets from the body position and are kept in a small local BVH. Pair
+//! tests and queries against the compound first walk that tree (the mid phase) and only run the
+//! exact shape tests on the sub shapes whose bounds are touched, so a body made of 64 pieces costs
+//! one broadphase entry and a handful of shape tests instead of 64 of each.
+//!
+//! The pipeline keeps one contact per pair, so a pair with a compound reports the deepest of its
+//! sub shape contacts. Like the rest of the physics, rotation is ignored.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const BVH = @import("BVH.zig");
+const AABB = BVH.AABB;
+const CCD = @import("CCD.zig");
+const Shapes = @import("Shapes.zig");
+const Shape = Shapes.Shape;
+const Separation = Shapes.Separation;
+
+const Compound = @This();
+
+pub const SubShape = struct {
+    Shape: Shape,
+    /// From the body position to the center of the shape
+    Offset: Vec3(f32),
+};
+
+//returned when no sub shape is near enough to test, only the sign matters to the callers
+const NO_SEPARATION = Separation{ .Distance = std.math.floatMax(f32), .Normal = .{ .x = 0, .y = 1, .z = 0 } };
+
+pub const empty: Compound = .{
+    ._SubShapes = .empty,
+    ._SubBounds = .empty,
+    ._BVH = .empty,
+    ._LocalBounds = .empty,
+};
+
+_SubShapes: std.ArrayList(SubShape),
+_SubBounds: std.ArrayList(AABB),
+_BVH: BVH,
+_LocalBounds: AABB,
+
+pub fn Deinit(self: *Compound, engine_allocator: std.mem.Allocator) void {
+    self._SubShapes.deinit(engine_allocator);
+    self._SubBounds.deinit(engine_allocator);
+    self._BVH.Deinit(engine_allocator);
+}
+
+/// Replaces the sub shapes and rebuilds the local tree, capacity is kept between builds
+pub fn Build(self: *Compound, engine_allocator: std.mem.Allocator, sub_shapes: []const SubShape) !void {
+    try self._SubShapes.resize(engine_allocator, sub_shapes.len);
+    try self._SubBounds.resize(engine_allocator, sub_shapes.len);
+    @memcpy(self._SubShapes.items, sub_shapes);
+
+    self._LocalBounds = .empty;
+    for (sub_shapes, self._SubBounds.items) |sub_shape, *bounds| {
+        bounds.* = AABB.FromCenter(sub_shape.Offset, Shapes.GetHalfExtents(sub_shape.Shape));
+        self._LocalBounds = self._LocalBounds.Union(bounds.*);
+    }
+
+    try self._BVH.Build(engine_allocator, self._SubBounds.items);
+}
+
+pub fn GetSubShapes(self: *const Compound) []const SubShape {
+    return self._SubShapes.items;
+}
+
+/// World bounds of every sub shape with the body at position
+pub fn GetBounds(self: *const Compound, position: Vec3(f32)) AABB {
+    if (self._SubShapes.items.len == 0) return AABB.FromCenter(position, Vec3(f32).FromScalar(0));
+    return .{ .Min = self._LocalBounds.Min.AddVec(position), .Max = self._LocalBounds.Max.AddVec(position) };
+}
+
+/// Deepest separation between the compound at position and shape at shape_position,
+/// the normal points from shape towards the compound like CCD.GetSeparation
+pub fn GetSeparation(self: *const Compound, position: Vec3(f32), shape: Shape, shape_position: Vec3(f32)) Separation {
+    const Deepest = struct {
+        mCompound: *const Compound,
+        mPosition: Vec3(f32),
+        mShape: Shape,
+        mShapePosition: Vec3(f32),
+        mResult: *Separation,
+
+        fn Visit(ctx: @This(), item: u32) void {
+            const sub_shape = ctx.mCompound._SubShapes.items[item];
+            const separation = CCD.GetSeparation(sub_shape.Shape, ctx.mPosition.AddVec(sub_shape.Offset), ctx.mShape, ctx.mShapePosition);
+            if (separation.Distance < ctx.mResult.Distance) ctx.mResult.* = separation;
+        }
+    };
+
+    var result = NO_SEPARATION;
+    const local_bounds = AABB.FromCenter(shape_position.SubVec(position), Shapes.GetHalfExtents(shape));
+    self._BVH.QueryAABB(local_bounds, Deepest{
+        .mCompound = self,
+        .mPosition = position,
+        .mShape = shape,
+        .mShapePosition = shape_position,
+        .mResult = &result,
+    }, Deepest.Visit);
+    return result;
+}
+
+/// Deepest separation between two compounds, the normal points from b towards a
+pub fn GetCompoundSeparation(compound_a: *const Compound, position_a: Vec3(f32), compound_b: *const Compound, position_b: Vec3(f32)) Separation {
+    var result = NO_SEPARATION;
+    if (!compound_a.GetBounds(position_a).Overlaps(compound_b.GetBounds(position_b))) return result;
+
+    for (compound_a._SubShapes.items) |sub_shape| {
+        const separation = compound_b.GetSeparation(position_b, sub_shape.Shape, position_a.AddVec(sub_shape.Offset));
+        if (separation.Distance < result.Distance) {
+            result = .{ .Distance = separation.Distance, .Normal = separation.Normal.MulScalar(-1) };
+        }
+    }
+    return result;
+}
+
+/// Separation between two proxies that are either a plain shape (compound null) or a compound,
+/// the normal points from b towards a
+pub fn GetProxySeparation(compound_a: ?*const Compound, shape_a: Shape, position_a: Vec3(f32), compound_b: ?*const Compound, shape_b: Shape, position_b: Vec3(f32)) Separation {
+    if (compound_a) |a| {
+        if (compound_b) |b| return GetCompoundSeparation(a, position_a, b, position_b);
+        return a.GetSeparation(position_a, shape_b, position_b);
+    }
+    if (compound_b) |b| {
+        const separation = b.GetSeparation(position_b, shape_a, position_a);
+        return .{ .Distance = separation.Distance, .Normal = separation.Normal.MulScalar(-1) };
+    }
+    return CCD.GetSeparation(shape_a, position_a, shape_b, position_b);
+}
+
+/// True if any sub shape of the compound at position overlaps shape at shape_position
+pub fn Overlaps(self: *const Compound, position: Vec3(f32), shape: Shape, shape_position: Vec3(f32)) bool {
+    const Any = struct {
+        mCompound: *const Compound,
+        mPosition: Vec3(f32),
+        mShape: Shape,
+        mShapePosition: Vec3(f32),
+        mFound: *bool,
+
+        fn Visit(ctx: @This(), item: u32) void {
+            if (ctx.mFound.*) return;
+            const sub_shape = ctx.mCompound._SubShapes.items[item];
+            ctx.mFound.* = CCD.Overlaps(sub_shape.Shape, ctx.mPosition.AddVec(sub_shape.Offset), ctx.mShape, ctx.mShapePosition);
+        }
+    };
+
+    var found = false;
+    const local_bounds = AABB.FromCenter(shape_position.SubVec(position), Shapes.GetHalfExtents(shape));
+    self._BVH.QueryAABB(local_bounds, Any{
+        .mCompound = self,
+        .mPosition = position,
+        .mShape = shape,
+        .mShapePosition = shape_position,
+        .mFound = &found,
+    }, Any.Visit);
+    return found;
+}
+
+/// Overlap test between two proxies that are either a plain shape (compound null) or a compound
+pub fn GetProxyOverlap(compound_a: ?*const Compound, shape_a: Shape, position_a: Vec3(f32), compound_b: ?*const Compound, shape_b: Shape, position_b: Vec3(f32)) bool {
+    const a = compound_a orelse {
+        if (compound_b) |b| return b.Overlaps(position_b, shape_a, position_a);
+        return CCD.Overlaps(shape_a, position_a, shape_b, position_b);
+    };
+    const b = compound_b orelse return a.Overlaps(position_a, shape_b, position_b);
+
+    if (!a.GetBounds(position_a).Overlaps(b.GetBounds(position_b))) return false;
+    for (a._SubShapes.items) |sub_shape| {
+        if (b.Overlaps(position_b, sub_shape.Shape, position_a.AddVec(sub_shape.Offset))) return true;
+    }
+    return false;
+}
+
+/// Closest sub shape hit by the ray within max_distance, direction must be normalized
+pub fn RayCast(self: *const Compound, position: Vec3(f32), origin: Vec3(f32), direction: Vec3(f32), max_distance: f32) ?CCD.RayImpact {
+    const Closest = struct {
+        mCompound: *const Compound,
+        mPosition: Vec3(f32),
+        mOrigin: Vec3(f32),
+        mDirection: Vec3(f32),
+        mHit: *?CCD.RayImpact,
+
+        fn Visit(ctx: @This(), item: u32, max_t: f32) f32 {
+            const sub_shape = ctx.mCompound._SubShapes.items[item];
+            const impact = CCD.RayCastShape(sub_shape.Shape, ctx.mPosition.AddVec(sub_shape.Offset), ctx.mOrigin, ctx.mDirection, max_t) orelse return max_t;
+            ctx.mHit.* = impact;
+            return impact.Distance;
+        }
+    };
+
+    var hit: ?CCD.RayImpact = null;
+    self._BVH.QueryRay(origin.SubVec(position), direction, max_distance, Vec3(f32).FromScalar(0), Closest{
+        .mCompound = self,
+        .mPosition = position,
+        .mOrigin = origin,
+        .mDirection = direction,
+        .mHit = &hit,
+    }, Closest.Visit);
+    return hit;
+}
+
+/// First time shape touches any sub shape while it moves by motion and the compound stays at position.
+/// Same rules as CCD.TimeOfImpact, the normal points from the compound towards shape
+pub fn TimeOfImpact(self: *const Compound, position: Vec3(f32), shape: Shape, start: Vec3(f32), motion: Vec3(f32)) ?CCD.Impact {
+    const First = struct {
+        mCompound: *const Compound,
+        mPosition: Vec3(f32),
+        mShape: Shape,
+        mStart: Vec3(f32),
+        mMotion: Vec3(f32),
+        mImpact: *?CCD.Impact,
+
+        fn Visit(ctx: @This(), item: u32) void {
+            const sub_shape = ctx.mCompound._SubShapes.items[item];
+            const impact = CCD.TimeOfImpact(ctx.mShape, ctx.mStart, ctx.mMotion, sub_shape.Shape, ctx.mPosition.AddVec(sub_shape.Offset), Vec3(f32).FromScalar(0)) orelse return;
+            if (ctx.mImpact.* == null or impact.Time < ctx.mImpact.*.?.Time) ctx.mImpact.* = impact;
+        }
+    };
+
+    //every sub shape the swept bounds of the moving shape touch
+    const half = Shapes.GetHalfExtents(shape);
+    const local_start = start.SubVec(position);
+    const swept = AABB.FromCenter(local_start, half).Union(AABB.FromCenter(local_start.AddVec(motion), half));
+
+    var first: ?CCD.Impact = null;
+    self._BVH.QueryAABB(swept, First{
+        .mCompound = self,
+        .mPosition = position,
+        .mShape = shape,
+        .mStart = start,
+        .mMotion = motion,
+        .mImpact = &first,
+    }, First.Visit);
+    return first;
+}
+
+fn MakeTestCompound(allocator: std.mem.Allocator, compound: *Compound) !void {
+    //a row of 8 boxes with a sphere on each end, like a small vehicle
+    var sub_shapes: [10]SubShape = undefined;
+    for (sub_shapes[0..8], 0..) |*sub_shape, i| {
+        sub_shape.* = .{ .Shape = .{ .Box = Vec3(f32).FromScalar(0.5) }, .Offset = .{ .x = @as(f32, @floatFromInt(i)) - 3.5, .y = 0, .z = 0 } };
+    }
+    sub_shapes[8] = .{ .Shape = .{ .Sphere = 0.75 }, .Offset = .{ .x = -4.5, .y = 1, .z = 0 } };
+    sub_shapes[9] = .{ .Shape = .{ .Sphere = 0.75 }, .Offset = .{ .x = 4.5, .y = 1, .z = 0 } };
+    try compound.Build(allocator, &sub_shapes);
+}
+
+test "Compound separation matches testing every sub shape" {
+    const allocator = std.testing.allocator;
+    var compound: Compound = .empty;
+    defer compound.Deinit(allocator);
+    try MakeTestCompound(allocator, &compound);
+
+    const position = Vec3(f32){ .x = 1, .y = 2, .z = 3 };
+    const bounds = compound.GetBounds(position);
+    try std.testing.expectEqual(@as(f32, 1 - 5.25), bounds.Min.x);
+    try std.testing.expectEqual(@as(f32, 1 + 5.25), bounds.Max.x);
+
+    var prng = std.Random.DefaultPrng.init(0x5eed);
+    const random = prng.random();
+    const probe = Shape{ .Sphere = 0.6 };
+    var overlaps: usize = 0;
+
+    for (0..500) |_| {
+        const probe_position = Vec3(f32){
+            .x = position.x + random.float(f32) * 14 - 7,
+            .y = position.y + random.float(f32) * 4 - 2,
+            .z = position.z + random.float(f32) * 4 - 2,
+        };
+
+        //brute force over every sub shape
+        var expected = NO_SEPARATION;
+        for (compound.GetSubShapes()) |sub_shape| {
+            const separation = CCD.GetSeparation(sub_shape.Shape, position.AddVec(sub_shape.Offset), probe, probe_position);
+            if (separation.Distance < expected.Distance) expected = separation;
+        }
+
+        const separation = compound.GetSeparation(position, probe, probe_position);
+        try std.testing.expectEqual(expected.Distance < 0, separation.Distance < 0);
+        if (expected.Distance < 0) {
+            overlaps += 1;
+            try std.testing.expectEqual(expected.Distance, separation.Distance);
+        }
+
+        if (@abs(separation.Distance) > 0.001) {
+            try std.testing.expectEqual(separation.Distance < 0, GetProxyOverlap(&compound, .{ .Sphere = 0 }, position, null, probe, probe_position));
+        }
+
+        //flipping the pair flips the normal
+        const flipped = GetProxySeparation(null, probe, probe_position, &compound, .{ .Sphere = 0 }, position);
+        try std.testing.expectEqual(separation.Distance, flipped.Distance);
+        try std.testing.expectEqual(separation.Normal.y, -flipped.Normal.y);
+    }
+    try std.testing.expect(overlaps > 0);
+}
+
+test "Compound ray casts and sweeps hit the nearest sub shape" {
+    const allocator = std.testing.allocator;
+    var compound: Compound = .empty;
+    defer compound.Deinit(allocator);
+    try MakeTestCompound(allocator, &compound);
+
+    const position = Vec3(f32).FromScalar(0);
+    const down = Vec3(f32){ .x = 0, .y = -1, .z = 0 };
+
+    //straight down onto the right sphere, which sits above the boxes
+    const hit = compound.RayCast(position, .{ .x = 4.5, .y = 10, .z = 0 }, down, 100).?;
+    try std.testing.expectApproxEqAbs(@as(f32, 10 - 1.75), hit.Distance, 1e-4);
+
+    //down through the gap between the end spheres only finds the boxes
+    const box_hit = compound.RayCast(position, .{ .x = 0.25, .y = 10, .z = 0 }, down, 100).?;
+    try std.testing.expectApproxEqAbs(@as(f32, 9.5), box_hit.Distance, 1e-4);
+
+    try std.testing.expect(compound.RayCast(position, .{ .x = 0, .y = 10, .z = 5 }, down, 100) == null);
+
+    const impact = compound.TimeOfImpact(position, .{ .Sphere = 0.5 }, .{ .x = 0.25, .y = 10, .z = 0 }, .{ .x = 0, .y = -20, .z = 0 }).?;
+    try std.testing.expectApproxEqAbs(@as(f32, 9.0 / 20.0), impact.Time, 0.01);
+}
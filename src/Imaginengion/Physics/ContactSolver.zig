@@ -0,0 +1,317 @@
+//! Sequential impulse contact solver that runs constraint batches in parallel.
+//!
+//! Contacts are partitioned with a greedy graph colouring so that no two contacts in
+//! the same batch (colour) touch the same dynamic body. Every contact inside a batch can
+//! then be solved at the same time without locks, and batches are solved one after the
+//! other. The colouring only depends on the order of the input contacts so results are
+//! identical for any number of threads.
+//!
+//! This file only works on plain arrays so it can be used headless by tests and benchmarks.
+//! CollisionManager is responsible for gathering the bodies from the ECS and scattering the
+//! results back out.
+const std = @import("std");
+const WorkerPool = @import("../Core/WorkerPool.zig");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+
+const ContactSolver = @This();
+
+/// Maximum number of colours tracked per body. Contacts that can not find a free colour
+/// are put into a final overflow batch that is solved on the calling thread.
+pub const MAX_COLORS: u32 = 64;
+const ColorMask = u64;
+
+/// How many constraints a worker grabs at a time
+const SOLVE_CHUNK_SIZE: usize = 64;
+
+pub const SolverBody = extern struct {
+    Velocity: Vec3(f32),
+    PositionCorrection: Vec3(f32),
+    InvMass: f32,
+};
+
+pub const SolverContact = extern struct {
+    BodyA: u32,
+    BodyB: u32,
+    Normal: Vec3(f32),
+    Penetration: f32,
+    AccumImpulse: f32,
+    Key: u64,
+};
+
+pub const Batch = struct {
+    Start: usize,
+    End: usize,
+    Parallel: bool,
+};
+
+pub const Settings = struct {
+    pub const default: Settings = .{
+        .Iterations = 4,
+        .Percent = 0.8,
+        .Slop = 0.01,
+        .Restitution = 0.0,
+    };
+    Iterations: u32,
+    Percent: f32,
+    Slop: f32,
+    Restitution: f32,
+};
+
+pub const empty: ContactSolver = .{
+    ._Contacts = .empty,
+    ._Batches = .empty,
+    ._BodyColors = .empty,
+    ._ContactColors = .empty,
+};
+
+_Contacts: std.ArrayList(SolverContact),
+_Batches: std.ArrayList(Batch),
+_BodyColors: std.ArrayList(ColorMask),
+_ContactColors: std.ArrayList(u32),
+
+pub fn Deinit(self: *ContactSolver, engine_allocator: std.mem.Allocator) void {
+    self._Contacts.deinit(engine_allocator);
+    self._Batches.deinit(engine_allocator);
+    self._BodyColors.deinit(engine_allocator);
+    self._ContactColors.deinit(engine_allocator);
+}
+
+/// Colours the contacts and stores them reordered by batch. Bodies with zero inverse mass
+/// are never written to by the solver so they do not take part in the colouring.
+/// The scratch buffers keep their capacity between steps.
+pub fn Prepare(self: *ContactSolver, engine_allocator: std.mem.Allocator, bodies: []const SolverBody, contacts: []const SolverContact) !void {
+    self._Batches.clearRetainingCapacity();
+
+    try self._BodyColors.resize(engine_allocator, bodies.len);
+    @memset(self._BodyColors.items, 0);
+
+    try self._ContactColors.resize(engine_allocator, contacts.len);
+    try self._Contacts.resize(engine_allocator, contacts.len);
+
+    //greedy colouring, each contact takes the lowest colour free on both of its bodies
+    var color_counts = [_]usize{0} ** (MAX_COLORS + 1);
+    for (contacts, 0..) |contact, i| {
+        var used: ColorMask = 0;
+        const a_dynamic = bodies[contact.BodyA].InvMass != 0;
+        const b_dynamic = bodies[contact.BodyB].InvMass != 0;
+        if (a_dynamic) used |= self._BodyColors.items[contact.BodyA];
+        if (b_dynamic) used |= self._BodyColors.items[contact.BodyB];
+
+        const color: u32 = if (used == std.math.maxInt(ColorMask)) MAX_COLORS else @ctz(~used);
+        if (color < MAX_COLORS) {
+            const bit = @as(ColorMask, 1) << @intCast(color);
+            if (a_dynamic) self._BodyColors.items[contact.BodyA] |= bit;
+            if (b_dynamic) self._BodyColors.items[contact.BodyB] |= bit;
+        }
+        self._ContactColors.items[i] = color;
+        color_counts[color] += 1;
+    }
+
+    //stable counting sort by colour so the order inside a batch follows the input order
+    var color_offsets = [_]usize{0} ** (MAX_COLORS + 1);
+    var offset: usize = 0;
+    for (color_counts, 0..) |count, color| {
+        color_offsets[color] = offset;
+        if (count > 0) {
+            try self._Batches.append(engine_allocator, .{
+                .Start = offset,
+                .End = offset + count,
+                .Parallel = color < MAX_COLORS,
+            });
+        }
+        offset += count;
+    }
+    for (contacts, self._ContactColors.items) |contact, color| {
+        self._Contacts.items[color_offsets[color]] = contact;
+        color_offsets[color] += 1;
+    }
+}
+
+/// Solves the prepared contacts. Velocity constraints are iterated settings.Iterations times
+/// and then a single position correction pass is run. Results are written into bodies and
+/// the accumulated impulses are kept on the stored contacts, see GetContacts.
+pub fn Solve(self: *ContactSolver, worker_pool: *WorkerPool, bodies: []SolverBody, settings: Settings) void {
+    //warm start from the impulses cached last step
+    for (self._Batches.items) |batch| {
+        RunBatch(worker_pool, bodies, self._Contacts.items[batch.Start..batch.End], settings, batch.Parallel, .WarmStart);
+    }
+    for (0..settings.Iterations) |_| {
+        for (self._Batches.items) |batch| {
+            RunBatch(worker_pool, bodies, self._Contacts.items[batch.Start..batch.End], settings, batch.Parallel, .Velocity);
+        }
+    }
+    for (self._Batches.items) |batch| {
+        RunBatch(worker_pool, bodies, self._Contacts.items[batch.Start..batch.End], settings, batch.Parallel, .Position);
+    }
+}
+
+/// The contacts in solve order with their final accumulated impulses
+pub fn GetContacts(self: ContactSolver) []const SolverContact {
+    return self._Contacts.items;
+}
+
+pub fn GetBatches(self: ContactSolver) []const Batch {
+    return self._Batches.items;
+}
+
+const SolvePhase = enum {
+    WarmStart,
+    Velocity,
+    Position,
+};
+
+fn RunBatch(worker_pool: *WorkerPool, bodies: []SolverBody, contacts: []SolverContact, settings: Settings, parallel: bool, comptime phase: SolvePhase) void {
+    const Ctx = struct {
+        mBodies: []SolverBody,
+        mContacts: []SolverContact,
+        mSettings: Settings,
+
+        fn Run(ctx: @This(), start: usize, end: usize) void {
+            for (ctx.mContacts[start..end]) |*contact| {
+                switch (phase) {
+                    .WarmStart => WarmStart(ctx.mBodies, contact),
+                    .Velocity => VelocityCorrection(ctx.mBodies, contact, ctx.mSettings),
+                    .Position => PositionCorrection(ctx.mBodies, contact, ctx.mSettings),
+                }
+            }
+        }
+    };
+    const ctx = Ctx{ .mBodies = bodies, .mContacts = contacts, .mSettings = settings };
+
+    if (parallel) {
+        worker_pool.ParallelFor(contacts.len, SOLVE_CHUNK_SIZE, ctx, Ctx.Run);
+    } else {
+        Ctx.Run(ctx, 0, contacts.len);
+    }
+}
+
+fn ApplyImpulse(bodies: []SolverBody, contact: *const SolverContact, impulse: Vec3(f32)) void {
+    const body_a = &bodies[contact.BodyA];
+    const body_b = &bodies[contact.BodyB];
+    //static bodies may be shared between batches so they must never be written to
+    if (body_a.InvMass != 0) body_a.Velocity.SubEqVec(impulse.MulScalar(body_a.InvMass));
+    if (body_b.InvMass != 0) body_b.Velocity.AddEqVec(impulse.MulScalar(body_b.InvMass));
+}
+
+fn WarmStart(bodies: []SolverBody, contact: *SolverContact) void {
+    if (contact.AccumImpulse == 0) return;
+    ApplyImpulse(bodies, contact, contact.Normal.MulScalar(contact.AccumImpulse));
+}
+
+fn VelocityCorrection(bodies: []SolverBody, contact: *SolverContact, settings: Settings) void {
+    const body_a = bodies[contact.BodyA];
+    const body_b = bodies[contact.BodyB];
+    const inv_mass_sum = body_a.InvMass + body_b.InvMass;
+    if (inv_mass_sum == 0) return;
+
+    const rv = body_b.Velocity.SubVec(body_a.Velocity);
+    const vel_along_norm = rv.Dot(contact.Normal);
+
+    //clamp the accumulated impulse instead of the per iteration one so we can push back
+    //impulse that was over applied in an earlier iteration
+    const j = (-(1.0 + settings.Restitution) * vel_along_norm) / inv_mass_sum;
+    const old_accum = contact.AccumImpulse;
+    contact.AccumImpulse = @max(old_accum + j, 0.0);
+    const applied = contact.AccumImpulse - old_accum;
+    if (applied == 0) return;
+
+    ApplyImpulse(bodies, contact, contact.Normal.MulScalar(applied));
+}
+
+fn PositionCorrection(bodies: []SolverBody, contact: *SolverContact, settings: Settings) void {
+    const body_a = &bodies[contact.BodyA];
+    const body_b = &bodies[contact.BodyB];
+    const inv_mass_sum = body_a.InvMass + body_b.InvMass;
+    if (inv_mass_sum == 0) return;
+
+    const correction_mag = (@max(contact.Penetration - settings.Slop, 0.0)) / inv_mass_sum * settings.Percent;
+    const correction = contact.Normal.MulScalar(correction_mag);
+
+    if (body_a.InvMass != 0) body_a.PositionCorrection.SubEqVec(correction.MulScalar(body_a.InvMass));
+    if (body_b.InvMass != 0) body_b.PositionCorrection.AddEqVec(correction.MulScalar(body_b.InvMass));
+}
+
+fn MakeTestScene(allocator: std.mem.Allocator, bodies: *std.ArrayList(SolverBody), contacts: *std.ArrayList(SolverContact)) !void {
+    const zero = Vec3(f32){ .x = 0, .y = 0, .z = 0 };
+    //ground body then a chain of falling bodies each resting on the one below
+    try bodies.append(allocator, .{ .Velocity = zero, .PositionCorrection = zero, .InvMass = 0 });
+    for (0..200) |i| {
+        try bodies.append(allocator, .{
+            .Velocity = .{ .x = 0, .y = -1.0 - @as(f32, @floatFromInt(i % 7)), .z = 0 },
+            .PositionCorrection = zero,
+            .InvMass = 1.0 / (1.0 + @as(f32, @floatFromInt(i % 3))),
+        });
+        try contacts.append(allocator, .{
+            .BodyA = @intCast(i),
+            .BodyB = @intCast(i + 1),
+            .Normal = .{ .x = 0, .y = 1, .z = 0 },
+            .Penetration = 0.02,
+            .AccumImpulse = 0,
+            .Key = i,
+        });
+        //every body also touches the ground
+        try contacts.append(allocator, .{
+            .BodyA = 0,
+            .BodyB = @intCast(i + 1),
+            .Normal = .{ .x = 0, .y = 1, .z = 0 },
+            .Penetration = 0.01,
+            .AccumImpulse = 0,
+            .Key = (@as(u64, 1) << 32) | i,
+        });
+    }
+}
+
+test "Colouring never puts a dynamic body twice in a batch" {
+    const allocator = std.testing.allocator;
+    var bodies: std.ArrayList(SolverBody) = .empty;
+    defer bodies.deinit(allocator);
+    var contacts: std.ArrayList(SolverContact) = .empty;
+    defer contacts.deinit(allocator);
+    try MakeTestScene(allocator, &bodies, &contacts);
+
+    var solver: ContactSolver = .empty;
+    defer solver.Deinit(allocator);
+    try solver.Prepare(allocator, bodies.items, contacts.items);
+
+    const seen = try allocator.alloc(bool, bodies.items.len);
+    defer allocator.free(seen);
+    for (solver.GetBatches()) |batch| {
+        if (!batch.Parallel) continue;
+        @memset(seen, false);
+        for (solver.GetContacts()[batch.Start..batch.End]) |contact| {
+            for ([_]u32{ contact.BodyA, contact.BodyB }) |body| {
+                if (bodies.items[body].InvMass == 0) continue;
+                try std.testing.expect(!seen[body]);
+                seen[body] = true;
+            }
+        }
+    }
+}
+
+test "Solve is deterministic across thread counts" {
+    const allocator = std.testing.allocator;
+    var results: [2][]SolverBody = undefined;
+
+    for ([_]usize{ 0, 3 }, 0..) |worker_count, run| {
+        var pool: WorkerPool = .empty;
+        try pool.Init(allocator, worker_count);
+        defer pool.Deinit(allocator);
+
+        var bodies: std.ArrayList(SolverBody) = .empty;
+        defer bodies.deinit(allocator);
+        var contacts: std.ArrayList(SolverContact) = .empty;
+        defer contacts.deinit(allocator);
+        try MakeTestScene(allocator, &bodies, &contacts);
+
+        var solver: ContactSolver = .empty;
+        defer solver.Deinit(allocator);
+        try solver.Prepare(allocator, bodies.items, contacts.items);
+        solver.Solve(&pool, bodies.items, .default);
+
+        results[run] = try allocator.dupe(SolverBody, bodies.items);
+    }
+    defer for (results) |result| allocator.free(result);
+
+    try std.testing.expectEqualSlices(u8, std.mem.sliceAsBytes(results[0]), std.mem.sliceAsBytes(results[1]));
+}
@@ -0,0 +1,439 @@
+//! General convex narrowphase.
+//!
+//! GJK finds the distance between the cores of two shapes (see Shapes.zig), the margins are then
+//! subtracted to get the real distance. Only when the cores themselves overlap does EPA run on the
+//! full shapes to find the penetration depth, which keeps shallow sphere and capsule contacts exact.
+//! Everything works on fixed size arrays on the stack so it is safe to call from any thread.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Shapes = @import("Shapes.zig");
+const Shape = Shapes.Shape;
+const Separation = Shapes.Separation;
+
+const MAX_GJK_ITERATIONS: u32 = 64;
+const MAX_EPA_ITERATIONS: u32 = 64;
+const MAX_EPA_VERTICES: usize = 64;
+const MAX_EPA_FACES: usize = 128;
+
+const GJK_TOLERANCE: f32 = 1.0e-6;
+const EPA_TOLERANCE: f32 = 1.0e-4;
+
+const Simplex = struct {
+    Points: [4]Vec3(f32) = undefined,
+    Count: usize = 0,
+
+    fn Add(self: *Simplex, point: Vec3(f32)) void {
+        self.Points[self.Count] = point;
+        self.Count += 1;
+    }
+
+    /// Keeps only the points whose bit is set in mask, in order
+    fn Reduce(self: *Simplex, mask: u4) void {
+        var count: usize = 0;
+        for (0..self.Count) |i| {
+            if (mask & (@as(u4, 1) << @intCast(i)) != 0) {
+                self.Points[count] = self.Points[i];
+                count += 1;
+            }
+        }
+        self.Count = count;
+    }
+};
+
+const Closest = struct {
+    Point: Vec3(f32),
+    Mask: u4,
+};
+
+const Pair = struct {
+    ShapeA: Shape,
+    PosA: Vec3(f32),
+    ShapeB: Shape,
+    PosB: Vec3(f32),
+
+    fn CoreSupport(self: Pair, direction: Vec3(f32)) Vec3(f32) {
+        const a = self.PosA.AddVec(Shapes.CoreSupport(self.ShapeA, direction));
+        const b = self.PosB.AddVec(Shapes.CoreSupport(self.ShapeB, direction.Neg()));
+        return a.SubVec(b);
+    }
+
+    fn Support(self: Pair, direction: Vec3(f32)) Vec3(f32) {
+        const a = self.PosA.AddVec(Shapes.Support(self.ShapeA, direction));
+        const b = self.PosB.AddVec(Shapes.Support(self.ShapeB, direction.Neg()));
+        return a.SubVec(b);
+    }
+};
+
+const GJKResult = struct {
+    /// Closest point of the minkowski difference to the origin, zero when overlapping
+    Closest: Vec3(f32),
+    Overlap: bool,
+    Simplex: Simplex,
+};
+
+/// Signed distance between any two shapes and the direction to push a away from b
+pub fn GetSeparation(shape_a: Shape, pos_a: Vec3(f32), shape_b: Shape, pos_b: Vec3(f32)) Separation {
+    const pair = Pair{ .ShapeA = shape_a, .PosA = pos_a, .ShapeB = shape_b, .PosB = pos_b };
+    const margin = Shapes.GetMargin(shape_a) + Shapes.GetMargin(shape_b);
+
+    const core = RunGJK(pair, Pair.CoreSupport);
+    if (!core.Overlap) {
+        const dist = core.Closest.Len();
+        return .{ .Distance = dist - margin, .Normal = core.Closest.DivScalar(dist) };
+    }
+
+    //cores overlap so the margins do not matter, find the depth on the full shapes
+    const full = if (margin == 0) core else RunGJK(pair, Pair.Support);
+    return RunEPA(pair, full.Simplex);
+}
+
+/// True if the shapes touch, cheaper than GetSeparation since it never runs EPA
+pub fn Intersects(shape_a: Shape, pos_a: Vec3(f32), shape_b: Shape, pos_b: Vec3(f32)) bool {
+    const pair = Pair{ .ShapeA = shape_a, .PosA = pos_a, .ShapeB = shape_b, .PosB = pos_b };
+    const core = RunGJK(pair, Pair.CoreSupport);
+    if (core.Overlap) return true;
+    return core.Closest.Len() <= Shapes.GetMargin(shape_a) + Shapes.GetMargin(shape_b);
+}
+
+fn RunGJK(pair: Pair, comptime support: fn (Pair, Vec3(f32)) Vec3(f32)) GJKResult {
+    var simplex = Simplex{};
+
+    var direction = pair.PosA.SubVec(pair.PosB);
+    if (direction.Dot(direction) < GJK_TOLERANCE) direction = .{ .x = 1, .y = 0, .z = 0 };
+
+    var v = support(pair, direction);
+    simplex.Add(v);
+
+    for (0..MAX_GJK_ITERATIONS) |_| {
+        const v_len_sq = v.Dot(v);
+        if (v_len_sq < GJK_TOLERANCE * GJK_TOLERANCE) {
+            return .{ .Closest = Vec3(f32).FromScalar(0), .Overlap = true, .Simplex = simplex };
+        }
+
+        const w = support(pair, v.Neg());
+
+        //no more progress towards the origin, v is the closest point
+        if (v_len_sq - v.Dot(w) <= GJK_TOLERANCE * v_len_sq) break;
+        if (Contains(simplex, w)) break;
+
+        simplex.Add(w);
+        const closest = ClosestOnSimplex(simplex);
+        simplex.Reduce(closest.Mask);
+        v = closest.Point;
+
+        if (simplex.Count == 4) {
+            return .{ .Closest = Vec3(f32).FromScalar(0), .Overlap = true, .Simplex = simplex };
+        }
+    }
+
+    return .{ .Closest = v, .Overlap = false, .Simplex = simplex };
+}
+
+fn Contains(simplex: Simplex, point: Vec3(f32)) bool {
+    for (simplex.Points[0..simplex.Count]) |existing| {
+        if (existing.SubVec(point).Dot(existing.SubVec(point)) < GJK_TOLERANCE * GJK_TOLERANCE) return true;
+    }
+    return false;
+}
+
+fn ClosestOnSimplex(simplex: Simplex) Closest {
+    const p = simplex.Points;
+    return switch (simplex.Count) {
+        1 => .{ .Point = p[0], .Mask = 0b0001 },
+        2 => ClosestOnSegment(p[0], p[1], 0, 1),
+        3 => ClosestOnTriangle(p[0], p[1], p[2], .{ 0, 1, 2 }),
+        4 => ClosestOnTetrahedron(p),
+        else => unreachable,
+    };
+}
+
+fn Bit(index: u2) u4 {
+    return @as(u4, 1) << index;
+}
+
+fn ClosestOnSegment(a: Vec3(f32), b: Vec3(f32), ia: u2, ib: u2) Closest {
+    const ab = b.SubVec(a);
+    const len_sq = ab.Dot(ab);
+    if (len_sq <= 0) return .{ .Point = a, .Mask = Bit(ia) };
+
+    const t = -a.Dot(ab) / len_sq;
+    if (t <= 0) return .{ .Point = a, .Mask = Bit(ia) };
+    if (t >= 1) return .{ .Point = b, .Mask = Bit(ib) };
+    return .{ .Point = a.AddVec(ab.MulScalar(t)), .Mask = Bit(ia) | Bit(ib) };
+}
+
+/// Closest point to the origin on triangle abc from Real-Time Collision Detection 5.1.5,
+/// indices map the corners back to their slot in the simplex
+fn ClosestOnTriangle(a: Vec3(f32), b: Vec3(f32), c: Vec3(f32), indices: [3]u2) Closest {
+    const ab = b.SubVec(a);
+    const ac = c.SubVec(a);
+    const ap = a.Neg();
+
+    const d1 = ab.Dot(ap);
+    const d2 = ac.Dot(ap);
+    if (d1 <= 0 and d2 <= 0) return .{ .Point = a, .Mask = Bit(indices[0]) };
+
+    const bp = b.Neg();
+    const d3 = ab.Dot(bp);
+    const d4 = ac.Dot(bp);
+    if (d3 >= 0 and d4 <= d3) return .{ .Point = b, .Mask = Bit(indices[1]) };
+
+    const vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 and d1 >= 0 and d3 <= 0) {
+        const v = d1 / (d1 - d3);
+        return .{ .Point = a.AddVec(ab.MulScalar(v)), .Mask = Bit(indices[0]) | Bit(indices[1]) };
+    }
+
+    const cp = c.Neg();
+    const d5 = ab.Dot(cp);
+    const d6 = ac.Dot(cp);
+    if (d6 >= 0 and d5 <= d6) return .{ .Point = c, .Mask = Bit(indices[2]) };
+
+    const vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 and d2 >= 0 and d6 <= 0) {
+        const w = d2 / (d2 - d6);
+        return .{ .Point = a.AddVec(ac.MulScalar(w)), .Mask = Bit(indices[0]) | Bit(indices[2]) };
+    }
+
+    const va = d3 * d6 - d5 * d4;
+    if (va <= 0 and (d4 - d3) >= 0 and (d5 - d6) >= 0) {
+        const w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return .{ .Point = b.AddVec(c.SubVec(b).MulScalar(w)), .Mask = Bit(indices[1]) | Bit(indices[2]) };
+    }
+
+    const denom = 1.0 / (va + vb + vc);
+    const v = vb * denom;
+    const w = vc * denom;
+    return .{ .Point = a.AddVec(ab.MulScalar(v)).AddVec(ac.MulScalar(w)), .Mask = Bit(indices[0]) | Bit(indices[1]) | Bit(indices[2]) };
+}
+
+fn ClosestOnTetrahedron(p: [4]Vec3(f32)) Closest {
+    const faces = [4][4]u2{
+        .{ 0, 1, 2, 3 },
+        .{ 0, 2, 3, 1 },
+        .{ 0, 3, 1, 2 },
+        .{ 1, 3, 2, 0 },
+    };
+
+    var best: ?Closest = null;
+    var best_dist_sq = std.math.inf(f32);
+    for (faces) |face| {
+        const a = p[face[0]];
+        const b = p[face[1]];
+        const c = p[face[2]];
+        const opposite = p[face[3]];
+
+        //origin and the opposite corner on the same side means this face can not be closest
+        const normal = b.SubVec(a).Cross(c.SubVec(a));
+        const side_origin = normal.Dot(a.Neg());
+        const side_opposite = normal.Dot(opposite.SubVec(a));
+        if (side_origin * side_opposite >= 0) continue;
+
+        const closest = ClosestOnTriangle(a, b, c, .{ face[0], face[1], face[2] });
+        const dist_sq = closest.Point.Dot(closest.Point);
+        if (dist_sq < best_dist_sq) {
+            best_dist_sq = dist_sq;
+            best = closest;
+        }
+    }
+
+    //origin is inside every face so it is inside the tetrahedron
+    return best orelse .{ .Point = Vec3(f32).FromScalar(0), .Mask = 0b1111 };
+}
+
+const Face = struct {
+    A: u8,
+    B: u8,
+    C: u8,
+    Normal: Vec3(f32),
+    Distance: f32,
+};
+
+const Edge = struct {
+    A: u8,
+    B: u8,
+};
+
+const Polytope = struct {
+    Vertices: [MAX_EPA_VERTICES]Vec3(f32) = undefined,
+    VertexCount: usize = 0,
+    Faces: [MAX_EPA_FACES]Face = undefined,
+    FaceCount: usize = 0,
+
+    fn AddVertex(self: *Polytope, point: Vec3(f32)) u8 {
+        self.Vertices[self.VertexCount] = point;
+        self.VertexCount += 1;
+        return @intCast(self.VertexCount - 1);
+    }
+
+    /// Adds the face with its normal pointing away from the origin, which is inside the polytope
+    fn AddFace(self: *Polytope, a: u8, b: u8, c: u8) void {
+        const pa = self.Vertices[a];
+        var normal = self.Vertices[b].SubVec(pa).Cross(self.Vertices[c].SubVec(pa));
+        const len = normal.Len();
+        //degenerate sliver, its neighbours cover the same area
+        if (len < GJK_TOLERANCE) return;
+        normal = normal.DivScalar(len);
+
+        var distance = normal.Dot(pa);
+        var face = Face{ .A = a, .B = b, .C = c, .Normal = normal, .Distance = distance };
+        if (distance < 0) {
+            distance = -distance;
+            face = .{ .A = a, .B = c, .C = b, .Normal = normal.Neg(), .Distance = distance };
+        }
+        self.Faces[self.FaceCount] = face;
+        self.FaceCount += 1;
+    }
+};
+
+fn RunEPA(pair: Pair, start: Simplex) Separation {
+    var simplex = start;
+    if (!CompleteTetrahedron(pair, &simplex)) {
+        //shapes only touch, there is no volume to expand
+        return .{ .Distance = 0, .Normal = FallbackNormal(pair) };
+    }
+
+    var polytope = Polytope{};
+    for (simplex.Points) |point| _ = polytope.AddVertex(point);
+    polytope.AddFace(0, 1, 2);
+    polytope.AddFace(0, 3, 1);
+    polytope.AddFace(0, 2, 3);
+    polytope.AddFace(1, 3, 2);
+
+    var closest_face = Face{ .A = 0, .B = 0, .C = 0, .Normal = FallbackNormal(pair).Neg(), .Distance = 0 };
+    for (0..MAX_EPA_ITERATIONS) |_| {
+        if (polytope.FaceCount == 0) break;
+
+        var closest_index: usize = 0;
+        for (polytope.Faces[1..polytope.FaceCount], 1..) |face, i| {
+            if (face.Distance < polytope.Faces[closest_index].Distance) closest_index = i;
+        }
+        closest_face = polytope.Faces[closest_index];
+
+        const w = pair.Support(closest_face.Normal);
+        if (w.Dot(closest_face.Normal) - closest_face.Distance < EPA_TOLERANCE) break;
+        if (polytope.VertexCount == MAX_EPA_VERTICES) break;
+
+        //remove every face the new point can see and stitch the hole back up around it
+        var horizon: [MAX_EPA_FACES * 3]Edge = undefined;
+        var horizon_count: usize = 0;
+        var i: usize = 0;
+        while (i < polytope.FaceCount) {
+            const face = polytope.Faces[i];
+            if (face.Normal.Dot(w.SubVec(polytope.Vertices[face.A])) <= 0) {
+                i += 1;
+                continue;
+            }
+            for ([_]Edge{ .{ .A = face.A, .B = face.B }, .{ .A = face.B, .B = face.C }, .{ .A = face.C, .B = face.A } }) |edge| {
+                AddHorizonEdge(&horizon, &horizon_count, edge);
+            }
+            polytope.FaceCount -= 1;
+            polytope.Faces[i] = polytope.Faces[polytope.FaceCount];
+        }
+
+        if (polytope.FaceCount + horizon_count > MAX_EPA_FACES) break;
+
+        const new_vertex = polytope.AddVertex(w);
+        for (horizon[0..horizon_count]) |edge| {
+            polytope.AddFace(edge.A, edge.B, new_vertex);
+        }
+    }
+
+    return .{ .Distance = -closest_face.Distance, .Normal = closest_face.Normal.Neg() };
+}
+
+/// An edge shared by two removed faces is inside the hole, only edges seen once form the horizon
+fn AddHorizonEdge(horizon: []Edge, count: *usize, edge: Edge) void {
+    for (horizon[0..count.*], 0..) |existing, i| {
+        if (existing.A == edge.B and existing.B == edge.A) {
+            count.* -= 1;
+            horizon[i] = horizon[count.*];
+            return;
+        }
+    }
+    horizon[count.*] = edge;
+    count.* += 1;
+}
+
+/// Grows a touching simplex into a tetrahedron with volume, false if the shapes only touch
+fn CompleteTetrahedron(pair: Pair, simplex: *Simplex) bool {
+    const axes = [_]Vec3(f32){
+        .{ .x = 1, .y = 0, .z = 0 },  .{ .x = -1, .y = 0, .z = 0 },
+        .{ .x = 0, .y = 1, .z = 0 },  .{ .x = 0, .y = -1, .z = 0 },
+        .{ .x = 0, .y = 0, .z = 1 },  .{ .x = 0, .y = 0, .z = -1 },
+    };
+
+    if (simplex.Count == 1) {
+        for (axes) |axis| {
+            const w = pair.Support(axis);
+            if (w.SubVec(simplex.Points[0]).Len() > EPA_TOLERANCE) {
+                simplex.Add(w);
+                break;
+            }
+        }
+    }
+    if (simplex.Count == 2) {
+        const line = simplex.Points[1].SubVec(simplex.Points[0]);
+        for (axes[0..3]) |axis| {
+            const dir = line.Cross(axis);
+            if (dir.Len() < GJK_TOLERANCE) continue;
+            const w = pair.Support(dir);
+            if (PointLineDistance(w, simplex.Points[0], line) > EPA_TOLERANCE) {
+                simplex.Add(w);
+                break;
+            }
+            const w_neg = pair.Support(dir.Neg());
+            if (PointLineDistance(w_neg, simplex.Points[0], line) > EPA_TOLERANCE) {
+                simplex.Add(w_neg);
+                break;
+            }
+        }
+    }
+    if (simplex.Count == 3) {
+        const normal = simplex.Points[1].SubVec(simplex.Points[0]).Cross(simplex.Points[2].SubVec(simplex.Points[0])).Dir();
+        var w = pair.Support(normal);
+        if (@abs(normal.Dot(w.SubVec(simplex.Points[0]))) <= EPA_TOLERANCE) w = pair.Support(normal.Neg());
+        if (@abs(normal.Dot(w.SubVec(simplex.Points[0]))) > EPA_TOLERANCE) simplex.Add(w);
+    }
+    return simplex.Count == 4;
+}
+
+fn PointLineDistance(point: Vec3(f32), origin: Vec3(f32), line: Vec3(f32)) f32 {
+    return point.SubVec(origin).Cross(line).Len() / line.Len();
+}
+
+fn FallbackNormal(pair: Pair) Vec3(f32) {
+    const delta = pair.PosA.SubVec(pair.PosB);
+    if (delta.Dot(delta) < GJK_TOLERANCE) return .{ .x = 0, .y = 1, .z = 0 };
+    return delta.Dir();
+}
+
+test "GJK distance matches the analytic answers" {
+    const sphere = Shape{ .Sphere = 1 };
+    const box = Shape{ .Box = Vec3(f32).FromScalar(1) };
+    const capsule = Shape{ .Capsule = .{ .Radius = 0.5, .HalfHeight = 1 } };
+
+    //sphere over a box face
+    const sphere_box = GetSeparation(sphere, .{ .x = 0, .y = 3, .z = 0 }, box, Vec3(f32).FromScalar(0));
+    try std.testing.expectApproxEqAbs(@as(f32, 1), sphere_box.Distance, 0.001);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), sphere_box.Normal.y, 0.001);
+
+    //capsules side by side
+    const capsules = GetSeparation(capsule, .{ .x = 2, .y = 0.3, .z = 0 }, capsule, Vec3(f32).FromScalar(0));
+    try std.testing.expectApproxEqAbs(@as(f32, 1), capsules.Distance, 0.001);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), capsules.Normal.x, 0.001);
+
+    //box sunk into a box, EPA depth
+    const boxes = GetSeparation(box, .{ .x = 0, .y = 1.75, .z = 0.2 }, box, Vec3(f32).FromScalar(0));
+    try std.testing.expectApproxEqAbs(@as(f32, -0.25), boxes.Distance, 0.001);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), boxes.Normal.y, 0.001);
+
+    //capsule standing in a box, cores overlap
+    const deep = GetSeparation(capsule, .{ .x = 0, .y = 0.5, .z = 0 }, Shape{ .Box = .{ .x = 4, .y = 1, .z = 4 } }, Vec3(f32).FromScalar(0));
+    try std.testing.expectApproxEqAbs(@as(f32, -2), deep.Distance, 0.001);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), deep.Normal.y, 0.001);
+
+    try std.testing.expect(!Intersects(sphere, .{ .x = 0, .y = 3, .z = 0 }, box, Vec3(f32).FromScalar(0)));
+    try std.testing.expect(Intersects(sphere, .{ .x = 0, .y = 1.5, .z = 0 }, box, Vec3(f32).FromScalar(0)));
+}
@@ -0,0 +1,180 @@
+//! Structure of arrays rigid body integrator.
+//!
+//! PhysicsManager gathers the state of every rigid body into BodyBuffers, the whole batch is
+//! integrated with symplectic euler using @Vector lanes and the results are scattered back to
+//! the components. Keeping each axis in its own contiguous array lets one vector load pull in
+//! LANES bodies at once instead of shuffling a Vec3 per body.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+
+/// Bodies integrated per vector op, clamped to 4-8 so the layout stays reasonable on
+/// targets that report very wide or no vector support
+pub const LANES: usize = std.math.clamp(std.simd.suggestVectorLength(f32) orelse 4, 4, 8);
+const VecT = @Vector(LANES, f32);
+
+pub const BodyBuffers = struct {
+    pub const empty: BodyBuffers = .{
+        .PositionX = .empty,
+        .PositionY = .empty,
+        .PositionZ = .empty,
+        .VelocityX = .empty,
+        .VelocityY = .empty,
+        .VelocityZ = .empty,
+        .ForceX = .empty,
+        .ForceY = .empty,
+        .ForceZ = .empty,
+        .InvMass = .empty,
+    };
+
+    PositionX: std.ArrayList(f32),
+    PositionY: std.ArrayList(f32),
+    PositionZ: std.ArrayList(f32),
+    VelocityX: std.ArrayList(f32),
+    VelocityY: std.ArrayList(f32),
+    VelocityZ: std.ArrayList(f32),
+    ForceX: std.ArrayList(f32),
+    ForceY: std.ArrayList(f32),
+    ForceZ: std.ArrayList(f32),
+    InvMass: std.ArrayList(f32),
+
+    pub fn Deinit(self: *BodyBuffers, engine_allocator: std.mem.Allocator) void {
+        inline for (std.meta.fields(BodyBuffers)) |field| {
+            @field(self, field.name).deinit(engine_allocator);
+        }
+    }
+
+    /// Resizes every buffer to count, capacity is kept between steps
+    pub fn Resize(self: *BodyBuffers, engine_allocator: std.mem.Allocator, count: usize) !void {
+        inline for (std.meta.fields(BodyBuffers)) |field| {
+            try @field(self, field.name).resize(engine_allocator, count);
+        }
+    }
+
+    pub fn Len(self: BodyBuffers) usize {
+        return self.InvMass.items.len;
+    }
+
+    pub fn SetBody(self: *BodyBuffers, i: usize, position: Vec3(f32), velocity: Vec3(f32), force: Vec3(f32), inv_mass: f32) void {
+        self.PositionX.items[i] = position.x;
+        self.PositionY.items[i] = position.y;
+        self.PositionZ.items[i] = position.z;
+        self.VelocityX.items[i] = velocity.x;
+        self.VelocityY.items[i] = velocity.y;
+        self.VelocityZ.items[i] = velocity.z;
+        self.ForceX.items[i] = force.x;
+        self.ForceY.items[i] = force.y;
+        self.ForceZ.items[i] = force.z;
+        self.InvMass.items[i] = inv_mass;
+    }
+
+    pub fn GetPosition(self: BodyBuffers, i: usize) Vec3(f32) {
+        return .{ .x = self.PositionX.items[i], .y = self.PositionY.items[i], .z = self.PositionZ.items[i] };
+    }
+
+    pub fn GetVelocity(self: BodyBuffers, i: usize) Vec3(f32) {
+        return .{ .x = self.VelocityX.items[i], .y = self.VelocityY.items[i], .z = self.VelocityZ.items[i] };
+    }
+};
+
+/// Integrates velocities then positions for every body in the buffers and clears the forces.
+/// Bodies are processed LANES at a time with a scalar loop for the remainder.
+pub fn Integrate(buffers: *BodyBuffers, dt: f32) void {
+    IntegrateRange(buffers, 0, buffers.Len(), dt);
+}
+
+/// Same as Integrate but only for [start, end), useful for splitting the batch across threads.
+/// start should be a multiple of LANES to keep the vector loads aligned with the other ranges.
+pub fn IntegrateRange(buffers: *BodyBuffers, start: usize, end: usize, dt: f32) void {
+    const dt_vec: VecT = @splat(dt);
+    const zero_vec: VecT = @splat(0.0);
+
+    var i: usize = start;
+    while (i + LANES <= end) : (i += LANES) {
+        const inv_mass_dt = Load(buffers.InvMass.items, i) * dt_vec;
+
+        const vel_x = Load(buffers.VelocityX.items, i) + Load(buffers.ForceX.items, i) * inv_mass_dt;
+        const vel_y = Load(buffers.VelocityY.items, i) + Load(buffers.ForceY.items, i) * inv_mass_dt;
+        const vel_z = Load(buffers.VelocityZ.items, i) + Load(buffers.ForceZ.items, i) * inv_mass_dt;
+
+        Store(buffers.VelocityX.items, i, vel_x);
+        Store(buffers.VelocityY.items, i, vel_y);
+        Store(buffers.VelocityZ.items, i, vel_z);
+
+        Store(buffers.PositionX.items, i, Load(buffers.PositionX.items, i) + vel_x * dt_vec);
+        Store(buffers.PositionY.items, i, Load(buffers.PositionY.items, i) + vel_y * dt_vec);
+        Store(buffers.PositionZ.items, i, Load(buffers.PositionZ.items, i) + vel_z * dt_vec);
+
+        Store(buffers.ForceX.items, i, zero_vec);
+        Store(buffers.ForceY.items, i, zero_vec);
+        Store(buffers.ForceZ.items, i, zero_vec);
+    }
+
+    IntegrateScalarRange(buffers, i, end, dt);
+}
+
+/// Reference one body at a time version, used for the remainder of a vector batch and
+/// by the tests/benchmarks to compare against
+pub fn IntegrateScalar(buffers: *BodyBuffers, dt: f32) void {
+    IntegrateScalarRange(buffers, 0, buffers.Len(), dt);
+}
+
+fn IntegrateScalarRange(buffers: *BodyBuffers, start: usize, end: usize, dt: f32) void {
+    for (start..end) |i| {
+        const inv_mass_dt = buffers.InvMass.items[i] * dt;
+
+        buffers.VelocityX.items[i] += buffers.ForceX.items[i] * inv_mass_dt;
+        buffers.VelocityY.items[i] += buffers.ForceY.items[i] * inv_mass_dt;
+        buffers.VelocityZ.items[i] += buffers.ForceZ.items[i] * inv_mass_dt;
+
+        buffers.PositionX.items[i] += buffers.VelocityX.items[i] * dt;
+        buffers.PositionY.items[i] += buffers.VelocityY.items[i] * dt;
+        buffers.PositionZ.items[i] += buffers.VelocityZ.items[i] * dt;
+
+        buffers.ForceX.items[i] = 0;
+        buffers.ForceY.items[i] = 0;
+        buffers.ForceZ.items[i] = 0;
+    }
+}
+
+inline fn Load(buffer: []const f32, i: usize) VecT {
+    return buffer[i..][0..LANES].*;
+}
+
+inline fn Store(buffer: []f32, i: usize, value: VecT) void {
+    buffer[i..][0..LANES].* = value;
+}
+
+test "SIMD integration matches scalar integration" {
+    const allocator = std.testing.allocator;
+    //odd count so the scalar remainder path runs too
+    const count = LANES * 9 + 3;
+
+    var simd_buffers: BodyBuffers = .empty;
+    defer simd_buffers.Deinit(allocator);
+    var scalar_buffers: BodyBuffers = .empty;
+    defer scalar_buffers.Deinit(allocator);
+
+    try simd_buffers.Resize(allocator, count);
+    try scalar_buffers.Resize(allocator, count);
+
+    var prng = std.Random.DefaultPrng.init(42);
+    const random = prng.random();
+    for (0..count) |i| {
+        const position = Vec3(f32){ .x = random.float(f32), .y = random.float(f32), .z = random.float(f32) };
+        const velocity = Vec3(f32){ .x = random.float(f32), .y = random.float(f32), .z = random.float(f32) };
+        const force = Vec3(f32){ .x = random.float(f32), .y = -9.81, .z = random.float(f32) };
+        const inv_mass: f32 = if (i % 5 == 0) 0.0 else random.float(f32) + 0.1;
+        simd_buffers.SetBody(i, position, velocity, force, inv_mass);
+        scalar_buffers.SetBody(i, position, velocity, force, inv_mass);
+    }
+
+    for (0..4) |_| {
+        Integrate(&simd_buffers, 1.0 / 120.0);
+        IntegrateScalar(&scalar_buffers, 1.0 / 120.0);
+    }
+
+    inline for (std.meta.fields(BodyBuffers)) |field| {
+        try std.testing.expectEqualSlices(f32, @field(scalar_buffers, field.name).items, @field(simd_buffers, field.name).items);
+    }
+}
@@ -0,0 +1,221 @@
+//! Runs the exact shape tests on the candidate pairs the broadphase found, in parallel.
+//!
+//! Pairs are split into fixed size chunks across the worker pool. Every chunk writes the
+//! manifolds of its touching pairs into its own region of one shared buffer, so workers never
+//! share an output slot or allocate. Afterwards the regions are compacted and sorted by pair key
+//! which gives the same manifold order for any number of threads and any BVH traversal order.
+//!
+//! This file only works on plain arrays so it can be used headless by tests and benchmarks.
+//! CollisionManager turns the manifolds back into entity contacts.
+const std = @import("std");
+const WorkerPool = @import("../Core/WorkerPool.zig");
+const CCD = @import("CCD.zig");
+const Compound = @import("Compound.zig");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+
+const Narrowphase = @This();
+
+/// How many pairs a worker grabs at a time
+pub const CHUNK_SIZE: usize = 128;
+
+/// Candidate pair from the broadphase, Origin and Target index the proxies passed to Run
+pub const Pair = struct {
+    Key: u64,
+    Origin: u32,
+    Target: u32,
+    Overlap: bool, //trigger pair, only needs to know that it touches
+};
+
+pub const Manifold = struct {
+    Key: u64,
+    Origin: u32,
+    Target: u32,
+    Overlap: bool, //trigger pair, Normal and Penetration are left at zero
+    Normal: Vec3(f32), //points from origin to target
+    Penetration: f32,
+};
+
+pub const empty: Narrowphase = .{
+    ._Manifolds = .empty,
+    ._ChunkCounts = .empty,
+};
+
+_Manifolds: std.ArrayList(Manifold),
+_ChunkCounts: std.ArrayList(u32),
+
+pub fn Deinit(self: *Narrowphase, engine_allocator: std.mem.Allocator) void {
+    self._Manifolds.deinit(engine_allocator);
+    self._ChunkCounts.deinit(engine_allocator);
+}
+
+/// Tests every pair and returns the manifolds of the ones that touch, sorted by pair key.
+/// Proxy can be any type with an mShape: CCD.Shape and mPosition: Vec3(f32) field, plus optionally
+/// an mCompound: ?*const Compound field for proxies that stand for a compound collider.
+/// The returned slice is valid until the next call to Run
+pub fn Run(self: *Narrowphase, engine_allocator: std.mem.Allocator, worker_pool: *WorkerPool, comptime Proxy: type, proxies: []const Proxy, pairs: []const Pair) ![]const Manifold {
+    //a pair makes at most one manifold so every chunk can get a region as big as itself
+    try self._Manifolds.resize(engine_allocator, pairs.len);
+    try self._ChunkCounts.resize(engine_allocator, std.math.divCeil(usize, pairs.len, CHUNK_SIZE) catch unreachable);
+
+    const ChunkContext = struct {
+        mProxies: []const Proxy,
+        mPairs: []const Pair,
+        mManifolds: []Manifold,
+        mChunkCounts: []u32,
+
+        fn Run(ctx: @This(), start: usize, end: usize) void {
+            var count: u32 = 0;
+            for (ctx.mPairs[start..end]) |pair| {
+                const origin = ctx.mProxies[pair.Origin];
+                const target = ctx.mProxies[pair.Target];
+
+                //trigger pairs only need to know that they touch, no normal or depth
+                if (pair.Overlap) {
+                    const overlaps = if (@hasField(Proxy, "mCompound"))
+                        Compound.GetProxyOverlap(origin.mCompound, origin.mShape, origin.mPosition, target.mCompound, target.mShape, target.mPosition)
+                    else
+                        CCD.Overlaps(origin.mShape, origin.mPosition, target.mShape, target.mPosition);
+                    if (!overlaps) continue;
+
+                    ctx.mManifolds[start + count] = .{
+                        .Key = pair.Key,
+                        .Origin = pair.Origin,
+                        .Target = pair.Target,
+                        .Overlap = true,
+                        .Normal = .{ .x = 0, .y = 0, .z = 0 },
+                        .Penetration = 0,
+                    };
+                    count += 1;
+                    continue;
+                }
+
+                //separation normal points from its b to its a, manifold normals point from origin to target
+                const separation = if (@hasField(Proxy, "mCompound"))
+                    Compound.GetProxySeparation(target.mCompound, target.mShape, target.mPosition, origin.mCompound, origin.mShape, origin.mPosition)
+                else
+                    CCD.GetSeparation(target.mShape, target.mPosition, origin.mShape, origin.mPosition);
+                if (separation.Distance >= 0) continue; //not a collision
+
+                ctx.mManifolds[start + count] = .{
+                    .Key = pair.Key,
+                    .Origin = pair.Origin,
+                    .Target = pair.Target,
+                    .Overlap = pair.Overlap,
+                    .Normal = separation.Normal,
+                    .Penetration = -separation.Distance,
+                };
+                count += 1;
+            }
+            ctx.mChunkCounts[start / CHUNK_SIZE] = count;
+        }
+    };
+
+    worker_pool.ParallelFor(pairs.len, CHUNK_SIZE, ChunkContext{
+        .mProxies = proxies,
+        .mPairs = pairs,
+        .mManifolds = self._Manifolds.items,
+        .mChunkCounts = self._ChunkCounts.items,
+    }, ChunkContext.Run);
+
+    //regions only ever move towards the front so copying forwards is safe
+    var total: usize = 0;
+    for (self._ChunkCounts.items, 0..) |count, chunk| {
+        const region = self._Manifolds.items[chunk * CHUNK_SIZE ..][0..count];
+        std.mem.copyForwards(Manifold, self._Manifolds.items[total..][0..count], region);
+        total += count;
+    }
+    self._Manifolds.items.len = total;
+
+    //keys are unique per pair so the unstable sort still has only one possible result
+    std.sort.pdq(Manifold, self._Manifolds.items, {}, KeyLessThan);
+    return self._Manifolds.items;
+}
+
+fn KeyLessThan(_: void, a: Manifold, b: Manifold) bool {
+    return a.Key < b.Key;
+}
+
+const TestProxy = struct {
+    mShape: CCD.Shape,
+    mPosition: Vec3(f32),
+};
+
+fn MakeTestScene(allocator: std.mem.Allocator, proxies: *std.ArrayList(TestProxy), pairs: *std.ArrayList(Pair)) !void {
+    var prng = std.Random.DefaultPrng.init(0x5eed);
+    const random = prng.random();
+
+    for (0..200) |_| {
+        const shape: CCD.Shape = switch (random.uintLessThan(u32, 3)) {
+            0 => .{ .Sphere = 0.5 + random.float(f32) },
+            1 => .{ .Box = .{ .x = 0.5 + random.float(f32), .y = 0.5 + random.float(f32), .z = 0.5 + random.float(f32) } },
+            else => .{ .Capsule = .{ .Radius = 0.3 + random.float(f32) * 0.5, .HalfHeight = 0.5 + random.float(f32) } },
+        };
+        try proxies.append(allocator, .{
+            .mShape = shape,
+            .mPosition = .{ .x = random.float(f32) * 20, .y = random.float(f32) * 20, .z = random.float(f32) * 20 },
+        });
+    }
+
+    //every pair once, in reverse key order so the sort has something to do
+    var origin: usize = proxies.items.len;
+    while (origin > 0) {
+        origin -= 1;
+        for (origin + 1..proxies.items.len) |target| {
+            try pairs.append(allocator, .{
+                .Key = (@as(u64, origin) << 32) | target,
+                .Origin = @intCast(origin),
+                .Target = @intCast(target),
+                .Overlap = (origin + target) % 5 == 0,
+            });
+        }
+    }
+}
+
+test "Parallel narrowphase matches the serial result for any thread count" {
+    const allocator = std.testing.allocator;
+
+    var proxies: std.ArrayList(TestProxy) = .empty;
+    defer proxies.deinit(allocator);
+    var pairs: std.ArrayList(Pair) = .empty;
+    defer pairs.deinit(allocator);
+    try MakeTestScene(allocator, &proxies, &pairs);
+
+    //reference: every pair tested in order on this thread
+    var expected: std.ArrayList(Manifold) = .empty;
+    defer expected.deinit(allocator);
+    for (pairs.items) |pair| {
+        const origin = proxies.items[pair.Origin];
+        const target = proxies.items[pair.Target];
+        if (pair.Overlap) {
+            if (!CCD.Overlaps(origin.mShape, origin.mPosition, target.mShape, target.mPosition)) continue;
+            try expected.append(allocator, .{ .Key = pair.Key, .Origin = pair.Origin, .Target = pair.Target, .Overlap = true, .Normal = .{ .x = 0, .y = 0, .z = 0 }, .Penetration = 0 });
+            continue;
+        }
+
+        const separation = CCD.GetSeparation(target.mShape, target.mPosition, origin.mShape, origin.mPosition);
+        if (separation.Distance >= 0) continue;
+        try expected.append(allocator, .{
+            .Key = pair.Key,
+            .Origin = pair.Origin,
+            .Target = pair.Target,
+            .Overlap = pair.Overlap,
+            .Normal = separation.Normal,
+            .Penetration = -separation.Distance,
+        });
+    }
+    std.sort.pdq(Manifold, expected.items, {}, KeyLessThan);
+    try std.testing.expect(expected.items.len > 0);
+
+    for ([_]usize{ 0, 1, 3, 7 }) |worker_count| {
+        var pool: WorkerPool = .empty;
+        try pool.Init(allocator, worker_count);
+        defer pool.Deinit(allocator);
+
+        var narrowphase: Narrowphase = .empty;
+        defer narrowphase.Deinit(allocator);
+
+        const manifolds = try narrowphase.Run(allocator, &pool, TestProxy, proxies.items, pairs.items);
+        try std.testing.expectEqualSlices(Manifold, expected.items, manifolds);
+    }
+}
@@ -0,0 +1,239 @@
+//! Overlap queries against the colliders.
+//!
+//! Like the casts in RayCast.zig these walk the collider BVH built by the last broadphase and
+//! only read the CollisionManager. Results go into a caller provided buffer so a query never
+//! allocates, callers are expected to keep one buffer around and reuse it every frame.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+
+const Entity = @import("../GameObjects/Entity.zig");
+const CollisionManager = @import("CollisionManager.zig");
+const AABB = @import("BVH.zig").AABB;
+const CCD = @import("CCD.zig");
+const Compound = @import("Compound.zig");
+const QueryFilter = @import("RayCast.zig").QueryFilter;
+
+/// Every collider whose bounds overlap aabb. Cheaper than OverlapBox since it skips the exact
+/// shape test. Only entities that have RequiredComponent are returned when it is not null.
+/// Writes at most results.len entities and returns how many were written
+pub fn OverlapAABB(collision_manager: *const CollisionManager, aabb: AABB, filter: QueryFilter, comptime RequiredComponent: ?type, results: []Entity) usize {
+    return Overlap(collision_manager, aabb, null, filter, RequiredComponent, results);
+}
+
+/// Every collider touching the sphere, see OverlapAABB for the filters and the result buffer
+pub fn OverlapSphere(collision_manager: *const CollisionManager, center: Vec3(f32), radius: f32, filter: QueryFilter, comptime RequiredComponent: ?type, results: []Entity) usize {
+    return Overlap(collision_manager, AABB.FromCenter(center, Vec3(f32).FromScalar(radius)), .{ .Sphere = radius }, filter, RequiredComponent, results);
+}
+
+/// Every collider touching the axis aligned box, see OverlapAABB for the filters and the result buffer
+pub fn OverlapBox(collision_manager: *const CollisionManager, center: Vec3(f32), half_extents: Vec3(f32), filter: QueryFilter, comptime RequiredComponent: ?type, results: []Entity) usize {
+    return Overlap(collision_manager, AABB.FromCenter(center, half_extents), .{ .Box = half_extents }, filter, RequiredComponent, results);
+}
+
+//collision_manager is the CollisionManager outside of the tests, anything with the same GetProxies,
+//GetBVH and GetProxyEntity works and results holds what GetProxyEntity returns
+fn Overlap(collision_manager: anytype, bounds: AABB, query_shape: ?CCD.Shape, filter: QueryFilter, comptime RequiredComponent: ?type, results: anytype) usize {
+    const Collector = struct {
+        mManager: @TypeOf(collision_manager),
+        mShape: ?CCD.Shape,
+        mCenter: Vec3(f32),
+        mFilter: QueryFilter,
+        mResults: @TypeOf(results),
+        mCount: *usize,
+
+        fn Visit(ctx: @This(), item: u32) void {
+            if (ctx.mCount.* == ctx.mResults.len) return;
+
+            const proxy = ctx.mManager.GetProxies()[item];
+            if (!ctx.mFilter.Accepts(proxy)) return;
+
+            if (ctx.mShape) |shape| {
+                if (Compound.GetProxySeparation(null, shape, ctx.mCenter, proxy.mCompound, proxy.mShape, proxy.mPosition).Distance > 0) return;
+            }
+
+            const entity = ctx.mManager.GetProxyEntity(item);
+            if (RequiredComponent) |ComponentT| {
+                if (!entity.HasComponent(ComponentT)) return;
+            }
+
+            ctx.mResults[ctx.mCount.*] = entity;
+            ctx.mCount.* += 1;
+        }
+    };
+
+    var count: usize = 0;
+    if (results.len == 0) return count;
+
+    collision_manager.GetBVH().QueryAABB(bounds, Collector{
+        .mManager = collision_manager,
+        .mShape = query_shape,
+        .mCenter = bounds.GetCenter(),
+        .mFilter = filter,
+        .mResults = results,
+        .mCount = &count,
+    }, Collector.Visit);
+    return count;
+}
+
+//stands in for the CollisionManager and the scene behind it, a row of unit spheres along x one apart
+const TestColliders = struct {
+    const ColliderProxy = CollisionManager.ColliderProxy;
+    const BVH = @import("BVH.zig");
+
+    const TestEntity = struct {
+        mEntityID: Entity.Type,
+        mTagged: bool,
+
+        fn HasComponent(self: TestEntity, comptime ComponentT: type) bool {
+            return ComponentT == TestTag and self.mTagged;
+        }
+    };
+    const TestTag = struct {};
+    const COUNT = 8;
+
+    mProxies: [COUNT]ColliderProxy,
+    mTagged: [COUNT]bool,
+    mBVH: BVH = .empty,
+
+    fn Init(allocator: std.mem.Allocator) !TestColliders {
+        var colliders = TestColliders{ .mProxies = undefined, .mTagged = undefined };
+        var bounds: [COUNT]AABB = undefined;
+        for (&colliders.mProxies, &colliders.mTagged, &bounds, 0..) |*proxy, *tagged, *bound, i| {
+            var filter: CollisionManager.CollisionFilter = .default;
+            //even colliders are category 0, odd ones category 1, every third one a trigger
+            //and the second half is on layer 1
+            filter.CategoryMask.set(i % 2);
+            filter.IsTrigger = i % 3 == 0;
+            filter.Layer = @intCast(i / 4);
+            proxy.* = .{
+                .mEntityID = @intCast(i),
+                .mShape = .{ .Sphere = 0.5 },
+                .mPosition = .{ .x = @floatFromInt(i), .y = 0, .z = 0 },
+                .mFilter = filter,
+            };
+            tagged.* = i < 4;
+            bound.* = AABB.FromCenter(proxy.mPosition, Vec3(f32).FromScalar(0.5));
+        }
+        try colliders.mBVH.Build(allocator, &bounds);
+        return colliders;
+    }
+
+    fn Deinit(self: *TestColliders, allocator: std.mem.Allocator) void {
+        self.mBVH.Deinit(allocator);
+    }
+
+    fn GetProxies(self: *const TestColliders) []const ColliderProxy {
+        return &self.mProxies;
+    }
+
+    fn GetBVH(self: *const TestColliders) *const BVH {
+        return &self.mBVH;
+    }
+
+    fn GetProxyEntity(self: *const TestColliders, proxy_index: u32) TestEntity {
+        return .{ .mEntityID = self.mProxies[proxy_index].mEntityID, .mTagged = self.mTagged[proxy_index] };
+    }
+
+    fn Query(self: *const TestColliders, center: Vec3(f32), radius: f32, filter: QueryFilter, comptime RequiredComponent: ?type, results: []TestEntity) usize {
+        return Overlap(self, AABB.FromCenter(center, Vec3(f32).FromScalar(radius)), .{ .Sphere = radius }, filter, RequiredComponent, results);
+    }
+
+    //sorted ids so the checks do not depend on the order the BVH visits items in
+    fn SortedIDs(results: []const TestEntity, ids: []Entity.Type) []Entity.Type {
+        for (results, ids[0..results.len]) |entity, *id| id.* = entity.mEntityID;
+        std.mem.sort(Entity.Type, ids[0..results.len], {}, std.sort.asc(Entity.Type));
+        return ids[0..results.len];
+    }
+};
+
+test "Overlap filters by category mask, layer mask and triggers" {
+    const allocator = std.testing.allocator;
+    var colliders = try TestColliders.Init(allocator);
+    defer colliders.Deinit(allocator);
+
+    var results: [TestColliders.COUNT]TestColliders.TestEntity = undefined;
+    var ids: [TestColliders.COUNT]Entity.Type = undefined;
+    const everything = Vec3(f32){ .x = 3.5, .y = 0, .z = 0 };
+
+    var count = colliders.Query(everything, 10, .default, null, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 0, 1, 2, 3, 4, 5, 6, 7 }, TestColliders.SortedIDs(results[0..count], &ids));
+
+    var odd_only: QueryFilter = .{ .CategoryMask = .initEmpty(), .LayerMask = .initFull(), .IncludeTriggers = true };
+    odd_only.CategoryMask.set(1);
+    count = colliders.Query(everything, 10, odd_only, null, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 1, 3, 5, 7 }, TestColliders.SortedIDs(results[0..count], &ids));
+
+    odd_only.IncludeTriggers = false;
+    count = colliders.Query(everything, 10, odd_only, null, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 1, 5, 7 }, TestColliders.SortedIDs(results[0..count], &ids));
+
+    //a mask that matches no category finds nothing
+    var unused_only: QueryFilter = .{ .CategoryMask = .initEmpty(), .LayerMask = .initFull(), .IncludeTriggers = true };
+    unused_only.CategoryMask.set(5);
+    try std.testing.expectEqual(@as(usize, 0), colliders.Query(everything, 10, unused_only, null, &results));
+
+    //the layer mask checks the collision layer, not the categories
+    var layer_one: QueryFilter = .default;
+    layer_one.LayerMask = .initEmpty();
+    layer_one.LayerMask.set(1);
+    count = colliders.Query(everything, 10, layer_one, null, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 4, 5, 6, 7 }, TestColliders.SortedIDs(results[0..count], &ids));
+    layer_one.CategoryMask = odd_only.CategoryMask;
+    count = colliders.Query(everything, 10, layer_one, null, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 5, 7 }, TestColliders.SortedIDs(results[0..count], &ids));
+
+    //between two spheres and above them, the bounds of both overlap the query but neither sphere does
+    const between = Vec3(f32){ .x = 2.5, .y = 0.85, .z = 0 };
+    count = Overlap(&colliders, AABB.FromCenter(between, Vec3(f32).FromScalar(0.4)), null, .default, null, @as([]TestColliders.TestEntity, &results));
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 2, 3 }, TestColliders.SortedIDs(results[0..count], &ids));
+    try std.testing.expectEqual(@as(usize, 0), colliders.Query(between, 0.4, .default, null, &results));
+    count = colliders.Query(.{ .x = 2, .y = 0.8, .z = 0 }, 0.4, .default, null, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{2}, TestColliders.SortedIDs(results[0..count], &ids));
+}
+
+test "Overlap only returns entities with the required component" {
+    const allocator = std.testing.allocator;
+    var colliders = try TestColliders.Init(allocator);
+    defer colliders.Deinit(allocator);
+
+    var results: [TestColliders.COUNT]TestColliders.TestEntity = undefined;
+    var ids: [TestColliders.COUNT]Entity.Type = undefined;
+    const everything = Vec3(f32){ .x = 3.5, .y = 0, .z = 0 };
+
+    var count = colliders.Query(everything, 10, .default, TestColliders.TestTag, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{ 0, 1, 2, 3 }, TestColliders.SortedIDs(results[0..count], &ids));
+
+    //combines with the filter, only the untriggered odd colliders that are tagged
+    var odd_only: QueryFilter = .{ .CategoryMask = .initEmpty(), .LayerMask = .initFull(), .IncludeTriggers = false };
+    odd_only.CategoryMask.set(1);
+    count = colliders.Query(everything, 10, odd_only, TestColliders.TestTag, &results);
+    try std.testing.expectEqualSlices(Entity.Type, &.{1}, TestColliders.SortedIDs(results[0..count], &ids));
+
+    //a component nobody has
+    try std.testing.expectEqual(@as(usize, 0), colliders.Query(everything, 10, .default, struct {}, &results));
+}
+
+test "Overlap stops once the result buffer is full" {
+    const allocator = std.testing.allocator;
+    var colliders = try TestColliders.Init(allocator);
+    defer colliders.Deinit(allocator);
+
+    var results: [3]TestColliders.TestEntity = undefined;
+    const everything = Vec3(f32){ .x = 3.5, .y = 0, .z = 0 };
+    try std.testing.expectEqual(@as(usize, 3), colliders.Query(everything, 10, .default, null, &results));
+    for (results) |entity| try std.testing.expect(entity.mEntityID < TestColliders.COUNT);
+    //no two results are the same collider
+    try std.testing.expect(results[0].mEntityID != results[1].mEntityID);
+    try std.testing.expect(results[0].mEntityID != results[2].mEntityID);
+    try std.testing.expect(results[1].mEntityID != results[2].mEntityID);
+
+    //rejected colliders do not use up the buffer, both tagged odd colliders fit
+    var odd_only: QueryFilter = .{ .CategoryMask = .initEmpty(), .LayerMask = .initFull(), .IncludeTriggers = true };
+    odd_only.CategoryMask.set(1);
+    var tagged: [2]TestColliders.TestEntity = undefined;
+    try std.testing.expectEqual(@as(usize, 2), colliders.Query(everything, 10, odd_only, TestColliders.TestTag, &tagged));
+    try std.testing.expectEqual(@as(u32, 4), tagged[0].mEntityID + tagged[1].mEntityID);
+
+    try std.testing.expectEqual(@as(usize, 0), colliders.Query(everything, 10, .default, null, &.{}));
+}
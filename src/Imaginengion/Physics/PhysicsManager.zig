@@ -15,10 +15,26 @@ const GroupQuery = @import("../ECS/ComponentManager.zig").GroupQuery;
 const SceneComponents = @import("../Scene/SceneComponents.zig");
 const ScenePhysicsComponent = SceneComponents.PhysicsComponent;
 const CollisionManager = @import("CollisionManager.zig");
+const CollisionLayers = @import("CollisionLayers.zig");
+const Integrator = @import("Integrator.zig");
+const CCD = @import("CCD.zig");
+const SceneQueries = @import("RayCast.zig");
+const RayHit = SceneQueries.RayHit;
+const QueryFilter = SceneQueries.QueryFilter;
+const OverlapQueries = @import("Overlap.zig");
+const AABB = @import("BVH.zig").AABB;
+const WorkerPool = @import("../Core/WorkerPool.zig");
+const PhysicsSnapshot = @import("PhysicsSnapshot.zig");
+const PhysicsThread = @import("PhysicsThread.zig");
+const TransformBuffer = @import("TransformBuffer.zig");
+const Allocators = @import("../Core/Allocators.zig");
+const EngineStats = @import("../Core/EngineStats.zig");
+const TransformStats = EngineStats.TransformStats;
 
 const MathTypes = @import("../Math/MathTypes.zig");
 const Vec3 = MathTypes.Vec3;
 const Quat = MathTypes.Quat;
+const Ray = MathTypes.Ray;
 
 const Collisions = @import("Collisions.zig");
 const Contact = Collisions.Contact;
@@ -35,13 +51,50 @@ const InternalData = struct {
     Accumulator: f32,
 };
 
+//positions are in world space so the sweep compares them with the world positions of the other colliders
+const ContinuousBody = struct {
+    mEntityID: Entity.Type,
+    mStart: Vec3(f32),
+    /// World position of the parent, local translation + this is the world position
+    mParentOffset: Vec3(f32),
+};
+
+pub const StepMode = enum {
+    /// Fixed steps run inside OnUpdate and bodies render at their latest state
+    Inline,
+    /// Fixed steps run on the physics thread between KickThreadedStep and SyncThreadedStep,
+    /// bodies render blended between the last two steps by the accumulator alpha
+    Threaded,
+};
+
+const ThreadedStep = struct {
+    mManager: *PhysicsManager,
+    mEngineContext: *EngineContext,
+    mWorldType: EngineContext.WorldType,
+};
+
 const PHYSICS_DT: f32 = 1.0 / 60.0;
 
 const SUB_STEPS: u32 = 2;
 const SUB_STEP_DT: f32 = PHYSICS_DT / @as(f32, @floatFromInt(SUB_STEPS));
 
+//how many times a continuous body can hit something and keep sliding within one substep
+const MAX_CCD_SUBSTEPS: u32 = 4;
+
 _CollisionManager: CollisionManager = .empty,
 _InternalData: InternalData = .empty,
+_BodyBuffers: Integrator.BodyBuffers = .empty,
+_ContinuousBodies: std.ArrayList(ContinuousBody) = .empty,
+
+mStepMode: StepMode = .Inline,
+_TransformBuffer: TransformBuffer = .empty,
+_PhysicsThread: PhysicsThread = .empty,
+_ThreadedStep: ThreadedStep = undefined,
+//kicked and not synced yet, the thread can be done already but its transforms are not published
+_StepKicked: bool = false,
+_ThreadArena: std.heap.ArenaAllocator = std.heap.ArenaAllocator.init(std.heap.page_allocator),
+//propagation counts of the steps, handed to the engine stats on the main thread
+_TransformStats: TransformStats = .{},
 
 pub fn Init(self: *PhysicsManager, engine_allocator: std.mem.Allocator) !void {
     try self._CollisionManager.Init(engine_allocator);
@@ -50,49 +103,269 @@ pub fn Init(self: *PhysicsManager, engine_allocator: std.mem.Allocator) !void {
 pub fn Deinit(self: *PhysicsManager, engine_allocator: std.mem.Allocator) void {
     const zone = Tracy.ZoneInit("PhysicsManager::Deinit", @src());
     defer zone.Deinit();
+    self.StopThread();
     self._CollisionManager.Deinit(engine_allocator);
+    self._BodyBuffers.Deinit(engine_allocator);
+    self._ContinuousBodies.deinit(engine_allocator);
+    self._TransformBuffer.Deinit(engine_allocator);
+    self._ThreadArena.deinit();
 }
 
+/// Waits for the step in flight and joins the physics thread. Call before tearing down the worlds
+pub fn StopThread(self: *PhysicsManager) void {
+    self._PhysicsThread.Deinit();
+}
+
+/// Runs the fixed steps for this frame. In the Threaded step mode this does nothing,
+/// the steps are handed to the physics thread by KickThreadedStep instead
 pub fn OnUpdate(self: *PhysicsManager, engine_context: *EngineContext, comptime world_type: EngineContext.WorldType) !void {
+    if (self.mStepMode == .Threaded) return;
+
     const zone = Tracy.ZoneInit("PhysicsManager::OnUpdate", @src());
     defer zone.Deinit();
 
     self._CollisionManager.StartFrame();
+    self._InternalData.Accumulator += engine_context.mDT;
 
-    var scene_manager = switch (world_type) {
-        .Game => engine_context.mGameWorld,
-        .Editor => engine_context.mEditorWorld,
-        .Simulate => engine_context.mSimulateWorld,
-    };
+    try self.RunFixedSteps(engine_context, world_type);
+    self.FlushTransformStats(engine_context, world_type);
+}
+
+/// Threaded step mode only. Hands this frame's fixed steps to the physics thread and returns right away.
+/// From here until SyncThreadedStep the world belongs to the physics thread, so call this once
+/// the frame is done touching the world (before presenting) and sync before anything reads it again
+pub fn KickThreadedStep(self: *PhysicsManager, engine_context: *EngineContext, comptime world_type: EngineContext.WorldType) !void {
+    if (self.mStepMode != .Threaded) return;
+
+    const zone = Tracy.ZoneInit("PhysicsManager::KickThreadedStep", @src());
+    defer zone.Deinit();
+
+    if (!self._PhysicsThread.IsRunning()) try self._PhysicsThread.Init();
+    try self.SyncThreadedStep(engine_context);
+
+    self._CollisionManager.StartFrame();
     self._InternalData.Accumulator += engine_context.mDT;
 
+    self._ThreadedStep = .{ .mManager = self, .mEngineContext = engine_context, .mWorldType = world_type };
+    self._PhysicsThread.Kick(&self._ThreadedStep, RunThreadedStep);
+    self._StepKicked = true;
+}
+
+/// Waits for the steps kicked by KickThreadedStep and publishes their transforms for ApplyInterpolation.
+/// Returns right away when nothing is in flight so it is safe to call at the top of every frame
+pub fn SyncThreadedStep(self: *PhysicsManager, engine_context: *EngineContext) !void {
+    if (!self._StepKicked) return;
+
+    const zone = Tracy.ZoneInit("PhysicsManager::SyncThreadedStep", @src());
+    defer zone.Deinit();
+
+    self._StepKicked = false;
+    try self._PhysicsThread.Wait();
+    try self._TransformBuffer.Publish(engine_context.EngineAllocator());
+    self.FlushTransformStats(engine_context, self._ThreadedStep.mWorldType);
+}
+
+/// True between KickThreadedStep and SyncThreadedStep, the world being stepped must not be touched then
+pub fn IsStepInFlight(self: *const PhysicsManager) bool {
+    return self._StepKicked;
+}
+
+/// Threaded step mode only. Moves every body to its state blended between the last two published
+/// steps by the accumulator alpha and updates the children. Call after the world transform update,
+/// right before rendering. The bodies are marked dirty so the next update puts their real world transforms back
+pub fn ApplyInterpolation(self: *PhysicsManager, engine_context: *EngineContext, comptime world_type: EngineContext.WorldType) void {
+    if (self.mStepMode != .Threaded) return;
+
+    const zone = Tracy.ZoneInit("PhysicsManager::ApplyInterpolation", @src());
+    defer zone.Deinit();
+
+    const scene_manager = switch (world_type) {
+        .Game => &engine_context.mGameWorld,
+        .Editor => &engine_context.mEditorWorld,
+        .Simulate => &engine_context.mSimulateWorld,
+    };
+    const alpha = self._InternalData.Accumulator / PHYSICS_DT;
+
+    for (0..self._TransformBuffer.GetCount()) |i| {
+        const state = self._TransformBuffer.GetInterpolated(i, alpha);
+        const entity = scene_manager.GetEntity(state.EntityID);
+        const transform = entity.GetComponent(EntityTransformComponent) orelse continue;
+
+        transform.SetWorldPosition(state.Position);
+        transform.SetWorldRotation(state.Rotation);
+        transform.MarkDirty();
+
+        if (entity.GetComponent(ParentComponent)) |parent_component| {
+            if (parent_component.mFirstEntity != Entity.NullEntity) {
+                var unused_stats: TransformStats = .{};
+                CalculateChildren(entity, state.Position, state.Rotation, transform.GetWorldScale(), true, &unused_stats);
+            }
+        }
+    }
+}
+
+fn FlushTransformStats(self: *PhysicsManager, engine_context: *EngineContext, world_type: EngineContext.WorldType) void {
+    engine_context.mEngineStats.GetWorldStats(world_type).mTransformStats.Add(self._TransformStats);
+    self._TransformStats = .{};
+}
+
+fn RunThreadedStep(threaded_step: *ThreadedStep) anyerror!void {
+    const manager = threaded_step.mManager;
+
+    //the main thread resets the frame arena while this runs, keep our frame allocations to ourselves
+    Allocators.FrameArenaOverride = &manager._ThreadArena;
+    defer _ = manager._ThreadArena.reset(.retain_capacity);
+
+    switch (threaded_step.mWorldType) {
+        inline else => |world_type| {
+            //ApplyInterpolation left blended world transforms behind for the renderer
+            try manager.PropagateTransforms(world_type, threaded_step.mEngineContext);
+            try manager.RunFixedSteps(threaded_step.mEngineContext, world_type);
+        },
+    }
+}
+
+fn RunFixedSteps(self: *PhysicsManager, engine_context: *EngineContext, comptime world_type: EngineContext.WorldType) !void {
+    const scene_manager = switch (world_type) {
+        .Game => &engine_context.mGameWorld,
+        .Editor => &engine_context.mEditorWorld,
+        .Simulate => &engine_context.mSimulateWorld,
+    };
+
     const rigid_body_arr = try scene_manager.GetEntityGroup(engine_context.FrameAllocator(), .{ .Component = RigidBodyComponent });
 
+    var stepped = false;
     while (self._InternalData.Accumulator >= PHYSICS_DT) : (self._InternalData.Accumulator -= PHYSICS_DT) {
         for (0..SUB_STEPS) |_| {
-            for (rigid_body_arr.items) |entity_id| {
-                const entity = scene_manager.GetEntity(entity_id);
-                const entity_rb = entity.GetComponent(RigidBodyComponent).?;
+            try self.IntegrateBodies(engine_context.EngineAllocator(), scene_manager, rigid_body_arr.items, SUB_STEP_DT);
+            try self.SweepContinuousBodies(engine_context, scene_manager, SUB_STEP_DT);
+
+            //one propagation per substep, it also picks up the previous substep's position corrections
+            try self.PropagateTransforms(world_type, engine_context);
+
+            try self._CollisionManager.BroadPass(engine_context, scene_manager);
+            try self._CollisionManager.NarrowPass(engine_context);
+            try self._CollisionManager.PreSolverPass(engine_context);
+            try self._CollisionManager.SolverPass(engine_context);
+            try self._CollisionManager.PostsolverPass(engine_context);
+            try self._CollisionManager.EndPass(engine_context);
+        }
+        stepped = true;
 
-                ApplyForces(entity, entity_rb);
+        if (self.mStepMode == .Threaded) {
+            try self.PropagateTransforms(world_type, engine_context);
+            try self.RecordTransforms(engine_context.EngineAllocator(), scene_manager, rigid_body_arr.items);
+        }
+    }
 
-                IntegrateVelocities(entity_rb, SUB_STEP_DT);
-                IntegratePositions(entity, entity_rb, SUB_STEP_DT);
-            }
+    //the last solver pass moved bodies after the last propagation, the rest of the frame should see where they ended up
+    if (stepped and self.mStepMode == .Inline) {
+        try self.PropagateTransforms(world_type, engine_context);
+    }
+}
 
-            try UpdateWorldTransforms(world_type, engine_context);
+fn PropagateTransforms(self: *PhysicsManager, comptime world_type: EngineContext.WorldType, engine_context: *EngineContext) !void {
+    self._TransformStats.Add(try UpdateDirtyTransforms(world_type, engine_context));
+}
 
-            self._CollisionManager.BroadPass(engine_context, scene_manager);
-            self._CollisionManager.NarrowPass(engine_context);
-            self._CollisionManager.PreSolverPass(engine_context);
-            self._CollisionManager.SolverPass(world_type, engine_context);
-            self._CollisionManager.PostsolverPass(engine_context);
-            self._CollisionManager.EndPass(engine_context);
-        }
+/// Records the world transform of every body at the end of a fixed step for the render interpolation
+fn RecordTransforms(self: *PhysicsManager, engine_allocator: std.mem.Allocator, scene_manager: *SceneManager, rigid_body_ids: []const Entity.Type) !void {
+    self._TransformBuffer.BeginStep();
+    for (rigid_body_ids) |entity_id| {
+        const transform = scene_manager.GetEntity(entity_id).GetComponent(EntityTransformComponent).?;
+        try self._TransformBuffer.Record(engine_allocator, .{
+            .EntityID = entity_id,
+            .Position = transform.GetWorldPosition(),
+            .Rotation = transform.GetWorldRotation(),
+        });
     }
 }
 
+/// Closest collider hit by the ray, see RayCast.zig for the details of every query
+pub fn RayCast(self: *const PhysicsManager, ray: Ray(f32), max_distance: f32, filter: QueryFilter) ?RayHit {
+    return SceneQueries.RayCast(&self._CollisionManager, ray, max_distance, filter);
+}
+
+pub fn RayCastAll(self: *const PhysicsManager, ray: Ray(f32), max_distance: f32, filter: QueryFilter, hits: []RayHit) usize {
+    return SceneQueries.RayCastAll(&self._CollisionManager, ray, max_distance, filter, hits);
+}
+
+pub fn SphereCast(self: *const PhysicsManager, ray: Ray(f32), radius: f32, max_distance: f32, filter: QueryFilter) ?RayHit {
+    return SceneQueries.SphereCast(&self._CollisionManager, ray, radius, max_distance, filter);
+}
+
+pub fn BoxCast(self: *const PhysicsManager, ray: Ray(f32), half_extents: Vec3(f32), max_distance: f32, filter: QueryFilter) ?RayHit {
+    return SceneQueries.BoxCast(&self._CollisionManager, ray, half_extents, max_distance, filter);
+}
+
+pub fn RayCastBatch(self: *const PhysicsManager, worker_pool: *WorkerPool, rays: []const Ray(f32), max_distance: f32, filter: QueryFilter, hits: []?RayHit) void {
+    SceneQueries.RayCastBatch(&self._CollisionManager, worker_pool, rays, max_distance, filter, hits);
+}
+
+/// Project wide layer matrix. Only change it from the main thread while no threaded step is in flight
+pub fn GetLayerMatrix(self: *PhysicsManager) *CollisionLayers.LayerMatrix {
+    return &self._CollisionManager.mLayerMatrix;
+}
+
+/// Collision events produced by every step of this frame, see CollisionManager.GetCollisionEvents
+pub fn GetCollisionEvents(self: *const PhysicsManager) []const CollisionManager.CollisionEvent {
+    return self._CollisionManager.GetCollisionEvents();
+}
+
+/// Overlap queries write into results and return how many entities were written, see Overlap.zig
+pub fn OverlapAABB(self: *const PhysicsManager, aabb: AABB, filter: QueryFilter, comptime RequiredComponent: ?type, results: []Entity) usize {
+    return OverlapQueries.OverlapAABB(&self._CollisionManager, aabb, filter, RequiredComponent, results);
+}
+
+pub fn OverlapSphere(self: *const PhysicsManager, center: Vec3(f32), radius: f32, filter: QueryFilter, comptime RequiredComponent: ?type, results: []Entity) usize {
+    return OverlapQueries.OverlapSphere(&self._CollisionManager, center, radius, filter, RequiredComponent, results);
+}
+
+pub fn OverlapBox(self: *const PhysicsManager, center: Vec3(f32), half_extents: Vec3(f32), filter: QueryFilter, comptime RequiredComponent: ?type, results: []Entity) usize {
+    return OverlapQueries.OverlapBox(&self._CollisionManager, center, half_extents, filter, RequiredComponent, results);
+}
+
+/// Writes the rigid bodies, colliders, contact cache and step accumulator of the world into buffer.
+/// The buffer is cleared first so one buffer per tick can be reused without reallocating
+pub fn SaveSnapshot(self: *PhysicsManager, engine_context: *EngineContext, comptime world_type: EngineContext.WorldType, buffer: *std.ArrayList(u8)) !void {
+    const zone = Tracy.ZoneInit("PhysicsManager::SaveSnapshot", @src());
+    defer zone.Deinit();
+
+    const scene_manager = switch (world_type) {
+        .Game => &engine_context.mGameWorld,
+        .Editor => &engine_context.mEditorWorld,
+        .Simulate => &engine_context.mSimulateWorld,
+    };
+
+    try PhysicsSnapshot.SaveWorld(engine_context.FrameAllocator(), engine_context.EngineAllocator(), scene_manager, &self._CollisionManager, self._InternalData.Accumulator, buffer);
+}
+
+/// Puts the world back to the state saved by SaveSnapshot. The entities in the snapshot must still exist
+/// with the same components, rollback is expected to happen within a set of networked entities.
+/// Records are restored in saved order so stepping afterwards is bit identical to the original run
+pub fn RestoreSnapshot(self: *PhysicsManager, engine_context: *EngineContext, comptime world_type: EngineContext.WorldType, bytes: []const u8) !void {
+    const zone = Tracy.ZoneInit("PhysicsManager::RestoreSnapshot", @src());
+    defer zone.Deinit();
+
+    const scene_manager = switch (world_type) {
+        .Game => &engine_context.mGameWorld,
+        .Editor => &engine_context.mEditorWorld,
+        .Simulate => &engine_context.mSimulateWorld,
+    };
+
+    self._InternalData.Accumulator = try PhysicsSnapshot.RestoreWorld(engine_context.EngineAllocator(), scene_manager, &self._CollisionManager, bytes);
+
+    try UpdateWorldTransforms(world_type, engine_context);
+}
+
+/// Recomputes the world transform of every dirty transform and of everything under it, clean subtrees
+/// are only walked. Adds how many transforms were recomputed and skipped to the world's engine stats
 pub fn UpdateWorldTransforms(comptime world_type: EngineContext.WorldType, engine_context: *EngineContext) !void {
+    const stats = try UpdateDirtyTransforms(world_type, engine_context);
+    engine_context.mEngineStats.GetWorldStats(world_type).mTransformStats.Add(stats);
+}
+
+fn UpdateDirtyTransforms(comptime world_type: EngineContext.WorldType, engine_context: *EngineContext) !TransformStats {
     const zone = Tracy.ZoneInit("PhysicsManager::UpdateWorldTransform", @src());
     defer zone.Deinit();
 
@@ -110,23 +383,33 @@ pub fn UpdateWorldTransforms(comptime world_type: EngineContext.WorldType, engin
         .{ .Not = .{ .mFirst = &EntityTransformQuery, .mSecond = &ChildQuery } },
     );
 
+    var stats: TransformStats = .{};
     for (transforms_arr.items) |entity_id| {
         const entity = scene_manager.GetEntity(entity_id);
         const transform = entity.GetComponent(EntityTransformComponent).?;
 
-        transform.SetWorldPosition(transform.Translation);
-        transform.SetWorldRotation(transform.Rotation);
-        transform.SetWorldScale(transform.Scale);
+        const dirty = transform.IsDirty();
+        if (dirty) {
+            transform.SetWorldPosition(transform.Translation);
+            transform.SetWorldRotation(transform.Rotation);
+            transform.SetWorldScale(transform.Scale);
+            transform.ClearDirty();
+            stats.Recomputed += 1;
+        } else {
+            stats.Skipped += 1;
+        }
 
         if (entity.GetComponent(ParentComponent)) |parent_component| {
             if (parent_component.mFirstEntity != Entity.NullEntity) {
-                CalculateChildren(entity, transform.GetWorldPosition(), transform.GetWorldRotation(), transform.GetWorldScale());
+                CalculateChildren(entity, transform.GetWorldPosition(), transform.GetWorldRotation(), transform.GetWorldScale(), dirty, &stats);
             }
         }
     }
+    return stats;
 }
 
-fn CalculateChildren(parent_entity: Entity, position_acc: Vec3(f32), rotation_acc: Quat(f32), scale_acc: Vec3(f32)) void {
+/// Children are recomputed when the parent was or when they are dirty themselves
+fn CalculateChildren(parent_entity: Entity, position_acc: Vec3(f32), rotation_acc: Quat(f32), scale_acc: Vec3(f32), parent_dirty: bool, stats: *TransformStats) void {
     const parent_component = parent_entity.GetComponent(ParentComponent).?;
 
     var curr_id = parent_component.mFirstEntity;
@@ -134,49 +417,178 @@ fn CalculateChildren(parent_entity: Entity, position_acc: Vec3(f32), rotation_ac
     while (true) : (if (curr_id == parent_component.mFirstEntity) break) {
         const child_entity = Entity{ .mEntityID = curr_id, .mSceneManager = parent_entity.mSceneManager };
 
-        CalculateChildTransform(child_entity, position_acc, rotation_acc, scale_acc);
+        CalculateChildTransform(child_entity, position_acc, rotation_acc, scale_acc, parent_dirty, stats);
 
         const child_component = child_entity.GetComponent(ChildComponent).?;
         curr_id = child_component.mNext;
     }
 }
 
-fn CalculateChildTransform(child_entity: Entity, position_acc: Vec3(f32), rotation_acc: Quat(f32), scale_acc: Vec3(f32)) void {
+fn CalculateChildTransform(child_entity: Entity, position_acc: Vec3(f32), rotation_acc: Quat(f32), scale_acc: Vec3(f32), parent_dirty: bool, stats: *TransformStats) void {
     const transform = child_entity.GetComponent(EntityTransformComponent).?;
 
-    transform.SetWorldPosition(transform.Translation.AddVec(position_acc));
-    transform.SetWorldRotation(rotation_acc.MulQuat(transform.Rotation));
-    transform.SetWorldScale(transform.Scale.AddVec(scale_acc));
+    const dirty = parent_dirty or transform.IsDirty();
+    if (dirty) {
+        transform.SetWorldPosition(transform.Translation.AddVec(position_acc));
+        transform.SetWorldRotation(rotation_acc.MulQuat(transform.Rotation));
+        transform.SetWorldScale(transform.Scale.AddVec(scale_acc));
+        transform.ClearDirty();
+        stats.Recomputed += 1;
+    } else {
+        stats.Skipped += 1;
+    }
 
     if (child_entity.GetComponent(ParentComponent)) |parent_component| {
-        _ = parent_component;
-        CalculateChildren(child_entity, transform.GetWorldPosition(), transform.GetWorldRotation(), transform.GetWorldScale());
+        if (parent_component.mFirstEntity != Entity.NullEntity) {
+            CalculateChildren(child_entity, transform.GetWorldPosition(), transform.GetWorldRotation(), transform.GetWorldScale(), dirty, stats);
+        }
     }
 }
 
-fn ApplyForces(entity: Entity, entity_rb: *RigidBodyComponent) void {
-    const zone = Tracy.ZoneInit("PhysicsManager::ApplyForces", @src());
+/// Gathers every rigid body into the SoA buffers, integrates them as one batch and scatters
+/// the results back. One zone for the whole batch instead of one per body.
+fn IntegrateBodies(self: *PhysicsManager, engine_allocator: std.mem.Allocator, scene_manager: *SceneManager, rigid_body_ids: []const Entity.Type, dt: f32) !void {
+    const zone = Tracy.ZoneInit("PhysicsManager::IntegrateBodies", @src());
     defer zone.Deinit();
-    const entity_scene_comp = entity.GetComponent(EntitySceneComponent).?;
-    const scene_layer = entity_scene_comp.mScene;
 
-    if (scene_layer.GetComponent(ScenePhysicsComponent)) |physics_component| {
-        if (entity_rb._InvMass != 0) {
-            entity_rb.ApplyForce(physics_component.mGravity.MulScalar(entity_rb.mMass));
+    try self._BodyBuffers.Resize(engine_allocator, rigid_body_ids.len);
+    self._ContinuousBodies.clearRetainingCapacity();
+
+    for (rigid_body_ids, 0..) |entity_id, i| {
+        const entity = scene_manager.GetEntity(entity_id);
+        const entity_rb = entity.GetComponent(RigidBodyComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+
+        const force = entity_rb._Force.AddVec(GetGravityForce(entity, entity_rb));
+        self._BodyBuffers.SetBody(i, transform.Translation, entity_rb._Velocity, force, entity_rb._InvMass);
+
+        if (entity_rb.mContinuous and entity_rb._InvMass != 0) {
+            const parent_offset = GetParentWorldPosition(entity);
+            try self._ContinuousBodies.append(engine_allocator, .{
+                .mEntityID = entity_id,
+                .mStart = transform.Translation.AddVec(parent_offset),
+                .mParentOffset = parent_offset,
+            });
+        }
+    }
+
+    Integrator.Integrate(&self._BodyBuffers, dt);
+
+    for (rigid_body_ids, 0..) |entity_id, i| {
+        const entity = scene_manager.GetEntity(entity_id);
+        const entity_rb = entity.GetComponent(RigidBodyComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+
+        entity_rb._Velocity = self._BodyBuffers.GetVelocity(i);
+        entity_rb._Force = std.mem.zeroes(Vec3(f32));
+
+        //bodies that did not move keep their transform clean so the propagation can skip them
+        const position = self._BodyBuffers.GetPosition(i);
+        if (!std.meta.eql(position, transform.Translation)) {
+            transform.SetTranslation(position);
         }
     }
 }
 
-fn IntegrateVelocities(entity_rb: *RigidBodyComponent, dt: f32) void {
-    const zone = Tracy.ZoneInit("PhysicsManager::IntegrateVelocities", @src());
+/// Re-runs the motion of the continuous bodies against the blocking colliders they can reach. A body advances to
+/// its first time of impact, loses the velocity going into the surface and spends the rest of the
+/// substep sliding from there. All other bodies keep the plain discrete step.
+/// The colliders are found with the broadphase BVH over the box the move sweeps, not by testing every collider
+fn SweepContinuousBodies(self: *PhysicsManager, engine_context: *EngineContext, scene_manager: *SceneManager, dt: f32) !void {
+    if (self._ContinuousBodies.items.len == 0) return;
+
+    const zone = Tracy.ZoneInit("PhysicsManager::SweepContinuousBodies", @src());
     defer zone.Deinit();
-    entity_rb.AddVelocity(entity_rb._Force.MulScalar(entity_rb._InvMass * dt));
-    entity_rb._Force = std.mem.zeroes(Vec3(f32));
+
+    //the proxies of the last broadphase are a substep old and may hold removed entities, gather them again
+    try self._CollisionManager.GatherProxies(engine_context, scene_manager);
+    const proxies = self._CollisionManager.GetProxies();
+    const bvh = self._CollisionManager.GetBVH();
+
+    const layer_matrix = self._CollisionManager.mLayerMatrix;
+    const no_motion = std.mem.zeroes(Vec3(f32));
+    const margin = Vec3(f32).FromScalar(CCD.TOLERANCE);
+
+    const CandidateCollector = struct {
+        mCandidates: *std.ArrayList(u32),
+
+        fn Collect(ctx: @This(), proxy_index: u32) void {
+            ctx.mCandidates.appendAssumeCapacity(proxy_index);
+        }
+    };
+    var candidates: std.ArrayList(u32) = .empty;
+    try candidates.ensureTotalCapacity(engine_context.FrameAllocator(), proxies.len);
+
+    for (self._ContinuousBodies.items) |continuous_body| {
+        const entity = scene_manager.GetEntity(continuous_body.mEntityID);
+        const collider = entity.GetComponent(ColliderComponent) orelse continue;
+        const entity_rb = entity.GetComponent(RigidBodyComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+        const shape = CollisionManager.GetColliderShape(collider, transform);
+
+        //moves shorter than half the body can not skip past anything the narrowphase would miss
+        const world_end = transform.Translation.AddVec(continuous_body.mParentOffset);
+        if (world_end.SubVec(continuous_body.mStart).Len() < CCD.GetMinExtent(shape) * 0.5) continue;
+
+        var position = continuous_body.mStart;
+        var remaining_dt = dt;
+        for (0..MAX_CCD_SUBSTEPS) |_| {
+            const motion = entity_rb._Velocity.MulScalar(remaining_dt);
+
+            //after an impact the body slides somewhere else, so every advance gets its own query
+            const swept_bounds = CollisionManager.GetShapeBounds(shape, position).Union(CollisionManager.GetShapeBounds(shape, position.AddVec(motion))).Expand(margin);
+            candidates.clearRetainingCapacity();
+            bvh.QueryAABB(swept_bounds, CandidateCollector{ .mCandidates = &candidates }, CandidateCollector.Collect);
+
+            var first_impact: ?CCD.Impact = null;
+            for (candidates.items) |proxy_index| {
+                const other = proxies[proxy_index];
+                if (other.mEntityID == continuous_body.mEntityID) continue;
+                if (!layer_matrix.Collides(collider.mCollisionFilter.Layer, other.mFilter.Layer)) continue;
+                if (CollisionManager.GetFilterCollisionType(collider.mCollisionFilter, other.mFilter) != .Block) continue;
+
+                const maybe_impact = if (other.mCompound) |compound|
+                    compound.TimeOfImpact(other.mPosition, shape, position, motion)
+                else
+                    CCD.TimeOfImpact(shape, position, motion, other.mShape, other.mPosition, no_motion);
+                const impact = maybe_impact orelse continue;
+                if (first_impact == null or impact.Time < first_impact.?.Time) {
+                    first_impact = impact;
+                }
+            }
+
+            const impact = first_impact orelse {
+                position.AddEqVec(motion);
+                break;
+            };
+
+            position.AddEqVec(motion.MulScalar(impact.Time));
+            const normal_speed = entity_rb._Velocity.Dot(impact.Normal);
+            if (normal_speed < 0) {
+                entity_rb._Velocity.SubEqVec(impact.Normal.MulScalar(normal_speed));
+            }
+            remaining_dt *= 1.0 - impact.Time;
+        }
+
+        transform.SetTranslation(position.SubVec(continuous_body.mParentOffset));
+    }
 }
 
-fn IntegratePositions(entity: Entity, entity_rb: *RigidBodyComponent, dt: f32) void {
-    const zone = Tracy.ZoneInit("PhysicsManager::IntegratePositions", @src());
-    defer zone.Deinit();
-    const transform = entity.GetComponent(EntityTransformComponent).?;
-    transform.Translation.AddEqVec(entity_rb._Velocity.MulScalar(dt));
+/// Children only offset their translation by the parent's world position, see CalculateChildTransform
+fn GetParentWorldPosition(entity: Entity) Vec3(f32) {
+    const child_component = entity.GetComponent(ChildComponent) orelse return std.mem.zeroes(Vec3(f32));
+    const parent = Entity{ .mEntityID = child_component.mParent, .mSceneManager = entity.mSceneManager };
+    return parent.GetComponent(EntityTransformComponent).?.GetWorldPosition();
+}
+
+fn GetGravityForce(entity: Entity, entity_rb: *RigidBodyComponent) Vec3(f32) {
+    const entity_scene_comp = entity.GetComponent(EntitySceneComponent).?;
+    const scene_layer = entity_scene_comp.mScene;
+
+    if (scene_layer.GetComponent(ScenePhysicsComponent)) |physics_component| {
+        if (entity_rb._InvMass != 0) {
+            return physics_component.mGravity.MulScalar(entity_rb.mMass);
+        }
+    }
+    return std.mem.zeroes(Vec3(f32));
 }
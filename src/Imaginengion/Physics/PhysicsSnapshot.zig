@@ -0,0 +1,463 @@
+//! Compact binary snapshot of the physics state for rollback.
+//!
+//! A snapshot is a header followed by the body, collider and contact cache records, each
+//! section a tightly packed array of extern structs. Records are written in the order the
+//! physics step visits them so restoring a snapshot and stepping again reproduces the exact
+//! same floating point operations, and therefore bit identical results, on the same binary.
+//!
+//! SaveWorld and RestoreWorld move the records in and out of the components and the contact cache,
+//! PhysicsManager only picks the world and updates the world transforms after a restore.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Quat = MathTypes.Quat;
+const CollisionManager = @import("CollisionManager.zig");
+const CollisionLayers = @import("CollisionLayers.zig");
+const EntityComponents = @import("../GameObjects/Components.zig");
+const RigidBodyComponent = EntityComponents.RigidBodyComponent;
+const ColliderComponent = EntityComponents.ColliderComponent;
+const EntityTransformComponent = EntityComponents.TransformComponent;
+
+pub const MAGIC: u32 = 0x50485953; //"PHYS"
+pub const VERSION: u32 = 3;
+
+pub const Header = extern struct {
+    Magic: u32,
+    Version: u32,
+    Accumulator: f32,
+    BodyCount: u32,
+    ColliderCount: u32,
+    CacheCount: u32,
+};
+
+pub const BodyRecord = extern struct {
+    EntityID: u32,
+    Mass: f32,
+    InvMass: f32,
+    Translation: Vec3(f32),
+    Rotation: Quat(f32),
+    Velocity: Vec3(f32),
+    Force: Vec3(f32),
+};
+
+pub const ColliderRecord = extern struct {
+    EntityID: u32,
+    Shape: u32,
+    IsTrigger: u32,
+    CategoryMask: u32,
+    RespondMask: u32,
+    EventMask: u32,
+    Layer: u32,
+};
+
+pub const CacheRecord = extern struct {
+    Key: u64,
+    AccumImpulse: f32,
+    Events: u32 = 0,
+};
+
+/// Clears buffer and writes the snapshot into it, keep the buffer around between ticks to avoid reallocating
+pub fn Encode(engine_allocator: std.mem.Allocator, buffer: *std.ArrayList(u8), accumulator: f32, bodies: []const BodyRecord, colliders: []const ColliderRecord, caches: []const CacheRecord) !void {
+    const header = Header{
+        .Magic = MAGIC,
+        .Version = VERSION,
+        .Accumulator = accumulator,
+        .BodyCount = @intCast(bodies.len),
+        .ColliderCount = @intCast(colliders.len),
+        .CacheCount = @intCast(caches.len),
+    };
+
+    buffer.clearRetainingCapacity();
+    try buffer.ensureTotalCapacity(engine_allocator, GetEncodedSize(header));
+    buffer.appendSliceAssumeCapacity(std.mem.asBytes(&header));
+    buffer.appendSliceAssumeCapacity(std.mem.sliceAsBytes(bodies));
+    buffer.appendSliceAssumeCapacity(std.mem.sliceAsBytes(colliders));
+    buffer.appendSliceAssumeCapacity(std.mem.sliceAsBytes(caches));
+}
+
+/// Records every rigid body, collider and contact cache entry of the world and encodes them into buffer.
+/// scene_manager is the world's SceneManager when called from PhysicsManager.SaveSnapshot, the tests pass
+/// a stand in with the same GetEntityGroup and GetEntity
+pub fn SaveWorld(frame_allocator: std.mem.Allocator, engine_allocator: std.mem.Allocator, scene_manager: anytype, collision_manager: *const CollisionManager, accumulator: f32, buffer: *std.ArrayList(u8)) !void {
+    const rigid_body_arr = try scene_manager.GetEntityGroup(frame_allocator, .{ .Component = RigidBodyComponent });
+    const bodies = try frame_allocator.alloc(BodyRecord, rigid_body_arr.items.len);
+    for (rigid_body_arr.items, bodies) |entity_id, *record| {
+        const entity = scene_manager.GetEntity(entity_id);
+        const entity_rb = entity.GetComponent(RigidBodyComponent).?;
+        const transform = entity.GetComponent(EntityTransformComponent).?;
+        record.* = .{
+            .EntityID = entity_id,
+            .Mass = entity_rb.mMass,
+            .InvMass = entity_rb._InvMass,
+            .Translation = transform.Translation,
+            .Rotation = transform.Rotation,
+            .Velocity = entity_rb._Velocity,
+            .Force = entity_rb._Force,
+        };
+    }
+
+    const colliders_arr = try scene_manager.GetEntityGroup(frame_allocator, .{ .Component = ColliderComponent });
+    const colliders = try frame_allocator.alloc(ColliderRecord, colliders_arr.items.len);
+    for (colliders_arr.items, colliders) |entity_id, *record| {
+        const collider = scene_manager.GetEntity(entity_id).GetComponent(ColliderComponent).?;
+        record.* = .{
+            .EntityID = entity_id,
+            .Shape = @intFromEnum(collider.mShape),
+            .IsTrigger = @intFromBool(collider.mCollisionFilter.IsTrigger),
+            .CategoryMask = collider.mCollisionFilter.CategoryMask.mask,
+            .RespondMask = collider.mCollisionFilter.RespondMask.mask,
+            .EventMask = collider.mCollisionFilter.EventMask.mask,
+            .Layer = collider.mCollisionFilter.Layer,
+        };
+    }
+
+    const contact_cache = collision_manager.GetContactCache();
+    const caches = try frame_allocator.alloc(CacheRecord, contact_cache.count());
+    for (contact_cache.keys(), contact_cache.values(), caches) |key, cache, *record| {
+        record.* = .{ .Key = key, .AccumImpulse = cache.AccumImpulse, .Events = @intFromBool(cache.Events) };
+    }
+
+    try Encode(engine_allocator, buffer, accumulator, bodies, colliders, caches);
+}
+
+/// Writes the records of a snapshot made by SaveWorld back into the components and replaces the contact
+/// cache with the saved one. Returns the saved step accumulator. World transforms are left to the caller
+pub fn RestoreWorld(engine_allocator: std.mem.Allocator, scene_manager: anytype, collision_manager: *CollisionManager, bytes: []const u8) !f32 {
+    const reader = try Reader.Init(bytes);
+
+    for (0..reader.BodyCount()) |i| {
+        const record = reader.GetBody(i);
+        const entity = scene_manager.GetEntity(record.EntityID);
+        const entity_rb = entity.GetComponent(RigidBodyComponent) orelse return error.InvalidSnapshot;
+        const transform = entity.GetComponent(EntityTransformComponent) orelse return error.InvalidSnapshot;
+        entity_rb.mMass = record.Mass;
+        entity_rb._InvMass = record.InvMass;
+        entity_rb._Velocity = record.Velocity;
+        entity_rb._Force = record.Force;
+        transform.SetTranslation(record.Translation);
+        transform.SetRotation(record.Rotation);
+    }
+
+    for (0..reader.ColliderCount()) |i| {
+        const record = reader.GetCollider(i);
+        const collider = scene_manager.GetEntity(record.EntityID).GetComponent(ColliderComponent) orelse return error.InvalidSnapshot;
+        collider.mShape = std.enums.fromInt(ColliderComponent.Shapes, record.Shape) orelse return error.InvalidSnapshot;
+        collider.mCollisionFilter.IsTrigger = record.IsTrigger != 0;
+        collider.mCollisionFilter.CategoryMask = .{ .mask = record.CategoryMask };
+        collider.mCollisionFilter.RespondMask = .{ .mask = record.RespondMask };
+        collider.mCollisionFilter.EventMask = .{ .mask = record.EventMask };
+        collider.mCollisionFilter.Layer = std.math.cast(CollisionLayers.Layer, record.Layer) orelse return error.InvalidSnapshot;
+    }
+
+    collision_manager.ClearContactCache();
+    for (0..reader.CacheCount()) |i| {
+        const record = reader.GetCache(i);
+        try collision_manager.PutContactCache(engine_allocator, record.Key, .{ .AccumImpulse = record.AccumImpulse, .Events = record.Events != 0 });
+    }
+
+    return reader.GetAccumulator();
+}
+
+/// Read only view of an encoded snapshot. The bytes do not need any alignment
+/// so records are copied out one at a time
+pub const Reader = struct {
+    mBytes: []const u8,
+    mHeader: Header,
+
+    pub fn Init(bytes: []const u8) !Reader {
+        if (bytes.len < @sizeOf(Header)) return error.InvalidSnapshot;
+        const header = std.mem.bytesToValue(Header, bytes[0..@sizeOf(Header)]);
+        if (header.Magic != MAGIC or header.Version != VERSION) return error.InvalidSnapshot;
+        if (bytes.len != GetEncodedSize(header)) return error.InvalidSnapshot;
+        return .{ .mBytes = bytes, .mHeader = header };
+    }
+
+    pub fn GetAccumulator(self: Reader) f32 {
+        return self.mHeader.Accumulator;
+    }
+
+    pub fn BodyCount(self: Reader) usize {
+        return self.mHeader.BodyCount;
+    }
+
+    pub fn ColliderCount(self: Reader) usize {
+        return self.mHeader.ColliderCount;
+    }
+
+    pub fn CacheCount(self: Reader) usize {
+        return self.mHeader.CacheCount;
+    }
+
+    pub fn GetBody(self: Reader, i: usize) BodyRecord {
+        return self.GetRecord(BodyRecord, @sizeOf(Header), i);
+    }
+
+    pub fn GetCollider(self: Reader, i: usize) ColliderRecord {
+        return self.GetRecord(ColliderRecord, @sizeOf(Header) + self.BodyCount() * @sizeOf(BodyRecord), i);
+    }
+
+    pub fn GetCache(self: Reader, i: usize) CacheRecord {
+        const offset = @sizeOf(Header) + self.BodyCount() * @sizeOf(BodyRecord) + self.ColliderCount() * @sizeOf(ColliderRecord);
+        return self.GetRecord(CacheRecord, offset, i);
+    }
+
+    fn GetRecord(self: Reader, comptime T: type, section_offset: usize, i: usize) T {
+        const start = section_offset + i * @sizeOf(T);
+        return std.mem.bytesToValue(T, self.mBytes[start..][0..@sizeOf(T)]);
+    }
+};
+
+fn GetEncodedSize(header: Header) usize {
+    return @sizeOf(Header) +
+        @as(usize, header.BodyCount) * @sizeOf(BodyRecord) +
+        @as(usize, header.ColliderCount) * @sizeOf(ColliderRecord) +
+        @as(usize, header.CacheCount) * @sizeOf(CacheRecord);
+}
+
+//a cut down fixed step made of the same headless pieces PhysicsManager uses: SoA integration,
+//sphere contacts against a ground box and the coloured parallel solver warm started from the
+//CollisionManager contact cache. Bodies live in components and the world stands in for the
+//SceneManager, so saving and restoring runs the same SaveWorld and RestoreWorld as PhysicsManager
+const TestWorld = struct {
+    const WorkerPool = @import("../Core/WorkerPool.zig");
+    const Integrator = @import("Integrator.zig");
+    const ContactSolver = @import("ContactSolver.zig");
+    const CCD = @import("CCD.zig");
+
+    const GROUND: CCD.Shape = .{ .Box = .{ .x = 20, .y = 1, .z = 20 } };
+    const GROUND_POS = Vec3(f32){ .x = 0, .y = -1, .z = 0 };
+    const BALL: CCD.Shape = .{ .Sphere = 0.5 };
+    const DT: f32 = 1.0 / 60.0;
+
+    const TestEntity = struct {
+        mWorld: *TestWorld,
+        mEntityID: u32,
+
+        fn GetComponent(self: TestEntity, comptime ComponentT: type) ?*ComponentT {
+            if (ComponentT == RigidBodyComponent) return &self.mWorld.mRigidBodies.items[self.mEntityID];
+            if (ComponentT == EntityTransformComponent) return &self.mWorld.mTransforms.items[self.mEntityID];
+            if (ComponentT == ColliderComponent) return &self.mWorld.mColliders.items[self.mEntityID];
+            return null;
+        }
+    };
+
+    mAllocator: std.mem.Allocator,
+    mFrameArena: std.heap.ArenaAllocator,
+    mAccumulator: f32 = 0,
+    mRigidBodies: std.ArrayList(RigidBodyComponent) = .empty,
+    mTransforms: std.ArrayList(EntityTransformComponent) = .empty,
+    mColliders: std.ArrayList(ColliderComponent) = .empty,
+    mCollisionManager: CollisionManager = .empty,
+    mBodies: Integrator.BodyBuffers = .empty,
+    mSolver: ContactSolver = .empty,
+    mSolverBodies: std.ArrayList(ContactSolver.SolverBody) = .empty,
+    mSolverContacts: std.ArrayList(ContactSolver.SolverContact) = .empty,
+
+    fn Init(allocator: std.mem.Allocator) TestWorld {
+        return .{ .mAllocator = allocator, .mFrameArena = .init(allocator) };
+    }
+
+    fn Deinit(self: *TestWorld) void {
+        self.mFrameArena.deinit();
+        self.mRigidBodies.deinit(self.mAllocator);
+        self.mTransforms.deinit(self.mAllocator);
+        self.mColliders.deinit(self.mAllocator);
+        self.mCollisionManager.Deinit(self.mAllocator);
+        self.mBodies.Deinit(self.mAllocator);
+        self.mSolver.Deinit(self.mAllocator);
+        self.mSolverBodies.deinit(self.mAllocator);
+        self.mSolverContacts.deinit(self.mAllocator);
+    }
+
+    fn AddBall(self: *TestWorld, position: Vec3(f32), mass: f32) !void {
+        var transform: EntityTransformComponent = .{};
+        transform.SetTranslation(position);
+        try self.mRigidBodies.append(self.mAllocator, .{ .mMass = mass, ._InvMass = 1.0 / mass });
+        try self.mTransforms.append(self.mAllocator, transform);
+        try self.mColliders.append(self.mAllocator, .{});
+    }
+
+    //every entity has all three components so every group is all of them
+    fn GetEntityGroup(self: *const TestWorld, frame_allocator: std.mem.Allocator, comptime query: anytype) !std.ArrayList(u32) {
+        _ = query;
+        var group: std.ArrayList(u32) = .empty;
+        try group.ensureTotalCapacity(frame_allocator, self.mRigidBodies.items.len);
+        for (0..self.mRigidBodies.items.len) |i| group.appendAssumeCapacity(@intCast(i));
+        return group;
+    }
+
+    fn GetEntity(self: *TestWorld, entity_id: u32) TestEntity {
+        return .{ .mWorld = self, .mEntityID = entity_id };
+    }
+
+    fn Step(self: *TestWorld, pool: *WorkerPool) !void {
+        const count = self.mRigidBodies.items.len;
+        try self.mBodies.Resize(self.mAllocator, count);
+        for (self.mRigidBodies.items, self.mTransforms.items, 0..) |entity_rb, transform, i| {
+            const force = entity_rb._Force.AddVec(.{ .x = 0, .y = -9.81 * entity_rb.mMass, .z = 0 });
+            self.mBodies.SetBody(i, transform.Translation, entity_rb._Velocity, force, entity_rb._InvMass);
+        }
+        Integrator.Integrate(&self.mBodies, DT);
+
+        //body 0 in the solver is the static ground
+        self.mSolverBodies.clearRetainingCapacity();
+        self.mSolverContacts.clearRetainingCapacity();
+        try self.mSolverBodies.append(self.mAllocator, .{ .Velocity = Vec3(f32).FromScalar(0), .PositionCorrection = Vec3(f32).FromScalar(0), .InvMass = 0 });
+        for (0..count) |i| {
+            try self.mSolverBodies.append(self.mAllocator, .{ .Velocity = self.mBodies.GetVelocity(i), .PositionCorrection = Vec3(f32).FromScalar(0), .InvMass = self.mBodies.InvMass.items[i] });
+        }
+
+        for (0..count) |i| {
+            const pos_i = self.mBodies.GetPosition(i);
+            try self.AddContact(i + 1, 0, CCD.GetSeparation(BALL, pos_i, GROUND, GROUND_POS));
+            for (i + 1..count) |j| {
+                try self.AddContact(i + 1, j + 1, CCD.GetSeparation(BALL, pos_i, BALL, self.mBodies.GetPosition(j)));
+            }
+        }
+
+        try self.mSolver.Prepare(self.mAllocator, self.mSolverBodies.items, self.mSolverContacts.items);
+        self.mSolver.Solve(pool, self.mSolverBodies.items, .default);
+
+        //the events flag alternates with the key so restoring has to bring it back too
+        self.mCollisionManager.ClearContactCache();
+        for (self.mSolver.GetContacts()) |contact| {
+            try self.mCollisionManager.PutContactCache(self.mAllocator, contact.Key, .{ .AccumImpulse = contact.AccumImpulse, .Events = contact.Key % 2 == 0 });
+        }
+        for (self.mRigidBodies.items, self.mTransforms.items, 0..) |*entity_rb, *transform, i| {
+            const body = self.mSolverBodies.items[i + 1];
+            entity_rb._Velocity = body.Velocity;
+            entity_rb._Force = Vec3(f32).FromScalar(0);
+            transform.SetTranslation(self.mBodies.GetPosition(i).AddVec(body.PositionCorrection));
+        }
+    }
+
+    fn AddContact(self: *TestWorld, a: usize, b: usize, separation: CCD.Separation) !void {
+        if (separation.Distance >= 0) return;
+        const key = @as(u64, a) << 32 | @as(u64, b);
+        const cache = self.mCollisionManager.GetContactCache().get(key);
+        try self.mSolverContacts.append(self.mAllocator, .{
+            .BodyA = @intCast(b),
+            .BodyB = @intCast(a),
+            .Normal = separation.Normal,
+            .Penetration = -separation.Distance,
+            .AccumImpulse = if (cache) |c| c.AccumImpulse else 0,
+            .Key = key,
+        });
+    }
+
+    fn Save(self: *TestWorld, buffer: *std.ArrayList(u8)) !void {
+        defer _ = self.mFrameArena.reset(.retain_capacity);
+        try SaveWorld(self.mFrameArena.allocator(), self.mAllocator, self, &self.mCollisionManager, self.mAccumulator, buffer);
+    }
+
+    fn Restore(self: *TestWorld, bytes: []const u8) !void {
+        self.mAccumulator = try RestoreWorld(self.mAllocator, self, &self.mCollisionManager, bytes);
+    }
+};
+
+test "Resimulating after a rollback is bit identical" {
+    const allocator = std.testing.allocator;
+
+    var pool: TestWorld.WorkerPool = .empty;
+    try pool.Init(allocator, 3);
+    defer pool.Deinit(allocator);
+
+    var world = TestWorld.Init(allocator);
+    defer world.Deinit();
+
+    //a loose pile of balls dropped onto the ground
+    const count = 48;
+    for (0..count) |i| {
+        const position = Vec3(f32){
+            .x = @as(f32, @floatFromInt(i % 4)) * 0.9,
+            .y = 0.5 + @as(f32, @floatFromInt(i / 16)) * 0.95,
+            .z = @as(f32, @floatFromInt((i / 4) % 4)) * 0.9,
+        };
+        try world.AddBall(position, 1.0 + @as(f32, @floatFromInt(i % 3)));
+    }
+
+    //settle a little so the contact cache is warm when we snapshot
+    for (0..8) |_| try world.Step(&pool);
+    try std.testing.expect(world.mCollisionManager.GetContactCache().count() > 0);
+
+    var snapshot: std.ArrayList(u8) = .empty;
+    defer snapshot.deinit(allocator);
+    try world.Save(&snapshot);
+
+    for (0..8) |_| try world.Step(&pool);
+    var first_run: std.ArrayList(u8) = .empty;
+    defer first_run.deinit(allocator);
+    try world.Save(&first_run);
+
+    try world.Restore(snapshot.items);
+    for (0..8) |_| try world.Step(&pool);
+    var second_run: std.ArrayList(u8) = .empty;
+    defer second_run.deinit(allocator);
+    try world.Save(&second_run);
+
+    try std.testing.expect(!std.mem.eql(u8, snapshot.items, first_run.items));
+    try std.testing.expectEqualSlices(u8, first_run.items, second_run.items);
+}
+
+test "Restoring a snapshot replaces the contact cache and the colliders" {
+    const allocator = std.testing.allocator;
+
+    var world = TestWorld.Init(allocator);
+    defer world.Deinit();
+    try world.AddBall(.{ .x = 0, .y = 1, .z = 0 }, 2);
+    try world.AddBall(.{ .x = 3, .y = 1, .z = 0 }, 1);
+
+    world.mColliders.items[1].mShape = .Box;
+    world.mColliders.items[1].mCollisionFilter.IsTrigger = true;
+    world.mColliders.items[1].mCollisionFilter.EventMask.set(3);
+    world.mColliders.items[1].mCollisionFilter.Layer = 2;
+    world.mAccumulator = 0.004;
+    try world.mCollisionManager.PutContactCache(allocator, 7, .{ .AccumImpulse = 1.5, .Events = true });
+    try world.mCollisionManager.PutContactCache(allocator, 9, .{ .AccumImpulse = 0.25, .Events = false });
+
+    var snapshot: std.ArrayList(u8) = .empty;
+    defer snapshot.deinit(allocator);
+    try world.Save(&snapshot);
+
+    //everything the snapshot holds changes, and the cache picks up a pair the snapshot never saw
+    world.mColliders.items[1] = .{};
+    world.mAccumulator = 0;
+    world.mRigidBodies.items[0]._Velocity = .{ .x = 1, .y = 2, .z = 3 };
+    world.mTransforms.items[0].SetTranslation(.{ .x = 5, .y = 5, .z = 5 });
+    world.mCollisionManager.ClearContactCache();
+    try world.mCollisionManager.PutContactCache(allocator, 7, .{ .AccumImpulse = 9, .Events = false });
+    try world.mCollisionManager.PutContactCache(allocator, 11, .{ .AccumImpulse = 2, .Events = true });
+
+    try world.Restore(snapshot.items);
+
+    try std.testing.expectEqual(@as(f32, 0.004), world.mAccumulator);
+    try std.testing.expectEqual(Vec3(f32){ .x = 0, .y = 0, .z = 0 }, world.mRigidBodies.items[0]._Velocity);
+    try std.testing.expectEqual(Vec3(f32){ .x = 0, .y = 1, .z = 0 }, world.mTransforms.items[0].Translation);
+
+    const collider = world.mColliders.items[1];
+    try std.testing.expectEqual(ColliderComponent.Shapes.Box, collider.mShape);
+    try std.testing.expect(collider.mCollisionFilter.IsTrigger);
+    try std.testing.expect(collider.mCollisionFilter.EventMask.isSet(3));
+    try std.testing.expectEqual(@as(CollisionLayers.Layer, 2), collider.mCollisionFilter.Layer);
+
+    const cache = world.mCollisionManager.GetContactCache();
+    try std.testing.expectEqual(@as(usize, 2), cache.count());
+    try std.testing.expectEqual(CollisionManager.ContactCache{ .AccumImpulse = 1.5, .Events = true }, cache.get(7).?);
+    try std.testing.expectEqual(CollisionManager.ContactCache{ .AccumImpulse = 0.25, .Events = false }, cache.get(9).?);
+    try std.testing.expect(cache.get(11) == null);
+}
+
+test "Reader rejects truncated snapshots" {
+    const allocator = std.testing.allocator;
+    var buffer: std.ArrayList(u8) = .empty;
+    defer buffer.deinit(allocator);
+
+    const caches = [_]CacheRecord{.{ .Key = 42, .AccumImpulse = 1.5 }};
+    try Encode(allocator, &buffer, 0.25, &.{}, &.{}, &caches);
+
+    const reader = try Reader.Init(buffer.items);
+    try std.testing.expectEqual(@as(f32, 0.25), reader.GetAccumulator());
+    try std.testing.expectEqual(@as(u64, 42), reader.GetCache(0).Key);
+
+    try std.testing.expectError(error.InvalidSnapshot, Reader.Init(buffer.items[0 .. buffer.items.len - 1]));
+}
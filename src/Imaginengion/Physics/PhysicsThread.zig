@@ -0,0 +1,150 @@
+//! Dedicated thread that runs the fixed step simulation off the main frame.
+//!
+//! The owner hands over one job at a time with Kick and collects it with Wait. The thread sleeps
+//! on a futex between jobs so an idle physics thread costs nothing. Only the owning thread may
+//! call Kick, IsBusy and Wait. Errors returned by the job are handed back by Wait.
+const std = @import("std");
+const PhysicsThread = @This();
+
+const Job = struct {
+    mContext: *anyopaque,
+    mRunFn: *const fn (context: *anyopaque) anyerror!void,
+};
+
+pub const empty: PhysicsThread = .{
+    ._Thread = null,
+    ._Job = undefined,
+    ._Error = null,
+    ._Requested = std.atomic.Value(u32).init(0),
+    ._Completed = std.atomic.Value(u32).init(0),
+    ._Shutdown = std.atomic.Value(bool).init(false),
+};
+
+_Thread: ?std.Thread,
+_Job: Job,
+_Error: ?anyerror,
+_Requested: std.atomic.Value(u32),
+_Completed: std.atomic.Value(u32),
+_Shutdown: std.atomic.Value(bool),
+
+pub fn Init(self: *PhysicsThread) !void {
+    std.debug.assert(self._Thread == null);
+    self._Thread = try std.Thread.spawn(.{}, ThreadMain, .{self});
+}
+
+/// Finishes the job in flight, if any, and joins the thread
+pub fn Deinit(self: *PhysicsThread) void {
+    const thread = self._Thread orelse return;
+    self.Wait() catch {};
+
+    self._Shutdown.store(true, .release);
+    _ = self._Requested.fetchAdd(1, .release);
+    std.Thread.Futex.wake(&self._Requested, 1);
+    thread.join();
+
+    self._Thread = null;
+    self._Requested.store(0, .monotonic);
+    self._Completed.store(0, .monotonic);
+    self._Shutdown.store(false, .monotonic);
+}
+
+pub fn IsRunning(self: PhysicsThread) bool {
+    return self._Thread != null;
+}
+
+/// Starts func(context) on the physics thread and returns right away. The previous job must have been collected with Wait
+pub fn Kick(self: *PhysicsThread, context: anytype, comptime func: fn (@TypeOf(context)) anyerror!void) void {
+    std.debug.assert(self._Thread != null);
+    std.debug.assert(!self.IsBusy());
+
+    const ContextT = @TypeOf(context);
+    const Wrapper = struct {
+        fn Run(ctx: *anyopaque) anyerror!void {
+            return func(@as(ContextT, @ptrCast(@alignCast(ctx))));
+        }
+    };
+
+    self._Job = .{ .mContext = @ptrCast(context), .mRunFn = Wrapper.Run };
+    _ = self._Requested.fetchAdd(1, .release);
+    std.Thread.Futex.wake(&self._Requested, 1);
+}
+
+/// True while a kicked job has not finished yet
+pub fn IsBusy(self: *const PhysicsThread) bool {
+    return self._Completed.load(.acquire) != self._Requested.load(.monotonic);
+}
+
+/// Blocks until the kicked job is done and returns its error, returns immediately when nothing is in flight
+pub fn Wait(self: *PhysicsThread) !void {
+    while (true) {
+        const completed = self._Completed.load(.acquire);
+        if (completed == self._Requested.load(.monotonic)) break;
+        std.Thread.Futex.wait(&self._Completed, completed);
+    }
+
+    const err = self._Error orelse return;
+    self._Error = null;
+    return err;
+}
+
+fn ThreadMain(self: *PhysicsThread) void {
+    var seen_request: u32 = 0;
+    while (true) {
+        var requested = self._Requested.load(.acquire);
+        while (requested == seen_request) {
+            std.Thread.Futex.wait(&self._Requested, seen_request);
+            requested = self._Requested.load(.acquire);
+        }
+        if (self._Shutdown.load(.acquire)) return;
+        seen_request = requested;
+
+        self._Job.mRunFn(self._Job.mContext) catch |err| {
+            self._Error = err;
+        };
+
+        self._Completed.store(seen_request, .release);
+        std.Thread.Futex.wake(&self._Completed, 1);
+    }
+}
+
+test "Jobs run on the physics thread one at a time" {
+    var physics_thread: PhysicsThread = .empty;
+    try physics_thread.Init();
+    defer physics_thread.Deinit();
+
+    const Counter = struct {
+        mCount: u32 = 0,
+        mThreadID: std.Thread.Id = undefined,
+
+        fn Run(self: *@This()) anyerror!void {
+            self.mCount += 1;
+            self.mThreadID = std.Thread.getCurrentId();
+        }
+    };
+
+    var counter: Counter = .{};
+    for (0..100) |_| {
+        physics_thread.Kick(&counter, Counter.Run);
+        try physics_thread.Wait();
+        try std.testing.expect(!physics_thread.IsBusy());
+    }
+    try std.testing.expectEqual(@as(u32, 100), counter.mCount);
+    try std.testing.expect(counter.mThreadID != std.Thread.getCurrentId());
+}
+
+test "Wait hands back the error of the job" {
+    var physics_thread: PhysicsThread = .empty;
+    try physics_thread.Init();
+    defer physics_thread.Deinit();
+
+    const Failing = struct {
+        fn Run(_: *u32) anyerror!void {
+            return error.OutOfMemory;
+        }
+    };
+
+    var unused: u32 = 0;
+    physics_thread.Kick(&unused, Failing.Run);
+    try std.testing.expectError(error.OutOfMemory, physics_thread.Wait());
+    try physics_thread.Wait();
+}
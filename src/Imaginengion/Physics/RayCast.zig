@@ -1,13 +1,194 @@
-const LinAlg = @import("../Math/LinAlg.zig");
-const Vec3f32 = LinAlg.Vec3f32;
+//! Ray and shape cast queries against the colliders.
+//!
+//! Queries run against the collider BVH built by the last broadphase, so they see the colliders
+//! as they were at the start of the last physics substep. Everything here only reads the
+//! CollisionManager which makes the queries safe to run from several threads at once.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Ray = MathTypes.Ray;
 
 const Entity = @import("../GameObjects/Entity.zig");
+const WorkerPool = @import("../Core/WorkerPool.zig");
+const CollisionManager = @import("CollisionManager.zig");
+const ColliderProxy = CollisionManager.ColliderProxy;
+const CollisionLayers = @import("CollisionLayers.zig");
+const CCD = @import("CCD.zig");
+const Shapes = @import("Shapes.zig");
 
 pub const RayHit = struct {
-    Hit: bool, //Was there a hit or not
-    Distance: f32, //how far the hit object is from the origin
-    Position: Vec3f32,
-    Normal: Vec3f32,
+    Distance: f32, //how far along the ray the hit is
+    Position: Vec3(f32), //point on the surface of the hit collider
+    Normal: Vec3(f32),
     Entity: Entity,
-    Collider: Entity, //optional depending on if we are tracing render objects or physics objects
 };
+
+pub const QueryFilter = struct {
+    pub const default: QueryFilter = .{
+        .CategoryMask = .initFull(),
+        .LayerMask = .initFull(),
+        .IncludeTriggers = true,
+    };
+
+    /// Only colliders with a category bit in this mask are considered
+    CategoryMask: std.StaticBitSet(32),
+    /// Only colliders on a layer in this mask are considered
+    LayerMask: CollisionLayers.LayerMask,
+    IncludeTriggers: bool,
+
+    pub fn Accepts(self: QueryFilter, proxy: ColliderProxy) bool {
+        if (!self.IncludeTriggers and proxy.mFilter.IsTrigger) return false;
+        if (!self.LayerMask.isSet(proxy.mFilter.Layer)) return false;
+        return self.CategoryMask.intersectWith(proxy.mFilter.CategoryMask).findFirstSet() != null;
+    }
+};
+
+const CastHit = struct {
+    mProxy: u32,
+    mDistance: f32,
+    mNormal: Vec3(f32),
+};
+
+const NO_EXTENT = Vec3(f32){ .x = 0, .y = 0, .z = 0 };
+
+/// Closest collider hit by the ray within max_distance. ray.Direction must be normalized
+pub fn RayCast(collision_manager: *const CollisionManager, ray: Ray(f32), max_distance: f32, filter: QueryFilter) ?RayHit {
+    return ClosestCast(collision_manager, ray, null, max_distance, filter);
+}
+
+/// Writes the hits closest to the ray origin into hits, sorted by distance, and returns how many were written.
+/// Hits past the end of the buffer are dropped so size it for the closest N colliders you care about
+pub fn RayCastAll(collision_manager: *const CollisionManager, ray: Ray(f32), max_distance: f32, filter: QueryFilter, hits: []RayHit) usize {
+    if (hits.len == 0) return 0;
+
+    const Collector = struct {
+        mManager: *const CollisionManager,
+        mRay: Ray(f32),
+        mFilter: QueryFilter,
+        mHits: []RayHit,
+        mCount: *usize,
+
+        fn Visit(ctx: @This(), item: u32, max_t: f32) f32 {
+            const proxy = ctx.mManager.GetProxies()[item];
+            if (!ctx.mFilter.Accepts(proxy)) return max_t;
+            const impact = CastProxy(proxy, null, ctx.mRay, max_t) orelse return max_t;
+
+            //insertion into the sorted buffer, the farthest hit falls off the end when full
+            var i = @min(ctx.mCount.*, ctx.mHits.len - 1);
+            while (i > 0 and ctx.mHits[i - 1].Distance > impact.Distance) : (i -= 1) {
+                ctx.mHits[i] = ctx.mHits[i - 1];
+            }
+            ctx.mHits[i] = MakeHit(ctx.mManager, ctx.mRay, NO_EXTENT, .{ .mProxy = item, .mDistance = impact.Distance, .mNormal = impact.Normal });
+            ctx.mCount.* = @min(ctx.mCount.* + 1, ctx.mHits.len);
+
+            //once full nothing past the farthest kept hit can make it in
+            return if (ctx.mCount.* == ctx.mHits.len) ctx.mHits[ctx.mHits.len - 1].Distance else max_t;
+        }
+    };
+
+    var count: usize = 0;
+    collision_manager.GetBVH().QueryRay(ray.Origin, ray.Direction, max_distance, NO_EXTENT, Collector{
+        .mManager = collision_manager,
+        .mRay = ray,
+        .mFilter = filter,
+        .mHits = hits,
+        .mCount = &count,
+    }, Collector.Visit);
+    return count;
+}
+
+/// Sweeps a sphere from ray.Origin along ray.Direction and returns the first collider it touches.
+/// Colliders already touching the sphere at the origin are ignored
+pub fn SphereCast(collision_manager: *const CollisionManager, ray: Ray(f32), radius: f32, max_distance: f32, filter: QueryFilter) ?RayHit {
+    return ClosestCast(collision_manager, ray, .{ .Sphere = radius }, max_distance, filter);
+}
+
+/// Sweeps an axis aligned box centered on ray.Origin along ray.Direction and returns the first collider it touches.
+/// Colliders already touching the box at the origin are ignored
+pub fn BoxCast(collision_manager: *const CollisionManager, ray: Ray(f32), half_extents: Vec3(f32), max_distance: f32, filter: QueryFilter) ?RayHit {
+    return ClosestCast(collision_manager, ray, .{ .Box = half_extents }, max_distance, filter);
+}
+
+/// Resolves RayCast for every ray, hits[i] is the result of rays[i].
+/// Rays are split into chunks across the worker pool.
+pub fn RayCastBatch(collision_manager: *const CollisionManager, worker_pool: *WorkerPool, rays: []const Ray(f32), max_distance: f32, filter: QueryFilter, hits: []?RayHit) void {
+    std.debug.assert(rays.len == hits.len);
+
+    const BatchContext = struct {
+        mManager: *const CollisionManager,
+        mRays: []const Ray(f32),
+        mHits: []?RayHit,
+        mMaxDistance: f32,
+        mFilter: QueryFilter,
+
+        fn Run(ctx: @This(), start: usize, end: usize) void {
+            for (ctx.mRays[start..end], ctx.mHits[start..end]) |ray, *hit| {
+                hit.* = RayCast(ctx.mManager, ray, ctx.mMaxDistance, ctx.mFilter);
+            }
+        }
+    };
+
+    worker_pool.ParallelFor(rays.len, 64, BatchContext{
+        .mManager = collision_manager,
+        .mRays = rays,
+        .mHits = hits,
+        .mMaxDistance = max_distance,
+        .mFilter = filter,
+    }, BatchContext.Run);
+}
+
+fn ClosestCast(collision_manager: *const CollisionManager, ray: Ray(f32), cast_shape: ?CCD.Shape, max_distance: f32, filter: QueryFilter) ?RayHit {
+    const Closest = struct {
+        mManager: *const CollisionManager,
+        mRay: Ray(f32),
+        mCastShape: ?CCD.Shape,
+        mFilter: QueryFilter,
+        mHit: *?CastHit,
+
+        fn Visit(ctx: @This(), item: u32, max_t: f32) f32 {
+            const proxy = ctx.mManager.GetProxies()[item];
+            if (!ctx.mFilter.Accepts(proxy)) return max_t;
+            const impact = CastProxy(proxy, ctx.mCastShape, ctx.mRay, max_t) orelse return max_t;
+            ctx.mHit.* = .{ .mProxy = item, .mDistance = impact.Distance, .mNormal = impact.Normal };
+            return impact.Distance;
+        }
+    };
+
+    const extent = if (cast_shape) |shape| Shapes.GetHalfExtents(shape) else NO_EXTENT;
+
+    var closest: ?CastHit = null;
+    collision_manager.GetBVH().QueryRay(ray.Origin, ray.Direction, max_distance, extent, Closest{
+        .mManager = collision_manager,
+        .mRay = ray,
+        .mCastShape = cast_shape,
+        .mFilter = filter,
+        .mHit = &closest,
+    }, Closest.Visit);
+
+    const hit = closest orelse return null;
+    return MakeHit(collision_manager, ray, extent, hit);
+}
+
+fn CastProxy(proxy: ColliderProxy, cast_shape: ?CCD.Shape, ray: Ray(f32), max_distance: f32) ?CCD.RayImpact {
+    if (proxy.mCompound) |compound| {
+        const shape = cast_shape orelse return compound.RayCast(proxy.mPosition, ray.Origin, ray.Direction, max_distance);
+        const impact = compound.TimeOfImpact(proxy.mPosition, shape, ray.Origin, ray.Direction.MulScalar(max_distance)) orelse return null;
+        return .{ .Distance = impact.Time * max_distance, .Normal = impact.Normal };
+    }
+
+    const shape = cast_shape orelse return CCD.RayCastShape(proxy.mShape, proxy.mPosition, ray.Origin, ray.Direction, max_distance);
+
+    const impact = CCD.TimeOfImpact(shape, ray.Origin, ray.Direction.MulScalar(max_distance), proxy.mShape, proxy.mPosition, NO_EXTENT) orelse return null;
+    return .{ .Distance = impact.Time * max_distance, .Normal = impact.Normal };
+}
+
+fn MakeHit(collision_manager: *const CollisionManager, ray: Ray(f32), extent: Vec3(f32), hit: CastHit) RayHit {
+    //for shape casts step from the center of the swept shape over to its surface along the normal
+    const center = ray.Origin.AddVec(ray.Direction.MulScalar(hit.mDistance));
+    return .{
+        .Distance = hit.mDistance,
+        .Position = center.SubVec(hit.mNormal.MulVec(extent)),
+        .Normal = hit.mNormal,
+        .Entity = collision_manager.GetProxyEntity(hit.mProxy),
+    };
+}
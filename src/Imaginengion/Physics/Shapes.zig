@@ -0,0 +1,158 @@
+//! Collision shapes shared by the narrowphase, the swept tests and the scene queries.
+//!
+//! Shapes are in world space orientation (like the rest of the physics, rotation is ignored)
+//! and centered on the position passed next to them. Every shape provides a support function
+//! so the general GJK/EPA path in GJK.zig can handle any pair. Spheres and capsules are split
+//! into a core (point, segment) plus a margin so GJK can work on the exact core geometry.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+
+/// Segment along the y axis from -HalfHeight to HalfHeight swept by Radius
+pub const Capsule = struct {
+    Radius: f32,
+    HalfHeight: f32,
+};
+
+/// Sphere holds the radius, Box holds the half extents, Hull holds points relative to the center
+pub const Shape = union(enum) {
+    Sphere: f32,
+    Box: Vec3(f32),
+    Capsule: Capsule,
+    Hull: []const Vec3(f32),
+};
+
+pub const Separation = struct {
+    /// Negative when the shapes overlap
+    Distance: f32,
+    /// Points from shape b towards shape a
+    Normal: Vec3(f32),
+};
+
+const HULL_LANES: usize = std.math.clamp(std.simd.suggestVectorLength(f32) orelse 4, 4, 8);
+const HullVec = @Vector(HULL_LANES, f32);
+const HullIndexVec = @Vector(HULL_LANES, u32);
+
+/// Half size of the axis aligned box around the shape
+pub fn GetHalfExtents(shape: Shape) Vec3(f32) {
+    return switch (shape) {
+        .Sphere => |radius| Vec3(f32).FromScalar(radius),
+        .Box => |half_extents| half_extents,
+        .Capsule => |capsule| .{ .x = capsule.Radius, .y = capsule.HalfHeight + capsule.Radius, .z = capsule.Radius },
+        .Hull => |points| blk: {
+            var extents = Vec3(f32).FromScalar(0);
+            for (points) |point| {
+                extents = Vec3(f32).FromVector(@max(extents.ToVector(), point.Abs().ToVector()));
+            }
+            break :blk extents;
+        },
+    };
+}
+
+/// Smallest extent of the shape, motion shorter than half of this can not tunnel through anything
+pub fn GetMinExtent(shape: Shape) f32 {
+    return switch (shape) {
+        .Sphere => |radius| radius,
+        .Capsule => |capsule| capsule.Radius,
+        .Box, .Hull => blk: {
+            const half = GetHalfExtents(shape);
+            break :blk @min(half.x, @min(half.y, half.z));
+        },
+    };
+}
+
+/// Rounded part of the shape that is not part of its core
+pub fn GetMargin(shape: Shape) f32 {
+    return switch (shape) {
+        .Sphere => |radius| radius,
+        .Capsule => |capsule| capsule.Radius,
+        .Box, .Hull => 0,
+    };
+}
+
+/// Farthest point of the core of the shape in direction, relative to the shape center
+pub fn CoreSupport(shape: Shape, direction: Vec3(f32)) Vec3(f32) {
+    return switch (shape) {
+        .Sphere => Vec3(f32).FromScalar(0),
+        .Box => |half| .{
+            .x = if (direction.x >= 0) half.x else -half.x,
+            .y = if (direction.y >= 0) half.y else -half.y,
+            .z = if (direction.z >= 0) half.z else -half.z,
+        },
+        .Capsule => |capsule| .{ .x = 0, .y = if (direction.y >= 0) capsule.HalfHeight else -capsule.HalfHeight, .z = 0 },
+        .Hull => |points| HullSupport(points, direction),
+    };
+}
+
+/// Farthest point of the whole shape in direction, relative to the shape center
+pub fn Support(shape: Shape, direction: Vec3(f32)) Vec3(f32) {
+    const margin = GetMargin(shape);
+    const core = CoreSupport(shape, direction);
+    if (margin == 0) return core;
+    return core.AddVec(direction.Dir().MulScalar(margin));
+}
+
+/// Support of a point cloud, HULL_LANES points are dotted with the direction per vector op
+/// and the best lane of each batch is kept with a select, the scalar loop handles the tail
+pub fn HullSupport(points: []const Vec3(f32), direction: Vec3(f32)) Vec3(f32) {
+    std.debug.assert(points.len > 0);
+
+    const dir_x: HullVec = @splat(direction.x);
+    const dir_y: HullVec = @splat(direction.y);
+    const dir_z: HullVec = @splat(direction.z);
+
+    var best_dots: HullVec = @splat(-std.math.inf(f32));
+    var best_indices: HullIndexVec = @splat(0);
+
+    var i: usize = 0;
+    while (i + HULL_LANES <= points.len) : (i += HULL_LANES) {
+        var xs: HullVec = undefined;
+        var ys: HullVec = undefined;
+        var zs: HullVec = undefined;
+        inline for (0..HULL_LANES) |lane| {
+            xs[lane] = points[i + lane].x;
+            ys[lane] = points[i + lane].y;
+            zs[lane] = points[i + lane].z;
+        }
+        const dots = xs * dir_x + ys * dir_y + zs * dir_z;
+        const better = dots > best_dots;
+        best_dots = @select(f32, better, dots, best_dots);
+        best_indices = @select(u32, better, @as(HullIndexVec, @splat(@intCast(i))) + std.simd.iota(u32, HULL_LANES), best_indices);
+    }
+
+    var best_dot = -std.math.inf(f32);
+    var best_index: usize = 0;
+    inline for (0..HULL_LANES) |lane| {
+        if (best_dots[lane] > best_dot) {
+            best_dot = best_dots[lane];
+            best_index = best_indices[lane];
+        }
+    }
+    for (points[i..], i..) |point, j| {
+        const dot = point.Dot(direction);
+        if (dot > best_dot) {
+            best_dot = dot;
+            best_index = j;
+        }
+    }
+    return points[best_index];
+}
+
+test "SIMD hull support matches the scalar search" {
+    var prng = std.Random.DefaultPrng.init(3);
+    const random = prng.random();
+
+    var points: [37]Vec3(f32) = undefined;
+    for (&points) |*point| {
+        point.* = .{ .x = random.float(f32) * 2 - 1, .y = random.float(f32) * 2 - 1, .z = random.float(f32) * 2 - 1 };
+    }
+
+    for (0..100) |_| {
+        const direction = Vec3(f32){ .x = random.float(f32) * 2 - 1, .y = random.float(f32) * 2 - 1, .z = random.float(f32) * 2 - 1 };
+        var expected = points[0];
+        for (points[1..]) |point| {
+            if (point.Dot(direction) > expected.Dot(direction)) expected = point;
+        }
+        try std.testing.expectEqual(expected, HullSupport(&points, direction));
+    }
+}
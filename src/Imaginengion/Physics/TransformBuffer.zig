@@ -0,0 +1,112 @@
+//! Double buffered transform output of the fixed step simulation.
+//!
+//! The simulation side records the state of every body at the end of each fixed step into the
+//! back buffer, keeping the state of the step before it next to it. Publish copies the back buffer
+//! into the front buffer at a sync point, after which the render side can blend the last two
+//! physics states by the accumulator alpha while the simulation keeps writing the back buffer.
+const std = @import("std");
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Quat = MathTypes.Quat;
+
+const TransformBuffer = @This();
+
+pub const BodyState = struct {
+    EntityID: u32,
+    Position: Vec3(f32),
+    Rotation: Quat(f32),
+};
+
+const States = struct {
+    pub const empty: States = .{
+        .Previous = .empty,
+        .Current = .empty,
+    };
+    Previous: std.ArrayList(BodyState),
+    Current: std.ArrayList(BodyState),
+
+    fn Deinit(self: *States, engine_allocator: std.mem.Allocator) void {
+        self.Previous.deinit(engine_allocator);
+        self.Current.deinit(engine_allocator);
+    }
+};
+
+pub const empty: TransformBuffer = .{
+    ._Back = .empty,
+    ._Front = .empty,
+};
+
+_Back: States,
+_Front: States,
+
+pub fn Deinit(self: *TransformBuffer, engine_allocator: std.mem.Allocator) void {
+    self._Back.Deinit(engine_allocator);
+    self._Front.Deinit(engine_allocator);
+}
+
+/// Simulation side. The current states become the previous ones and the current list is emptied for Record
+pub fn BeginStep(self: *TransformBuffer) void {
+    std.mem.swap(std.ArrayList(BodyState), &self._Back.Previous, &self._Back.Current);
+    self._Back.Current.clearRetainingCapacity();
+}
+
+/// Simulation side. Adds the state of one body at the end of the step
+pub fn Record(self: *TransformBuffer, engine_allocator: std.mem.Allocator, state: BodyState) !void {
+    try self._Back.Current.append(engine_allocator, state);
+}
+
+/// Makes the recorded states visible to the render side. The simulation must not be writing the back buffer
+pub fn Publish(self: *TransformBuffer, engine_allocator: std.mem.Allocator) !void {
+    try self._Front.Previous.resize(engine_allocator, self._Back.Previous.items.len);
+    try self._Front.Current.resize(engine_allocator, self._Back.Current.items.len);
+    @memcpy(self._Front.Previous.items, self._Back.Previous.items);
+    @memcpy(self._Front.Current.items, self._Back.Current.items);
+}
+
+/// Render side. Number of bodies in the front buffer
+pub fn GetCount(self: TransformBuffer) usize {
+    return self._Front.Current.items.len;
+}
+
+/// Render side. State of body index blended from the previous step (alpha 0) to the current one (alpha 1).
+/// Bodies that did not exist in the previous step, or moved index, snap to their current state
+pub fn GetInterpolated(self: TransformBuffer, index: usize, alpha: f32) BodyState {
+    const current = self._Front.Current.items[index];
+    if (index >= self._Front.Previous.items.len) return current;
+
+    const previous = self._Front.Previous.items[index];
+    if (previous.EntityID != current.EntityID) return current;
+
+    return .{
+        .EntityID = current.EntityID,
+        .Position = previous.Position.Lerp(current.Position, alpha),
+        .Rotation = previous.Rotation.Slerp(current.Rotation, alpha),
+    };
+}
+
+test "Interpolates between the last two published steps" {
+    const allocator = std.testing.allocator;
+    var buffer: TransformBuffer = .empty;
+    defer buffer.Deinit(allocator);
+
+    const identity = Quat(f32){ .w = 1, .x = 0, .y = 0, .z = 0 };
+
+    buffer.BeginStep();
+    try buffer.Record(allocator, .{ .EntityID = 1, .Position = .{ .x = 0, .y = 0, .z = 0 }, .Rotation = identity });
+    buffer.BeginStep();
+    try buffer.Record(allocator, .{ .EntityID = 1, .Position = .{ .x = 2, .y = 0, .z = 0 }, .Rotation = identity });
+    try buffer.Record(allocator, .{ .EntityID = 7, .Position = .{ .x = 5, .y = 5, .z = 5 }, .Rotation = identity });
+    try buffer.Publish(allocator);
+
+    //later steps must not show up until the next publish
+    buffer.BeginStep();
+    try buffer.Record(allocator, .{ .EntityID = 1, .Position = .{ .x = 9, .y = 9, .z = 9 }, .Rotation = identity });
+
+    try std.testing.expectEqual(@as(usize, 2), buffer.GetCount());
+    try std.testing.expectEqual(@as(f32, 0), buffer.GetInterpolated(0, 0).Position.x);
+    try std.testing.expectEqual(@as(f32, 1), buffer.GetInterpolated(0, 0.5).Position.x);
+    try std.testing.expectEqual(@as(f32, 2), buffer.GetInterpolated(0, 1).Position.x);
+
+    //new body has no previous state so it stays where it is
+    try std.testing.expectEqual(@as(f32, 5), buffer.GetInterpolated(1, 0.5).Position.x);
+}
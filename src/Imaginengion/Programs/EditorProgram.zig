@@ -13,6 +13,7 @@ const AssetHandle = @import("../Assets/AssetHandle.zig");
 const imgui = @import("../Core/CImports.zig").imgui;
 const PlatformUtils = @import("../PlatformUtils/PlatformUtils.zig");
 const GameMode = @import("../GameModes/GameMode.zig");
+const CollisionLayers = @import("../Physics/CollisionLayers.zig");
 
 const Assets = @import("../Assets/Assets.zig");
 const AudioAsset = Assets.AudioAsset;
@@ -115,6 +116,8 @@ mEditorViewportPlayer: Player = .{},
 mEditorFont: AssetHandle = .{},
 mActiveWorld: *SceneManager = undefined,
 mActiveWorldType: EngineContext.WorldType = .Game,
+//set when the end of frame removals were left for the next frame because physics was still stepping
+_FrameEndDeferred: bool = false,
 
 pub fn Init(self: *EditorProgram, engine_context: *EngineContext) !void {
     engine_context.mImguiManager.Init(engine_context);
@@ -127,7 +130,7 @@ pub fn Init(self: *EditorProgram, engine_context: *EngineContext) !void {
     self.mEditorUIScene = try engine_context.mEditorWorld.NewScene(engine_context, .OverlayLayer, .{});
     self.mEditorUIEntity = try self.mEditorUIScene.CreateEntity(engine_context, .{});
     self.mEditorUIPlayer = try engine_context.mEditorWorld.CreatePlayer(engine_context, .{ .bAddNameComponent = false, .bAddUUIDComponent = false });
-    self.mEditorUIEntity.GetComponent(TransformComponent).?.Translation = Vec3(f32){ .x = 0.0, .y = 0.0, .z = 15.0 };
+    self.mEditorUIEntity.GetComponent(TransformComponent).?.SetTranslation(.{ .x = 0.0, .y = 0.0, .z = 15.0 });
     try self.mEditorUIPlayer.GetComponent(PlayerRenderComponent).?.SetViewportSize(engine_context, engine_context.mAppWindow.GetWidth(), engine_context.mAppWindow.GetHeight());
     _ = try self.mEditorUIEntity.AddComponent(engine_context, PlayerSlotComponent{});
     _ = try self.mEditorUIEntity.AddComponent(engine_context, ViewpointComponent{});
@@ -138,7 +141,7 @@ pub fn Init(self: *EditorProgram, engine_context: *EngineContext) !void {
     self.mEditorViewportScene = try engine_context.mEditorWorld.NewScene(engine_context, .GameLayer, .{});
     self.mEditorViewportEntity = try self.mEditorViewportScene.CreateEntity(engine_context, .{});
     self.mEditorViewportPlayer = try engine_context.mEditorWorld.CreatePlayer(engine_context, .{ .bAddNameComponent = false, .bAddUUIDComponent = false });
-    self.mEditorViewportEntity.GetComponent(TransformComponent).?.Translation = Vec3(f32){ .x = 0.0, .y = 0.0, .z = 15.0 };
+    self.mEditorViewportEntity.GetComponent(TransformComponent).?.SetTranslation(.{ .x = 0.0, .y = 0.0, .z = 15.0 });
     try self.mEditorViewportEntity.AddComponentScript(engine_context, "assets/scripts/EditorCameraInput.zig", .Eng);
     try self.mEditorViewportPlayer.GetComponent(PlayerRenderComponent).?.SetViewportSize(engine_context, self._ViewportPanel.mViewportWidth, self._ViewportPanel.mViewportHeight);
     _ = try self.mEditorViewportEntity.AddComponent(engine_context, PlayerSlotComponent{});
@@ -170,6 +173,11 @@ pub fn OnUpdate(self: *EditorProgram, engine_context: *EngineContext) !void {
 
     const engine_allocator = engine_context.EngineAllocator();
 
+    //physics may still be stepping the simulate world on its own thread from last frame,
+    //the end of frame work that had to wait for it runs once it is done
+    try engine_context.mPhysicsManager.SyncThreadedStep(engine_context);
+    if (self._FrameEndDeferred) try self.ProcessFrameEnd(engine_context);
+
     //--------------Incoming network packets
     {
         const incoming_zone = Tracy.ZoneInit("Incoming Network Section", @src());
@@ -240,6 +248,7 @@ pub fn OnUpdate(self: *EditorProgram, engine_context: *EngineContext) !void {
         try engine_context.mPhysicsManager.UpdateWorldTransforms(.Editor, engine_context);
         if (self.mEditorState == .Play) {
             try engine_context.mPhysicsManager.UpdateWorldTransforms(.Simulate, engine_context);
+            engine_context.mPhysicsManager.ApplyInterpolation(engine_context, .Simulate);
         }
     }
     //---------------End World Transform Update ------------
@@ -279,7 +288,12 @@ pub fn OnUpdate(self: *EditorProgram, engine_context: *EngineContext) !void {
             callback_list.last = null;
 
             Dockspace.End();
+
+            //physics steps the simulate world from here until the top of the next frame
+            try self.KickPhysics(engine_context);
             engine_context.mImguiManager.End(engine_context);
+        } else {
+            try self.KickPhysics(engine_context);
         }
     }
     //--------------Render End-------------------
@@ -310,22 +324,15 @@ pub fn OnUpdate(self: *EditorProgram, engine_context: *EngineContext) !void {
         callback_list.first = null;
         callback_list.last = null;
 
-        //handle deleted objects this frame
-        var game_event_callback = EngineContext.GameEventCallback{ .mCtx = self, .mCallbackFn = OnGameEvent };
-        callback_list.append(&game_event_callback.mNode);
-        try engine_context.mGameEventManager.ProcessCategory(.FrameEnd, engine_context, callback_list);
-        callback_list.first = null;
-        callback_list.last = null;
-
-        try engine_context.mGameWorld.ProcessRemovedObj(engine_context);
-        try engine_context.mEditorWorld.ProcessRemovedObj(engine_context);
-        try engine_context.mSimulateWorld.ProcessRemovedObj(engine_context);
-
-        try engine_context.mAssetManager.ProcessDestroyedAssets(engine_context);
+        //removals touch the worlds, while a step is in flight they wait for the sync at the top of the next frame
+        if (engine_context.mPhysicsManager.IsStepInFlight()) {
+            self._FrameEndDeferred = true;
+        } else {
+            try self.ProcessFrameEnd(engine_context);
+        }
 
         //end of frame resets
         engine_context.mSystemEventManager.EventsReset(engine_allocator, .ClearRetainingCapacity);
-        engine_context.mGameEventManager.EventsReset(engine_allocator, .ClearRetainingCapacity);
         engine_context.mImguiEventManager.EventsReset(engine_allocator, .ClearRetainingCapacity);
     }
     //-----------------End End of Frame-------------------
@@ -442,10 +449,37 @@ pub fn OnChangeEditorStateEvent(self: *EditorProgram, engine_context: *EngineCon
     }
 }
 
+/// Handles the objects deleted this frame and the FrameEnd game events, then resets the game events
+fn ProcessFrameEnd(self: *EditorProgram, engine_context: *EngineContext) !void {
+    var callback_list: std.DoublyLinkedList = .{};
+    var game_event_callback = EngineContext.GameEventCallback{ .mCtx = self, .mCallbackFn = OnGameEvent };
+    callback_list.append(&game_event_callback.mNode);
+    try engine_context.mGameEventManager.ProcessCategory(.FrameEnd, engine_context, callback_list);
+
+    try engine_context.mGameWorld.ProcessRemovedObj(engine_context);
+    try engine_context.mEditorWorld.ProcessRemovedObj(engine_context);
+    try engine_context.mSimulateWorld.ProcessRemovedObj(engine_context);
+
+    try engine_context.mAssetManager.ProcessDestroyedAssets(engine_context);
+
+    engine_context.mGameEventManager.EventsReset(engine_context.EngineAllocator(), .ClearRetainingCapacity);
+    self._FrameEndDeferred = false;
+}
+
+fn KickPhysics(self: *EditorProgram, engine_context: *EngineContext) !void {
+    if (self.mEditorState == .Play) {
+        try engine_context.mPhysicsManager.KickThreadedStep(engine_context, .Simulate);
+    }
+}
+
 fn RenderRenderTargets(self: *EditorProgram, engine_context: *EngineContext) !void {
     const zone = Tracy.ZoneInit("Render Lenses", @src());
     defer zone.Deinit();
 
+    //one sample per frame, every target this frame renders at the same scale. The work time since
+    //the vsync wait would keep the delta from ever dropping under the refresh interval
+    _ = engine_context.mRenderer.mDynamicResolution.OnFrame(engine_context.mWorkDT * std.time.ms_per_s);
+
     if (!self._ViewportPanel.mP_OpenPlay) {
         if (self.mEditorState == .Play) {
             try self.RenderWorldTarget(engine_context, .ViewportPanel);
@@ -484,14 +518,18 @@ fn RenderEditorTarget(self: *EditorProgram, engine_context: *EngineContext, view
     const world_rot = transform_component.GetWorldRotation();
     const world_pos = transform_component.GetWorldPosition();
 
-    try switch (viewport_type) {
-        .ViewportPanel => render_component.mComputeTexture.Resize(engine_context, self._ViewportPanel.mViewportWidth, self._ViewportPanel.mViewportHeight),
-        .PlayPanel => render_component.mComputeTexture.Resize(engine_context, self._ViewportPanel.mPlayWidth, self._ViewportPanel.mPlayHeight),
+    const dynamic_resolution = engine_context.mRenderer.mDynamicResolution;
+    const panel_size = switch (viewport_type) {
+        .ViewportPanel => dynamic_resolution.GetRenderSize(self._ViewportPanel.mViewportWidth, self._ViewportPanel.mViewportHeight),
+        .PlayPanel => dynamic_resolution.GetRenderSize(self._ViewportPanel.mPlayWidth, self._ViewportPanel.mPlayHeight),
     };
+    try render_component.mComputeTexture.Resize(engine_context, panel_size.Width, panel_size.Height);
 
+    //rays are spread over the scaled target so it still covers the whole view
+    const target_size = dynamic_resolution.GetRenderSize(viewpoint_component.mViewportWidth, viewpoint_component.mViewportHeight);
     const tan_half_fov: f32 = @tan(viewpoint_component.mPerspectiveFOVRad * 0.5);
-    const ray_scale_x: f32 = tan_half_fov * (viewpoint_component.mAspectRatio / (@as(f32, @floatFromInt(viewpoint_component.mViewportWidth)) * 0.5)); //note here we use aspect ratio cuz its editor
-    const ray_scale_y: f32 = -tan_half_fov / (@as(f32, @floatFromInt(viewpoint_component.mViewportHeight)) * 0.5);
+    const ray_scale_x: f32 = tan_half_fov * (viewpoint_component.mAspectRatio / (@as(f32, @floatFromInt(target_size.Width)) * 0.5)); //note here we use aspect ratio cuz its editor
+    const ray_scale_y: f32 = -tan_half_fov / (@as(f32, @floatFromInt(target_size.Height)) * 0.5);
     const ray_offset_x: f32 = -tan_half_fov * viewpoint_component.mAspectRatio;
     const ray_offset_y: f32 = tan_half_fov;
 
@@ -506,8 +544,8 @@ fn RenderEditorTarget(self: *EditorProgram, engine_context: *EngineContext, view
             .mPerspectiveFar = viewpoint_component.mPerspectiveFar,
             .mQuadsCount = 0,
             .mGlyphsCount = 0,
-            .mViewportWidth = @floatFromInt(viewpoint_component.mViewportWidth),
-            .mViewportHeight = @floatFromInt(viewpoint_component.mViewportHeight),
+            .mViewportWidth = @floatFromInt(target_size.Width),
+            .mViewportHeight = @floatFromInt(target_size.Height),
         },
         &render_component.mComputeTexture,
     );
@@ -520,6 +558,7 @@ fn RenderWorldTarget(self: *EditorProgram, engine_context: *EngineContext, viewp
     const scene_manager = self.mActiveWorld;
 
     const frame_allocator = engine_context.FrameAllocator();
+    const dynamic_resolution = engine_context.mRenderer.mDynamicResolution;
 
     var player_entites = try scene_manager.GetPlayerGroup(frame_allocator, .{ .Component = PossessComponent });
     try FilterPossessedPlayers(frame_allocator, &player_entites, scene_manager);
@@ -534,14 +573,16 @@ fn RenderWorldTarget(self: *EditorProgram, engine_context: *EngineContext, viewp
         const world_rot = transform_component.GetWorldRotation();
         const world_pos = transform_component.GetWorldPosition();
 
-        try switch (viewport_type) {
-            .ViewportPanel => render_component.mComputeTexture.Resize(engine_context, self._ViewportPanel.mViewportWidth, self._ViewportPanel.mViewportHeight),
-            .PlayPanel => render_component.mComputeTexture.Resize(engine_context, self._ViewportPanel.mPlayWidth, self._ViewportPanel.mPlayHeight),
+        const panel_size = switch (viewport_type) {
+            .ViewportPanel => dynamic_resolution.GetRenderSize(self._ViewportPanel.mViewportWidth, self._ViewportPanel.mViewportHeight),
+            .PlayPanel => dynamic_resolution.GetRenderSize(self._ViewportPanel.mPlayWidth, self._ViewportPanel.mPlayHeight),
         };
+        try render_component.mComputeTexture.Resize(engine_context, panel_size.Width, panel_size.Height);
 
+        const target_size = dynamic_resolution.GetRenderSize(viewpoint_component.mViewportWidth, viewpoint_component.mViewportHeight);
         const tan_half_fov: f32 = @tan(viewpoint_component.mPerspectiveFOVRad * 0.5);
-        const ray_scale_x: f32 = tan_half_fov * (viewpoint_component.mAspectRatio / (@as(f32, @floatFromInt(viewpoint_component.mViewportWidth)) * 0.5)); //note here we use aspect ratio cuz its editor
-        const ray_scale_y: f32 = -tan_half_fov / (@as(f32, @floatFromInt(viewpoint_component.mViewportHeight)) * 0.5);
+        const ray_scale_x: f32 = tan_half_fov * (viewpoint_component.mAspectRatio / (@as(f32, @floatFromInt(target_size.Width)) * 0.5)); //note here we use aspect ratio cuz its editor
+        const ray_scale_y: f32 = -tan_half_fov / (@as(f32, @floatFromInt(target_size.Height)) * 0.5);
         const ray_offset_x: f32 = -tan_half_fov * viewpoint_component.mAspectRatio;
         const ray_offset_y: f32 = tan_half_fov;
 
@@ -556,8 +597,8 @@ fn RenderWorldTarget(self: *EditorProgram, engine_context: *EngineContext, viewp
                 .mRayOffset = Vec2(f32).VectorT{ ray_offset_x, ray_offset_y },
                 .mQuadsCount = 0,
                 .mGlyphsCount = 0,
-                .mViewportWidth = @floatFromInt(viewpoint_component.mViewportWidth),
-                .mViewportHeight = @floatFromInt(viewpoint_component.mViewportHeight),
+                .mViewportWidth = @floatFromInt(target_size.Width),
+                .mViewportHeight = @floatFromInt(target_size.Height),
             },
             &render_component.mComputeTexture,
         );
@@ -766,6 +807,21 @@ pub fn OnImguiRender(self: *EditorProgram, engine_context: *EngineContext) !void
             if (imgui.igMenuItem_Bool("Use Preview Panel", @ptrCast(@alignCast(my_null_ptr)), self._ViewportPanel.mP_OpenPlay, true) == true) {
                 self._ViewportPanel.mP_OpenPlay = !self._ViewportPanel.mP_OpenPlay;
             }
+            const physics_manager = &engine_context.mPhysicsManager;
+            if (imgui.igMenuItem_Bool("Threaded Physics", @ptrCast(@alignCast(my_null_ptr)), physics_manager.mStepMode == .Threaded, true) == true) {
+                physics_manager.mStepMode = if (physics_manager.mStepMode == .Threaded) .Inline else .Threaded;
+            }
+            if (imgui.igBeginMenu("Collision Layers", true) == true) {
+                defer imgui.igEndMenu();
+                const layer_matrix = physics_manager.GetLayerMatrix();
+                for (0..CollisionLayers.LAYER_COUNT) |layer| {
+                    var label_buf: [16]u8 = undefined;
+                    const label = std.fmt.bufPrintZ(&label_buf, "Layer {d}", .{layer}) catch continue;
+                    var row = layer_matrix.GetRow(@intCast(layer));
+                    ImGui.RenderStaticBitSet(CollisionLayers.LayerMask, &row, label);
+                    layer_matrix.SetRow(@intCast(layer), row);
+                }
+            }
         }
     }
 }
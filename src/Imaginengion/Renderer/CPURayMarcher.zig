@@ -0,0 +1,501 @@
+//! Runs the SDF ray marcher on the cpu.
+//!
+//! The frame is split into 8x8 pixel tiles, the size of one workgroup of the compute shaders, and the
+//! tiles are handed out over a WorkerPool. Every pixel runs the same RayMarcher as SDFComputeGame on the
+//! same quad, glyph and shading buffers the renderer uploads, so machines without a gpu can capture
+//! frames, run golden image tests and profile the cost of the marcher itself.
+const std = @import("std");
+const WorkerPool = @import("../Core/WorkerPool.zig");
+const RayMarcher = @import("SDFRayMarcher.zig");
+const PushConstants = @import("RenderPipeline.zig").SDFPushConstants;
+const QuadData = @import("Renderer2D.zig").QuadData;
+const GlyphData = @import("Renderer2D.zig").GlyphData;
+const SurfShadingData = @import("Renderer.zig").SurfShadingData;
+const MedShadingData = @import("Renderer.zig").MedShadingData;
+const SDFObjectBVH = @import("SDFObjectBVH.zig");
+const BVH = @import("../Physics/BVH.zig");
+const SDFTileBins = @import("SDFTileBins.zig");
+const ATLAS_SIZE = @import("../TextureManager/backends/SGTextureManager.zig").ATLAS_SIZE;
+
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec2 = MathTypes.Vec2;
+const Vec3 = MathTypes.Vec3;
+const Vec4 = MathTypes.Vec4;
+
+pub const TILE_SIZE = SDFTileBins.TILE_SIZE;
+
+const DEFAULT_COLOR = Vec4(f32){ .x = 0.0, .y = 0.0, .z = 0.0, .w = 0.0 };
+const WHITE = Vec4(f32).VectorT{ 1.0, 1.0, 1.0, 1.0 };
+
+/// Cpu copy of the texture array the shaders sample, one RGBA8 image of mLayerSize x mLayerSize per layer.
+/// Layers that are missing sample as opaque white, the same as an untextured surface
+pub const TextureArray = struct {
+    pub const empty: TextureArray = .{
+        .mLayers = &.{},
+        .mLayerSize = ATLAS_SIZE,
+    };
+
+    mLayers: []const ?[]const u8,
+    mLayerSize: u32,
+
+    /// Nearest sample at uv, z is the layer index. Same signature as the sampler the shaders pass to the marcher
+    pub fn Sample(self: *const TextureArray, uv: Vec3(f32)) Vec4(f32).VectorT {
+        if (!(uv.z >= 0) or uv.z >= @as(f32, @floatFromInt(self.mLayers.len))) return WHITE;
+        const pixels = self.mLayers[@intFromFloat(uv.z)] orelse return WHITE;
+
+        const size: f32 = @floatFromInt(self.mLayerSize);
+        const x: usize = @intFromFloat(std.math.clamp(uv.x * size, 0, size - 1));
+        const y: usize = @intFromFloat(std.math.clamp(uv.y * size, 0, size - 1));
+        const i = (y * self.mLayerSize + x) * 4;
+
+        const texel = Vec4(f32).VectorT{
+            @floatFromInt(pixels[i]),
+            @floatFromInt(pixels[i + 1]),
+            @floatFromInt(pixels[i + 2]),
+            @floatFromInt(pixels[i + 3]),
+        };
+        return texel / @as(Vec4(f32).VectorT, @splat(255.0));
+    }
+};
+
+/// Everything one pipeline pass of the renderer reads, as it is laid out in the gpu buffers
+pub const Frame = struct {
+    Camera: PushConstants,
+    Quads: []const QuadData,
+    Glyphs: []const GlyphData,
+    /// SDFObjectBVH over Quads then Glyphs, leave empty to march every object
+    Nodes: []const SDFObjectBVH.Node = &.{},
+    Items: []const u32 = &.{},
+    /// Per tile object lists built for this camera and image size. Each tile then only marches its
+    /// own list and tiles with nothing in them are skipped, Nodes and Items are not used
+    Bins: ?*const SDFTileBins = null,
+    SurfShadings: []const SurfShadingData,
+    MedShadings: []const MedShadingData,
+    Textures: *const TextureArray,
+};
+
+/// Straight alpha RGBA pixels, row major from the top left like the compute output texture
+pub const Image = struct {
+    pub const empty: Image = .{
+        .mWidth = 0,
+        .mHeight = 0,
+        .mPixels = &.{},
+    };
+
+    mWidth: u32,
+    mHeight: u32,
+    mPixels: []Vec4(f32),
+
+    pub fn Init(self: *Image, engine_allocator: std.mem.Allocator, width: u32, height: u32) !void {
+        self.mPixels = try engine_allocator.alloc(Vec4(f32), @as(usize, width) * height);
+        self.mWidth = width;
+        self.mHeight = height;
+        self.Clear(DEFAULT_COLOR);
+    }
+
+    pub fn Deinit(self: *Image, engine_allocator: std.mem.Allocator) void {
+        engine_allocator.free(self.mPixels);
+        self.* = .empty;
+    }
+
+    pub fn Clear(self: *Image, color: Vec4(f32)) void {
+        @memset(self.mPixels, color);
+    }
+
+    pub fn GetPixel(self: Image, x: u32, y: u32) Vec4(f32) {
+        return self.mPixels[@as(usize, y) * self.mWidth + x];
+    }
+
+    /// Number of pixels where any channel differs from other by more than tolerance, for golden image tests
+    pub fn CountDifferent(self: Image, other: Image, tolerance: f32) usize {
+        std.debug.assert(self.mWidth == other.mWidth and self.mHeight == other.mHeight);
+        var count: usize = 0;
+        for (self.mPixels, other.mPixels) |a, b| {
+            const diff = @abs(a.ToVector() - b.ToVector());
+            if (@reduce(.Max, diff) > tolerance) count += 1;
+        }
+        return count;
+    }
+
+    /// Caller owns the returned RGBA8 pixels
+    pub fn ToRGBA8(self: Image, allocator: std.mem.Allocator) ![]u8 {
+        const bytes = try allocator.alloc(u8, self.mPixels.len * 4);
+        for (self.mPixels, 0..) |pixel, i| {
+            const clamped = @min(@max(pixel.ToVector(), @as(Vec4(f32).VectorT, @splat(0))), @as(Vec4(f32).VectorT, @splat(1)));
+            const scaled = clamped * @as(Vec4(f32).VectorT, @splat(255.0)) + @as(Vec4(f32).VectorT, @splat(0.5));
+            bytes[i * 4 ..][0..4].* = @as(@Vector(4, u8), @intFromFloat(scaled));
+        }
+        return bytes;
+    }
+
+    /// Writes the pixels as RGBA8 with no header, width * height * 4 bytes
+    pub fn WriteRaw(self: Image, io: std.Io, allocator: std.mem.Allocator, path: []const u8) !void {
+        const bytes = try self.ToRGBA8(allocator);
+        defer allocator.free(bytes);
+
+        const file = try std.Io.Dir.cwd().createFile(io, path, .{ .read = false, .truncate = true });
+        defer file.close(io);
+        try file.writeStreamingAll(io, bytes);
+    }
+
+    pub fn WritePNG(self: Image, io: std.Io, allocator: std.mem.Allocator, path: []const u8) !void {
+        const bytes = try self.ToRGBA8(allocator);
+        defer allocator.free(bytes);
+
+        var out: std.Io.Writer.Allocating = .init(allocator);
+        defer out.deinit();
+        try EncodePNG(&out.writer, allocator, self.mWidth, self.mHeight, bytes);
+
+        const file = try std.Io.Dir.cwd().createFile(io, path, .{ .read = false, .truncate = true });
+        defer file.close(io);
+        try file.writeStreamingAll(io, out.written());
+    }
+};
+
+/// Marches every pixel of image and blends the result over what is already in it, the same way the game
+/// pass blends over the overlay pass. Pixels that are already opaque are skipped like in the shader.
+/// Tiles only write their own pixels so the image does not depend on the thread count of pool
+pub fn Render(pool: *WorkerPool, frame: Frame, image: *Image) void {
+    const tiles_x = std.math.divCeil(u32, image.mWidth, TILE_SIZE) catch unreachable;
+    const tiles_y = std.math.divCeil(u32, image.mHeight, TILE_SIZE) catch unreachable;
+
+    const context = TileContext{
+        .mFrame = &frame,
+        .mImage = image,
+        .mTilesX = tiles_x,
+    };
+    //a tile of sky is far cheaper than a tile of text, so tiles are handed out one at a time
+    pool.ParallelFor(@as(usize, tiles_x) * tiles_y, 1, context, RenderTiles);
+}
+
+/// Color of the primary ray through the center of pixel x, y. Mirrors main of the SDFComputeGame shader
+pub fn MarchPixel(frame: Frame, x: u32, y: u32) Vec4(f32) {
+    const camera = frame.Camera;
+
+    const frag = Vec2(f32){ .x = @as(f32, @floatFromInt(x)) + 0.5, .y = @as(f32, @floatFromInt(y)) + 0.5 };
+    const uv = Vec2(f32).FromVector(camera.mRayScale).MulVec(frag).AddVec(.FromVector(camera.mRayOffset));
+
+    const dir = Vec3(f32).Dir(.{ .x = uv.x, .y = uv.y, .z = -1.0 });
+    const ray_dir = dir.QuatRotate(.FromVector(camera.mRotation));
+
+    var marcher = RayMarcher{
+        .mNodes = undefined,
+        .mEdges = undefined,
+        .mNodeCount = 0,
+        .mEdgeCount = 0,
+        .mDefaultColor = DEFAULT_COLOR,
+    };
+
+    //setup initial node and edge
+    marcher.mNodes[0] = RayMarcher.Node{
+        .Point = .FromVector(camera.mPosition),
+        .Normal = .{ .x = 0, .y = 0, .z = 0 },
+        .ParentEdge = RayMarcher.NO_EDGE,
+        .FirstEdge = 0,
+        .MaterialHandle = 0,
+        .AccumColor = DEFAULT_COLOR,
+        .TextureUV = .{ .x = -1, .y = -1, .z = -1 },
+        .ShapeT = .None,
+    };
+    marcher.mNodeCount = 1;
+
+    marcher.mEdges[0] = RayMarcher.Edge{
+        .Direction = ray_dir,
+        .Length = 0.0,
+        .FromNode = 0,
+        .ToNode = 0,
+        .SiblingEdge = RayMarcher.NO_EDGE,
+        .AccumColor = DEFAULT_COLOR,
+        .MaterialHandle = 0,
+    };
+    marcher.mEdgeCount = 1;
+
+    marcher.March(frame.Quads, frame.Glyphs, frame.Nodes, frame.Items, frame.SurfShadings, camera.mPerspectiveFar, frame.Textures, TextureArray.Sample);
+
+    return marcher.GenerateColor(frame.SurfShadings, frame.MedShadings, frame.Textures, TextureArray.Sample);
+}
+
+/// Straight alpha "over" blend of top onto bottom
+pub fn BlendOver(top: Vec4(f32), bottom: Vec4(f32)) Vec4(f32) {
+    const out_a = top.w + bottom.w * (1.0 - top.w);
+    if (out_a <= 0) return DEFAULT_COLOR;
+
+    const out_rgb = top.ToVec3().MulScalar(top.w).AddVec(bottom.ToVec3().MulScalar(bottom.w * (1.0 - top.w))).DivScalar(out_a);
+    return .{ .x = out_rgb.x, .y = out_rgb.y, .z = out_rgb.z, .w = out_a };
+}
+
+/// Zlib stream of the PNG is written with stored blocks, std has no deflate compressor and
+/// the files are for tests and captures where size does not matter
+pub fn EncodePNG(writer: *std.Io.Writer, allocator: std.mem.Allocator, width: u32, height: u32, rgba: []const u8) !void {
+    std.debug.assert(rgba.len == @as(usize, width) * height * 4);
+
+    //every scanline starts with filter type 0 (none)
+    const row_len = @as(usize, width) * 4;
+    const filtered = try allocator.alloc(u8, (row_len + 1) * height);
+    defer allocator.free(filtered);
+    for (0..height) |y| {
+        filtered[y * (row_len + 1)] = 0;
+        @memcpy(filtered[y * (row_len + 1) + 1 ..][0..row_len], rgba[y * row_len ..][0..row_len]);
+    }
+
+    var zlib: std.Io.Writer.Allocating = .init(allocator);
+    defer zlib.deinit();
+    try zlib.writer.writeAll(&.{ 0x78, 0x01 });
+    var offset: usize = 0;
+    while (true) {
+        const block_len: u16 = @intCast(@min(filtered.len - offset, std.math.maxInt(u16)));
+        const last = offset + block_len == filtered.len;
+        try zlib.writer.writeByte(@intFromBool(last));
+        try zlib.writer.writeInt(u16, block_len, .little);
+        try zlib.writer.writeInt(u16, ~block_len, .little);
+        try zlib.writer.writeAll(filtered[offset..][0..block_len]);
+        offset += block_len;
+        if (last) break;
+    }
+    try zlib.writer.writeInt(u32, std.hash.Adler32.hash(filtered), .big);
+
+    var header: [13]u8 = undefined;
+    std.mem.writeInt(u32, header[0..4], width, .big);
+    std.mem.writeInt(u32, header[4..8], height, .big);
+    header[8..13].* = .{ 8, 6, 0, 0, 0 }; //8 bit RGBA, deflate, no filter, no interlace
+
+    try writer.writeAll("\x89PNG\r\n\x1a\n");
+    try WriteChunk(writer, "IHDR", &header);
+    try WriteChunk(writer, "IDAT", zlib.written());
+    try WriteChunk(writer, "IEND", &.{});
+}
+
+fn WriteChunk(writer: *std.Io.Writer, chunk_type: *const [4]u8, data: []const u8) !void {
+    try writer.writeInt(u32, @intCast(data.len), .big);
+    try writer.writeAll(chunk_type);
+    try writer.writeAll(data);
+
+    var crc = std.hash.Crc32.init();
+    crc.update(chunk_type);
+    crc.update(data);
+    try writer.writeInt(u32, crc.final(), .big);
+}
+
+const TileContext = struct {
+    mFrame: *const Frame,
+    mImage: *Image,
+    mTilesX: u32,
+};
+
+fn RenderTiles(context: TileContext, start: usize, end: usize) void {
+    const image = context.mImage;
+    for (start..end) |tile| {
+        const tile_x: u32 = @intCast(tile % context.mTilesX);
+        const tile_y: u32 = @intCast(tile / context.mTilesX);
+
+        const x_end = @min((tile_x + 1) * TILE_SIZE, image.mWidth);
+        const y_end = @min((tile_y + 1) * TILE_SIZE, image.mHeight);
+
+        var frame = context.mFrame.*;
+        if (frame.Bins) |bins| {
+            const tile_items = bins.GetTile(tile_x, tile_y);
+            if (tile_items.len == 0) continue;
+            frame.Nodes = &.{};
+            frame.Items = tile_items;
+        }
+
+        for (tile_y * TILE_SIZE..y_end) |y| {
+            for (tile_x * TILE_SIZE..x_end) |x| {
+                const pixel = &image.mPixels[y * image.mWidth + x];
+                if (pixel.w >= 0.999) continue;
+
+                const march_color = MarchPixel(frame, @intCast(x), @intCast(y));
+                pixel.* = BlendOver(march_color, pixel.*);
+            }
+        }
+    }
+}
+
+const TestScene = struct {
+    const THICKNESS_2D = @import("../Math/SDFFunctions.zig").THICKNESS_2D;
+    const IDENTITY = Vec4(f32).VectorT{ 1, 0, 0, 0 };
+
+    quads: [2]QuadData,
+    surf_shadings: [2]SurfShadingData,
+    med_shadings: [1]MedShadingData,
+    textures: TextureArray,
+
+    fn Init() TestScene {
+        const surface = SurfShadingData{
+            .Color = .{ 1, 0, 0, 1 },
+            .TextureUV0 = .{ 0, 0 },
+            .TextureUV1 = .{ 1, 1 },
+            .TilingFactor = 1,
+            .Texturehandle = 0,
+            .SiblingShading = std.math.maxInt(u32),
+        };
+        var blue = surface;
+        blue.Color = .{ 0, 0, 1, 1 };
+
+        return .{
+            .quads = .{
+                .{ .Rotation = IDENTITY, .Position = .{ -0.6, 0, -2 }, .HalfExtents = .{ 0.3, 0.3, THICKNESS_2D }, .ShadingHandle = 0, .ShadingFlags = 0 },
+                .{ .Rotation = IDENTITY, .Position = .{ 0.6, 0, -3 }, .HalfExtents = .{ 0.3, 0.3, THICKNESS_2D }, .ShadingHandle = 1, .ShadingFlags = 0 },
+            },
+            .surf_shadings = .{ surface, blue },
+            .med_shadings = .{.{ .Absorption = .{ 0, 0, 0 }, .Scattering = .{ 0, 0, 0 } }},
+            .textures = .empty,
+        };
+    }
+
+    /// 90 degree square view looking down -z from the origin
+    fn GetFrame(self: *const TestScene, size: u32) Frame {
+        const scale = 2.0 / @as(f32, @floatFromInt(size));
+        return .{
+            .Camera = .{
+                .mPosition = .{ 0, 0, 0 },
+                .mPerspectiveFar = 50,
+                .mRotation = IDENTITY,
+                .mRayScale = .{ scale, -scale },
+                .mRayOffset = .{ -1, 1 },
+                .mQuadsCount = self.quads.len,
+                .mGlyphsCount = 0,
+                .mViewportWidth = @floatFromInt(size),
+                .mViewportHeight = @floatFromInt(size),
+            },
+            .Quads = &self.quads,
+            .Glyphs = &.{},
+            .SurfShadings = &self.surf_shadings,
+            .MedShadings = &self.med_shadings,
+            .Textures = &self.textures,
+        };
+    }
+};
+
+test "Cpu marcher image does not depend on the thread count" {
+    const allocator = std.testing.allocator;
+    const size: u32 = 20; //not a multiple of the tile size so the edge tiles get clipped
+    const scene = TestScene.Init();
+
+    var single: WorkerPool = .empty;
+    try single.Init(allocator, 0);
+    defer single.Deinit(allocator);
+    var threaded: WorkerPool = .empty;
+    try threaded.Init(allocator, 3);
+    defer threaded.Deinit(allocator);
+
+    var image_a: Image = .empty;
+    try image_a.Init(allocator, size, size);
+    defer image_a.Deinit(allocator);
+    var image_b: Image = .empty;
+    try image_b.Init(allocator, size, size);
+    defer image_b.Deinit(allocator);
+
+    Render(&single, scene.GetFrame(size), &image_a);
+    Render(&threaded, scene.GetFrame(size), &image_b);
+
+    try std.testing.expectEqual(@as(usize, 0), image_a.CountDifferent(image_b, 0));
+
+    //red quad left of center, blue quad right of center and further away, nothing above them
+    const red = image_a.GetPixel(6, size / 2);
+    const blue = image_a.GetPixel(11, size / 2);
+    const sky = image_a.GetPixel(size / 2, 0);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), red.x, 0.01);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), red.w, 0.01);
+    try std.testing.expectApproxEqAbs(@as(f32, 1), blue.z, 0.01);
+    try std.testing.expectApproxEqAbs(@as(f32, 0), blue.x, 0.01);
+    try std.testing.expectApproxEqAbs(@as(f32, 0), sky.w, 0.01);
+}
+
+test "Cpu marcher gives the same image with and without the object BVH" {
+    const allocator = std.testing.allocator;
+    const size: u32 = 24;
+    const scene = TestScene.Init();
+
+    var bvh: BVH = .empty;
+    defer bvh.Deinit(allocator);
+    try SDFObjectBVH.Build(&bvh, allocator, allocator, &scene.quads, &.{});
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, 0);
+    defer pool.Deinit(allocator);
+
+    var brute: Image = .empty;
+    try brute.Init(allocator, size, size);
+    defer brute.Deinit(allocator);
+    var culled: Image = .empty;
+    try culled.Init(allocator, size, size);
+    defer culled.Deinit(allocator);
+
+    var frame = scene.GetFrame(size);
+    Render(&pool, frame, &brute);
+    frame.Nodes = bvh.GetNodes();
+    frame.Items = bvh.GetItems();
+    Render(&pool, frame, &culled);
+
+    //steps differ so hit points move by less than the surface distance
+    try std.testing.expectEqual(@as(usize, 0), brute.CountDifferent(culled, 0.01));
+}
+
+test "Cpu marcher gives the same image with and without tile bins" {
+    const allocator = std.testing.allocator;
+    const size: u32 = 24;
+    const scene = TestScene.Init();
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, 0);
+    defer pool.Deinit(allocator);
+
+    var frame = scene.GetFrame(size);
+    var bins: SDFTileBins = .empty;
+    defer bins.Deinit(allocator);
+    try bins.Build(allocator, allocator, frame.Camera, size, size, &scene.quads, &.{});
+
+    var brute: Image = .empty;
+    try brute.Init(allocator, size, size);
+    defer brute.Deinit(allocator);
+    var binned: Image = .empty;
+    try binned.Init(allocator, size, size);
+    defer binned.Deinit(allocator);
+
+    Render(&pool, frame, &brute);
+    frame.Bins = &bins;
+    Render(&pool, frame, &binned);
+
+    try std.testing.expectEqual(@as(usize, 0), brute.CountDifferent(binned, 0.01));
+}
+
+test "Cpu marcher keeps opaque pixels of the previous pass" {
+    const allocator = std.testing.allocator;
+    const size: u32 = 8;
+    const scene = TestScene.Init();
+
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, 0);
+    defer pool.Deinit(allocator);
+
+    var image: Image = .empty;
+    try image.Init(allocator, size, size);
+    defer image.Deinit(allocator);
+    image.Clear(.{ .x = 0, .y = 1, .z = 0, .w = 1 });
+
+    Render(&pool, scene.GetFrame(size), &image);
+    for (image.mPixels) |pixel| {
+        try std.testing.expectEqual(@as(f32, 1), pixel.y);
+    }
+}
+
+test "PNG encoding" {
+    const allocator = std.testing.allocator;
+    const rgba = [_]u8{ 255, 0, 0, 255, 0, 255, 0, 128 };
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try EncodePNG(&out.writer, allocator, 2, 1, &rgba);
+
+    const png = out.written();
+    try std.testing.expectEqualSlices(u8, "\x89PNG\r\n\x1a\n", png[0..8]);
+    try std.testing.expectEqualSlices(u8, "IHDR", png[12..16]);
+    try std.testing.expectEqual(@as(u32, 2), std.mem.readInt(u32, png[16..20], .big));
+    try std.testing.expectEqualSlices(u8, "IEND", png[png.len - 8 .. png.len - 4]);
+
+    //scanline of the single row is the filter byte and then the pixels as they are
+    const scanline = png[33 + 8 + 2 + 5 ..][0 .. rgba.len + 1];
+    try std.testing.expectEqual(@as(u8, 0), scanline[0]);
+    try std.testing.expectEqualSlices(u8, &rgba, scanline[1..]);
+}
@@ -0,0 +1,254 @@
+//! Picks the fraction of the viewport the compute raymarch target is rendered at from the frame time.
+//!
+//! The time fed has to be the work of the frame without the wait for the swapchain. On a vsync
+//! swapchain the whole frame delta never drops below the refresh interval, so the scale could never
+//! grow back, and on a display slower than the budget it would shrink for nothing.
+//!
+//! Marching cost follows the pixel count, so when frames run over budget the target shrinks and the
+//! present stretches it back over the viewport. Frame times are smoothed, and the scale only moves
+//! once the smoothed time has stayed outside a band around the budget for a number of frames. After
+//! a change it holds until frames at the new resolution have filled the average, so a change is
+//! never judged on frames from the old one and the scale does not oscillate.
+const std = @import("std");
+const DynamicResolution = @This();
+
+pub const Settings = struct {
+    /// Frame time the scale is adjusted to stay under
+    BudgetMs: f32 = 1000.0 / 60.0,
+    MinScale: f32 = 0.5,
+    MaxScale: f32 = 1.0,
+    /// Shrinks when the smoothed frame time is above BudgetMs * this
+    DownThreshold: f32 = 1.05,
+    /// Grows when the smoothed frame time is below BudgetMs * this
+    UpThreshold: f32 = 0.8,
+    /// Frames the smoothed time has to stay past a threshold, a single hitch never moves the scale
+    Patience: u32 = 8,
+    /// Frames a new scale is held before it is judged
+    SettleFrames: u32 = 20,
+    /// Weight of the newest frame in the smoothed frame time
+    Smoothing: f32 = 0.1,
+    /// Scales snap to multiples of this so the target is not recreated for tiny changes
+    ScaleStep: f32 = 0.05,
+    MaxDownStep: f32 = 0.25,
+    //growing is slower than shrinking, an overshoot costs frames over budget
+    MaxUpStep: f32 = 0.1,
+};
+
+pub const Size = struct {
+    Width: usize,
+    Height: usize,
+};
+
+mSettings: Settings = .{},
+_Enabled: bool = true,
+_Scale: f32 = 1.0,
+_SmoothedMs: f32 = 0,
+_SampleCount: u32 = 0,
+_OverCount: u32 = 0,
+_UnderCount: u32 = 0,
+
+pub fn SetEnabled(self: *DynamicResolution, enabled: bool) void {
+    self._Enabled = enabled;
+    self._Scale = self.mSettings.MaxScale;
+    self.ResetHistory();
+}
+
+pub fn IsEnabled(self: DynamicResolution) bool {
+    return self._Enabled;
+}
+
+/// Fraction of the viewport size the target is rendered at
+pub fn GetScale(self: DynamicResolution) f32 {
+    return if (self._Enabled) self._Scale else 1.0;
+}
+
+/// Smoothed frame time the controller is currently judging, 0 until a frame was seen
+pub fn GetSmoothedMs(self: DynamicResolution) f32 {
+    return self._SmoothedMs;
+}
+
+/// Size to render a viewport of width x height at, never below one pixel
+pub fn GetRenderSize(self: DynamicResolution, width: usize, height: usize) Size {
+    const scale = self.GetScale();
+    return .{
+        .Width = ScaleDimension(width, scale),
+        .Height = ScaleDimension(height, scale),
+    };
+}
+
+/// Feeds the time the last frame worked, without waiting on the swapchain. True if the scale changed
+pub fn OnFrame(self: *DynamicResolution, frame_ms: f32) bool {
+    if (!self._Enabled or !std.math.isFinite(frame_ms) or frame_ms <= 0) return false;
+    const settings = self.mSettings;
+
+    self._SmoothedMs = if (self._SampleCount == 0) frame_ms else std.math.lerp(self._SmoothedMs, frame_ms, settings.Smoothing);
+    self._SampleCount +|= 1;
+    if (self._SampleCount < settings.SettleFrames) return false;
+
+    if (self._SmoothedMs > settings.BudgetMs * settings.DownThreshold) {
+        self._OverCount += 1;
+        self._UnderCount = 0;
+    } else if (self._SmoothedMs < settings.BudgetMs * settings.UpThreshold) {
+        self._UnderCount += 1;
+        self._OverCount = 0;
+    } else {
+        self._OverCount = 0;
+        self._UnderCount = 0;
+        return false;
+    }
+    if (self._OverCount < settings.Patience and self._UnderCount < settings.Patience) return false;
+
+    //cost goes with the pixel count, the scale that would land exactly on budget
+    const ideal = self._Scale * @sqrt(settings.BudgetMs / self._SmoothedMs);
+    const clamped = std.math.clamp(ideal, self._Scale - settings.MaxDownStep, self._Scale + settings.MaxUpStep);
+    //rounded down either way so a grown scale still lands under budget
+    const snapped = @floor(clamped / settings.ScaleStep + 0.001) * settings.ScaleStep;
+    const new_scale = std.math.clamp(snapped, settings.MinScale, settings.MaxScale);
+
+    const grows = self._UnderCount > 0;
+    if ((grows and new_scale <= self._Scale) or (!grows and new_scale >= self._Scale)) {
+        //already at the limit, keep watching without piling up counts
+        self._OverCount = 0;
+        self._UnderCount = 0;
+        return false;
+    }
+
+    self._Scale = new_scale;
+    self.ResetHistory();
+    return true;
+}
+
+fn ResetHistory(self: *DynamicResolution) void {
+    self._SmoothedMs = 0;
+    self._SampleCount = 0;
+    self._OverCount = 0;
+    self._UnderCount = 0;
+}
+
+fn ScaleDimension(size: usize, scale: f32) usize {
+    if (size == 0) return 0;
+    const scaled: usize = @intFromFloat(@round(@as(f32, @floatFromInt(size)) * scale));
+    return @max(scaled, 1);
+}
+
+//synthetic gpu bound frames, full resolution costs full_ms and cost follows the pixel count
+const TestTrace = struct {
+    mFullMs: f32,
+    mNoise: f32,
+    mRandom: std.Random.DefaultPrng,
+
+    fn Init(full_ms: f32, noise: f32) TestTrace {
+        return .{ .mFullMs = full_ms, .mNoise = noise, .mRandom = .init(1234) };
+    }
+
+    fn Next(self: *TestTrace, scale: f32) f32 {
+        const jitter = (self.mRandom.random().float(f32) * 2 - 1) * self.mNoise;
+        return self.mFullMs * scale * scale * (1 + jitter);
+    }
+
+    /// Runs frame_count frames, returns how many of them changed the scale
+    fn Run(self: *TestTrace, controller: *DynamicResolution, frame_count: usize) usize {
+        var changes: usize = 0;
+        for (0..frame_count) |_| {
+            if (controller.OnFrame(self.Next(controller.GetScale()))) changes += 1;
+        }
+        return changes;
+    }
+};
+
+test "Dynamic resolution drops until a heavy scene fits the budget then holds" {
+    var controller: DynamicResolution = .{};
+    var trace = TestTrace.Init(28, 0.1);
+
+    try std.testing.expect(trace.Run(&controller, 600) > 0);
+    const settled_scale = controller.GetScale();
+    //28ms at full size fits 16.7ms at about 0.77
+    try std.testing.expect(settled_scale < 0.8);
+    try std.testing.expect(settled_scale >= controller.mSettings.MinScale);
+    try std.testing.expect(28 * settled_scale * settled_scale < controller.mSettings.BudgetMs * controller.mSettings.DownThreshold);
+
+    //noisy frames around the budget do not move it any more
+    try std.testing.expectEqual(@as(usize, 0), trace.Run(&controller, 2000));
+    try std.testing.expectEqual(settled_scale, controller.GetScale());
+}
+
+test "Dynamic resolution leaves a light scene alone and ignores hitches" {
+    var controller: DynamicResolution = .{};
+    var trace = TestTrace.Init(9, 0.2);
+
+    try std.testing.expectEqual(@as(usize, 0), trace.Run(&controller, 300));
+    //a single long frame, like a level load, is smoothed away before patience runs out
+    try std.testing.expect(!controller.OnFrame(120));
+    try std.testing.expectEqual(@as(usize, 0), trace.Run(&controller, 300));
+    try std.testing.expectEqual(@as(f32, 1.0), controller.GetScale());
+}
+
+test "Dynamic resolution recovers once the load goes away and clamps to its range" {
+    var controller: DynamicResolution = .{};
+
+    //far too heavy to ever fit, stops at the minimum
+    var heavy = TestTrace.Init(200, 0.05);
+    _ = heavy.Run(&controller, 600);
+    try std.testing.expectApproxEqAbs(controller.mSettings.MinScale, controller.GetScale(), 0.001);
+    try std.testing.expectEqual(@as(usize, 0), heavy.Run(&controller, 300));
+
+    //climbs back no more than one up step at a time
+    var light = TestTrace.Init(10, 0.05);
+    var scale_before = controller.GetScale();
+    for (0..2000) |_| {
+        if (controller.OnFrame(light.Next(controller.GetScale()))) {
+            try std.testing.expect(controller.GetScale() > scale_before);
+            try std.testing.expect(controller.GetScale() - scale_before <= controller.mSettings.MaxUpStep + 0.001);
+            scale_before = controller.GetScale();
+        }
+    }
+    try std.testing.expectApproxEqAbs(@as(f32, 1.0), controller.GetScale(), 0.001);
+
+    const size = controller.GetRenderSize(1280, 720);
+    try std.testing.expectEqual(@as(usize, 1280), size.Width);
+
+    controller.SetEnabled(false);
+    try std.testing.expect(!controller.OnFrame(500));
+    try std.testing.expectEqual(@as(f32, 1.0), controller.GetScale());
+}
+
+//the delta a vsync swapchain presents a frame with, work rounded up to whole refresh intervals
+fn VsyncDelta(work_ms: f32, interval_ms: f32) f32 {
+    return @ceil(work_ms / interval_ms) * interval_ms;
+}
+
+test "Dynamic resolution judges frame work and not the vsync clamped delta" {
+    //60 Hz after a slowdown, the scene got light again but the delta sits at the refresh interval
+    const interval_60: f32 = 1000.0 / 60.0;
+    var on_delta: DynamicResolution = .{};
+    var on_work: DynamicResolution = .{};
+    on_delta._Scale = 0.6;
+    on_work._Scale = 0.6;
+    var light = TestTrace.Init(10, 0);
+    for (0..1000) |_| {
+        _ = on_delta.OnFrame(VsyncDelta(light.Next(on_delta.GetScale()), interval_60));
+        _ = on_work.OnFrame(light.Next(on_work.GetScale()));
+    }
+    try std.testing.expectApproxEqAbs(@as(f32, 0.6), on_delta.GetScale(), 0.001);
+    try std.testing.expectApproxEqAbs(@as(f32, 1.0), on_work.GetScale(), 0.001);
+
+    //50 Hz with an empty scene, every delta is 20ms and over the budget
+    const interval_50: f32 = 1000.0 / 50.0;
+    on_delta = .{};
+    on_work = .{};
+    var empty = TestTrace.Init(4, 0.1);
+    for (0..1000) |_| {
+        _ = on_delta.OnFrame(VsyncDelta(empty.Next(on_delta.GetScale()), interval_50));
+        _ = on_work.OnFrame(empty.Next(on_work.GetScale()));
+    }
+    try std.testing.expectApproxEqAbs(on_delta.mSettings.MinScale, on_delta.GetScale(), 0.001);
+    try std.testing.expectEqual(@as(f32, 1.0), on_work.GetScale());
+}
+
+test "Dynamic resolution render size never reaches zero" {
+    var controller: DynamicResolution = .{};
+    controller._Scale = 0.5;
+    const size = controller.GetRenderSize(1, 3);
+    try std.testing.expectEqual(@as(usize, 1), size.Width);
+    try std.testing.expectEqual(@as(usize, 2), size.Height);
+}
@@ -0,0 +1,382 @@
+//! One frame of the SDF renderer saved to a file, so a slow frame from the field can be replayed offline.
+//!
+//! Holds exactly what the two pipeline passes read: the push constants, quads, glyphs and BVH of each
+//! pass, the shadings they share and the texture handles those shadings sample. The file is a header
+//! followed by the raw bytes of every buffer in the layout the gpu sees, so it only loads on a build
+//! with the same record sizes, which the header checks. Frames can be fed straight to CPURayMarcher.
+const std = @import("std");
+const PushConstants = @import("RenderPipeline.zig").SDFPushConstants;
+const QuadData = @import("Renderer2D.zig").QuadData;
+const GlyphData = @import("Renderer2D.zig").GlyphData;
+const SurfShadingData = @import("Renderer.zig").SurfShadingData;
+const MedShadingData = @import("Renderer.zig").MedShadingData;
+const SDFObjectBVH = @import("SDFObjectBVH.zig");
+const BVH = @import("../Physics/BVH.zig");
+const CPURayMarcher = @import("CPURayMarcher.zig");
+
+const FrameCapture = @This();
+
+pub const MAGIC = [4]u8{ 'I', 'M', 'F', 'C' };
+pub const VERSION: u32 = 1;
+
+/// In the order the renderer runs them, the game pass blends over the overlay pass
+pub const PassKind = enum(u32) {
+    Overlay,
+    Game,
+};
+
+pub const Pass = struct {
+    Camera: PushConstants,
+    Quads: []const QuadData = &.{},
+    Glyphs: []const GlyphData = &.{},
+    Nodes: []const SDFObjectBVH.Node = &.{},
+    Items: []const u32 = &.{},
+};
+
+const Header = extern struct {
+    Magic: [4]u8,
+    Version: u32,
+    //a build with a different layout would read garbage, so the sizes have to match
+    CameraSize: u32,
+    QuadSize: u32,
+    GlyphSize: u32,
+    NodeSize: u32,
+    SurfShadingSize: u32,
+    MedShadingSize: u32,
+    Width: u32,
+    Height: u32,
+    SurfShadingCount: u32,
+    MedShadingCount: u32,
+    TextureHandleCount: u32,
+};
+
+const PassHeader = extern struct {
+    QuadCount: u32,
+    GlyphCount: u32,
+    NodeCount: u32,
+    ItemCount: u32,
+};
+
+mWidth: u32,
+mHeight: u32,
+mPasses: [2]Pass,
+mSurfShadings: []const SurfShadingData,
+mMedShadings: []const MedShadingData,
+/// Every distinct texture handle the surface shadings reference
+mTextureHandles: []const u32,
+//set when loaded, owns every slice above
+_Arena: ?std.heap.ArenaAllocator = null,
+
+pub fn Deinit(self: *FrameCapture) void {
+    if (self._Arena) |*arena| arena.deinit();
+    self._Arena = null;
+}
+
+pub fn GetPass(self: FrameCapture, kind: PassKind) Pass {
+    return self.mPasses[@intFromEnum(kind)];
+}
+
+/// The pass ready for CPURayMarcher.Render. The captured textures are only handles, so textures
+/// should hold cpu copies of them if the replay has to sample the real pixels
+pub fn ToFrame(self: *const FrameCapture, kind: PassKind, textures: *const CPURayMarcher.TextureArray) CPURayMarcher.Frame {
+    const pass = self.GetPass(kind);
+    return .{
+        .Camera = pass.Camera,
+        .Quads = pass.Quads,
+        .Glyphs = pass.Glyphs,
+        .Nodes = pass.Nodes,
+        .Items = pass.Items,
+        .SurfShadings = self.mSurfShadings,
+        .MedShadings = self.mMedShadings,
+        .Textures = textures,
+    };
+}
+
+/// Sorted distinct texture handles of surf_shadings, allocated with allocator
+pub fn CollectTextureHandles(allocator: std.mem.Allocator, surf_shadings: []const SurfShadingData) ![]u32 {
+    var handles: std.ArrayList(u32) = .empty;
+    errdefer handles.deinit(allocator);
+    for (surf_shadings) |shading| try handles.append(allocator, shading.Texturehandle);
+
+    std.mem.sort(u32, handles.items, {}, std.sort.asc(u32));
+    var unique_len: usize = 0;
+    for (handles.items) |handle| {
+        if (unique_len > 0 and handles.items[unique_len - 1] == handle) continue;
+        handles.items[unique_len] = handle;
+        unique_len += 1;
+    }
+    handles.shrinkRetainingCapacity(unique_len);
+    return handles.toOwnedSlice(allocator);
+}
+
+pub fn Serialize(self: FrameCapture, writer: *std.Io.Writer) !void {
+    const header = Header{
+        .Magic = MAGIC,
+        .Version = VERSION,
+        .CameraSize = @sizeOf(PushConstants),
+        .QuadSize = @sizeOf(QuadData),
+        .GlyphSize = @sizeOf(GlyphData),
+        .NodeSize = @sizeOf(SDFObjectBVH.Node),
+        .SurfShadingSize = @sizeOf(SurfShadingData),
+        .MedShadingSize = @sizeOf(MedShadingData),
+        .Width = self.mWidth,
+        .Height = self.mHeight,
+        .SurfShadingCount = @intCast(self.mSurfShadings.len),
+        .MedShadingCount = @intCast(self.mMedShadings.len),
+        .TextureHandleCount = @intCast(self.mTextureHandles.len),
+    };
+    try writer.writeAll(std.mem.asBytes(&header));
+
+    for (self.mPasses) |pass| {
+        const pass_header = PassHeader{
+            .QuadCount = @intCast(pass.Quads.len),
+            .GlyphCount = @intCast(pass.Glyphs.len),
+            .NodeCount = @intCast(pass.Nodes.len),
+            .ItemCount = @intCast(pass.Items.len),
+        };
+        try writer.writeAll(std.mem.asBytes(&pass_header));
+        try writer.writeAll(std.mem.asBytes(&pass.Camera));
+        try writer.writeAll(std.mem.sliceAsBytes(pass.Quads));
+        try writer.writeAll(std.mem.sliceAsBytes(pass.Glyphs));
+        try writer.writeAll(std.mem.sliceAsBytes(pass.Nodes));
+        try writer.writeAll(std.mem.sliceAsBytes(pass.Items));
+    }
+
+    try writer.writeAll(std.mem.sliceAsBytes(self.mSurfShadings));
+    try writer.writeAll(std.mem.sliceAsBytes(self.mMedShadings));
+    try writer.writeAll(std.mem.sliceAsBytes(self.mTextureHandles));
+}
+
+/// Copies everything out of bytes, the result owns its memory and has to be Deinit.
+/// Every index the marchers follow is checked, so a damaged file is refused instead of read out of bounds
+pub fn Parse(allocator: std.mem.Allocator, bytes: []const u8) !FrameCapture {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    errdefer arena.deinit();
+    const arena_allocator = arena.allocator();
+
+    var cursor = Cursor{ .mBytes = bytes };
+    const header = try cursor.Take(Header);
+    if (!std.mem.eql(u8, &header.Magic, &MAGIC)) return error.NotAFrameCapture;
+    if (header.Version != VERSION or
+        header.CameraSize != @sizeOf(PushConstants) or
+        header.QuadSize != @sizeOf(QuadData) or
+        header.GlyphSize != @sizeOf(GlyphData) or
+        header.NodeSize != @sizeOf(SDFObjectBVH.Node) or
+        header.SurfShadingSize != @sizeOf(SurfShadingData) or
+        header.MedShadingSize != @sizeOf(MedShadingData)) return error.FrameCaptureLayoutMismatch;
+
+    var passes: [2]Pass = undefined;
+    for (&passes) |*pass| {
+        const pass_header = try cursor.Take(PassHeader);
+        pass.* = .{
+            .Camera = try cursor.Take(PushConstants),
+            .Quads = try cursor.TakeSlice(arena_allocator, QuadData, pass_header.QuadCount),
+            .Glyphs = try cursor.TakeSlice(arena_allocator, GlyphData, pass_header.GlyphCount),
+            .Nodes = try cursor.TakeSlice(arena_allocator, SDFObjectBVH.Node, pass_header.NodeCount),
+            .Items = try cursor.TakeSlice(arena_allocator, u32, pass_header.ItemCount),
+        };
+    }
+
+    const surf_shadings = try cursor.TakeSlice(arena_allocator, SurfShadingData, header.SurfShadingCount);
+    for (passes) |pass| try ValidatePass(allocator, pass, surf_shadings);
+
+    return .{
+        .mWidth = header.Width,
+        .mHeight = header.Height,
+        .mPasses = passes,
+        .mSurfShadings = surf_shadings,
+        .mMedShadings = try cursor.TakeSlice(arena_allocator, MedShadingData, header.MedShadingCount),
+        .mTextureHandles = try cursor.TakeSlice(arena_allocator, u32, header.TextureHandleCount),
+        ._Arena = arena,
+    };
+}
+
+fn ValidatePass(allocator: std.mem.Allocator, pass: Pass, surf_shadings: []const SurfShadingData) !void {
+    //items index the quads followed by the glyphs
+    const object_count = pass.Quads.len + pass.Glyphs.len;
+    for (pass.Items) |item| {
+        if (item >= object_count) return error.FrameCaptureCorrupt;
+    }
+
+    //the marchers only reach the listed objects, or every object when nothing is listed. Free slots
+    //are captured too and may point at shadings that were handed on, so they are not checked
+    if (pass.Items.len == 0) {
+        for (0..object_count) |item| try ValidateObject(pass, surf_shadings, item);
+    } else {
+        for (pass.Items) |item| try ValidateObject(pass, surf_shadings, item);
+    }
+
+    if (pass.Nodes.len == 0) return;
+
+    //the builder puts children after their parent, requiring that rules out cycles, and a walk
+    //only fits its fixed stack as long as inner nodes stay as shallow as the builder keeps them
+    const depths = try allocator.alloc(usize, pass.Nodes.len);
+    defer allocator.free(depths);
+    @memset(depths, 0);
+
+    for (pass.Nodes, 0..) |node, i| {
+        if (node.IsLeaf()) {
+            if (@as(usize, node.First) + node.Count > pass.Items.len) return error.FrameCaptureCorrupt;
+            continue;
+        }
+        if (node.First <= i or @as(usize, node.First) + 1 >= pass.Nodes.len) return error.FrameCaptureCorrupt;
+        if (depths[i] + 2 >= BVH.MAX_DEPTH) return error.FrameCaptureCorrupt;
+        for (depths[node.First..][0..2]) |*child_depth| child_depth.* = @max(child_depth.*, depths[i] + 1);
+    }
+}
+
+fn ValidateObject(pass: Pass, surf_shadings: []const SurfShadingData, item: usize) !void {
+    if (item < pass.Quads.len) {
+        if (pass.Quads[item].ShadingHandle >= surf_shadings.len) return error.FrameCaptureCorrupt;
+        return;
+    }
+    //a glyph samples its atlas shading and the texture shading that one points to
+    const glyph = pass.Glyphs[item - pass.Quads.len];
+    if (glyph.AtlasShadingHandle >= surf_shadings.len) return error.FrameCaptureCorrupt;
+    if (surf_shadings[glyph.AtlasShadingHandle].SiblingShading >= surf_shadings.len) return error.FrameCaptureCorrupt;
+}
+
+pub fn Save(self: FrameCapture, io: std.Io, allocator: std.mem.Allocator, path: []const u8) !void {
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try self.Serialize(&out.writer);
+
+    const file = try std.Io.Dir.cwd().createFile(io, path, .{ .read = false, .truncate = true });
+    defer file.close(io);
+    try file.writeStreamingAll(io, out.written());
+}
+
+pub fn Load(io: std.Io, allocator: std.mem.Allocator, path: []const u8) !FrameCapture {
+    const file = try std.Io.Dir.cwd().openFile(io, path, .{});
+    defer file.close(io);
+
+    var file_reader = file.reader(io, &.{});
+    const contents = try file_reader.interface.allocRemaining(allocator, .unlimited);
+    defer allocator.free(contents);
+
+    return Parse(allocator, contents);
+}
+
+//the records are copied out since the file bytes carry no alignment
+const Cursor = struct {
+    mBytes: []const u8,
+    mPos: usize = 0,
+
+    fn Take(self: *Cursor, comptime T: type) !T {
+        var value: T = undefined;
+        try self.Copy(std.mem.asBytes(&value));
+        return value;
+    }
+
+    fn TakeSlice(self: *Cursor, allocator: std.mem.Allocator, comptime T: type, count: u32) ![]const T {
+        if (@as(usize, count) * @sizeOf(T) > self.mBytes.len - self.mPos) return error.FrameCaptureTruncated;
+        const values = try allocator.alloc(T, count);
+        try self.Copy(std.mem.sliceAsBytes(values));
+        return values;
+    }
+
+    fn Copy(self: *Cursor, dst: []u8) !void {
+        if (dst.len > self.mBytes.len - self.mPos) return error.FrameCaptureTruncated;
+        @memcpy(dst, self.mBytes[self.mPos..][0..dst.len]);
+        self.mPos += dst.len;
+    }
+};
+
+test "Frame capture round trips and replays to the same image" {
+    const allocator = std.testing.allocator;
+
+    var quads: [5]QuadData = undefined;
+    for (&quads, 0..) |*quad, i| quad.* = .{
+        .Rotation = .{ 1, 0, 0, 0 },
+        .Position = .{ @as(f32, @floatFromInt(i)) - 2, 0, -4 },
+        .HalfExtents = .{ 0.4, 0.4, 0.01 },
+        .ShadingHandle = @intCast(i % 2),
+        .ShadingFlags = 0,
+    };
+    const surf_shadings = [_]SurfShadingData{
+        .{ .Color = .{ 1, 0, 0, 1 }, .TextureUV0 = .{ 0, 0 }, .TextureUV1 = .{ 1, 1 }, .TilingFactor = 1, .Texturehandle = 3, .SiblingShading = 0 },
+        .{ .Color = .{ 0, 1, 0, 1 }, .TextureUV0 = .{ 0, 0 }, .TextureUV1 = .{ 1, 1 }, .TilingFactor = 1, .Texturehandle = 3, .SiblingShading = 0 },
+    };
+    const med_shadings = [_]MedShadingData{.{ .Absorption = .{ 0, 0, 0 }, .Scattering = .{ 0, 0, 0 } }};
+
+    var bvh: BVH = .empty;
+    defer bvh.Deinit(allocator);
+    try SDFObjectBVH.Build(&bvh, allocator, allocator, &quads, &.{});
+
+    const size: u32 = 16;
+    const scale = 2.0 / @as(f32, @floatFromInt(size));
+    const camera = PushConstants{
+        .mPosition = .{ 0, 0, 0 },
+        .mPerspectiveFar = 50,
+        .mRotation = .{ 1, 0, 0, 0 },
+        .mRayScale = .{ scale, -scale },
+        .mRayOffset = .{ -1, 1 },
+        .mQuadsCount = quads.len,
+        .mGlyphsCount = 0,
+        .mViewportWidth = @floatFromInt(size),
+        .mViewportHeight = @floatFromInt(size),
+    };
+
+    const texture_handles = try CollectTextureHandles(allocator, &surf_shadings);
+    defer allocator.free(texture_handles);
+    try std.testing.expectEqualSlices(u32, &.{3}, texture_handles);
+
+    const capture = FrameCapture{
+        .mWidth = size,
+        .mHeight = size,
+        .mPasses = .{
+            .{ .Camera = camera, .Quads = quads[0..2] },
+            .{ .Camera = camera, .Quads = &quads, .Nodes = bvh.GetNodes(), .Items = bvh.GetItems() },
+        },
+        .mSurfShadings = &surf_shadings,
+        .mMedShadings = &med_shadings,
+        .mTextureHandles = texture_handles,
+    };
+
+    var out: std.Io.Writer.Allocating = .init(allocator);
+    defer out.deinit();
+    try capture.Serialize(&out.writer);
+
+    var loaded = try FrameCapture.Parse(allocator, out.written());
+    defer loaded.Deinit();
+    try std.testing.expectEqual(size, loaded.mWidth);
+    try std.testing.expectEqualSlices(u8, std.mem.sliceAsBytes(capture.mPasses[1].Nodes), std.mem.sliceAsBytes(loaded.mPasses[1].Nodes));
+    try std.testing.expectEqualSlices(u32, texture_handles, loaded.mTextureHandles);
+
+    //both passes of both captures onto one image each, the way the renderer draws them
+    const WorkerPool = @import("../Core/WorkerPool.zig");
+    var pool: WorkerPool = .empty;
+    try pool.Init(allocator, 0);
+    defer pool.Deinit(allocator);
+
+    const textures: CPURayMarcher.TextureArray = .empty;
+    var images: [2]CPURayMarcher.Image = .{ .empty, .empty };
+    defer for (&images) |*image| image.Deinit(allocator);
+    for (&images, [_]*const FrameCapture{ &capture, &loaded }) |*image, source| {
+        try image.Init(allocator, size, size);
+        CPURayMarcher.Render(&pool, source.ToFrame(.Overlay, &textures), image);
+        CPURayMarcher.Render(&pool, source.ToFrame(.Game, &textures), image);
+    }
+    try std.testing.expectEqual(@as(usize, 0), images[0].CountDifferent(images[1], 0));
+
+    //a capture from a build with other record sizes is refused instead of read as garbage
+    out.written()[8] +%= 1;
+    try std.testing.expectError(error.FrameCaptureLayoutMismatch, FrameCapture.Parse(allocator, out.written()));
+
+    //as is one whose indices point outside its arrays or whose tree loops back on itself
+    const bad_items = [_]u32{ 0, 1, @intCast(quads.len) };
+    var bad_nodes = [_]SDFObjectBVH.Node{ bvh.GetNodes()[0], bvh.GetNodes()[1] };
+    bad_nodes[0].First = 0;
+    for ([_]Pass{
+        .{ .Camera = camera, .Quads = &quads, .Items = &bad_items },
+        .{ .Camera = camera, .Quads = &quads, .Nodes = &bad_nodes, .Items = bvh.GetItems() },
+    }) |bad_pass| {
+        var bad_capture = capture;
+        bad_capture.mPasses[1] = bad_pass;
+
+        var bad_out: std.Io.Writer.Allocating = .init(allocator);
+        defer bad_out.deinit();
+        try bad_capture.Serialize(&bad_out.writer);
+        try std.testing.expectError(error.FrameCaptureCorrupt, FrameCapture.Parse(allocator, bad_out.written()));
+    }
+}
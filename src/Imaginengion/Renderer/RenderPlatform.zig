@@ -42,6 +42,16 @@ pub fn EndFrame(self: *Platform) void {
     self._Impl.EndFrame();
 }
 
+/// For acquires made outside the platform, like the imgui pass
+pub fn AddSwapchainWait(self: *Platform, wait_ns: u64) void {
+    self._Impl.AddSwapchainWait(wait_ns);
+}
+
+/// Time spent blocked on the swapchain since the last call, vsync included
+pub fn TakeSwapchainWaitNs(self: *Platform) u64 {
+    return self._Impl.TakeSwapchainWaitNs();
+}
+
 pub fn GetMaxTextureImageSlots(self: Platform) usize {
     return self._Impl.GetMaxTextureImageSlots();
 }
@@ -54,6 +64,16 @@ pub fn Present(self: Platform, compute_texture: *ComputeOutput) void {
     self._Impl.Present(compute_texture);
 }
 
+/// Queue the storage buffers stage their uploads in, see SSBOs/GPUStorage.zig
+pub fn GetUploadQueue(self: *Platform) *anyopaque {
+    return self._Impl.GetUploadQueue();
+}
+
+/// Encodes every upload staged so far in one copy pass on the frame's command buffer
+pub fn FlushUploads(self: *Platform) !void {
+    try self._Impl.FlushUploads();
+}
+
 pub fn GetCommandBuff(self: Platform) *anyopaque {
     return self._Impl.GetCommandBuff();
 }
@@ -36,6 +36,12 @@ const PushConstants = RenderPipeline.SDFPushConstants;
 const MediumMaterial = @import("../Physics/MediumMaterial.zig");
 
 const SDFPipeline = @import("backends/SDFPipeline.zig").SDFPipeline;
+const ViewFrustum = @import("ViewFrustum.zig");
+const FrameCapture = @import("FrameCapture.zig");
+const DynamicResolution = @import("DynamicResolution.zig");
+const RetainedBuffer = @import("RetainedBuffer.zig").RetainedBuffer;
+const Range = @import("RetainedBuffer.zig").Range;
+const AABB = @import("../Physics/BVH.zig").AABB;
 
 const GroupQuery = @import("../ECS/ComponentManager.zig").GroupQuery;
 
@@ -86,25 +92,42 @@ pub const ShapeType = enum(u32) {
 
 pub const ShadingBuffers = struct {
     mSurfShadingBuff: SSBO = .{},
-    mSurfShadingBuffBase: std.ArrayList(SurfShadingData) = .empty,
+    mSurfaces: RetainedBuffer(SurfShadingData) = .empty,
     mMedShadingBuff: SSBO = .{},
-    mMedShadingBuffBase: std.ArrayList(MedShadingData) = .empty,
+    mMediums: RetainedBuffer(MedShadingData) = .empty,
     pub fn Init(self: *ShadingBuffers, engine_context: *EngineContext) !void {
         self.mSurfShadingBuff.Init(engine_context, @sizeOf(SurfShadingData) * 100, 2, .Fragment);
-        self.mSurfShadingBuffBase = try std.ArrayList(SurfShadingData).initCapacity(engine_context.EngineAllocator(), 100);
-
         self.mMedShadingBuff.Init(engine_context, @sizeOf(MedShadingData) * 100, 3, .Fragment);
-        self.mMedShadingBuffBase = try std.ArrayList(MedShadingData).initCapacity(engine_context.EngineAllocator(), 100);
+
+        //NOTE: temporary just add air as the medium
+        const air_mat = MediumMaterial.MediumDatabase.get(.Air);
+        const air_range = try self.mMediums.Alloc(engine_context.EngineAllocator(), 1);
+        _ = self.mMediums.Write(air_range.Start, .{
+            .Absorption = air_mat.RenderData.Absorption.ToVector(),
+            .Scattering = air_mat.RenderData.Scattering.ToVector(),
+        });
     }
     pub fn Deinit(self: *ShadingBuffers, engine_context: *EngineContext) void {
         self.mSurfShadingBuff.Deinit(engine_context);
-        self.mSurfShadingBuffBase.deinit(engine_context.EngineAllocator());
+        self.mSurfaces.Deinit(engine_context.EngineAllocator());
 
         self.mMedShadingBuff.Deinit(engine_context);
-        self.mMedShadingBuffBase.deinit(engine_context.EngineAllocator());
+        self.mMediums.Deinit(engine_context.EngineAllocator());
+    }
+    pub fn AllocSurfaces(self: *ShadingBuffers, engine_allocator: std.mem.Allocator, count: u32) !Range {
+        return self.mSurfaces.Alloc(engine_allocator, count);
+    }
+    pub fn ResizeSurfaces(self: *ShadingBuffers, engine_allocator: std.mem.Allocator, range: Range, count: u32) !Range {
+        return self.mSurfaces.Resize(engine_allocator, range, count);
+    }
+    pub fn FreeSurfaces(self: *ShadingBuffers, engine_allocator: std.mem.Allocator, range: Range) !void {
+        try self.mSurfaces.Free(engine_allocator, range);
     }
-    pub fn AddSurface(self: *ShadingBuffers, engine_allocator: std.mem.Allocator, color: Vec4(f32), texture_uv0: Vec2(f32), texture_uv1: Vec2(f32), tiling_factor: f32, texture_handle: u32, sibling_shading: u32) usize {
-        self.mSurfShadingBuffBase.append(engine_allocator, .{
+    pub fn ResetSurfaces(self: *ShadingBuffers) void {
+        self.mSurfaces.Reset();
+    }
+    pub fn WriteSurface(self: *ShadingBuffers, slot: u32, color: Vec4(f32), texture_uv0: Vec2(f32), texture_uv1: Vec2(f32), tiling_factor: f32, texture_handle: u32, sibling_shading: u32) void {
+        _ = self.mSurfaces.Write(slot, .{
             .Color = color.ToVector(),
             .TextureUV0 = texture_uv0.ToVector(),
             .TextureUV1 = texture_uv1.ToVector(),
@@ -112,48 +135,28 @@ pub const ShadingBuffers = struct {
             .Texturehandle = texture_handle,
             .SiblingShading = sibling_shading,
         });
-
-        return self.mSurfShadingBuffBase.items.len - 1;
-    }
-    pub fn AddMedium(self: *ShadingBuffers, engine_allocator: std.mem.Allocator, absorption: Vec3(f32), scattering: Vec3(f32)) void {
-        self.mMedShadingBuffBase.append(engine_allocator, .{
-            .Absorption = absorption.ToVector(),
-            .Scattering = scattering.ToVector(),
-        });
-    }
-    pub fn ClearAndFree(self: *ShadingBuffers, engine_allocator: std.mem.Allocator) void {
-        self.mSurfShadingBuffBase.clearAndFree(engine_allocator);
-        self.mMedShadingBuffBase.clearAndFree(engine_allocator);
     }
     pub fn SetBuffers(self: *ShadingBuffers, world_type: EngineContext.WorldType, engine_context: *EngineContext) !void {
         const zone = Tracy.ZoneInit("R2D SetBuffers", @src());
         defer zone.Deinit();
 
-        const surf_byte_size = self.mSurfShadingBuffBase.items.len * @sizeOf(SurfShadingData);
-        const med_byte_size = self.mMedShadingBuffBase.items.len * @sizeOf(MedShadingData);
-
-        //shadings
-        _ = self.mSurfShadingBuff.SetData(engine_context, self.mSurfShadingBuffBase.items.ptr, surf_byte_size, 0);
-        _ = self.mSurfShadingBuff.SetData(engine_context, self.mMedShadingBuffBase.items.ptr, med_byte_size, 0);
+        //shadings, only what was written since the last upload
+        if (self.mSurfaces.GetDirtyRange()) |dirty| {
+            const items = self.mSurfaces.GetItems()[dirty.Start..dirty.End()];
+            _ = try self.mSurfShadingBuff.SetData(engine_context, items.ptr, items.len * @sizeOf(SurfShadingData), dirty.Start * @sizeOf(SurfShadingData));
+            self.mSurfaces.ClearDirty();
+        }
+        if (self.mMediums.GetDirtyRange()) |dirty| {
+            const items = self.mMediums.GetItems()[dirty.Start..dirty.End()];
+            _ = try self.mMedShadingBuff.SetData(engine_context, items.ptr, items.len * @sizeOf(MedShadingData), dirty.Start * @sizeOf(MedShadingData));
+            self.mMediums.ClearDirty();
+        }
 
         //fill out stats
-        switch (world_type) {
-            .Game => {
-                engine_context.mEngineStats.GameWorldStats.mRenderStats.Shadings.TotalShadings = self.mSurfShadingBuffBase.items.len + self.mMedShadingBuffBase.items.len;
-                engine_context.mEngineStats.GameWorldStats.mRenderStats.Shadings.SurfShadings = self.mSurfShadingBuffBase.items.len;
-                engine_context.mEngineStats.GameWorldStats.mRenderStats.Shadings.MedShadings = self.mMedShadingBuffBase.items.len;
-            },
-            .Editor => {
-                engine_context.mEngineStats.EditorWorldStats.mRenderStats.Shadings.TotalShadings = self.mSurfShadingBuffBase.items.len + self.mMedShadingBuffBase.items.len;
-                engine_context.mEngineStats.EditorWorldStats.mRenderStats.Shadings.SurfShadings = self.mSurfShadingBuffBase.items.len;
-                engine_context.mEngineStats.EditorWorldStats.mRenderStats.Shadings.MedShadings = self.mMedShadingBuffBase.items.len;
-            },
-            .Simulate => {
-                engine_context.mEngineStats.SimulateWorldStats.mRenderStats.Shadings.TotalShadings = self.mSurfShadingBuffBase.items.len + self.mMedShadingBuffBase.items.len;
-                engine_context.mEngineStats.SimulateWorldStats.mRenderStats.Shadings.SurfShadings = self.mSurfShadingBuffBase.items.len;
-                engine_context.mEngineStats.SimulateWorldStats.mRenderStats.Shadings.MedShadings = self.mMedShadingBuffBase.items.len;
-            },
-        }
+        const shading_stats = &engine_context.mEngineStats.GetWorldStats(world_type).mRenderStats.Shadings;
+        shading_stats.SurfShadings = self.mSurfaces.GetCount();
+        shading_stats.MedShadings = self.mMediums.GetCount();
+        shading_stats.TotalShadings = shading_stats.SurfShadings + shading_stats.MedShadings;
     }
     pub fn BindBuffers(self: ShadingBuffers, render_pass: *anyopaque) void {
         self.mSurfShadingBuff.Bind(render_pass);
@@ -169,6 +172,12 @@ mSDFPushConstants: PushConstants = undefined,
 mR2D: Renderer2D = .{},
 mR3D: Renderer3D = .{},
 mSDFShading: ShadingBuffers = .{},
+/// Objects further than this from the camera are culled even if rays would still reach them
+mMaxDrawDistance: ?f32 = null,
+/// Scale the compute targets are rendered at, fed the frame time once a frame by the program
+mDynamicResolution: DynamicResolution = .{},
+//where the next rendered frame gets captured to, see RequestCapture
+_CapturePath: ?[]u8 = null,
 
 pub fn Init(self: *Renderer, engine_context: *EngineContext) !void {
     self.mPlatform.Init(engine_context);
@@ -185,6 +194,7 @@ pub fn Init(self: *Renderer, engine_context: *EngineContext) !void {
 }
 
 pub fn Deinit(self: *Renderer, engine_context: *EngineContext) void {
+    if (self._CapturePath) |path| engine_context.EngineAllocator().free(path);
     self.mSDFShading.Deinit(engine_context);
     self.mTextureManager.Deinit(engine_context);
     self.mGamePipeline.Deinit(engine_context);
@@ -213,7 +223,7 @@ pub fn OnUpdate(self: *Renderer, world_type: EngineContext.WorldType, engine_con
 
     self.mSDFPushConstants = push_constants;
 
-    self.BeginRendering(engine_context.EngineAllocator());
+    self.mR2D.BeginFrame(world_type, &self.mSDFShading);
 
     //get all the shapes
     const shapes_ids = try scene_manager.GetEntityGroup(
@@ -226,18 +236,27 @@ pub fn OnUpdate(self: *Renderer, world_type: EngineContext.WorldType, engine_con
         },
     );
 
-    switch (world_type) {
-        .Game => engine_context.mEngineStats.GameWorldStats.mRenderStats.TotalObjects = shapes_ids.items.len,
-        .Editor => engine_context.mEngineStats.EditorWorldStats.mRenderStats.TotalObjects = shapes_ids.items.len,
-        .Simulate => engine_context.mEngineStats.SimulateWorldStats.mRenderStats.TotalObjects = shapes_ids.items.len,
-    }
-
+    //rays have a max distance and only leave the camera through the viewport, anything they cannot reach is not packed
+    const frustum = ViewFrustum.Init(push_constants, self.mMaxDrawDistance);
+    var submitted_count: usize = 0;
     for (shapes_ids.items) |shape_id| {
-        //TODO: distance based culling
-        //because since rays have max distances we know if something is greater than the camera point to the object then we can ignore
         const shape_entity = scene_manager.GetEntity(shape_id);
+        const bounds = try self.GetShapeBounds(engine_context, shape_entity) orelse continue;
+        if (!frustum.IsVisible(bounds)) {
+            self.mR2D.KeepAlive(shape_id);
+            continue;
+        }
+
         try self.DrawShape(engine_context, shape_entity);
+        submitted_count += 1;
     }
+    //entities that are gone give their slots back
+    try self.mR2D.EndFrame(engine_context, &self.mSDFShading);
+
+    const render_stats = &engine_context.mEngineStats.GetWorldStats(world_type).mRenderStats;
+    render_stats.TotalObjects = shapes_ids.items.len;
+    render_stats.SubmittedObjects = submitted_count;
+    render_stats.CulledObjects = shapes_ids.items.len - submitted_count;
 
     //TODO: sorting
     //TODO: other optimizsations?
@@ -245,16 +264,31 @@ pub fn OnUpdate(self: *Renderer, world_type: EngineContext.WorldType, engine_con
     try self.EndRendering(world_type, engine_context, compute_texture, rendering_mode);
 }
 
-fn BeginRendering(self: *Renderer, engine_allocator: std.mem.Allocator) void {
-    const zone = Tracy.ZoneInit("BeginFrame", @src());
-    defer zone.Deinit();
+pub fn SetMaxDrawDistance(self: *Renderer, max_draw_distance: ?f32) void {
+    self.mMaxDrawDistance = max_draw_distance;
+}
+
+/// Saves the buffers of the next rendered frame to path so it can be replayed, see FrameCapture
+pub fn RequestCapture(self: *Renderer, engine_allocator: std.mem.Allocator, path: []const u8) !void {
+    const path_copy = try engine_allocator.dupe(u8, path);
+    if (self._CapturePath) |old_path| engine_allocator.free(old_path);
+    self._CapturePath = path_copy;
+}
 
-    self.mR2D.StartBatch(engine_allocator);
-    self.mSDFShading.ClearAndFree(engine_allocator);
+/// Union of the bounds of every shape on the entity, null if none of them would draw anything
+fn GetShapeBounds(self: *Renderer, engine_context: *EngineContext, entity: Entity) !?AABB {
+    const transform_component = entity.GetComponent(TransformComponent).?;
 
-    //NOTE: temporary just add air as the medium
-    const air_mat = MediumMaterial.MediumDatabase.get(.Air);
-    self.mSDFShading.AddMedium(engine_allocator, air_mat.RenderData.Absorption, air_mat.RenderData.Scattering);
+    var bounds: ?AABB = null;
+    if (entity.GetComponent(QuadComponent) != null) {
+        bounds = Renderer2D.GetQuadBounds(transform_component);
+    }
+    if (entity.GetComponent(TextComponent)) |text_component| {
+        if (try self.mR2D.GetTextBounds(engine_context, transform_component, text_component)) |text_bounds| {
+            bounds = if (bounds) |b| b.Union(text_bounds) else text_bounds;
+        }
+    }
+    return bounds;
 }
 
 fn DrawShape(self: *Renderer, engine_context: *EngineContext, entity: Entity) anyerror!void {
@@ -264,27 +298,61 @@ fn DrawShape(self: *Renderer, engine_context: *EngineContext, entity: Entity) an
     const transform_component = entity.GetComponent(TransformComponent).?;
     const entity_scene_comp = entity.GetComponent(EntitySceneComponent).?;
 
+    //shapes that did not change since they were packed keep their slots, the quad and the text share one transform
+    const transform_changed = transform_component.IsRenderDirty();
+    transform_component.ClearRenderDirty();
+
     //check for specific shapes and draw them if they exist
     if (entity.GetComponent(QuadComponent)) |quad_component| {
         try self.mR2D.DrawQuad(
             engine_context,
+            entity.mEntityID,
             transform_component,
             quad_component,
             entity_scene_comp,
             &self.mSDFShading,
+            transform_changed,
         );
+    } else {
+        try self.mR2D.FreeQuad(engine_context.EngineAllocator(), entity.mEntityID, &self.mSDFShading);
     }
     if (entity.GetComponent(TextComponent)) |text_component| {
         try self.mR2D.DrawText(
             engine_context,
+            entity.mEntityID,
             transform_component,
             text_component,
             entity_scene_comp,
             &self.mSDFShading,
+            transform_changed,
         );
+    } else {
+        try self.mR2D.FreeText(engine_context.EngineAllocator(), entity.mEntityID, &self.mSDFShading);
     }
 }
 
+/// The buffers as just uploaded, push constants per pass as the pipelines are about to get them
+fn WriteCapture(self: *Renderer, engine_context: *EngineContext, compute_texture: *ComputeOutput, path: []const u8) !void {
+    const zone = Tracy.ZoneInit("Renderer WriteCapture", @src());
+    defer zone.Deinit();
+
+    const frame_allocator = engine_context.FrameAllocator();
+    const surf_shadings = self.mSDFShading.mSurfaces.GetItems();
+
+    const capture = FrameCapture{
+        .mWidth = @intCast(compute_texture.GetWidth()),
+        .mHeight = @intCast(compute_texture.GetHeight()),
+        .mPasses = .{
+            try self.mR2D.GetCapturePass(engine_context, .OverlayPipeline, self.mSDFPushConstants),
+            try self.mR2D.GetCapturePass(engine_context, .GamePipeline, self.mSDFPushConstants),
+        },
+        .mSurfShadings = surf_shadings,
+        .mMedShadings = self.mSDFShading.mMediums.GetItems(),
+        .mTextureHandles = try FrameCapture.CollectTextureHandles(frame_allocator, surf_shadings),
+    };
+    try capture.Save(engine_context.Io(), frame_allocator, path);
+}
+
 fn EndRendering(self: *Renderer, world_type: EngineContext.WorldType, engine_context: *EngineContext, compute_texture: *ComputeOutput, rendering_mode: RenderingMode) !void {
     const zone = Tracy.ZoneInit("Renderer EndRendering", @src());
     defer zone.Deinit();
@@ -298,11 +366,25 @@ fn EndRendering(self: *Renderer, world_type: EngineContext.WorldType, engine_con
         .Overlay, .OverlayGame => {},
         .Game => {},
     }
-    self.mPlatform.PushDebugGroup("Upload Buffers - Overlay\x00");
-    try self.mR2D.SetBuffers(world_type, engine_context, .OverlayPipeline);
+    //every buffer of both pipelines goes up in one copy pass before either of them runs
+    self.mPlatform.PushDebugGroup("Upload Buffers\x00");
+    try self.mR2D.SetBuffers(world_type, engine_context, .OverlayPipeline, self.mSDFPushConstants);
+    try self.mR2D.SetBuffers(world_type, engine_context, .GamePipeline, self.mSDFPushConstants);
     try self.mSDFShading.SetBuffers(world_type, engine_context);
+    try self.mPlatform.FlushUploads();
     self.mPlatform.PopDebugGroup();
 
+    if (self._CapturePath) |path| {
+        defer {
+            engine_context.EngineAllocator().free(path);
+            self._CapturePath = null;
+        }
+        //a failed capture is not worth losing the frame over
+        self.WriteCapture(engine_context, compute_texture, path) catch |err| {
+            std.log.err("frame capture to {s} failed: {}", .{ path, err });
+        };
+    }
+
     self.mPlatform.PushDebugGroup("Draw - Overlay\x00");
     const overlay_compute_pass = compute_texture.BeginComputePass(engine_context, true);
 
@@ -322,11 +404,6 @@ fn EndRendering(self: *Renderer, world_type: EngineContext.WorldType, engine_con
     //=======================================end overlay render pipeline============================
 
     //=====================================now for game layer render pipeline======================================================
-    self.mPlatform.PushDebugGroup("Upload Buffers - Game\x00");
-    try self.mR2D.SetBuffers(world_type, engine_context, .GamePipeline);
-    try self.mSDFShading.SetBuffers(world_type, engine_context);
-    self.mPlatform.PopDebugGroup();
-
     self.mPlatform.PushDebugGroup("Draw - Game\x00");
     const game_compute_pass = compute_texture.BeginComputePass(engine_context, false);
 
@@ -29,11 +29,20 @@ const EntityTransformComponent = EntityComponents.TransformComponent;
 const QuadComponent = EntityComponents.QuadComponent;
 const TextComponent = EntityComponents.TextComponent;
 const EntitySceneComponent = EntityComponents.EntitySceneComponent;
+const Entity = @import("../GameObjects/Entity.zig");
 
 const SceneComponents = @import("../Scene/SceneComponents.zig");
 const SceneSceneComponent = SceneComponents.SceneComponent;
 
 const StorageBufferBinding = @import("RenderPlatform.zig").StorageBufferBinding;
+const BVH = @import("../Physics/BVH.zig");
+const SDFObjectBVH = @import("SDFObjectBVH.zig");
+const SDFTileBins = @import("SDFTileBins.zig");
+const RetainedBuffer = @import("RetainedBuffer.zig").RetainedBuffer;
+const Range = @import("RetainedBuffer.zig").Range;
+const TextLayoutCache = @import("TextLayoutCache.zig").TextLayoutCache;
+const FrameCapture = @import("FrameCapture.zig");
+const PushConstants = @import("RenderPipeline.zig").SDFPushConstants;
 
 const Tracy = @import("../Core/Tracy.zig");
 
@@ -54,6 +63,10 @@ pub const GlyphData = extern struct {
     Position: Vec3(f32).VectorT,
     HalfExtents: Vec3(f32).VectorT,
     PlaneCenter: Vec2(f32).VectorT,
+    //where the glyph is in the atlas, the only part of its shading that differs from the rest of the text
+    AtlasUV0: Vec2(f32).VectorT,
+    AtlasUV1: Vec2(f32).VectorT,
+    /// Atlas shading shared by every glyph of the text, its sibling is the shading of the text itself
     AtlasShadingHandle: u32,
     TextureShadingFlags: u32,
 };
@@ -61,70 +74,168 @@ pub const GlyphData = extern struct {
 pub const BufferKind = enum {
     Quad,
     Glyph,
-    Shading,
 };
 
 pub const RenderBuffers = struct {
     mQuadBuffer: SSBO = .{},
-    mQuadBufferBase: std.ArrayList(QuadData) = .empty,
+    mQuads: RetainedBuffer(QuadData) = .empty,
 
     mGlyphBuffer: SSBO = .{},
-    mGlyphBufferBase: std.ArrayList(GlyphData) = .empty,
+    mGlyphs: RetainedBuffer(GlyphData) = .empty,
+
+    //shown slots binned into the screen tiles the shaders march, only rebuilt when the slots, their records or the camera changed
+    mTileBins: SDFTileBins = .empty,
+    mTileOffsetBuffer: SSBO = .{},
+    mTileItemBuffer: SSBO = .{},
+
+    //only the cpu replay of a capture walks a tree, so it is built when a capture asks for it. Items are remapped to slots
+    mBVH: BVH = .empty,
+    mBVHItems: std.ArrayList(u32) = .empty,
+
+    //slots of every shown renderable, glyph slots after every quad slot. Collected again only when a renderable
+    //gets or frees slots or is shown or hidden, so a scene where nothing changes does not touch it
+    _ShownItems: std.ArrayList(u32) = .empty,
+    _ShownQuads: u32 = 0,
+    _ItemsStale: bool = true,
+    _BinsStale: bool = true,
+    _BVHStale: bool = true,
+    _BinnedCamera: ?PushConstants = null,
 
     pub fn Init(self: *RenderBuffers, engine_context: *EngineContext) !void {
         self.mQuadBuffer.Init(engine_context, @sizeOf(QuadData) * 100, 4, .Fragment);
-        self.mQuadBufferBase = try std.ArrayList(QuadData).initCapacity(engine_context.EngineAllocator(), 100);
-
         self.mGlyphBuffer.Init(engine_context, @sizeOf(GlyphData) * 100, 5, .Fragment);
-        self.mGlyphBufferBase = try std.ArrayList(GlyphData).initCapacity(engine_context.EngineAllocator(), 100);
+
+        self.mTileOffsetBuffer.Init(engine_context, @sizeOf(u32) * 1024, 6, .Fragment);
+        self.mTileItemBuffer.Init(engine_context, @sizeOf(u32) * 1024, 7, .Fragment);
     }
     pub fn Deinit(self: *RenderBuffers, engine_context: *EngineContext) void {
+        const engine_allocator = engine_context.EngineAllocator();
+
         self.mQuadBuffer.Deinit(engine_context);
-        self.mQuadBufferBase.deinit(engine_context.EngineAllocator());
+        self.mQuads.Deinit(engine_allocator);
 
         self.mGlyphBuffer.Deinit(engine_context);
-        self.mGlyphBufferBase.deinit(engine_context.EngineAllocator());
+        self.mGlyphs.Deinit(engine_allocator);
+
+        self.mTileBins.Deinit(engine_allocator);
+        self.mTileOffsetBuffer.Deinit(engine_context);
+        self.mTileItemBuffer.Deinit(engine_context);
+
+        self.mBVH.Deinit(engine_allocator);
+        self.mBVHItems.deinit(engine_allocator);
+
+        self._ShownItems.deinit(engine_allocator);
     }
-    pub fn ClearAndFree(self: *RenderBuffers, engine_allocator: std.mem.Allocator) void {
-        self.mQuadBufferBase.clearAndFree(engine_allocator);
-        self.mGlyphBufferBase.clearAndFree(engine_allocator);
+    /// Drops every slot, the next frame writes and uploads everything again
+    pub fn Reset(self: *RenderBuffers) void {
+        self.mQuads.Reset();
+        self.mGlyphs.Reset();
+        self._ShownItems.clearRetainingCapacity();
+        self._ShownQuads = 0;
+        self._ItemsStale = true;
     }
-    pub fn SetBuffers(self: *RenderBuffers, world_type: EngineContext.WorldType, engine_context: *EngineContext) !void {
+    /// Uploads the dirty slots and, when the shown slots, their records or the camera changed, the tile lists
+    /// of the shown slots as seen through camera
+    pub fn SetBuffers(self: *RenderBuffers, world_type: EngineContext.WorldType, engine_context: *EngineContext, camera: PushConstants) !void {
         const zone = Tracy.ZoneInit("R2D SetBuffers", @src());
         defer zone.Deinit();
 
-        const quad_byte_size = self.mQuadBufferBase.items.len * @sizeOf(QuadData);
-        const glyph_byte_size = self.mGlyphBufferBase.items.len * @sizeOf(GlyphData);
-
-        //quads
-        _ = self.mQuadBuffer.SetData(engine_context, self.mQuadBufferBase.items.ptr, quad_byte_size, 0);
+        const engine_allocator = engine_context.EngineAllocator();
+
+        const quads_dirty = try UploadDirty(QuadData, &self.mQuadBuffer, &self.mQuads, engine_context);
+        const glyphs_dirty = try UploadDirty(GlyphData, &self.mGlyphBuffer, &self.mGlyphs, engine_context);
+
+        //the tree does not depend on the camera
+        if (self._BinsStale or quads_dirty or glyphs_dirty) self._BVHStale = true;
+
+        //the counts are set per pass after this so they are left out of the compare
+        var view = camera;
+        view.mQuadsCount = 0;
+        view.mGlyphsCount = 0;
+        const camera_moved = if (self._BinnedCamera) |binned| !std.mem.eql(u8, std.mem.asBytes(&binned), std.mem.asBytes(&view)) else true;
+        if (self._BinsStale or quads_dirty or glyphs_dirty or camera_moved) {
+            //the shaders find the tile of a pixel from the viewport size, so bin over the same size
+            const width: u32 = @intFromFloat(camera.mViewportWidth);
+            const height: u32 = @intFromFloat(camera.mViewportHeight);
+            try self.mTileBins.BuildSubset(engine_allocator, engine_context.FrameAllocator(), camera, width, height, self.mQuads.GetItems(), self.mGlyphs.GetItems(), self._ShownItems.items);
+            const offsets = self.mTileBins.GetOffsets();
+            const items = self.mTileBins.GetItems();
+            _ = try self.mTileOffsetBuffer.SetData(engine_context, offsets.ptr, offsets.len * @sizeOf(u32), 0);
+            _ = try self.mTileItemBuffer.SetData(engine_context, items.ptr, items.len * @sizeOf(u32), 0);
+            self._BinnedCamera = view;
+            self._BinsStale = false;
+        }
 
-        //glyphs
-        _ = self.mGlyphBuffer.SetData(engine_context, self.mGlyphBufferBase.items.ptr, glyph_byte_size, 0);
         //fill out stats
-        switch (world_type) {
-            .Game => {
-                engine_context.mEngineStats.GameWorldStats.mRenderStats.OutputQuadNum = @intCast(self.mQuadBufferBase.items.len);
-                engine_context.mEngineStats.GameWorldStats.mRenderStats.OutputGlyphNum = @intCast(self.mGlyphBufferBase.items.len);
-            },
-            .Editor => {
-                engine_context.mEngineStats.EditorWorldStats.mRenderStats.OutputQuadNum = @intCast(self.mQuadBufferBase.items.len);
-                engine_context.mEngineStats.EditorWorldStats.mRenderStats.OutputGlyphNum = @intCast(self.mGlyphBufferBase.items.len);
-            },
-            .Simulate => {
-                engine_context.mEngineStats.SimulateWorldStats.mRenderStats.OutputQuadNum = @intCast(self.mQuadBufferBase.items.len);
-                engine_context.mEngineStats.SimulateWorldStats.mRenderStats.OutputGlyphNum = @intCast(self.mGlyphBufferBase.items.len);
-            },
-        }
+        const render_stats = &engine_context.mEngineStats.GetWorldStats(world_type).mRenderStats;
+        render_stats.OutputQuadNum = self._ShownQuads;
+        render_stats.OutputGlyphNum = self._ShownItems.items.len - self._ShownQuads;
     }
     pub fn BindBuffers(self: RenderBuffers, render_pass: *anyopaque) void {
         self.mQuadBuffer.Bind(render_pass);
         self.mGlyphBuffer.Bind(render_pass);
+        self.mTileOffsetBuffer.Bind(render_pass);
+        self.mTileItemBuffer.Bind(render_pass);
+    }
+    /// Every retained slot, the shaders only march the shown ones through the tile lists
+    pub fn GetCount(self: RenderBuffers, comptime buff_kind: BufferKind) u32 {
+        return switch (buff_kind) {
+            .Quad => self.mQuads.GetCount(),
+            .Glyph => self.mGlyphs.GetCount(),
+        };
     }
+    /// The cpu copies of what the last SetBuffers uploaded, camera gets the counts the shader is given.
+    /// The tree of the pass is built here over the shown slots since nothing else needs it, and kept until they change
+    pub fn GetCapturePass(self: *RenderBuffers, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, camera: PushConstants) !FrameCapture.Pass {
+        if (self._BVHStale) {
+            try SDFObjectBVH.BuildSubset(&self.mBVH, &self.mBVHItems, engine_allocator, frame_allocator, self.mQuads.GetItems(), self.mGlyphs.GetItems(), self._ShownItems.items);
+            self._BVHStale = false;
+        }
+
+        var pass_camera = camera;
+        pass_camera.mQuadsCount = self.GetCount(.Quad);
+        pass_camera.mGlyphsCount = self.GetCount(.Glyph);
+        return .{
+            .Camera = pass_camera,
+            .Quads = self.mQuads.GetItems()[0..pass_camera.mQuadsCount],
+            .Glyphs = self.mGlyphs.GetItems()[0..pass_camera.mGlyphsCount],
+            .Nodes = self.mBVH.GetNodes(),
+            .Items = self.mBVHItems.items,
+        };
+    }
+};
+
+/// Uploads the slots written since the last upload, true if there were any
+fn UploadDirty(comptime T: type, ssbo: *SSBO, retained: *RetainedBuffer(T), engine_context: *EngineContext) !bool {
+    const dirty = retained.GetDirtyRange() orelse return false;
+    const items = retained.GetItems()[dirty.Start..dirty.End()];
+    _ = try ssbo.SetData(engine_context, items.ptr, items.len * @sizeOf(T), dirty.Start * @sizeOf(T));
+    retained.ClearDirty();
+    return true;
+}
+
+/// Slots one entity holds, kept until a frame passes without it being drawn or kept alive
+const Renderable = struct {
+    Pipeline: PipelineType,
+    Quad: Range = .{},
+    QuadShading: Range = .{},
+    //texture the quad shading was written with, a reloaded texture gets a new handle
+    QuadTexture: u32 = 0,
+    Glyphs: Range = .{},
+    //the texture shading then the atlas shading, shared by all the glyphs
+    TextShadings: Range = .{},
+    TextTextures: [2]u32 = .{ 0, 0 },
+    //drawn rather than kept alive the last frame, only shown slots are binned
+    Shown: bool = false,
+    LastFrame: u64,
 };
 
 mGameData: RenderBuffers = .{},
 mOverlayData: RenderBuffers = .{},
+mRenderables: std.AutoHashMapUnmanaged(Entity.Type, Renderable) = .empty,
+mTextLayouts: TextLayoutCache(TextAsset) = .empty,
+_Frame: u64 = 0,
+_WorldType: ?EngineContext.WorldType = null,
 
 pub fn Init(self: *Renderer2D, engine_context: *EngineContext) !void {
     try self.mGameData.Init(engine_context);
@@ -134,18 +245,52 @@ pub fn Init(self: *Renderer2D, engine_context: *EngineContext) !void {
 pub fn Deinit(self: *Renderer2D, engine_context: *EngineContext) void {
     self.mGameData.Deinit(engine_context);
     self.mOverlayData.Deinit(engine_context);
+    self.mRenderables.deinit(engine_context.EngineAllocator());
+    self.mTextLayouts.Deinit(engine_context.EngineAllocator());
 }
 
-pub fn StartBatch(self: *Renderer2D, engine_allocator: std.mem.Allocator) void {
-    self.mGameData.ClearAndFree(engine_allocator);
-    self.mOverlayData.ClearAndFree(engine_allocator);
+/// Entity ids only mean something within one world, switching worlds starts the slots over
+pub fn BeginFrame(self: *Renderer2D, world_type: EngineContext.WorldType, shading_buff: *ShadingBuffers) void {
+    if (self._WorldType != world_type) {
+        self.mRenderables.clearRetainingCapacity();
+        self.mGameData.Reset();
+        self.mOverlayData.Reset();
+        shading_buff.ResetSurfaces();
+        self._WorldType = world_type;
+    }
+    self._Frame += 1;
 }
 
-pub fn SetBuffers(self: *Renderer2D, world_type: EngineContext.WorldType, engine_context: *EngineContext, pipeline_t: PipelineType) !void {
-    try switch (pipeline_t) {
-        .GamePipeline => self.mGameData.SetBuffers(world_type, engine_context),
-        .OverlayPipeline => self.mOverlayData.SetBuffers(world_type, engine_context),
-    };
+/// Frees the slots of every entity that was neither drawn nor kept alive this frame
+pub fn EndFrame(self: *Renderer2D, engine_context: *EngineContext, shading_buff: *ShadingBuffers) !void {
+    const engine_allocator = engine_context.EngineAllocator();
+
+    var stale: std.ArrayList(Entity.Type) = .empty;
+    var iter = self.mRenderables.iterator();
+    while (iter.next()) |entry| {
+        if (entry.value_ptr.LastFrame != self._Frame) try stale.append(engine_context.FrameAllocator(), entry.key_ptr.*);
+    }
+    for (stale.items) |entity_id| {
+        const renderable = self.mRenderables.fetchRemove(entity_id).?.value;
+        try self.FreeRenderable(engine_allocator, renderable, shading_buff);
+    }
+
+    //every text asks for its layout while being culled, so only edited or removed texts lose theirs
+    try self.mTextLayouts.EndFrame(engine_allocator, engine_context.FrameAllocator());
+}
+
+/// Keeps the slots of an entity that was culled this frame so it can come back without reallocating.
+/// They are hidden until it is drawn again and keep whatever they held, a change while culled is packed then
+pub fn KeepAlive(self: *Renderer2D, entity_id: Entity.Type) void {
+    const renderable = self.mRenderables.getPtr(entity_id) orelse return;
+    renderable.LastFrame = self._Frame;
+    self.SetShown(renderable, false);
+}
+
+pub fn SetBuffers(self: *Renderer2D, world_type: EngineContext.WorldType, engine_context: *EngineContext, pipeline_t: PipelineType, camera: PushConstants) !void {
+    const render_buffers = self.GetRenderBuffers(pipeline_t);
+    if (render_buffers._ItemsStale) try self.CollectShownItems(engine_context.EngineAllocator(), pipeline_t);
+    try render_buffers.SetBuffers(world_type, engine_context, camera);
 }
 
 pub fn BindBuffers(self: Renderer2D, render_pass: *anyopaque, pipeline_t: PipelineType) void {
@@ -157,30 +302,25 @@ pub fn BindBuffers(self: Renderer2D, render_pass: *anyopaque, pipeline_t: Pipeli
 
 pub fn GetBufferCount(self: Renderer2D, comptime buff_kind: BufferKind, pipeline_kind: PipelineType) u32 {
     return switch (pipeline_kind) {
-        .GamePipeline => switch (buff_kind) {
-            .Quad => @intCast(self.mGameData.mQuadBufferBase.items.len),
-            .Glyph => @intCast(self.mGameData.mGlyphBufferBase.items.len),
-            .Shading => @intCast(self.mGameData.mShadingBufferBase.items.len),
-        },
-        .OverlayPipeline => switch (buff_kind) {
-            .Quad => @intCast(self.mOverlayData.mQuadBufferBase.items.len),
-            .Glyph => @intCast(self.mOverlayData.mGlyphBufferBase.items.len),
-            .Shading => @intCast(self.mOverlayData.mShadingBufferBase.items.len),
-        },
+        .GamePipeline => self.mGameData.GetCount(buff_kind),
+        .OverlayPipeline => self.mOverlayData.GetCount(buff_kind),
     };
 }
 
+pub fn GetCapturePass(self: *Renderer2D, engine_context: *EngineContext, pipeline_kind: PipelineType, camera: PushConstants) !FrameCapture.Pass {
+    const render_buffers = self.GetRenderBuffers(pipeline_kind);
+    return render_buffers.GetCapturePass(engine_context.EngineAllocator(), engine_context.FrameAllocator(), camera);
+}
+
 pub fn GetBuffer(self: Renderer2D, comptime buff_kind: BufferKind, pipeline_kind: PipelineType) *anyopaque {
     return switch (pipeline_kind) {
         .GamePipeline => switch (buff_kind) {
-            .Quad => @intCast(self.mGameData.mQuadBuffer.GetBuffer()),
-            .Glyph => @intCast(self.mGameData.mGlyphBuffer.GetBuffer()),
-            .Shading => @intCast(self.mGameData.mShadingBuffer.GetBuffer()),
+            .Quad => self.mGameData.mQuadBuffer.GetBuffer(),
+            .Glyph => self.mGameData.mGlyphBuffer.GetBuffer(),
         },
         .OverlayPipeline => switch (buff_kind) {
-            .Quad => @intCast(self.mOverlayData.mQuadBuffer.GetBuffer()),
-            .Glyph => @intCast(self.mOverlayData.mGlyphBuffer.GetBuffer()),
-            .Shading => @intCast(self.mOverlayData.mShadingBuffer.GetBuffer()),
+            .Quad => self.mOverlayData.mQuadBuffer.GetBuffer(),
+            .Glyph => self.mOverlayData.mGlyphBuffer.GetBuffer(),
         },
     };
 }
@@ -188,75 +328,127 @@ pub fn GetBuffer(self: Renderer2D, comptime buff_kind: BufferKind, pipeline_kind
 pub fn DrawQuad(
     self: *Renderer2D,
     engine_context: *EngineContext,
+    entity_id: Entity.Type,
     transform_component: *EntityTransformComponent,
     quad_component: *QuadComponent,
     entity_scene_comp: *EntitySceneComponent,
     shading_buff: *ShadingBuffers,
+    transform_changed: bool,
 ) !void {
     const zone = Tracy.ZoneInit("R2D DrawQuad", @src());
     defer zone.Deinit();
 
+    const engine_allocator = engine_context.EngineAllocator();
     const texture_asset = try quad_component.mTexture.GetAsset(engine_context, Texture2D);
+    const texture_handle = texture_asset.GetTextureHandle();
     const scene_scene_comp = entity_scene_comp.mScene.GetComponent(SceneSceneComponent).?;
 
+    const renderable = try self.GetRenderable(engine_allocator, entity_id, scene_scene_comp.mLayerType, shading_buff);
+    self.SetShown(renderable, true);
+
+    //the slot still holds exactly this quad, nothing to write or compare
+    if (renderable.Quad.Count != 0 and !transform_changed and !quad_component.IsDirty() and renderable.QuadTexture == texture_handle) return;
+    quad_component.ClearDirty();
+    self.CountRepacked(engine_context);
+
+    const render_buffers = self.GetRenderBuffers(renderable.Pipeline);
+    if (renderable.Quad.Count == 0) {
+        renderable.Quad = try render_buffers.mQuads.Alloc(engine_allocator, 1);
+        renderable.QuadShading = try shading_buff.AllocSurfaces(engine_allocator, 1);
+        render_buffers._ItemsStale = true;
+    }
+    renderable.QuadTexture = texture_handle;
+
     const world_pos = transform_component.GetWorldPosition();
     const world_rot = transform_component.GetWorldRotation();
     const world_scale = transform_component.GetWorldScale();
 
-    const shading_handle = shading_buff.AddSurface(
-        engine_context.EngineAllocator(),
-        quad_component.mTexOptions.mTilingFactor,
+    shading_buff.WriteSurface(
+        renderable.QuadShading.Start,
+        quad_component.mTexOptions.mColor,
         quad_component.mTexOptions.mTextureUV0,
         quad_component.mTexOptions.mTextureUV1,
         quad_component.mTexOptions.mTilingFactor,
-        texture_asset.GetTextureHandle(),
+        texture_handle,
         std.math.maxInt(u32),
     );
 
     var shading_flag: u32 = 0;
     if (quad_component.mMaterial.mOpaqueMode == .Transparent) shading_flag |= EShadingFlags.SURFACE_TRANSPARENT.ToInt();
 
-    switch (scene_scene_comp.mLayerType) {
-        .GameLayer => try self.mGameData.mQuadBufferBase.append(engine_context.EngineAllocator(), .{
-            .Position = world_pos.ToVector(),
-            .Rotation = world_rot.ToVector(),
-            .HalfExtents = Vec3(f32).VectorT{ world_scale.x * 0.5, world_scale.y * 0.5, THICKNESS_2D },
-            .ShadingHandle = @intCast(shading_handle),
-            .ShadingFlags = shading_flag,
-        }),
-        .OverlayLayer => try self.mGameData.mQuadBufferBase.append(engine_context.EngineAllocator(), .{
-            .Position = world_pos.ToVector(),
-            .Rotation = world_rot.ToVector(),
-            .HalfExtents = Vec3(f32).VectorT{ world_scale.x * 0.5, world_scale.y * 0.5, THICKNESS_2D },
-            .ShadingHandle = @intCast(shading_handle),
-            .ShadingFlags = shading_flag,
-        }),
-    }
+    _ = render_buffers.mQuads.Write(renderable.Quad.Start, .{
+        .Position = world_pos.ToVector(),
+        .Rotation = world_rot.ToVector(),
+        .HalfExtents = Vec3(f32).VectorT{ world_scale.x * 0.5, world_scale.y * 0.5, THICKNESS_2D },
+        .ShadingHandle = renderable.QuadShading.Start,
+        .ShadingFlags = shading_flag,
+    });
 }
 
 pub fn DrawText(
     self: *Renderer2D,
     engine_context: *EngineContext,
+    entity_id: Entity.Type,
     transform_component: *EntityTransformComponent,
     text_component: *TextComponent,
     entity_scene_comp: *EntitySceneComponent,
     shading_buff: *ShadingBuffers,
+    transform_changed: bool,
 ) !void {
-    const zone = Tracy.ZoneInit("R2D DrawQuad", @src());
+    const zone = Tracy.ZoneInit("R2D DrawText", @src());
     defer zone.Deinit();
 
+    const engine_allocator = engine_context.EngineAllocator();
     const text_asset = try text_component.mTextAssetHandle.GetAsset(engine_context, TextAsset);
     const atlas_asset = text_asset.mAtlas;
     const texture_asset = try text_component.mTexHandle.GetAsset(engine_context, Texture2D);
+    const text_textures = [2]u32{ texture_asset.GetTextureHandle(), atlas_asset.GetTextureHandle() };
     const scene_scene_comp = entity_scene_comp.mScene.GetComponent(SceneSceneComponent).?;
 
-    const texture_shading_handle = shading_buff.AddSurface(
-        engine_context.EngineAllocator(),
+    //the glyph slots still hold exactly this text, nothing to lay out, write or compare
+    if (self.mRenderables.getPtr(entity_id)) |renderable| {
+        if (renderable.Glyphs.Count != 0 and renderable.Pipeline == GetPipeline(scene_scene_comp.mLayerType) and
+            !transform_changed and !text_component.IsDirty() and std.mem.eql(u32, &renderable.TextTextures, &text_textures))
+        {
+            renderable.LastFrame = self._Frame;
+            self.SetShown(renderable, true);
+            return;
+        }
+    }
+    text_component.ClearDirty();
+    self.CountRepacked(engine_context);
+
+    const layout = try self.mTextLayouts.GetLayout(
+        engine_allocator,
+        text_component.mText.items,
+        text_component.mTextAssetHandle.mID,
+        text_asset,
+        text_component.mFontSize,
+        text_component.mBounds,
+    );
+    const glyph_count: u32 = @intCast(layout.Glyphs.len);
+    if (glyph_count == 0) return self.FreeText(engine_allocator, entity_id, shading_buff);
+
+    const renderable = try self.GetRenderable(engine_allocator, entity_id, scene_scene_comp.mLayerType, shading_buff);
+    self.SetShown(renderable, true);
+    const render_buffers = self.GetRenderBuffers(renderable.Pipeline);
+    if (renderable.Glyphs.Count != glyph_count) {
+        renderable.Glyphs = try render_buffers.mGlyphs.Resize(engine_allocator, renderable.Glyphs, glyph_count);
+        render_buffers._ItemsStale = true;
+    }
+    if (renderable.TextShadings.Count == 0) {
+        renderable.TextShadings = try shading_buff.AllocSurfaces(engine_allocator, 2);
+    }
+    renderable.TextTextures = text_textures;
+
+    const texture_shading_handle = renderable.TextShadings.Start;
+    shading_buff.WriteSurface(
+        texture_shading_handle,
         text_component.mTexOptions.mColor,
         text_component.mTexOptions.mTextureUV0,
         text_component.mTexOptions.mTextureUV1,
         text_component.mTexOptions.mTilingFactor,
-        texture_asset.GetTextureHandle(),
+        text_textures[0],
         std.math.maxInt(u32),
     );
 
@@ -264,80 +456,147 @@ pub fn DrawText(
     if (text_component.mMaterial.mOpaqueMode == .Transparent) texture_shading_flags |= EShadingFlags.SURFACE_TRANSPARENT.ToInt();
 
     const world_pos = transform_component.GetWorldPosition();
+    //the uvs of each glyph live on the glyph so every glyph can share this one
+    const atlas_shading_handle = texture_shading_handle + 1;
+    shading_buff.WriteSurface(
+        atlas_shading_handle,
+        Vec4(f32).FromScalar(1.0),
+        .{ .x = 0, .y = 0 },
+        .{ .x = 1, .y = 1 },
+        1.0,
+        text_textures[1],
+        texture_shading_handle,
+    );
 
-    const left_bounds = world_pos.x - text_component.mBounds.x;
-    const right_bounds = world_pos.x + text_component.mBounds.y;
-
-    var pen_x = left_bounds;
-    var pen_y = world_pos.y;
+    for (layout.Glyphs, 0..) |laid, i| {
+        const glyph_slot = renderable.Glyphs.Start + @as(u32, @intCast(i));
+        _ = render_buffers.mGlyphs.Write(glyph_slot, .{
+            .Position = world_pos.AddVec(laid.Offset).ToVector(),
+            .Rotation = transform_component.Rotation.ToVector(),
+            .HalfExtents = laid.HalfExtents.ToVector(),
+            .PlaneCenter = laid.PlaneCenter.ToVector(),
+            .AtlasUV0 = laid.AtlasUV0.ToVector(),
+            .AtlasUV1 = laid.AtlasUV1.ToVector(),
+            .AtlasShadingHandle = atlas_shading_handle,
+            .TextureShadingFlags = texture_shading_flags,
+        });
+    }
+}
 
-    for (text_component.mText.items, 0..) |char, i| {
-        const array_ind = TextAsset.ToArrayIndex(char);
-        const glyph = text_asset.mGlyphs[array_ind];
+/// For an entity that no longer has a quad component
+pub fn FreeQuad(self: *Renderer2D, engine_allocator: std.mem.Allocator, entity_id: Entity.Type, shading_buff: *ShadingBuffers) !void {
+    const renderable = self.mRenderables.getPtr(entity_id) orelse return;
+    if (renderable.Quad.Count == 0) return;
+    const render_buffers = self.GetRenderBuffers(renderable.Pipeline);
+    try render_buffers.mQuads.Free(engine_allocator, renderable.Quad);
+    try shading_buff.FreeSurfaces(engine_allocator, renderable.QuadShading);
+    render_buffers._ItemsStale = true;
+    renderable.Quad = .{};
+    renderable.QuadShading = .{};
+}
 
-        if (char == 32) { //if its space just continue on
-            pen_x += glyph.mAdvance * text_component.mFontSize;
-            continue;
-        }
+/// For an entity that no longer has a text component
+pub fn FreeText(self: *Renderer2D, engine_allocator: std.mem.Allocator, entity_id: Entity.Type, shading_buff: *ShadingBuffers) !void {
+    const renderable = self.mRenderables.getPtr(entity_id) orelse return;
+    if (renderable.Glyphs.Count == 0 and renderable.TextShadings.Count == 0) return;
+    const render_buffers = self.GetRenderBuffers(renderable.Pipeline);
+    try render_buffers.mGlyphs.Free(engine_allocator, renderable.Glyphs);
+    try shading_buff.FreeSurfaces(engine_allocator, renderable.TextShadings);
+    render_buffers._ItemsStale = true;
+    renderable.Glyphs = .{};
+    renderable.TextShadings = .{};
+}
 
-        const glyph_width = glyph.mAdvance;
+fn GetPipeline(layer_type: SceneSceneComponent.LayerType) PipelineType {
+    return switch (layer_type) {
+        .GameLayer => .GamePipeline,
+        .OverlayLayer => .OverlayPipeline,
+    };
+}
 
-        if (pen_x + glyph_width > right_bounds) {
-            pen_x = left_bounds;
-            pen_y -= (text_asset.mLineHeight * text_component.mFontSize);
-        }
+fn GetRenderable(self: *Renderer2D, engine_allocator: std.mem.Allocator, entity_id: Entity.Type, layer_type: SceneSceneComponent.LayerType, shading_buff: *ShadingBuffers) !*Renderable {
+    const pipeline = GetPipeline(layer_type);
 
-        const atlas_shading_handle = shading_buff.AddSurface(
-            engine_context.EngineAllocator(),
-            Vec4(f32).VectorT{ 1.0, 1.0, 1.0, 1.0 },
-            (glyph.mAtlasTexel0.ToVector() / text_asset.mAtlasSize.ToVector()),
-            (glyph.mAtlasTexel1.ToVector() / text_asset.mAtlasSize.ToVector()),
-            1.0,
-            atlas_asset.GetTextureHandle(),
-            texture_shading_handle,
-        );
-
-        const left = glyph.mPlaneMin.x;
-        const top = glyph.mPlaneMin.y;
-        const right = glyph.mPlaneMax.x;
-        const bottom = glyph.mPlaneMax.y;
-
-        const plane_size: Vec2(f32) = .{
-            .x = (right - left) * text_component.mFontSize,
-            .y = (top - bottom) * text_component.mFontSize,
-        };
+    const entry = try self.mRenderables.getOrPut(engine_allocator, entity_id);
+    if (!entry.found_existing or entry.value_ptr.Pipeline != pipeline) {
+        //moved to a scene on the other layer, its slots belong to the other buffers
+        if (entry.found_existing) try self.FreeRenderable(engine_allocator, entry.value_ptr.*, shading_buff);
+        entry.value_ptr.* = .{ .Pipeline = pipeline, .LastFrame = self._Frame };
+    }
+    entry.value_ptr.LastFrame = self._Frame;
+    return entry.value_ptr;
+}
 
-        const plane_center: Vec2(f32) = .{
-            .x = (left + right) * 0.5 * text_component.mFontSize,
-            .y = (top + bottom) * 0.5 * text_component.mFontSize,
-        };
+fn FreeRenderable(self: *Renderer2D, engine_allocator: std.mem.Allocator, renderable: Renderable, shading_buff: *ShadingBuffers) !void {
+    const render_buffers = self.GetRenderBuffers(renderable.Pipeline);
+    try render_buffers.mQuads.Free(engine_allocator, renderable.Quad);
+    try render_buffers.mGlyphs.Free(engine_allocator, renderable.Glyphs);
+    try shading_buff.FreeSurfaces(engine_allocator, renderable.QuadShading);
+    try shading_buff.FreeSurfaces(engine_allocator, renderable.TextShadings);
+    render_buffers._ItemsStale = true;
+}
 
-        switch (scene_scene_comp.mLayerType) {
-            .GameLayer => try self.mGameData.mGlyphBufferBase.append(engine_context.FrameAllocator(), .{
-                .Position = Vec3(f32).VectorT{ pen_x, pen_y, world_pos.z },
-                .Rotation = transform_component.Rotation.ToVector(),
-                .HalfExtents = Vec3(f32).VectorT{ plane_size.x * 0.5, plane_size.y * 0.5, THICKNESS_2D },
-                .PlaneCenter = Vec2(f32).VectorT{ plane_center.x, plane_center.y },
-                .AtlasShadingHandle = atlas_shading_handle,
-                .TextureShadingFlags = texture_shading_flags,
-            }),
-            .OverlayLayer => try self.mOverlayData.mGlyphBufferBase.append(engine_context.FrameAllocator(), .{
-                .Position = Vec3(f32).VectorT{ pen_x, pen_y, world_pos.z },
-                .Rotation = transform_component.Rotation.ToVector(),
-                .HalfExtents = Vec3(f32).VectorT{ plane_size.x * 0.5, plane_size.y * 0.5, THICKNESS_2D },
-                .PlaneCenter = Vec2(f32).VectorT{ plane_center.x, plane_center.y },
-                .AtlasShadingHandle = atlas_shading_handle, //
-                .TextureShadingFlags = texture_shading_flags,
-            }),
-        }
+fn SetShown(self: *Renderer2D, renderable: *Renderable, shown: bool) void {
+    if (renderable.Shown == shown) return;
+    renderable.Shown = shown;
+    self.GetRenderBuffers(renderable.Pipeline)._ItemsStale = true;
+}
 
-        var move_dist = glyph_width;
-        if (i < text_component.mText.items.len - 1) {
-            if (glyph.mKernings.get(text_component.mText.items[i + 1])) |kerning_advance| {
-                move_dist += kerning_advance;
-            }
-        }
+fn CountRepacked(self: *Renderer2D, engine_context: *EngineContext) void {
+    engine_context.mEngineStats.GetWorldStats(self._WorldType.?).mRenderStats.RepackedObjects += 1;
+}
 
-        pen_x += (move_dist) * text_component.mFontSize;
+/// Gathers the slots of the shown renderables of one pipeline, sorted so the tile lists keep slot order
+fn CollectShownItems(self: *Renderer2D, engine_allocator: std.mem.Allocator, pipeline_t: PipelineType) !void {
+    const render_buffers = self.GetRenderBuffers(pipeline_t);
+    const quad_count = render_buffers.mQuads.GetCount();
+    const items = &render_buffers._ShownItems;
+    items.clearRetainingCapacity();
+
+    var shown_quads: u32 = 0;
+    var iter = self.mRenderables.valueIterator();
+    while (iter.next()) |renderable| {
+        if (renderable.Pipeline != pipeline_t or !renderable.Shown) continue;
+        for (renderable.Quad.Start..renderable.Quad.End()) |slot| try items.append(engine_allocator, @intCast(slot));
+        for (renderable.Glyphs.Start..renderable.Glyphs.End()) |slot| try items.append(engine_allocator, quad_count + @as(u32, @intCast(slot)));
+        shown_quads += renderable.Quad.Count;
     }
+    std.mem.sort(u32, items.items, {}, std.sort.asc(u32));
+
+    render_buffers._ShownQuads = shown_quads;
+    render_buffers._ItemsStale = false;
+    render_buffers._BinsStale = true;
+}
+
+fn GetRenderBuffers(self: *Renderer2D, pipeline_t: PipelineType) *RenderBuffers {
+    return switch (pipeline_t) {
+        .GamePipeline => &self.mGameData,
+        .OverlayPipeline => &self.mOverlayData,
+    };
+}
+
+/// World bounds of the quad DrawQuad would pack for this transform
+pub fn GetQuadBounds(transform_component: *EntityTransformComponent) BVH.AABB {
+    const world_scale = transform_component.GetWorldScale();
+    return SDFObjectBVH.GetBoxBounds(
+        transform_component.GetWorldPosition(),
+        .{ .x = world_scale.x * 0.5, .y = world_scale.y * 0.5, .z = THICKNESS_2D },
+        transform_component.GetWorldRotation(),
+    );
+}
+
+/// Contains the world bounds of the glyphs DrawText would pack, null if the text has no visible glyphs.
+/// Lays the text out if it is not cached yet, so culled text keeps its layout too
+pub fn GetTextBounds(self: *Renderer2D, engine_context: *EngineContext, transform_component: *EntityTransformComponent, text_component: *TextComponent) !?BVH.AABB {
+    const text_asset = try text_component.mTextAssetHandle.GetAsset(engine_context, TextAsset);
+
+    const layout = try self.mTextLayouts.GetLayout(
+        engine_context.EngineAllocator(),
+        text_component.mText.items,
+        text_component.mTextAssetHandle.mID,
+        text_asset,
+        text_component.mFontSize,
+        text_component.mBounds,
+    );
+    return layout.GetBounds(transform_component.GetWorldPosition());
 }
@@ -0,0 +1,190 @@
+//! CPU side of a gpu buffer in which every renderable keeps the same slots from frame to frame.
+//!
+//! Renderables allocate a range of slots once and write their records into it when their transform or
+//! shape changed. A write only counts when the record actually changed, and the buffer tracks the one range
+//! that covers every changed slot so only that part has to be uploaded. Freed ranges are reused by
+//! later allocations, first fit.
+const std = @import("std");
+
+pub const Range = struct {
+    Start: u32 = 0,
+    Count: u32 = 0,
+
+    pub fn End(self: Range) u32 {
+        return self.Start + self.Count;
+    }
+};
+
+pub fn RetainedBuffer(comptime T: type) type {
+    return struct {
+        const Self = @This();
+
+        pub const empty: Self = .{
+            ._Items = .empty,
+            ._FreeRanges = .empty,
+            ._DirtyStart = 0,
+            ._DirtyEnd = 0,
+        };
+
+        _Items: std.ArrayList(T),
+        _FreeRanges: std.ArrayList(Range),
+        _DirtyStart: u32,
+        _DirtyEnd: u32,
+
+        pub fn Deinit(self: *Self, engine_allocator: std.mem.Allocator) void {
+            self._Items.deinit(engine_allocator);
+            self._FreeRanges.deinit(engine_allocator);
+        }
+
+        /// Drops every slot, for when the renderables they belonged to are gone all at once
+        pub fn Reset(self: *Self) void {
+            self._Items.clearRetainingCapacity();
+            self._FreeRanges.clearRetainingCapacity();
+            self._DirtyStart = 0;
+            self._DirtyEnd = 0;
+        }
+
+        /// count contiguous slots, their contents are undefined until written.
+        /// They start out dirty so whatever gets written is uploaded even if it matches the old bytes
+        pub fn Alloc(self: *Self, engine_allocator: std.mem.Allocator, count: u32) !Range {
+            if (count == 0) return .{};
+
+            const range = for (self._FreeRanges.items, 0..) |*free_range, i| {
+                if (free_range.Count < count) continue;
+                const found = Range{ .Start = free_range.Start, .Count = count };
+                free_range.Start += count;
+                free_range.Count -= count;
+                if (free_range.Count == 0) _ = self._FreeRanges.orderedRemove(i);
+                break found;
+            } else blk: {
+                const start: u32 = @intCast(self._Items.items.len);
+                try self._Items.resize(engine_allocator, start + count);
+                break :blk Range{ .Start = start, .Count = count };
+            };
+
+            self.MarkDirty(range);
+            return range;
+        }
+
+        pub fn Free(self: *Self, engine_allocator: std.mem.Allocator, range: Range) !void {
+            if (range.Count == 0) return;
+
+            //kept sorted by start so neighbours can be merged
+            var index: usize = 0;
+            while (index < self._FreeRanges.items.len and self._FreeRanges.items[index].Start < range.Start) index += 1;
+            try self._FreeRanges.insert(engine_allocator, index, range);
+
+            if (index + 1 < self._FreeRanges.items.len and self._FreeRanges.items[index].End() == self._FreeRanges.items[index + 1].Start) {
+                self._FreeRanges.items[index].Count += self._FreeRanges.items[index + 1].Count;
+                _ = self._FreeRanges.orderedRemove(index + 1);
+            }
+            if (index > 0 and self._FreeRanges.items[index - 1].End() == self._FreeRanges.items[index].Start) {
+                self._FreeRanges.items[index - 1].Count += self._FreeRanges.items[index].Count;
+                _ = self._FreeRanges.orderedRemove(index);
+            }
+        }
+
+        /// Keeps range if count fits in it, otherwise moves to a new range
+        pub fn Resize(self: *Self, engine_allocator: std.mem.Allocator, range: Range, count: u32) !Range {
+            if (count <= range.Count) {
+                try self.Free(engine_allocator, .{ .Start = range.Start + count, .Count = range.Count - count });
+                return .{ .Start = if (count == 0) 0 else range.Start, .Count = count };
+            }
+            try self.Free(engine_allocator, range);
+            return self.Alloc(engine_allocator, count);
+        }
+
+        /// Stores value in slot, false if the slot already held it and nothing needs to be uploaded
+        pub fn Write(self: *Self, slot: u32, value: T) bool {
+            if (std.meta.eql(self._Items.items[slot], value)) return false;
+            self._Items.items[slot] = value;
+            self.MarkDirty(.{ .Start = slot, .Count = 1 });
+            return true;
+        }
+
+        pub fn MarkDirty(self: *Self, range: Range) void {
+            if (range.Count == 0) return;
+            if (self._DirtyStart >= self._DirtyEnd) {
+                self._DirtyStart = range.Start;
+                self._DirtyEnd = range.End();
+            } else {
+                self._DirtyStart = @min(self._DirtyStart, range.Start);
+                self._DirtyEnd = @max(self._DirtyEnd, range.End());
+            }
+        }
+
+        /// Everything written since the last ClearDirty, null if nothing changed
+        pub fn GetDirtyRange(self: Self) ?Range {
+            if (self._DirtyStart >= self._DirtyEnd) return null;
+            return .{ .Start = self._DirtyStart, .Count = self._DirtyEnd - self._DirtyStart };
+        }
+
+        pub fn ClearDirty(self: *Self) void {
+            self._DirtyStart = 0;
+            self._DirtyEnd = 0;
+        }
+
+        pub fn Get(self: Self, slot: u32) T {
+            return self._Items.items[slot];
+        }
+
+        /// Every slot up to the highest one ever allocated, free slots included
+        pub fn GetItems(self: Self) []const T {
+            return self._Items.items;
+        }
+
+        pub fn GetCount(self: Self) u32 {
+            return @intCast(self._Items.items.len);
+        }
+    };
+}
+
+test "Retained buffer only reports changed slots as dirty" {
+    const allocator = std.testing.allocator;
+    var buffer: RetainedBuffer(u64) = .empty;
+    defer buffer.Deinit(allocator);
+
+    const a = try buffer.Alloc(allocator, 4);
+    const b = try buffer.Alloc(allocator, 4);
+    for (0..4) |i| {
+        _ = buffer.Write(a.Start + @as(u32, @intCast(i)), i);
+        _ = buffer.Write(b.Start + @as(u32, @intCast(i)), 10 + i);
+    }
+    try std.testing.expectEqual(Range{ .Start = 0, .Count = 8 }, buffer.GetDirtyRange().?);
+    buffer.ClearDirty();
+
+    //the same values again are free
+    for (0..4) |i| try std.testing.expect(!buffer.Write(b.Start + @as(u32, @intCast(i)), 10 + i));
+    try std.testing.expect(buffer.GetDirtyRange() == null);
+
+    try std.testing.expect(buffer.Write(b.Start + 1, 99));
+    try std.testing.expect(buffer.Write(b.Start + 2, 98));
+    try std.testing.expectEqual(Range{ .Start = 5, .Count = 2 }, buffer.GetDirtyRange().?);
+}
+
+test "Retained buffer reuses and merges freed ranges" {
+    const allocator = std.testing.allocator;
+    var buffer: RetainedBuffer(u32) = .empty;
+    defer buffer.Deinit(allocator);
+
+    const a = try buffer.Alloc(allocator, 3);
+    const b = try buffer.Alloc(allocator, 2);
+    const c = try buffer.Alloc(allocator, 3);
+    try std.testing.expectEqual(@as(u32, 8), buffer.GetCount());
+
+    try buffer.Free(allocator, a);
+    try buffer.Free(allocator, b);
+    //a and b merged, so 5 fit without growing
+    const d = try buffer.Alloc(allocator, 5);
+    try std.testing.expectEqual(@as(u32, 0), d.Start);
+    try std.testing.expectEqual(@as(u32, 8), buffer.GetCount());
+
+    //shrinking in place hands the tail back, growing moves
+    const d_small = try buffer.Resize(allocator, d, 2);
+    try std.testing.expectEqual(@as(u32, 0), d_small.Start);
+    const e = try buffer.Alloc(allocator, 3);
+    try std.testing.expectEqual(@as(u32, 2), e.Start);
+    const c_big = try buffer.Resize(allocator, c, 4);
+    try std.testing.expectEqual(@as(u32, 8), c_big.Start);
+    try std.testing.expectEqual(@as(u32, 12), buffer.GetCount());
+}
@@ -0,0 +1,116 @@
+//! Bounding volume hierarchy over the quads and glyphs of one pipeline pass.
+//!
+//! The renderer rebuilds it from the object buffers whenever the objects drawn change and uploads the flat
+//! node and item arrays next to them. Items are indices into the quads followed by the glyphs,
+//! so item i is quad i when i is less than the quad count and glyph i - quad count otherwise.
+//! The ray marcher walks it to find the nearest surface instead of evaluating every object.
+const std = @import("std");
+const BVH = @import("../Physics/BVH.zig");
+const AABB = BVH.AABB;
+const QuadData = @import("Renderer2D.zig").QuadData;
+const GlyphData = @import("Renderer2D.zig").GlyphData;
+
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Quat = MathTypes.Quat;
+
+pub const Node = BVH.Node;
+
+/// World bounds of a box of half_extents centered at center and rotated by rotation
+pub fn GetBoxBounds(center: Vec3(f32), half_extents: Vec3(f32), rotation: Quat(f32)) AABB {
+    const axis_x = (Vec3(f32){ .x = half_extents.x, .y = 0, .z = 0 }).QuatRotate(rotation).Abs();
+    const axis_y = (Vec3(f32){ .x = 0, .y = half_extents.y, .z = 0 }).QuatRotate(rotation).Abs();
+    const axis_z = (Vec3(f32){ .x = 0, .y = 0, .z = half_extents.z }).QuatRotate(rotation).Abs();
+    return AABB.FromCenter(center, axis_x.AddVec(axis_y).AddVec(axis_z));
+}
+
+pub fn GetQuadBounds(quad: QuadData) AABB {
+    return GetBoxBounds(.FromVector(quad.Position), .FromVector(quad.HalfExtents), .FromVector(quad.Rotation));
+}
+
+pub fn GetGlyphBounds(glyph: GlyphData) AABB {
+    const rotation = Quat(f32).FromVector(glyph.Rotation);
+    //the glyph box sits at the plane center in the local space of the glyph
+    const plane_offset = (Vec3(f32){ .x = glyph.PlaneCenter[0], .y = glyph.PlaneCenter[1], .z = 0 }).QuatRotate(rotation);
+    return GetBoxBounds(Vec3(f32).FromVector(glyph.Position).AddVec(plane_offset), .FromVector(glyph.HalfExtents), rotation);
+}
+
+/// Rebuilds bvh over quads followed by glyphs
+pub fn Build(bvh: *BVH, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, quads: []const QuadData, glyphs: []const GlyphData) !void {
+    const bounds = try frame_allocator.alloc(AABB, quads.len + glyphs.len);
+    defer frame_allocator.free(bounds);
+
+    for (quads, bounds[0..quads.len]) |quad, *b| b.* = GetQuadBounds(quad);
+    for (glyphs, bounds[quads.len..]) |glyph, *b| b.* = GetGlyphBounds(glyph);
+
+    try bvh.Build(engine_allocator, bounds);
+}
+
+/// Rebuilds bvh over only the objects in subset, items indexing the quads followed by the glyphs.
+/// items_out gets the leaf items mapped back to those indices, bvh.GetItems() holds positions in subset
+pub fn BuildSubset(bvh: *BVH, items_out: *std.ArrayList(u32), engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, quads: []const QuadData, glyphs: []const GlyphData, subset: []const u32) !void {
+    const bounds = try frame_allocator.alloc(AABB, subset.len);
+    defer frame_allocator.free(bounds);
+
+    for (subset, bounds) |item, *b| {
+        b.* = if (item < quads.len) GetQuadBounds(quads[item]) else GetGlyphBounds(glyphs[item - quads.len]);
+    }
+
+    try bvh.Build(engine_allocator, bounds);
+
+    try items_out.resize(engine_allocator, subset.len);
+    for (bvh.GetItems(), items_out.items) |local_item, *item| item.* = subset[local_item];
+}
+
+test "Object bounds contain the SDF surface" {
+    const SDFFunc = @import("../Math/SDFFunctions.zig");
+
+    const rotation = (Vec3(f32){ .x = 20, .y = 35, .z = -50 }).DegreesToQuat();
+    const glyph = GlyphData{
+        .Rotation = rotation.ToVector(),
+        .Position = .{ 1, 2, 3 },
+        .HalfExtents = .{ 0.2, 0.4, SDFFunc.THICKNESS_2D },
+        .PlaneCenter = .{ 0.5, -0.3 },
+        .AtlasUV0 = .{ 0, 0 },
+        .AtlasUV1 = .{ 1, 1 },
+        .AtlasShadingHandle = 0,
+        .TextureShadingFlags = 0,
+    };
+    const bounds = GetGlyphBounds(glyph);
+
+    //the box distance never overestimates the SDF, which is what lets the marcher skip nodes with it
+    var prng = std.Random.DefaultPrng.init(3);
+    const random = prng.random();
+    for (0..200) |_| {
+        const point = Vec3(f32){ .x = random.float(f32) * 4 - 1, .y = random.float(f32) * 4, .z = random.float(f32) * 4 + 1 };
+        try std.testing.expect(bounds.Distance(point) <= SDFFunc.sdIMGlyph(point, glyph) + 0.0001);
+    }
+}
+
+test "Subset tree only references the subset" {
+    const allocator = std.testing.allocator;
+    var quads: [6]QuadData = undefined;
+    for (&quads, 0..) |*quad, i| quad.* = .{
+        .Rotation = .{ 0, 0, 0, 1 },
+        .Position = .{ @floatFromInt(i * 2), 0, 0 },
+        .HalfExtents = .{ 0.5, 0.5, 0.01 },
+        .ShadingHandle = 0,
+        .ShadingFlags = 0,
+    };
+
+    var bvh: BVH = .empty;
+    defer bvh.Deinit(allocator);
+    var items: std.ArrayList(u32) = .empty;
+    defer items.deinit(allocator);
+
+    const subset = [_]u32{ 5, 1, 3 };
+    try BuildSubset(&bvh, &items, allocator, allocator, &quads, &.{}, &subset);
+
+    const sorted = try allocator.dupe(u32, items.items);
+    defer allocator.free(sorted);
+    std.mem.sort(u32, sorted, {}, std.sort.asc(u32));
+    try std.testing.expectEqualSlices(u32, &.{ 1, 3, 5 }, sorted);
+    //quad 0 at the origin is left out of the root bounds
+    const root_bounds = bvh.GetNodes()[0].Bounds;
+    try std.testing.expect(root_bounds.Min.x > 1 and root_bounds.Max.x >= 10.4);
+}
@@ -1,7 +1,9 @@
 const std = @import("std");
 const QuadData = @import("Renderer2D.zig").QuadData;
 const GlyphData = @import("Renderer2D.zig").GlyphData;
-const ShadingData = @import("Renderer.zig").ShadingData;
+const SurfShadingData = @import("Renderer.zig").SurfShadingData;
+const MedShadingData = @import("Renderer.zig").MedShadingData;
+const EShadingFlags = @import("Renderer.zig").EShadingFlags;
 
 const MathTypes = @import("../Math/MathTypes.zig");
 const Ray = MathTypes.Ray;
@@ -18,6 +20,8 @@ const THICKNESS_2D = SDFFunc.THICKNESS_2D;
 
 const Stack = @import("../Core/Stack.zig").Stack;
 
+const BVH = @import("../Physics/BVH.zig");
+
 const MAX_STEPS: u32 = 9999;
 const SURF_DIST: f32 = 0.00099;
 pub const MAX_NODES: u32 = 9;
@@ -83,6 +87,11 @@ const MarchData = extern struct {
     object: ObjectData,
 };
 
+const RaySegment = struct {
+    InvDir: Vec3(f32),
+    Length: f32,
+};
+
 const Self = @This();
 
 mNodes: NodeArr,
@@ -91,14 +100,18 @@ mNodeCount: usize,
 mEdgeCount: usize,
 mDefaultColor: Vec4(f32),
 
-pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype, perspective_far: f32, texturess_array: anytype, sample_sampler: anytype) void {
-    var edge_ind_stack: Stack(usize, MAX_EDGES) = undefined;
+/// nodes and items are the SDFObjectBVH over quads then glyphs. With no nodes, items is a flat list of
+/// the objects to check, like an SDFTileBins tile, and with no items either every object is checked.
+/// A flat list can also be a struct with len and At(i), for a window into a larger buffer
+pub fn March(self: *Self, quads: anytype, glyphs: anytype, nodes: anytype, items: anytype, surf_shading: anytype, perspective_far: f32, textures_array: anytype, sample_sampler: anytype) void {
+    var edge_ind_stack: Stack(usize, MAX_EDGES) = .{};
     edge_ind_stack.Push(0);
 
     while (edge_ind_stack.len > 0) {
         const curr_edge_ind = edge_ind_stack.Pop();
         const curr_edge = self.mEdges[curr_edge_ind];
         const from_point = self.mNodes[@intCast(curr_edge.FromNode)].Point;
+        const inv_dir = Vec3(f32).FromVector(@as(Vec3(f32).VectorT, @splat(1.0)) / curr_edge.Direction.ToVector());
 
         var i: u32 = 0;
         var march_data: MarchData = .{ .min_dist = std.math.floatMax(f32), .object = .{ .shape_type = .None, .shape_ind = 0 } };
@@ -107,7 +120,7 @@ pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype
         while (i < MAX_STEPS and dist_origin < perspective_far and march_data.min_dist > SURF_DIST) : (i += 1) {
             march_data = MarchData{ .min_dist = std.math.floatMax(f32), .object = .{ .shape_type = .None, .shape_ind = 0 } };
             const point = from_point.AddVec(curr_edge.Direction.MulScalar(dist_origin));
-            march_data = NextSurface(point, quads, glyphs);
+            march_data = NextSurface(point, .{ .InvDir = inv_dir, .Length = perspective_far - dist_origin }, quads, glyphs, nodes, items);
             dist_origin += march_data.min_dist;
         }
         //once we are herer we either a) hit max steps, b) hit our max distance, c) hit a surface
@@ -125,7 +138,7 @@ pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype
                 .FirstEdge = NO_EDGE,
                 .MaterialHandle = 0,
                 .AccumColor = self.mDefaultColor,
-                .TextureUV = .{ .x = 0, .y = 0 },
+                .TextureUV = .{ .x = -1, .y = -1, .z = -1 },
                 .ShapeT = .None,
             };
             self.mEdges[curr_edge_ind].ToNode = @intCast(miss_node_ind);
@@ -133,7 +146,7 @@ pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype
         }
 
         //calculate the normal
-        const hit_normal = CalcNormal(end_point, quads, glyphs);
+        const hit_normal = CalcNormal(end_point, quads, glyphs, nodes, items);
 
         const shading_handle = march_data.object.GetShadingHandle(quads, glyphs);
 
@@ -142,19 +155,21 @@ pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype
             .Quad => blk: {
                 //calculate the UV based off the texture_handle
                 const quad: QuadData = quads[march_data.object.shape_ind];
-                const texture_shading_data: ShadingData = shading_data[quad.ShadingHandle];
+                const texture_shading_data: SurfShadingData = surf_shading[quad.ShadingHandle];
                 break :blk SDFFunc.uvIMQuad(end_point, quad, texture_shading_data.Texturehandle);
             },
             .Glyph => blk: {
                 const glyph: GlyphData = glyphs[march_data.object.shape_ind];
                 const atlas_shading_handle = glyph.AtlasShadingHandle;
-                const atlas_shading_data: ShadingData = shading_data[atlas_shading_handle];
+                const atlas_shading_data: SurfShadingData = surf_shading[atlas_shading_handle];
                 const texture_shading_handle = atlas_shading_data.SiblingShading;
 
-                const uv = SDFFunc.uvIMGlyph(end_point, glyph, texture_shading_handle);
+                const texture_shading_data: SurfShadingData = surf_shading[texture_shading_handle];
+
+                const uv = SDFFunc.uvIMGlyph(end_point, glyph, texture_shading_data.Texturehandle);
 
                 if (uv.x >= 0.0 and uv.y >= 0.0) {
-                    const msd = SDFFunc.GetMSD(.{ .x = uv.x, .y = uv.y }, atlas_shading_data, texturess_array, sample_sampler);
+                    const msd = SDFFunc.GetMSD(.{ .x = uv.x, .y = uv.y }, glyph, atlas_shading_data, textures_array, sample_sampler);
                     if (msd >= 0.5) {
                         break :blk uv;
                     } else {
@@ -186,14 +201,14 @@ pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype
         const shading_flags = march_data.object.GetShadingFlags(quads, glyphs);
 
         //if transparent bit is set, aka it can be some level of transparent and we are not already full of edges
-        if (shading_flags & ShadingData.SHADING_FLAG_TRANSPARENT != 0 and !edge_ind_stack.IsFull()) {
+        if (shading_flags & EShadingFlags.SURFACE_TRANSPARENT.ToInt() != 0 and !edge_ind_stack.IsFull() and self.mEdgeCount < MAX_EDGES) {
             const new_node = self.mNodes[new_node_ind];
             const material_handle = new_node.MaterialHandle;
-            const material: ShadingData = shading_data[material_handle];
+            const material: SurfShadingData = surf_shading[material_handle];
 
-            const texture_color = SampleTexture(new_node.TextureUV);
+            const texture_color = SampleTexture(new_node.TextureUV, textures_array, sample_sampler);
             const material_color = Vec4(f32).FromVector(material.Color);
-            const color = material_color.Mul(.FromVector(texture_color)); // tint
+            const color = material_color.MulVec(.FromVector(texture_color)); // tint
             const alpha = color.w;
             if (alpha < 1.0) {
                 const new_edge_ind = self.GetEdgeIndex();
@@ -215,7 +230,7 @@ pub fn March(self: *Self, quads: anytype, glyphs: anytype, shading_data: anytype
     }
 }
 
-pub fn GenerateColor(self: *Self, materials: anytype, textures_array: anytype, sample_sampler: anytype) Vec4(f32).VectorT {
+pub fn GenerateColor(self: *Self, surf_shading: anytype, med_shading: anytype, textures_array: anytype, sample_sampler: anytype) Vec4(f32) {
     var i: usize = self.mNodeCount;
     while (i > 0) {
         i -= 1;
@@ -223,13 +238,13 @@ pub fn GenerateColor(self: *Self, materials: anytype, textures_array: anytype, s
 
         var ei: u32 = node.FirstEdge;
         while (ei != NO_EDGE) {
-            self.CalcEdgeColor(materials, ei);
+            self.CalcEdgeColor(med_shading, ei);
             ei = self.mEdges[@intCast(ei)].SiblingEdge;
         }
-        self.CalcNodeColor(materials, i, textures_array, sample_sampler);
+        self.CalcNodeColor(surf_shading, @intCast(i), textures_array, sample_sampler);
     }
 
-    return self.mNodes[0].AccumColor.ToVector();
+    return self.mNodes[0].AccumColor;
 }
 
 fn GetNodeIndex(self: *Self) usize {
@@ -242,29 +257,79 @@ fn GetEdgeIndex(self: *Self) usize {
     return self.mEdgeCount;
 }
 
-fn NextSurface(point: Vec3(f32), quads: anytype, glyphs: anytype) MarchData {
+/// Closest surface to point. When ray is given, objects whose bounds the ray does not pass through
+/// within its length are skipped. They can not be the next thing the ray hits, so leaving them out
+/// still gives a step that never goes through a surface
+fn NextSurface(point: Vec3(f32), ray: ?RaySegment, quads: anytype, glyphs: anytype, nodes: anytype, items: anytype) MarchData {
     var data = MarchData{ .min_dist = std.math.floatMax(f32), .object = .{ .shape_type = .None, .shape_ind = 0 } };
 
-    for (quads, 0..) |quad, i| {
-        const dist = SDFFunc.sdIMQuad(point, quad);
+    //without a tree items is a flat candidate list, like the list of a screen tile, or every object when it is empty too
+    if (nodes.len == 0) {
+        if (items.len != 0) {
+            for (0..items.len) |i| CheckObject(&data, point, quads, glyphs, ItemAt(items, i));
+        } else {
+            for (0..quads.len) |i| CheckObject(&data, point, quads, glyphs, @intCast(i));
+            for (0..glyphs.len) |i| CheckObject(&data, point, quads, glyphs, @intCast(quads.len + i));
+        }
+        return data;
+    }
+
+    var stack: [BVH.MAX_DEPTH]u32 = undefined;
+    var stack_len: usize = 1;
+    stack[0] = 0;
+
+    while (stack_len > 0) {
+        stack_len -= 1;
+        const node: BVH.Node = nodes[stack[stack_len]];
+
+        //nothing in the node can be closer than what we already have
+        if (node.Bounds.Distance(point) >= data.min_dist) continue;
+        if (ray) |r| {
+            if (node.Bounds.RayEnter(point, r.InvDir, r.Length) == null) continue;
+        }
+
+        if (node.IsLeaf()) {
+            for (node.First..node.First + node.Count) |i| CheckObject(&data, point, quads, glyphs, items[i]);
+        } else {
+            //nearer child goes on top so the closest distance shrinks sooner
+            const left_dist = nodes[node.First].Bounds.Distance(point);
+            const right_dist = nodes[node.First + 1].Bounds.Distance(point);
+            const near: u32 = if (left_dist <= right_dist) node.First else node.First + 1;
+            const far: u32 = if (near == node.First) node.First + 1 else node.First;
+            stack[stack_len] = far;
+            stack[stack_len + 1] = near;
+            stack_len += 2;
+        }
+    }
+    return data;
+}
+
+/// item indexes the quads followed by the glyphs
+fn CheckObject(data: *MarchData, point: Vec3(f32), quads: anytype, glyphs: anytype, item: u32) void {
+    if (item < quads.len) {
+        const dist = SDFFunc.sdIMQuad(point, quads[item]);
         if (dist < data.min_dist) {
             data.min_dist = dist;
             data.object.shape_type = .Quad;
-            data.object.shape_ind = @intCast(i);
+            data.object.shape_ind = item;
         }
-    }
-    for (glyphs, 0..) |glyph, i| {
-        const dist = SDFFunc.sdIMGlyph(point, glyph);
+    } else {
+        const glyph_ind = item - quads.len;
+        const dist = SDFFunc.sdIMGlyph(point, glyphs[glyph_ind]);
         if (dist < data.min_dist) {
             data.min_dist = dist;
             data.object.shape_type = .Glyph;
-            data.object.shape_ind = @intCast(i);
+            data.object.shape_ind = glyph_ind;
         }
     }
-    return data;
 }
 
-fn CalcNormal(point: Vec3(f32), quads: anytype, glyphs: anytype) Vec3(f32) {
+/// items[i] of a flat list. Shaders cannot slice a storage buffer, so a window into one is a struct with At
+fn ItemAt(items: anytype, i: usize) u32 {
+    return if (@typeInfo(@TypeOf(items)) == .@"struct") items.At(i) else items[i];
+}
+
+fn CalcNormal(point: Vec3(f32), quads: anytype, glyphs: anytype, nodes: anytype, items: anytype) Vec3(f32) {
     const e: f32 = 0.001;
 
     const x = Vec3(f32){ .x = e, .y = 0, .z = 0 };
@@ -274,12 +339,12 @@ fn CalcNormal(point: Vec3(f32), quads: anytype, glyphs: anytype) Vec3(f32) {
     const z = Vec3(f32){ .x = 0, .y = 0, .z = e };
     const neg_z = Vec3(f32){ .x = 0, .y = 0, .z = -e };
 
-    const next_surf_x = NextSurface(point.AddVec(x), quads, glyphs);
-    const next_surf_neg_x = NextSurface(point.AddVec(neg_x), quads, glyphs);
-    const next_surf_y = NextSurface(point.AddVec(y), quads, glyphs);
-    const next_surf_neg_y = NextSurface(point.AddVec(neg_y), quads, glyphs);
-    const next_surf_z = NextSurface(point.AddVec(z), quads, glyphs);
-    const next_surf_neg_z = NextSurface(point.AddVec(neg_z), quads, glyphs);
+    const next_surf_x = NextSurface(point.AddVec(x), null, quads, glyphs, nodes, items);
+    const next_surf_neg_x = NextSurface(point.AddVec(neg_x), null, quads, glyphs, nodes, items);
+    const next_surf_y = NextSurface(point.AddVec(y), null, quads, glyphs, nodes, items);
+    const next_surf_neg_y = NextSurface(point.AddVec(neg_y), null, quads, glyphs, nodes, items);
+    const next_surf_z = NextSurface(point.AddVec(z), null, quads, glyphs, nodes, items);
+    const next_surf_neg_z = NextSurface(point.AddVec(neg_z), null, quads, glyphs, nodes, items);
 
     const dx = next_surf_x.min_dist - next_surf_neg_x.min_dist;
     const dy = next_surf_y.min_dist - next_surf_neg_y.min_dist;
@@ -290,28 +355,33 @@ fn CalcNormal(point: Vec3(f32), quads: anytype, glyphs: anytype) Vec3(f32) {
     return vec.Dir();
 }
 
-fn CalcNodeColor(self: *Self, materials: anytype, node_ind: u32, texture_array: anytype, sample_sampler: anytype) void {
+fn CalcNodeColor(self: *Self, surf_shading: anytype, node_ind: u32, texture_array: anytype, sample_sampler: anytype) void {
     const curr_node = self.mNodes[node_ind];
 
     const child_accum = if (curr_node.FirstEdge == NO_EDGE) self.mDefaultColor else self.mEdges[@intCast(curr_node.FirstEdge)].AccumColor;
 
-    const material: ShadingData = materials[curr_node.MaterialHandle];
+    //the ray origin and misses have no surface, they just pass on what is behind them
+    if (curr_node.ShapeT == .None) {
+        self.mNodes[node_ind].AccumColor = child_accum;
+        return;
+    }
+
+    const material: SurfShadingData = surf_shading[curr_node.MaterialHandle];
     const texture_color = SampleTexture(curr_node.TextureUV, texture_array, sample_sampler);
     const material_color = Vec4(f32).FromVector(material.Color);
-    const color = material_color.Mul(texture_color); // tint
+    const color = material_color.MulVec(.FromVector(texture_color)); // tint
     const alpha = color.w;
 
     self.mNodes[node_ind].AccumColor = color.Lerp(child_accum, 1.0 - alpha);
 }
 
-fn CalcEdgeColor(self: *Self, materials: anytype, edge_ind: u32) void {
+fn CalcEdgeColor(self: *Self, med_shading: anytype, edge_ind: u32) void {
     const curr_edge = self.mEdges[edge_ind];
     const to_node = self.mNodes[curr_edge.ToNode];
-    const from_node = self.mNodes[curr_edge.FromNode];
 
     const child_accum = to_node.AccumColor;
 
-    const material: ShadingData = materials[from_node.MaterialHandle];
+    const material: MedShadingData = med_shading[curr_edge.MaterialHandle];
 
     // Beer-Lambert for absorbtion  over edge length
     const extinction = material.Absorption + material.Scattering;
@@ -319,7 +389,7 @@ fn CalcEdgeColor(self: *Self, materials: anytype, edge_ind: u32) void {
 
     //scattering
     const ONE = Vec3(f32){ .x = 1, .y = 1, .z = 1 };
-    const scatter_amount = ONE.SubVec(.FromVector(-material.Scattering * curr_edge.Length).Exp());
+    const scatter_amount = ONE.SubVec(Vec3(f32).FromVector(-material.Scattering * @as(Vec3(f32).VectorT, @splat(curr_edge.Length))).Exp());
 
     const transmitted = transmittance.MulVec(.{ .x = child_accum.x, .y = child_accum.y, .z = child_accum.z });
     const inscattered = scatter_amount.MulVec(SKY_COLOR);
@@ -330,7 +400,7 @@ fn CalcEdgeColor(self: *Self, materials: anytype, edge_ind: u32) void {
 }
 
 fn SampleTexture(texture_uv: Vec3(f32), texture_array: anytype, sample_sampler: anytype) Vec4(f32).VectorT {
-    if (texture_uv.x < 0 or texture_uv.y < 0 or texture_uv.z < 0) return Vec4(f32){ .x = 0.0, .y = 0.0, .z = 0.0, .w = 0.0 };
+    if (texture_uv.x < 0 or texture_uv.y < 0 or texture_uv.z < 0) return Vec4(f32).VectorT{ 0.0, 0.0, 0.0, 0.0 };
 
     return sample_sampler(texture_array, texture_uv);
 }
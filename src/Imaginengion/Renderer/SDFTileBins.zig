@@ -0,0 +1,229 @@
+//! Screen space binning of the quads and glyphs of one pass into 8x8 pixel tiles.
+//!
+//! The bounds of every object are projected with the same camera the rays are generated from,
+//! and the object is added to the list of every tile its projection touches. The lists are kept
+//! in one item array with an offset per tile. A ray can only hit an object whose projection
+//! covers its pixel, so the marcher of a tile only needs to look at that tile's list, and tiles
+//! with an empty list do not need to be marched at all. The compute shaders read the same offsets
+//! and items from storage buffers, the CPU marcher reads them from here.
+//! Items use the same encoding as SDFObjectBVH: quads first, then glyphs.
+const std = @import("std");
+const BVH = @import("../Physics/BVH.zig");
+const AABB = BVH.AABB;
+const SDFObjectBVH = @import("SDFObjectBVH.zig");
+const PushConstants = @import("RenderPipeline.zig").SDFPushConstants;
+const QuadData = @import("Renderer2D.zig").QuadData;
+const GlyphData = @import("Renderer2D.zig").GlyphData;
+
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec2 = MathTypes.Vec2;
+const Vec3 = MathTypes.Vec3;
+const Quat = MathTypes.Quat;
+
+const SDFTileBins = @This();
+
+/// Same as the workgroup size of the compute shaders
+pub const TILE_SIZE: u32 = 8;
+
+//rays that pass closer than the marcher surface distance count as hits, so bounds are grown by a bit more
+const HIT_MARGIN: f32 = 0.001;
+
+/// Inclusive range of tiles
+pub const TileRect = struct {
+    MinX: u32,
+    MinY: u32,
+    MaxX: u32,
+    MaxY: u32,
+};
+
+pub const empty: SDFTileBins = .{
+    .mTilesX = 0,
+    .mTilesY = 0,
+    ._Offsets = .empty,
+    ._Items = .empty,
+};
+
+mTilesX: u32,
+mTilesY: u32,
+
+//items of tile t are _Items[_Offsets[t].._Offsets[t + 1]]
+_Offsets: std.ArrayList(u32),
+_Items: std.ArrayList(u32),
+
+pub fn Deinit(self: *SDFTileBins, engine_allocator: std.mem.Allocator) void {
+    self._Offsets.deinit(engine_allocator);
+    self._Items.deinit(engine_allocator);
+}
+
+/// Rebuilds the tile lists of a width x height target. Capacity is kept between builds
+pub fn Build(self: *SDFTileBins, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, camera: PushConstants, width: u32, height: u32, quads: []const QuadData, glyphs: []const GlyphData) !void {
+    return self.BuildSubset(engine_allocator, frame_allocator, camera, width, height, quads, glyphs, null);
+}
+
+/// Same as Build but only bins the objects in subset, items indexing the quads followed by the glyphs.
+/// Lets slots that are free or culled this frame stay out of every tile
+pub fn BuildSubset(self: *SDFTileBins, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator, camera: PushConstants, width: u32, height: u32, quads: []const QuadData, glyphs: []const GlyphData, subset: ?[]const u32) !void {
+    self.mTilesX = std.math.divCeil(u32, width, TILE_SIZE) catch unreachable;
+    self.mTilesY = std.math.divCeil(u32, height, TILE_SIZE) catch unreachable;
+    const tile_count = @as(usize, self.mTilesX) * self.mTilesY;
+
+    const object_count = if (subset) |items| items.len else quads.len + glyphs.len;
+    const rects = try frame_allocator.alloc(?TileRect, object_count);
+    defer frame_allocator.free(rects);
+    for (rects, 0..) |*rect, i| {
+        const item = if (subset) |items| items[i] else i;
+        const bounds = if (item < quads.len) SDFObjectBVH.GetQuadBounds(quads[item]) else SDFObjectBVH.GetGlyphBounds(glyphs[item - quads.len]);
+        rect.* = ProjectBounds(camera, width, height, bounds);
+    }
+
+    //count, prefix sum, then fill so every list stays in object order
+    try self._Offsets.resize(engine_allocator, tile_count + 1);
+    @memset(self._Offsets.items, 0);
+    for (rects) |maybe_rect| {
+        const rect = maybe_rect orelse continue;
+        for (rect.MinY..rect.MaxY + 1) |y| {
+            for (rect.MinX..rect.MaxX + 1) |x| self._Offsets.items[y * self.mTilesX + x + 1] += 1;
+        }
+    }
+    for (1..tile_count + 1) |t| self._Offsets.items[t] += self._Offsets.items[t - 1];
+
+    try self._Items.resize(engine_allocator, self._Offsets.items[tile_count]);
+    const cursors = try frame_allocator.dupe(u32, self._Offsets.items[0..tile_count]);
+    defer frame_allocator.free(cursors);
+    for (rects, 0..) |maybe_rect, i| {
+        const rect = maybe_rect orelse continue;
+        const item: u32 = if (subset) |items| items[i] else @intCast(i);
+        for (rect.MinY..rect.MaxY + 1) |y| {
+            for (rect.MinX..rect.MaxX + 1) |x| {
+                const tile = y * self.mTilesX + x;
+                self._Items.items[cursors[tile]] = item;
+                cursors[tile] += 1;
+            }
+        }
+    }
+}
+
+/// Objects whose projection touches the tile
+pub fn GetTile(self: SDFTileBins, tile_x: u32, tile_y: u32) []const u32 {
+    const tile = @as(usize, tile_y) * self.mTilesX + tile_x;
+    return self._Items.items[self._Offsets.items[tile]..self._Offsets.items[tile + 1]];
+}
+
+/// Offsets and items laid out for upload, tile t owns items[offsets[t]..offsets[t + 1]]
+pub fn GetOffsets(self: SDFTileBins) []const u32 {
+    return self._Offsets.items;
+}
+
+pub fn GetItems(self: SDFTileBins) []const u32 {
+    return self._Items.items;
+}
+
+/// Tiles covered by bounds as seen through camera, null if no ray of the target can reach it.
+/// Bounds that cross the plane of the camera are given every tile
+pub fn ProjectBounds(camera: PushConstants, width: u32, height: u32, bounds: AABB) ?TileRect {
+    const position = Vec3(f32).FromVector(camera.mPosition);
+    const rotation = Quat(f32).FromVector(camera.mRotation);
+    const grown = bounds.Expand(Vec3(f32).FromScalar(HIT_MARGIN));
+
+    if (grown.Distance(position) > camera.mPerspectiveFar) return null;
+
+    var frag_min = Vec2(f32){ .x = std.math.inf(f32), .y = std.math.inf(f32) };
+    var frag_max = Vec2(f32){ .x = -std.math.inf(f32), .y = -std.math.inf(f32) };
+    var behind_count: usize = 0;
+
+    for (0..8) |corner_ind| {
+        const corner = Vec3(f32){
+            .x = if (corner_ind & 1 != 0) grown.Max.x else grown.Min.x,
+            .y = if (corner_ind & 2 != 0) grown.Max.y else grown.Min.y,
+            .z = if (corner_ind & 4 != 0) grown.Max.z else grown.Min.z,
+        };
+        //rays leave the camera down -z in its local space
+        const local = corner.SubVec(position).InvQuatRotate(rotation);
+        if (local.z > -HIT_MARGIN) {
+            behind_count += 1;
+            continue;
+        }
+
+        //inverse of the ray setup in the shaders, uv = ray scale * frag + ray offset
+        const uv = Vec2(f32){ .x = local.x / -local.z, .y = local.y / -local.z };
+        const frag = uv.SubVec(.FromVector(camera.mRayOffset)).DivVec(.FromVector(camera.mRayScale));
+        frag_min = .{ .x = @min(frag_min.x, frag.x), .y = @min(frag_min.y, frag.y) };
+        frag_max = .{ .x = @max(frag_max.x, frag.x), .y = @max(frag_max.y, frag.y) };
+    }
+
+    const tiles_x = std.math.divCeil(u32, width, TILE_SIZE) catch unreachable;
+    const tiles_y = std.math.divCeil(u32, height, TILE_SIZE) catch unreachable;
+    if (behind_count == 8) return null;
+    if (behind_count > 0) return .{ .MinX = 0, .MinY = 0, .MaxX = tiles_x - 1, .MaxY = tiles_y - 1 };
+
+    //pixel p is sampled at p + 0.5
+    const width_f: f32 = @floatFromInt(width);
+    const height_f: f32 = @floatFromInt(height);
+    const px_min_x = @floor(frag_min.x - 0.5);
+    const px_min_y = @floor(frag_min.y - 0.5);
+    const px_max_x = @ceil(frag_max.x - 0.5);
+    const px_max_y = @ceil(frag_max.y - 0.5);
+    if (px_max_x < 0 or px_max_y < 0 or px_min_x >= width_f or px_min_y >= height_f) return null;
+
+    const tile_size: f32 = @floatFromInt(TILE_SIZE);
+    return .{
+        .MinX = @intFromFloat(@max(px_min_x, 0) / tile_size),
+        .MinY = @intFromFloat(@max(px_min_y, 0) / tile_size),
+        .MaxX = @intFromFloat(@min(px_max_x, width_f - 1) / tile_size),
+        .MaxY = @intFromFloat(@min(px_max_y, height_f - 1) / tile_size),
+    };
+}
+
+fn TestCamera(size: u32) PushConstants {
+    const scale = 2.0 / @as(f32, @floatFromInt(size));
+    return .{
+        .mPosition = .{ 0, 0, 0 },
+        .mPerspectiveFar = 50,
+        .mRotation = .{ 1, 0, 0, 0 },
+        .mRayScale = .{ scale, -scale },
+        .mRayOffset = .{ -1, 1 },
+        .mQuadsCount = 0,
+        .mGlyphsCount = 0,
+        .mViewportWidth = @floatFromInt(size),
+        .mViewportHeight = @floatFromInt(size),
+    };
+}
+
+test "Objects are binned into the tiles they project onto" {
+    const allocator = std.testing.allocator;
+    const size: u32 = 64; //8x8 tiles
+    const identity = Vec3(f32).FromScalar(0).DegreesToQuat().ToVector();
+
+    const quads = [_]QuadData{
+        //small and dead center, 4 tiles around the middle
+        .{ .Rotation = identity, .Position = .{ 0, 0, -4 }, .HalfExtents = .{ 0.1, 0.1, 0.001 }, .ShadingHandle = 0, .ShadingFlags = 0 },
+        //top left corner of the view
+        .{ .Rotation = identity, .Position = .{ -3.5, 3.5, -4 }, .HalfExtents = .{ 0.2, 0.2, 0.001 }, .ShadingHandle = 0, .ShadingFlags = 0 },
+        //behind the camera
+        .{ .Rotation = identity, .Position = .{ 0, 0, 4 }, .HalfExtents = .{ 1, 1, 0.001 }, .ShadingHandle = 0, .ShadingFlags = 0 },
+        //off to the side
+        .{ .Rotation = identity, .Position = .{ 20, 0, -4 }, .HalfExtents = .{ 1, 1, 0.001 }, .ShadingHandle = 0, .ShadingFlags = 0 },
+        //wrapped around the camera
+        .{ .Rotation = identity, .Position = .{ 0, 0, 0 }, .HalfExtents = .{ 1, 1, 1 }, .ShadingHandle = 0, .ShadingFlags = 0 },
+    };
+
+    var bins: SDFTileBins = .empty;
+    defer bins.Deinit(allocator);
+    try bins.Build(allocator, allocator, TestCamera(size), size, size, &quads, &.{});
+
+    try std.testing.expectEqual(@as(u32, 8), bins.mTilesX);
+    try std.testing.expectEqualSlices(u32, &.{ 0, 4 }, bins.GetTile(3, 3));
+    try std.testing.expectEqualSlices(u32, &.{ 0, 4 }, bins.GetTile(4, 4));
+    try std.testing.expectEqualSlices(u32, &.{ 1, 4 }, bins.GetTile(0, 0));
+    try std.testing.expectEqualSlices(u32, &.{4}, bins.GetTile(7, 7));
+    try std.testing.expectEqualSlices(u32, &.{4}, bins.GetTile(1, 5));
+    //the quads behind and beside the camera are in no tile
+    try std.testing.expectEqual(@as(usize, 4 + 1 + 64), bins.GetItems().len);
+
+    //a subset keeps the indices of the full list, the quads left out are in no tile
+    try bins.BuildSubset(allocator, allocator, TestCamera(size), size, size, &quads, &.{}, &.{ 1, 0 });
+    try std.testing.expectEqualSlices(u32, &.{0}, bins.GetTile(3, 3));
+    try std.testing.expectEqualSlices(u32, &.{1}, bins.GetTile(0, 0));
+    try std.testing.expectEqualSlices(u32, &.{}, bins.GetTile(7, 7));
+    try std.testing.expectEqual(@as(usize, 4 + 1), bins.GetItems().len);
+}
@@ -0,0 +1,288 @@
+//! Glyph layouts of text components, computed once and reused while the text does not change.
+//!
+//! A layout only depends on the string, the font, the font size and the left and right bounds, so
+//! it is kept in the local space of the text under those and shared by every text that has the
+//! same ones. Drawing and culling only add the world position. A layout no text asked for during a
+//! frame is dropped at the end of it, which is what happens to the old one when a text is edited.
+const std = @import("std");
+const AABB = @import("../Physics/BVH.zig").AABB;
+const THICKNESS_2D = @import("../Math/SDFFunctions.zig").THICKNESS_2D;
+
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec2 = MathTypes.Vec2;
+const Vec3 = MathTypes.Vec3;
+
+pub const LaidGlyph = struct {
+    /// From the world position of the text to the glyph position
+    Offset: Vec3(f32),
+    HalfExtents: Vec3(f32),
+    PlaneCenter: Vec2(f32),
+    AtlasUV0: Vec2(f32),
+    AtlasUV1: Vec2(f32),
+};
+
+pub const Layout = struct {
+    Glyphs: []const LaidGlyph = &.{},
+    MinOffset: Vec3(f32) = .FromScalar(0),
+    MaxOffset: Vec3(f32) = .FromScalar(0),
+    /// How far any part of a glyph box can be from its position, whatever the rotation
+    Reach: f32 = 0,
+
+    /// Contains the bounds of every glyph at world_pos, null if there are none
+    pub fn GetBounds(self: Layout, world_pos: Vec3(f32)) ?AABB {
+        if (self.Glyphs.len == 0) return null;
+        return .{
+            .Min = world_pos.AddVec(self.MinOffset).AddScalar(-self.Reach),
+            .Max = world_pos.AddVec(self.MaxOffset).AddScalar(self.Reach),
+        };
+    }
+};
+
+/// Font needs mGlyphs, mLineHeight, mAtlasSize and ToArrayIndex the way TextAsset has them
+pub fn TextLayoutCache(comptime Font: type) type {
+    return struct {
+        const Self = @This();
+
+        const Key = struct {
+            TextHash: u64,
+            FontID: u32,
+            FontSize: u32,
+            LeftBound: u32,
+            RightBound: u32,
+        };
+
+        const Entry = struct {
+            mLayout: Layout,
+            //kept to rule out hash collisions
+            mText: []const u8,
+            mLastFrame: u64,
+        };
+
+        pub const empty: Self = .{
+            ._Layouts = .empty,
+            ._Frame = 0,
+            ._LayoutCount = 0,
+        };
+
+        _Layouts: std.AutoHashMapUnmanaged(Key, Entry),
+        _Frame: u64,
+        /// Layouts computed so far, for checking that static text is not laid out again
+        _LayoutCount: usize,
+
+        pub fn Deinit(self: *Self, engine_allocator: std.mem.Allocator) void {
+            var iter = self._Layouts.valueIterator();
+            while (iter.next()) |entry| FreeEntry(engine_allocator, entry.*);
+            self._Layouts.deinit(engine_allocator);
+        }
+
+        /// The layout of text, computing it only if no text with the same key was seen last frame or this one.
+        /// The glyphs stay valid until the EndFrame of a frame that does not ask for them
+        pub fn GetLayout(self: *Self, engine_allocator: std.mem.Allocator, text: []const u8, font_id: u32, font: *const Font, font_size: f32, bounds: Vec2(f32)) !Layout {
+            const key = Key{
+                .TextHash = std.hash.Wyhash.hash(0, text),
+                .FontID = font_id,
+                .FontSize = @bitCast(font_size),
+                .LeftBound = @bitCast(bounds.x),
+                .RightBound = @bitCast(bounds.y),
+            };
+
+            const found = try self._Layouts.getOrPut(engine_allocator, key);
+            if (found.found_existing) {
+                if (std.mem.eql(u8, found.value_ptr.mText, text)) {
+                    found.value_ptr.mLastFrame = self._Frame;
+                    return found.value_ptr.mLayout;
+                }
+                FreeEntry(engine_allocator, found.value_ptr.*);
+            }
+            errdefer _ = self._Layouts.remove(key);
+
+            const text_copy = try engine_allocator.dupe(u8, text);
+            errdefer engine_allocator.free(text_copy);
+            const layout = try LayOut(engine_allocator, text, font, font_size, bounds);
+
+            found.value_ptr.* = .{ .mLayout = layout, .mText = text_copy, .mLastFrame = self._Frame };
+            self._LayoutCount += 1;
+            return layout;
+        }
+
+        /// Drops the layouts nothing asked for this frame
+        pub fn EndFrame(self: *Self, engine_allocator: std.mem.Allocator, frame_allocator: std.mem.Allocator) !void {
+            var stale: std.ArrayList(Key) = .empty;
+            var iter = self._Layouts.iterator();
+            while (iter.next()) |entry| {
+                if (entry.value_ptr.mLastFrame != self._Frame) try stale.append(frame_allocator, entry.key_ptr.*);
+            }
+            for (stale.items) |key| {
+                FreeEntry(engine_allocator, self._Layouts.fetchRemove(key).?.value);
+            }
+            self._Frame += 1;
+        }
+
+        pub fn GetCount(self: Self) usize {
+            return self._Layouts.count();
+        }
+
+        pub fn GetLayoutCount(self: Self) usize {
+            return self._LayoutCount;
+        }
+
+        fn FreeEntry(engine_allocator: std.mem.Allocator, entry: Entry) void {
+            engine_allocator.free(entry.mLayout.Glyphs);
+            engine_allocator.free(entry.mText);
+        }
+
+        /// Places each glyph with the pen starting at the left bound, wrapping lines at the right bound
+        fn LayOut(engine_allocator: std.mem.Allocator, text: []const u8, font: *const Font, font_size: f32, bounds: Vec2(f32)) !Layout {
+            var glyphs: std.ArrayList(LaidGlyph) = .empty;
+            errdefer glyphs.deinit(engine_allocator);
+
+            const left_bound = -bounds.x;
+            const right_bound = bounds.y;
+            var pen_x = left_bound;
+            var pen_y: f32 = 0;
+
+            var layout = Layout{};
+            for (text, 0..) |char, i| {
+                const glyph = &font.mGlyphs[Font.ToArrayIndex(char)];
+
+                if (char == 32) { //if its space just continue on
+                    pen_x += glyph.mAdvance * font_size;
+                    continue;
+                }
+
+                const glyph_width = glyph.mAdvance;
+
+                if (pen_x + glyph_width > right_bound) {
+                    pen_x = left_bound;
+                    pen_y -= (font.mLineHeight * font_size);
+                }
+
+                const left = glyph.mPlaneMin.x;
+                const top = glyph.mPlaneMin.y;
+                const right = glyph.mPlaneMax.x;
+                const bottom = glyph.mPlaneMax.y;
+
+                const laid = LaidGlyph{
+                    .Offset = .{ .x = pen_x, .y = pen_y, .z = 0 },
+                    .HalfExtents = .{
+                        .x = (right - left) * font_size * 0.5,
+                        .y = (top - bottom) * font_size * 0.5,
+                        .z = THICKNESS_2D,
+                    },
+                    .PlaneCenter = .{
+                        .x = (left + right) * 0.5 * font_size,
+                        .y = (top + bottom) * 0.5 * font_size,
+                    },
+                    .AtlasUV0 = glyph.mAtlasTexel0.DivVec(font.mAtlasSize),
+                    .AtlasUV1 = glyph.mAtlasTexel1.DivVec(font.mAtlasSize),
+                };
+                try glyphs.append(engine_allocator, laid);
+
+                const plane_center = Vec3(f32){ .x = laid.PlaneCenter.x, .y = laid.PlaneCenter.y, .z = 0 };
+                layout.Reach = @max(layout.Reach, plane_center.Len() + laid.HalfExtents.Len());
+                if (glyphs.items.len == 1) {
+                    layout.MinOffset = laid.Offset;
+                    layout.MaxOffset = laid.Offset;
+                } else {
+                    layout.MinOffset = .{ .x = @min(layout.MinOffset.x, pen_x), .y = @min(layout.MinOffset.y, pen_y), .z = 0 };
+                    layout.MaxOffset = .{ .x = @max(layout.MaxOffset.x, pen_x), .y = @max(layout.MaxOffset.y, pen_y), .z = 0 };
+                }
+
+                var move_dist = glyph_width;
+                if (i < text.len - 1) {
+                    if (glyph.mKernings.get(text[i + 1])) |kerning_advance| {
+                        move_dist += kerning_advance;
+                    }
+                }
+
+                pen_x += (move_dist) * font_size;
+            }
+
+            layout.Glyphs = try glyphs.toOwnedSlice(engine_allocator);
+            return layout;
+        }
+    };
+}
+
+const TestFont = struct {
+    const Glyph = struct {
+        mAtlasTexel0: Vec2(f32),
+        mAtlasTexel1: Vec2(f32),
+        mPlaneMin: Vec2(f32),
+        mPlaneMax: Vec2(f32),
+        mAdvance: f32,
+        mKernings: std.AutoHashMapUnmanaged(u16, f32) = .empty,
+    };
+
+    mGlyphs: [128]Glyph,
+    mLineHeight: f32 = 1.2,
+    mAtlasSize: Vec2(f32) = .{ .x = 64, .y = 64 },
+
+    fn ToArrayIndex(unicode: usize) usize {
+        return unicode;
+    }
+
+    fn Init() TestFont {
+        var font: TestFont = .{ .mGlyphs = undefined };
+        for (&font.mGlyphs, 0..) |*glyph, i| glyph.* = .{
+            .mAtlasTexel0 = .{ .x = @floatFromInt(i % 8 * 8), .y = @floatFromInt(i / 8 * 8) },
+            .mAtlasTexel1 = .{ .x = @floatFromInt(i % 8 * 8 + 8), .y = @floatFromInt(i / 8 * 8 + 8) },
+            .mPlaneMin = .{ .x = 0, .y = 0.8 },
+            .mPlaneMax = .{ .x = 0.5, .y = -0.2 },
+            .mAdvance = 0.6,
+        };
+        return font;
+    }
+};
+
+test "Text layouts are computed once per text and dropped when unused" {
+    const allocator = std.testing.allocator;
+    const font = TestFont.Init();
+    var cache: TextLayoutCache(TestFont) = .empty;
+    defer cache.Deinit(allocator);
+
+    const bounds = Vec2(f32){ .x = 0, .y = 2 };
+    for (0..3) |_| {
+        const hud = try cache.GetLayout(allocator, "Health 100", 1, &font, 1, bounds);
+        const label = try cache.GetLayout(allocator, "Health 100", 1, &font, 1, bounds);
+        try std.testing.expectEqual(hud.Glyphs.ptr, label.Glyphs.ptr);
+        try std.testing.expectEqual(@as(usize, 9), hud.Glyphs.len);
+        _ = try cache.GetLayout(allocator, "Ammo", 1, &font, 1, bounds);
+        try cache.EndFrame(allocator, allocator);
+    }
+    try std.testing.expectEqual(@as(usize, 2), cache.GetLayoutCount());
+
+    //the text got edited, the old layout goes at the end of the frame
+    _ = try cache.GetLayout(allocator, "Health 99", 1, &font, 1, bounds);
+    _ = try cache.GetLayout(allocator, "Ammo", 1, &font, 1, bounds);
+    try std.testing.expectEqual(@as(usize, 3), cache.GetCount());
+    try cache.EndFrame(allocator, allocator);
+    try std.testing.expectEqual(@as(usize, 2), cache.GetCount());
+    try std.testing.expectEqual(@as(usize, 3), cache.GetLayoutCount());
+
+    //a different size is a different layout
+    const big = try cache.GetLayout(allocator, "Ammo", 1, &font, 2, bounds);
+    try std.testing.expectEqual(@as(f32, 0.6 * 2), big.Glyphs[1].Offset.x - big.Glyphs[0].Offset.x);
+}
+
+test "Text layout wraps at the right bound and bounds every glyph" {
+    const allocator = std.testing.allocator;
+    const font = TestFont.Init();
+    var cache: TextLayoutCache(TestFont) = .empty;
+    defer cache.Deinit(allocator);
+
+    //room for 4 glyphs of 0.6 before 2.5
+    const layout = try cache.GetLayout(allocator, "abcdefgh", 7, &font, 1, .{ .x = 0, .y = 2.5 });
+    try std.testing.expectEqual(@as(f32, 0), layout.Glyphs[3].Offset.y);
+    try std.testing.expectEqual(@as(f32, -1.2), layout.Glyphs[4].Offset.y);
+    try std.testing.expectEqual(@as(f32, 0), layout.Glyphs[4].Offset.x);
+
+    const world_pos = Vec3(f32){ .x = 5, .y = -3, .z = 2 };
+    const bounds = layout.GetBounds(world_pos).?;
+    for (layout.Glyphs) |glyph| {
+        const center = world_pos.AddVec(glyph.Offset).AddVec(.{ .x = glyph.PlaneCenter.x, .y = glyph.PlaneCenter.y, .z = 0 });
+        const glyph_bounds = AABB.FromCenter(center, glyph.HalfExtents);
+        try std.testing.expectEqual(bounds, bounds.Union(glyph_bounds));
+    }
+    try std.testing.expect((try cache.GetLayout(allocator, "   ", 7, &font, 1, .{ .x = 0, .y = 2.5 })).GetBounds(world_pos) == null);
+}
@@ -0,0 +1,143 @@
+//! Volume of space the rays of one SDF pass can reach, used to cull objects before they are packed.
+//!
+//! The side planes go through the camera and the rays of the four corners of the viewport, built
+//! from the same ray scale and offset the shaders use, so an object outside of them cannot be hit
+//! by any pixel. Rays stop at the perspective far distance, and an optional max draw distance can
+//! pull that in further.
+const std = @import("std");
+const BVH = @import("../Physics/BVH.zig");
+const AABB = BVH.AABB;
+const PushConstants = @import("RenderPipeline.zig").SDFPushConstants;
+
+const MathTypes = @import("../Math/MathTypes.zig");
+const Vec3 = MathTypes.Vec3;
+const Quat = MathTypes.Quat;
+
+const ViewFrustum = @This();
+
+/// Points p with Normal dot (p - camera position) >= 0 are inside
+pub const Plane = struct {
+    Normal: Vec3(f32),
+};
+
+mPosition: Vec3(f32),
+mPlanes: [4]Plane,
+mMaxDistance: f32,
+
+pub fn Init(camera: PushConstants, max_draw_distance: ?f32) ViewFrustum {
+    const rotation = Quat(f32).FromVector(camera.mRotation);
+    const width = camera.mViewportWidth;
+    const height = camera.mViewportHeight;
+
+    //corner rays in camera space, in order around the viewport
+    const corners = [4]Vec3(f32){
+        CornerRay(camera, 0, 0),
+        CornerRay(camera, width, 0),
+        CornerRay(camera, width, height),
+        CornerRay(camera, 0, height),
+    };
+    const center = CornerRay(camera, width * 0.5, height * 0.5);
+
+    var planes: [4]Plane = undefined;
+    for (&planes, 0..) |*plane, i| {
+        var normal = corners[i].Cross(corners[(i + 1) % 4]);
+        //the winding depends on the sign of the ray scale, flip toward the middle of the view
+        if (normal.Dot(center) < 0) normal = normal.Neg();
+        normal.Normalize();
+        plane.* = .{ .Normal = normal.QuatRotate(rotation) };
+    }
+
+    return .{
+        .mPosition = Vec3(f32).FromVector(camera.mPosition),
+        .mPlanes = planes,
+        .mMaxDistance = if (max_draw_distance) |max_distance| @min(max_distance, camera.mPerspectiveFar) else camera.mPerspectiveFar,
+    };
+}
+
+/// False only when no ray of the pass can reach bounds
+pub fn IsVisible(self: ViewFrustum, bounds: AABB) bool {
+    if (bounds.Distance(self.mPosition) > self.mMaxDistance) return false;
+
+    for (self.mPlanes) |plane| {
+        //the corner furthest along the normal, if it is outside the whole box is
+        const corner = Vec3(f32){
+            .x = if (plane.Normal.x >= 0) bounds.Max.x else bounds.Min.x,
+            .y = if (plane.Normal.y >= 0) bounds.Max.y else bounds.Min.y,
+            .z = if (plane.Normal.z >= 0) bounds.Max.z else bounds.Min.z,
+        };
+        if (plane.Normal.Dot(corner.SubVec(self.mPosition)) < 0) return false;
+    }
+    return true;
+}
+
+//same mapping as the shaders, uv = ray scale * frag + ray offset looking down -z
+fn CornerRay(camera: PushConstants, frag_x: f32, frag_y: f32) Vec3(f32) {
+    return .{
+        .x = camera.mRayScale[0] * frag_x + camera.mRayOffset[0],
+        .y = camera.mRayScale[1] * frag_y + camera.mRayOffset[1],
+        .z = -1,
+    };
+}
+
+fn TestCamera(size: f32, rotation: Quat(f32)) PushConstants {
+    const scale = 2.0 / size;
+    return .{
+        .mPosition = .{ 1, 2, 3 },
+        .mPerspectiveFar = 50,
+        .mRotation = rotation.ToVector(),
+        .mRayScale = .{ scale, -scale },
+        .mRayOffset = .{ -1, 1 },
+        .mQuadsCount = 0,
+        .mGlyphsCount = 0,
+        .mViewportWidth = size,
+        .mViewportHeight = size,
+    };
+}
+
+test "Frustum culls what the camera rays cannot reach" {
+    const camera = TestCamera(64, Vec3(f32).FromScalar(0).DegreesToQuat());
+    const half = Vec3(f32).FromScalar(0.5);
+
+    const frustum = ViewFrustum.Init(camera, null);
+    //in front, behind, off to the side, past the far distance and crossing the edge of the view
+    try std.testing.expect(frustum.IsVisible(AABB.FromCenter(.{ .x = 1, .y = 2, .z = -5 }, half)));
+    try std.testing.expect(!frustum.IsVisible(AABB.FromCenter(.{ .x = 1, .y = 2, .z = 8 }, half)));
+    try std.testing.expect(!frustum.IsVisible(AABB.FromCenter(.{ .x = 20, .y = 2, .z = -5 }, half)));
+    try std.testing.expect(!frustum.IsVisible(AABB.FromCenter(.{ .x = 1, .y = 2, .z = -60 }, half)));
+    try std.testing.expect(frustum.IsVisible(AABB.FromCenter(.{ .x = 1 + 8.2, .y = 2, .z = -5 }, half)));
+
+    const near_frustum = ViewFrustum.Init(camera, 10);
+    try std.testing.expect(near_frustum.IsVisible(AABB.FromCenter(.{ .x = 1, .y = 2, .z = -5 }, half)));
+    try std.testing.expect(!near_frustum.IsVisible(AABB.FromCenter(.{ .x = 1, .y = 2, .z = -20 }, half)));
+}
+
+test "Frustum never culls a box a pixel ray hits" {
+    const size: u32 = 16;
+    const camera = TestCamera(@floatFromInt(size), (Vec3(f32){ .x = 10, .y = -30, .z = 5 }).DegreesToQuat());
+    const rotation = Quat(f32).FromVector(camera.mRotation);
+    const position = Vec3(f32).FromVector(camera.mPosition);
+    const frustum = ViewFrustum.Init(camera, null);
+
+    var prng = std.Random.DefaultPrng.init(11);
+    const random = prng.random();
+    var visible_count: usize = 0;
+    for (0..300) |_| {
+        const center = Vec3(f32){ .x = random.float(f32) * 40 - 20, .y = random.float(f32) * 40 - 20, .z = random.float(f32) * 40 - 20 };
+        const bounds = AABB.FromCenter(center, Vec3(f32).FromScalar(random.float(f32) * 2 + 0.01));
+        if (frustum.IsVisible(bounds)) {
+            visible_count += 1;
+            continue;
+        }
+        for (0..size) |y| {
+            for (0..size) |x| {
+                var dir = CornerRay(camera, @as(f32, @floatFromInt(x)) + 0.5, @as(f32, @floatFromInt(y)) + 0.5);
+                dir.Normalize();
+                dir = dir.QuatRotate(rotation);
+                const inv_dir = Vec3(f32){ .x = 1 / dir.x, .y = 1 / dir.y, .z = 1 / dir.z };
+                try std.testing.expect(bounds.RayEnter(position, inv_dir, camera.mPerspectiveFar) == null);
+            }
+        }
+    }
+    //a 90 degree view should keep well under half of the boxes around the camera
+    try std.testing.expect(visible_count > 0 and visible_count < 150);
+}
@@ -22,7 +22,8 @@ pub const PipelineType = enum {
 const ShaderInfo: StageInfo = .{
     .mNumSamplers = 2,
     .mNumROStorageTextures = 0,
-    .mNumROStorageBuffers = 3,
+    //surface and medium shadings, quads, glyphs, tile offsets and tile items
+    .mNumROStorageBuffers = 6,
     .mNumRWStorageTextures = 1,
     .mNumRWStorageBuffers = 0,
     .mNumUniformBuffers = 1,
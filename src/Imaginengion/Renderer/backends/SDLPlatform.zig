@@ -6,6 +6,8 @@ const EngineContext = @import("../../Core/EngineContext.zig");
 const PushConstants = @import("../RenderPlatform.zig").PushConstants;
 const ComputeOutput = @import("../Renderer.zig").ComputeOutput;
 const StorageBufferBinding = @import("../RenderPlatform.zig").StorageBufferBinding;
+const SDLGPUDevice = @import("../../SSBOs/SDLGPUDevice.zig");
+const UploadQueue = @import("../../SSBOs/SDLGPUSSBO.zig").UploadQueue;
 
 const sdl = @import("../../Core/CImports.zig").sdl;
 
@@ -16,9 +18,14 @@ mCurrentCmdBuffer: ?*sdl.SDL_GPUCommandBuffer = null,
 mSwapchainTexture: ?*sdl.SDL_GPUTexture = null,
 mSwapchainWidth: u32 = 0,
 mSwapchainHeight: u32 = 0,
+mUploads: UploadQueue = .empty,
+//time blocked acquiring swapchain textures since the last TakeSwapchainWaitNs
+mSwapchainWaitNs: u64 = 0,
+mEngineAllocator: std.mem.Allocator = undefined,
 
 pub fn Init(self: *SDLPlatform, engine_context: *EngineContext) void {
     const sdl_window: ?*sdl.SDL_Window = @ptrCast(engine_context.mAppWindow.GetNativeWindow());
+    self.mEngineAllocator = engine_context.EngineAllocator();
     const vk_api_1_3_0: u32 = (0 << 29) | (1 << 22) | (3 << 12) | 0;
 
     var features_1_0 = sdl.VkPhysicalDeviceFeatures{
@@ -69,6 +76,8 @@ pub fn Deinit(self: *SDLPlatform, window: *Window) void {
 
     _ = sdl.SDL_WaitForGPUIdle(self.mDevice);
     _ = if (self.mCurrentCmdBuffer) |cmd| sdl.SDL_CancelGPUCommandBuffer(cmd);
+    var device = self.GetGPUDevice();
+    self.mUploads.Deinit(self.mEngineAllocator, &device);
     sdl.SDL_ReleaseWindowFromGPUDevice(self.mDevice, sdl_window);
     sdl.SDL_DestroyGPUDevice(self.mDevice);
 }
@@ -84,6 +93,7 @@ pub fn BeginFrame(self: *SDLPlatform, window: *Window) bool {
 
     const sdl_window: *sdl.SDL_Window = @ptrCast(window.GetNativeWindow());
 
+    const wait_start = sdl.SDL_GetTicksNS();
     const acquired = sdl.SDL_AcquireGPUSwapchainTexture(
         self.mCurrentCmdBuffer,
         sdl_window,
@@ -91,6 +101,7 @@ pub fn BeginFrame(self: *SDLPlatform, window: *Window) bool {
         @ptrCast(&width),
         @ptrCast(&height),
     );
+    self.AddSwapchainWait(sdl.SDL_GetTicksNS() - wait_start);
 
     if (!acquired) {
         _ = sdl.SDL_CancelGPUCommandBuffer(self.mCurrentCmdBuffer);
@@ -102,9 +113,22 @@ pub fn BeginFrame(self: *SDLPlatform, window: *Window) bool {
     self.mSwapchainWidth = width;
     self.mSwapchainHeight = height;
 
+    var device = self.GetGPUDevice();
+    self.mUploads.BeginFrame(&device);
+
     return true;
 }
 
+pub fn AddSwapchainWait(self: *SDLPlatform, wait_ns: u64) void {
+    self.mSwapchainWaitNs += wait_ns;
+}
+
+/// Time spent blocked on the swapchain since the last call, vsync included
+pub fn TakeSwapchainWaitNs(self: *SDLPlatform) u64 {
+    defer self.mSwapchainWaitNs = 0;
+    return self.mSwapchainWaitNs;
+}
+
 pub fn HasFrame(self: SDLPlatform) bool {
     if (self.mCurrentCmdBuffer != null and self.mSwapchainTexture != null) {
         return true;
@@ -115,6 +139,9 @@ pub fn HasFrame(self: SDLPlatform) bool {
 pub fn EndFrame(self: *SDLPlatform) void {
     std.debug.assert(self.mCurrentCmdBuffer != null);
 
+    //anything staged after the last flush still has to land before the ring moves on
+    self.FlushUploads() catch |err| std.log.err("failed to flush gpu uploads: {}", .{err});
+
     _ = sdl.SDL_SubmitGPUCommandBuffer(self.mCurrentCmdBuffer);
 
     self.mCurrentCmdBuffer = null;
@@ -143,7 +170,8 @@ pub fn Present(self: SDLPlatform, compute_texture: *ComputeOutput) void {
         .load_op = sdl.SDL_GPU_LOADOP_DONT_CARE,
         .clear_color = .{ .r = 0, .g = 0, .b = 0, .a = 0 },
         .flip_mode = sdl.SDL_FLIP_NONE,
-        .filter = sdl.SDL_GPU_FILTER_NEAREST,
+        //the target may be rendered below the swapchain size by dynamic resolution
+        .filter = sdl.SDL_GPU_FILTER_LINEAR,
         .cycle = false,
     };
     sdl.SDL_BlitGPUTexture(self.mCurrentCmdBuffer.?, &blit_info);
@@ -153,6 +181,15 @@ pub fn GetDevice(self: SDLPlatform) *sdl.SDL_GPUDevice {
     return self.mDevice;
 }
 
+pub fn GetUploadQueue(self: *SDLPlatform) *UploadQueue {
+    return &self.mUploads;
+}
+
+pub fn FlushUploads(self: *SDLPlatform) !void {
+    var device = self.GetGPUDevice();
+    try self.mUploads.Flush(&device, self.GetCommandBuff());
+}
+
 pub fn GetCommandBuff(self: SDLPlatform) *sdl.SDL_GPUCommandBuffer {
     std.debug.assert(self.mCurrentCmdBuffer != null);
     return self.mCurrentCmdBuffer.?;
@@ -167,3 +204,7 @@ pub fn PopDebugGroup(self: SDLPlatform) void {
     std.debug.assert(self.mCurrentCmdBuffer != null);
     sdl.SDL_PopGPUDebugGroup(self.mCurrentCmdBuffer);
 }
+
+fn GetGPUDevice(self: SDLPlatform) SDLGPUDevice {
+    return .{ .mDevice = self.mDevice };
+}
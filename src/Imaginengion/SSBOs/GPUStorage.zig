@@ -0,0 +1,325 @@
+//! Persistent storage buffers and the per frame upload queue that fills them.
+//!
+//! Both are generic over a device type so they can run on SDLGPUDevice or on NullGPUDevice in tests.
+//! A device provides the Buffer, TransferBuffer, CommandBuffer and CopyPass types and these calls:
+//!   CreateBuffer(size) !Buffer, ReleaseBuffer(buffer)
+//!   CreateTransferBuffer(size) !TransferBuffer, ReleaseTransferBuffer(transfer_buffer)
+//!   MapTransferBuffer(transfer_buffer, cycle) ![*]u8, UnmapTransferBuffer(transfer_buffer)
+//!   BeginCopyPass(command_buffer) !CopyPass, EndCopyPass(copy_pass)
+//!   UploadToBuffer(copy_pass, src, src_offset, dst, dst_offset, size)
+//!   CopyBufferToBuffer(copy_pass, src, dst, size)
+//!
+//! Uploads are written straight into a mapped transfer buffer owned by the current frame and recorded
+//! as pending copies. Flush encodes every pending copy of the frame in one copy pass. There is one
+//! transfer buffer per frame in flight, each kept and grown as needed, so after the first few frames
+//! no transfer buffers are created at all.
+const std = @import("std");
+
+/// More than SDL allows in flight by default, so a frame never writes a transfer buffer the gpu is reading
+pub const FRAMES_IN_FLIGHT: usize = 3;
+
+const MIN_TRANSFER_SIZE: u32 = 64 * 1024;
+const UPLOAD_ALIGNMENT: u32 = 16;
+
+pub fn UploadQueue(comptime Device: type) type {
+    return struct {
+        const Self = @This();
+
+        const Op = union(enum) {
+            //from the transfer buffer of the current frame
+            Upload: struct { SrcOffset: u32, Dst: Device.Buffer, DstOffset: u32, Size: u32 },
+            Copy: struct { Src: Device.Buffer, Dst: Device.Buffer, Size: u32 },
+        };
+
+        const TransferSlot = struct {
+            Buffer: ?Device.TransferBuffer = null,
+            Capacity: u32 = 0,
+        };
+
+        pub const empty: Self = .{
+            ._Slots = [_]TransferSlot{.{}} ** FRAMES_IN_FLIGHT,
+            ._FrameIndex = 0,
+            ._Cursor = 0,
+            ._Mapped = null,
+            ._Ops = .empty,
+            ._Releases = .empty,
+        };
+
+        _Slots: [FRAMES_IN_FLIGHT]TransferSlot,
+        _FrameIndex: usize,
+        _Cursor: u32,
+        _Mapped: ?[*]u8,
+        _Ops: std.ArrayList(Op),
+        //buffers replaced this frame, released once the copies out of them are encoded
+        _Releases: std.ArrayList(Device.Buffer),
+
+        pub fn Deinit(self: *Self, engine_allocator: std.mem.Allocator, device: *Device) void {
+            const slot = &self._Slots[self._FrameIndex];
+            if (self._Mapped != null) device.UnmapTransferBuffer(slot.Buffer.?);
+            for (self._Slots) |s| {
+                if (s.Buffer) |transfer_buffer| device.ReleaseTransferBuffer(transfer_buffer);
+            }
+            for (self._Releases.items) |buffer| device.ReleaseBuffer(buffer);
+            self._Ops.deinit(engine_allocator);
+            self._Releases.deinit(engine_allocator);
+            self.* = .empty;
+        }
+
+        /// Moves on to the transfer buffer of the next frame. Anything still pending is dropped
+        pub fn BeginFrame(self: *Self, device: *Device) void {
+            if (self._Mapped != null) {
+                device.UnmapTransferBuffer(self._Slots[self._FrameIndex].Buffer.?);
+                self._Mapped = null;
+            }
+            self._Ops.clearRetainingCapacity();
+            self._FrameIndex = (self._FrameIndex + 1) % FRAMES_IN_FLIGHT;
+            self._Cursor = 0;
+        }
+
+        /// Copies bytes into the transfer buffer now and records the upload into dst for the next Flush
+        pub fn StageUpload(self: *Self, engine_allocator: std.mem.Allocator, device: *Device, dst: Device.Buffer, dst_offset: u32, bytes: []const u8) !void {
+            if (bytes.len == 0) return;
+            const size: u32 = @intCast(bytes.len);
+            const src_offset = std.mem.alignForward(u32, self._Cursor, UPLOAD_ALIGNMENT);
+
+            try self.ReserveTransfer(device, src_offset + size);
+            if (self._Mapped == null) {
+                //the first map of the frame may cycle, later ones must keep what was already written
+                self._Mapped = try device.MapTransferBuffer(self._Slots[self._FrameIndex].Buffer.?, self._Cursor == 0);
+            }
+            @memcpy(self._Mapped.?[src_offset..][0..size], bytes);
+            self._Cursor = src_offset + size;
+
+            try self._Ops.append(engine_allocator, .{ .Upload = .{ .SrcOffset = src_offset, .Dst = dst, .DstOffset = dst_offset, .Size = size } });
+        }
+
+        /// Records a copy of the first size bytes of src into dst, in order with the uploads
+        pub fn QueueCopy(self: *Self, engine_allocator: std.mem.Allocator, src: Device.Buffer, dst: Device.Buffer, size: u32) !void {
+            if (size == 0) return;
+            try self._Ops.append(engine_allocator, .{ .Copy = .{ .Src = src, .Dst = dst, .Size = size } });
+        }
+
+        /// Releases buffer after the next Flush, when no pending copy reads it anymore
+        pub fn QueueRelease(self: *Self, engine_allocator: std.mem.Allocator, buffer: Device.Buffer) !void {
+            try self._Releases.append(engine_allocator, buffer);
+        }
+
+        /// Encodes everything recorded since the last flush in a single copy pass
+        pub fn Flush(self: *Self, device: *Device, command_buffer: Device.CommandBuffer) !void {
+            const slot = &self._Slots[self._FrameIndex];
+            if (self._Mapped != null) {
+                device.UnmapTransferBuffer(slot.Buffer.?);
+                self._Mapped = null;
+            }
+
+            if (self._Ops.items.len != 0) {
+                const copy_pass = try device.BeginCopyPass(command_buffer);
+                for (self._Ops.items) |op| {
+                    switch (op) {
+                        .Upload => |upload| device.UploadToBuffer(copy_pass, slot.Buffer.?, upload.SrcOffset, upload.Dst, upload.DstOffset, upload.Size),
+                        .Copy => |copy| device.CopyBufferToBuffer(copy_pass, copy.Src, copy.Dst, copy.Size),
+                    }
+                }
+                device.EndCopyPass(copy_pass);
+                self._Ops.clearRetainingCapacity();
+            }
+
+            for (self._Releases.items) |buffer| device.ReleaseBuffer(buffer);
+            self._Releases.clearRetainingCapacity();
+        }
+
+        pub fn GetPendingCount(self: Self) usize {
+            return self._Ops.items.len;
+        }
+
+        fn ReserveTransfer(self: *Self, device: *Device, size: u32) !void {
+            const slot = &self._Slots[self._FrameIndex];
+            if (size <= slot.Capacity) return;
+
+            const new_capacity = @max(size, slot.Capacity * 2, MIN_TRANSFER_SIZE);
+            const new_buffer = try device.CreateTransferBuffer(new_capacity);
+
+            //keep what was staged before this upload, the pending uploads read it from the new buffer
+            if (slot.Buffer) |old_buffer| {
+                if (self._Cursor != 0) {
+                    const old_mapped = self._Mapped orelse try device.MapTransferBuffer(old_buffer, false);
+                    const new_mapped = try device.MapTransferBuffer(new_buffer, false);
+                    @memcpy(new_mapped[0..self._Cursor], old_mapped[0..self._Cursor]);
+                    device.UnmapTransferBuffer(old_buffer);
+                    self._Mapped = new_mapped;
+                } else if (self._Mapped != null) {
+                    device.UnmapTransferBuffer(old_buffer);
+                    self._Mapped = null;
+                }
+                device.ReleaseTransferBuffer(old_buffer);
+            }
+
+            slot.Buffer = new_buffer;
+            slot.Capacity = new_capacity;
+        }
+    };
+}
+
+/// A gpu buffer that is created once and grown geometrically, keeping its contents when it grows
+pub fn StorageBuffer(comptime Device: type) type {
+    return struct {
+        const Self = @This();
+
+        pub const empty: Self = .{
+            .mBuffer = null,
+            .mCapacity = 0,
+            .mUsedSize = 0,
+        };
+
+        mBuffer: ?Device.Buffer,
+        mCapacity: u32,
+        //bytes written so far, only these are copied over when the buffer grows
+        mUsedSize: u32,
+
+        pub fn Init(self: *Self, device: *Device, capacity: u32) !void {
+            self.* = .empty;
+            if (capacity == 0) return;
+            self.mBuffer = try device.CreateBuffer(capacity);
+            self.mCapacity = capacity;
+        }
+
+        pub fn Deinit(self: *Self, device: *Device) void {
+            if (self.mBuffer) |buffer| device.ReleaseBuffer(buffer);
+            self.* = .empty;
+        }
+
+        /// Makes room for size bytes, true if the buffer was replaced and needs to be bound again.
+        /// The old contents up to keep_size are copied over in the next flush
+        pub fn Reserve(self: *Self, engine_allocator: std.mem.Allocator, queue: *UploadQueue(Device), device: *Device, size: u32, keep_size: u32) !bool {
+            if (size <= self.mCapacity) return false;
+
+            const new_capacity = @max(size, self.mCapacity + self.mCapacity / 2);
+            const new_buffer = try device.CreateBuffer(new_capacity);
+            errdefer device.ReleaseBuffer(new_buffer);
+
+            if (self.mBuffer) |old_buffer| {
+                try queue.QueueCopy(engine_allocator, old_buffer, new_buffer, @min(keep_size, self.mUsedSize));
+                try queue.QueueRelease(engine_allocator, old_buffer);
+            }
+
+            self.mBuffer = new_buffer;
+            self.mCapacity = new_capacity;
+            return true;
+        }
+
+        /// Stages bytes for offset, growing first if needed. True if the buffer was replaced
+        pub fn SetData(self: *Self, engine_allocator: std.mem.Allocator, queue: *UploadQueue(Device), device: *Device, bytes: []const u8, offset: u32) !bool {
+            if (bytes.len == 0) return false;
+            const end = offset + @as(u32, @intCast(bytes.len));
+
+            //a write from the start that covers everything written so far leaves nothing to keep
+            const keep_size: u32 = if (offset == 0 and end >= self.mUsedSize) 0 else self.mUsedSize;
+            const resized = try self.Reserve(engine_allocator, queue, device, end, keep_size);
+
+            try queue.StageUpload(engine_allocator, device, self.mBuffer.?, offset, bytes);
+            self.mUsedSize = @max(self.mUsedSize, end);
+            return resized;
+        }
+    };
+}
+
+const NullGPUDevice = @import("NullGPUDevice.zig");
+const TestQueue = UploadQueue(NullGPUDevice);
+const TestStorage = StorageBuffer(NullGPUDevice);
+
+test "Storage buffers grow geometrically and transfer buffers are reused" {
+    const allocator = std.testing.allocator;
+    var device = NullGPUDevice.Init(allocator);
+
+    var queue: TestQueue = .empty;
+    var storage: TestStorage = .empty;
+    try storage.Init(&device, 256);
+
+    var data: [16 * 1000]u8 = undefined;
+    for (&data, 0..) |*byte, i| byte.* = @truncate(i * 7);
+
+    var resize_count: usize = 0;
+    for (1..1001) |frame| {
+        queue.BeginFrame(&device);
+        if (try storage.SetData(allocator, &queue, &device, data[0 .. frame * 16], 0)) resize_count += 1;
+        try queue.Flush(&device, {});
+    }
+
+    //1.5x growth from 256 to 16000 bytes, not one buffer per new size
+    try std.testing.expect(resize_count <= 12);
+    try std.testing.expectEqual(resize_count + 1, device.mStats.BuffersCreated);
+    //the 64k minimum covers every frame, so one transfer buffer per frame in flight
+    try std.testing.expectEqual(FRAMES_IN_FLIGHT, device.mStats.TransferBuffersCreated);
+    try std.testing.expectEqual(@as(usize, 1000), device.mStats.CopyPasses);
+    //whole buffer rewrites never copy the old contents
+    try std.testing.expectEqual(@as(usize, 0), device.mStats.BufferCopies);
+    try std.testing.expectEqualSlices(u8, &data, storage.mBuffer.?.mBytes[0..data.len]);
+
+    storage.Deinit(&device);
+    queue.Deinit(allocator, &device);
+    try std.testing.expectEqual(@as(usize, 0), device.GetLiveCount());
+}
+
+test "All uploads of a frame share one copy pass" {
+    const allocator = std.testing.allocator;
+    var device = NullGPUDevice.Init(allocator);
+
+    var queue: TestQueue = .empty;
+    defer queue.Deinit(allocator, &device);
+    var storages = [_]TestStorage{.empty} ** 5;
+    defer for (&storages) |*storage| storage.Deinit(&device);
+    for (&storages) |*storage| try storage.Init(&device, 64);
+
+    for (0..10) |frame| {
+        queue.BeginFrame(&device);
+        for (&storages, 0..) |*storage, i| {
+            const value: u8 = @intCast(frame * 10 + i);
+            const bytes = [_]u8{value} ** 48;
+            _ = try storage.SetData(allocator, &queue, &device, &bytes, 0);
+        }
+        try std.testing.expectEqual(@as(usize, 5), queue.GetPendingCount());
+        try queue.Flush(&device, {});
+    }
+
+    try std.testing.expectEqual(@as(usize, 10), device.mStats.CopyPasses);
+    try std.testing.expectEqual(@as(usize, 50), device.mStats.Uploads);
+    //one map per frame, not one per upload
+    try std.testing.expectEqual(@as(usize, 10), device.mStats.Maps);
+    for (storages, 0..) |storage, i| {
+        try std.testing.expectEqual(@as(u8, @intCast(90 + i)), storage.mBuffer.?.mBytes[47]);
+    }
+}
+
+test "Growing keeps the contents written before" {
+    const allocator = std.testing.allocator;
+    var device = NullGPUDevice.Init(allocator);
+
+    var queue: TestQueue = .empty;
+    defer queue.Deinit(allocator, &device);
+    var storage: TestStorage = .empty;
+    defer storage.Deinit(&device);
+    try storage.Init(&device, 64);
+
+    const head = [_]u8{0xAB} ** 64;
+    const tail = [_]u8{0xCD} ** 200;
+    const tail2 = [_]u8{0xEF} ** 300;
+
+    //written in an earlier frame
+    queue.BeginFrame(&device);
+    try std.testing.expect(!try storage.SetData(allocator, &queue, &device, &head, 0));
+    try queue.Flush(&device, {});
+
+    //and in the same frame as the growth, the copy has to land between the two uploads
+    queue.BeginFrame(&device);
+    try std.testing.expect(try storage.SetData(allocator, &queue, &device, &tail, 64));
+    try std.testing.expect(try storage.SetData(allocator, &queue, &device, &tail2, 264));
+    try queue.Flush(&device, {});
+
+    const bytes = storage.mBuffer.?.mBytes;
+    try std.testing.expectEqualSlices(u8, &head, bytes[0..64]);
+    try std.testing.expectEqualSlices(u8, &tail, bytes[64..264]);
+    try std.testing.expectEqualSlices(u8, &tail2, bytes[264..564]);
+    try std.testing.expectEqual(@as(usize, 2), device.mStats.BufferCopies);
+    //the replaced buffers are gone once the copies out of them are encoded
+    try std.testing.expectEqual(@as(usize, 1), device.mStats.BuffersCreated - device.mStats.BuffersReleased);
+}
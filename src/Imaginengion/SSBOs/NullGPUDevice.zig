@@ -0,0 +1,111 @@
+//! GPU device that keeps every buffer in host memory and counts what gets created.
+//!
+//! Implements the same device interface as SDLGPUDevice so the storage buffer and upload code
+//! can run without a GPU. Uploads and copies are applied when they are recorded, so the buffer
+//! contents can be checked after a flush.
+const std = @import("std");
+const NullGPUDevice = @This();
+
+pub const HostBuffer = struct {
+    mBytes: []u8,
+    mMapped: bool = false,
+};
+
+pub const Buffer = *HostBuffer;
+pub const TransferBuffer = *HostBuffer;
+pub const CommandBuffer = void;
+pub const CopyPass = void;
+
+pub const Stats = struct {
+    BuffersCreated: usize = 0,
+    BuffersReleased: usize = 0,
+    TransferBuffersCreated: usize = 0,
+    TransferBuffersReleased: usize = 0,
+    Maps: usize = 0,
+    CopyPasses: usize = 0,
+    Uploads: usize = 0,
+    BufferCopies: usize = 0,
+};
+
+mAllocator: std.mem.Allocator,
+mStats: Stats = .{},
+_InCopyPass: bool = false,
+
+pub fn Init(allocator: std.mem.Allocator) NullGPUDevice {
+    return .{ .mAllocator = allocator };
+}
+
+pub fn CreateBuffer(self: *NullGPUDevice, size: u32) !Buffer {
+    self.mStats.BuffersCreated += 1;
+    return self.CreateHostBuffer(size);
+}
+
+pub fn ReleaseBuffer(self: *NullGPUDevice, buffer: Buffer) void {
+    self.mStats.BuffersReleased += 1;
+    self.DestroyHostBuffer(buffer);
+}
+
+pub fn CreateTransferBuffer(self: *NullGPUDevice, size: u32) !TransferBuffer {
+    self.mStats.TransferBuffersCreated += 1;
+    return self.CreateHostBuffer(size);
+}
+
+pub fn ReleaseTransferBuffer(self: *NullGPUDevice, transfer_buffer: TransferBuffer) void {
+    self.mStats.TransferBuffersReleased += 1;
+    self.DestroyHostBuffer(transfer_buffer);
+}
+
+pub fn MapTransferBuffer(self: *NullGPUDevice, transfer_buffer: TransferBuffer, cycle: bool) ![*]u8 {
+    _ = cycle;
+    std.debug.assert(!transfer_buffer.mMapped);
+    self.mStats.Maps += 1;
+    transfer_buffer.mMapped = true;
+    return transfer_buffer.mBytes.ptr;
+}
+
+pub fn UnmapTransferBuffer(_: *NullGPUDevice, transfer_buffer: TransferBuffer) void {
+    std.debug.assert(transfer_buffer.mMapped);
+    transfer_buffer.mMapped = false;
+}
+
+pub fn BeginCopyPass(self: *NullGPUDevice, _: CommandBuffer) !CopyPass {
+    std.debug.assert(!self._InCopyPass);
+    self.mStats.CopyPasses += 1;
+    self._InCopyPass = true;
+}
+
+pub fn UploadToBuffer(self: *NullGPUDevice, _: CopyPass, src: TransferBuffer, src_offset: u32, dst: Buffer, dst_offset: u32, size: u32) void {
+    //like the real thing, the transfer buffer has to be unmapped before it is used
+    std.debug.assert(self._InCopyPass and !src.mMapped);
+    self.mStats.Uploads += 1;
+    @memcpy(dst.mBytes[dst_offset..][0..size], src.mBytes[src_offset..][0..size]);
+}
+
+pub fn CopyBufferToBuffer(self: *NullGPUDevice, _: CopyPass, src: Buffer, dst: Buffer, size: u32) void {
+    std.debug.assert(self._InCopyPass);
+    self.mStats.BufferCopies += 1;
+    @memcpy(dst.mBytes[0..size], src.mBytes[0..size]);
+}
+
+pub fn EndCopyPass(self: *NullGPUDevice, _: CopyPass) void {
+    std.debug.assert(self._InCopyPass);
+    self._InCopyPass = false;
+}
+
+/// Buffers and transfer buffers that have not been released yet
+pub fn GetLiveCount(self: NullGPUDevice) usize {
+    return self.mStats.BuffersCreated + self.mStats.TransferBuffersCreated - self.mStats.BuffersReleased - self.mStats.TransferBuffersReleased;
+}
+
+fn CreateHostBuffer(self: *NullGPUDevice, size: u32) !*HostBuffer {
+    const host_buffer = try self.mAllocator.create(HostBuffer);
+    errdefer self.mAllocator.destroy(host_buffer);
+    host_buffer.* = .{ .mBytes = try self.mAllocator.alloc(u8, size) };
+    @memset(host_buffer.mBytes, 0);
+    return host_buffer;
+}
+
+fn DestroyHostBuffer(self: *NullGPUDevice, host_buffer: *HostBuffer) void {
+    self.mAllocator.free(host_buffer.mBytes);
+    self.mAllocator.destroy(host_buffer);
+}
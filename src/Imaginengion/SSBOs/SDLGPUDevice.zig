@@ -0,0 +1,86 @@
+//! The SDL GPU calls used by GPUStorage, behind the device interface NullGPUDevice also implements.
+const std = @import("std");
+const sdl = @import("../Core/CImports.zig").sdl;
+const SDLGPUDevice = @This();
+
+pub const Buffer = *sdl.SDL_GPUBuffer;
+pub const TransferBuffer = *sdl.SDL_GPUTransferBuffer;
+pub const CommandBuffer = *sdl.SDL_GPUCommandBuffer;
+pub const CopyPass = *sdl.SDL_GPUCopyPass;
+
+mDevice: *sdl.SDL_GPUDevice,
+
+pub fn CreateBuffer(self: *SDLGPUDevice, size: u32) !Buffer {
+    const buffer_info = sdl.SDL_GPUBufferCreateInfo{
+        .usage = sdl.SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+        .size = size,
+        .props = 0,
+    };
+    return sdl.SDL_CreateGPUBuffer(self.mDevice, &buffer_info) orelse {
+        std.log.err("SDL_CreateGPUBuffer failed: {s}", .{sdl.SDL_GetError()});
+        return error.GPUBufferCreateFailed;
+    };
+}
+
+pub fn ReleaseBuffer(self: *SDLGPUDevice, buffer: Buffer) void {
+    sdl.SDL_ReleaseGPUBuffer(self.mDevice, buffer);
+}
+
+pub fn CreateTransferBuffer(self: *SDLGPUDevice, size: u32) !TransferBuffer {
+    const transfer_info = sdl.SDL_GPUTransferBufferCreateInfo{
+        .usage = sdl.SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+        .size = size,
+        .props = 0,
+    };
+    return sdl.SDL_CreateGPUTransferBuffer(self.mDevice, &transfer_info) orelse {
+        std.log.err("SDL_CreateGPUTransferBuffer failed: {s}", .{sdl.SDL_GetError()});
+        return error.GPUTransferBufferCreateFailed;
+    };
+}
+
+pub fn ReleaseTransferBuffer(self: *SDLGPUDevice, transfer_buffer: TransferBuffer) void {
+    sdl.SDL_ReleaseGPUTransferBuffer(self.mDevice, transfer_buffer);
+}
+
+/// With cycle set SDL hands back fresh memory if the gpu is still reading the buffer
+pub fn MapTransferBuffer(self: *SDLGPUDevice, transfer_buffer: TransferBuffer, cycle: bool) ![*]u8 {
+    const mapped = sdl.SDL_MapGPUTransferBuffer(self.mDevice, transfer_buffer, cycle) orelse {
+        std.log.err("SDL_MapGPUTransferBuffer failed: {s}", .{sdl.SDL_GetError()});
+        return error.GPUTransferBufferMapFailed;
+    };
+    return @ptrCast(mapped);
+}
+
+pub fn UnmapTransferBuffer(self: *SDLGPUDevice, transfer_buffer: TransferBuffer) void {
+    sdl.SDL_UnmapGPUTransferBuffer(self.mDevice, transfer_buffer);
+}
+
+pub fn BeginCopyPass(_: *SDLGPUDevice, command_buffer: CommandBuffer) !CopyPass {
+    return sdl.SDL_BeginGPUCopyPass(command_buffer) orelse {
+        std.log.err("SDL_BeginGPUCopyPass failed: {s}", .{sdl.SDL_GetError()});
+        return error.GPUCopyPassFailed;
+    };
+}
+
+pub fn UploadToBuffer(_: *SDLGPUDevice, copy_pass: CopyPass, src: TransferBuffer, src_offset: u32, dst: Buffer, dst_offset: u32, size: u32) void {
+    const src_location = sdl.SDL_GPUTransferBufferLocation{
+        .transfer_buffer = src,
+        .offset = src_offset,
+    };
+    const dst_region = sdl.SDL_GPUBufferRegion{
+        .buffer = dst,
+        .offset = dst_offset,
+        .size = size,
+    };
+    sdl.SDL_UploadToGPUBuffer(copy_pass, &src_location, &dst_region, false);
+}
+
+pub fn CopyBufferToBuffer(_: *SDLGPUDevice, copy_pass: CopyPass, src: Buffer, dst: Buffer, size: u32) void {
+    const src_location = sdl.SDL_GPUBufferLocation{ .buffer = src, .offset = 0 };
+    const dst_location = sdl.SDL_GPUBufferLocation{ .buffer = dst, .offset = 0 };
+    sdl.SDL_CopyGPUBufferToBuffer(copy_pass, &src_location, &dst_location, size, false);
+}
+
+pub fn EndCopyPass(_: *SDLGPUDevice, copy_pass: CopyPass) void {
+    sdl.SDL_EndGPUCopyPass(copy_pass);
+}
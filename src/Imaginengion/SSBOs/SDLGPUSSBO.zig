@@ -2,113 +2,68 @@ const std = @import("std");
 const sdl = @import("../Core/CImports.zig").sdl;
 const Stage = @import("../Assets/Assets/ShaderAsset.zig").Stage;
 const EngineContext = @import("../Core/EngineContext.zig");
+const GPUStorage = @import("GPUStorage.zig");
+const SDLGPUDevice = @import("SDLGPUDevice.zig");
 const SDLSSBO = @This();
 
-mSize: usize,
+pub const UploadQueue = GPUStorage.UploadQueue(SDLGPUDevice);
+const StorageBuffer = GPUStorage.StorageBuffer(SDLGPUDevice);
+
 mSlot: usize,
 mStage: Stage,
-mBuffer: ?*sdl.SDL_GPUBuffer,
+mStorage: StorageBuffer,
 
 pub const empty: SDLSSBO = .{
-    .mBuffer = null,
     .mStage = undefined,
-    .mSize = undefined,
     .mSlot = undefined,
+    .mStorage = .empty,
 };
 
 pub fn Init(self: *SDLSSBO, engine_context: *EngineContext, size: usize, slot: usize, stage: Stage) void {
-    self.mSize = size;
     self.mSlot = slot;
     self.mStage = stage;
 
-    if (size == 0) return;
-
-    const device: *sdl.SDL_GPUDevice = @ptrCast(@alignCast(engine_context.mRenderer.mPlatform.GetDevice()));
-    self.mBuffer = CreateBuffer(device, size);
+    var device = GetDevice(engine_context);
+    self.mStorage.Init(&device, @intCast(size)) catch |err| {
+        std.log.err("failed to create storage buffer for slot {d}: {}", .{ slot, err });
+    };
 }
 
 pub fn Deinit(self: *SDLSSBO, engine_context: *EngineContext) void {
-    if (self.mBuffer) |buf| {
-        const device: *sdl.SDL_GPUDevice = @ptrCast(@alignCast(engine_context.mRenderer.mPlatform.GetDevice()));
-        sdl.SDL_ReleaseGPUBuffer(device, buf);
-        self.mBuffer = null;
-    }
+    var device = GetDevice(engine_context);
+    self.mStorage.Deinit(&device);
 }
 
 pub fn Bind(self: SDLSSBO, render_pass: *anyopaque) void {
-    if (self.mBuffer == null) return;
+    if (self.mStorage.mBuffer == null) return;
     const pass: *sdl.SDL_GPURenderPass = @ptrCast(@alignCast(render_pass));
     switch (self.mStage) {
-        .Vertex => sdl.SDL_BindGPUVertexStorageBuffers(pass, @intCast(self.mSlot), &self.mBuffer, 1),
-        .Fragment => sdl.SDL_BindGPUFragmentStorageBuffers(pass, @intCast(self.mSlot), &self.mBuffer, 1),
+        .Vertex => sdl.SDL_BindGPUVertexStorageBuffers(pass, @intCast(self.mSlot), &self.mStorage.mBuffer, 1),
+        .Fragment => sdl.SDL_BindGPUFragmentStorageBuffers(pass, @intCast(self.mSlot), &self.mStorage.mBuffer, 1),
     }
 }
 
-pub fn SetData(self: *SDLSSBO, engine_context: *EngineContext, data: *const anyopaque, size: usize, offset: u32) bool {
+/// Stages the data in this frame's transfer buffer, it reaches the gpu buffer when the renderer
+/// flushes the upload queue. Returns true if the buffer had to grow and was replaced
+pub fn SetData(self: *SDLSSBO, engine_context: *EngineContext, data: *const anyopaque, size: usize, offset: u32) !bool {
     if (size == 0) return false;
 
-    var resize: bool = false;
-    const device: *sdl.SDL_GPUDevice = @ptrCast(@alignCast(engine_context.mRenderer.mPlatform.GetDevice()));
-    const cmd: *sdl.SDL_GPUCommandBuffer = @ptrCast(@alignCast(engine_context.mRenderer.mPlatform.GetCommandBuff()));
-
-    if (size + offset > self.mSize) {
-        if (self.mBuffer) |buf| sdl.SDL_ReleaseGPUBuffer(device, buf);
-        self.mSize = size + offset;
-        self.mBuffer = CreateBuffer(device, self.mSize);
-        resize = true;
-    }
-
-    const transfer_info = sdl.SDL_GPUTransferBufferCreateInfo{
-        .usage = sdl.SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-        .size = @intCast(size),
-        .props = 0,
-    };
-    const transfer_buf = sdl.SDL_CreateGPUTransferBuffer(device, &transfer_info);
-    std.debug.assert(transfer_buf != null);
-    defer sdl.SDL_ReleaseGPUTransferBuffer(device, transfer_buf);
-
-    const mapped = sdl.SDL_MapGPUTransferBuffer(device, transfer_buf, false);
-    std.debug.assert(mapped != null);
-    @memcpy(
-        @as([*]u8, @ptrCast(mapped))[0..size],
-        @as([*]const u8, @ptrCast(data))[0..size],
-    );
-    sdl.SDL_UnmapGPUTransferBuffer(device, transfer_buf);
+    var device = GetDevice(engine_context);
+    const queue: *UploadQueue = @ptrCast(@alignCast(engine_context.mRenderer.mPlatform.GetUploadQueue()));
+    const bytes = @as([*]const u8, @ptrCast(data))[0..size];
 
-    const copy_pass = sdl.SDL_BeginGPUCopyPass(cmd);
-    std.debug.assert(copy_pass != null);
-
-    const src = sdl.SDL_GPUTransferBufferLocation{
-        .transfer_buffer = transfer_buf,
-        .offset = 0,
-    };
-    const dst = sdl.SDL_GPUBufferRegion{
-        .buffer = self.mBuffer,
-        .offset = offset,
-        .size = @intCast(size),
-    };
-    sdl.SDL_UploadToGPUBuffer(copy_pass, &src, &dst, false);
-    sdl.SDL_EndGPUCopyPass(copy_pass);
-
-    return resize;
+    return self.mStorage.SetData(engine_context.EngineAllocator(), queue, &device, bytes, offset);
 }
 
 pub fn GetBuffer(self: SDLSSBO) *sdl.SDL_GPUBuffer {
-    std.debug.assert(self.mBuffer != null);
-    return self.mBuffer.?;
+    std.debug.assert(self.mStorage.mBuffer != null);
+    return self.mStorage.mBuffer.?;
 }
 
 pub fn GetBinding(self: SDLSSBO) usize {
     return self.mSlot;
 }
 
-fn CreateBuffer(device: *sdl.SDL_GPUDevice, size: usize) ?*sdl.SDL_GPUBuffer {
-    const buffer_info = sdl.SDL_GPUBufferCreateInfo{
-        .usage = sdl.SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
-        .size = @intCast(size),
-        .props = 0,
-    };
-    const buffer = sdl.SDL_CreateGPUBuffer(device, &buffer_info);
-    std.debug.assert(buffer != null);
-    return buffer;
+fn GetDevice(engine_context: *EngineContext) SDLGPUDevice {
+    return .{ .mDevice = @ptrCast(@alignCast(engine_context.mRenderer.mPlatform.GetDevice())) };
 }
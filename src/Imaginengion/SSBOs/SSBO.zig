@@ -27,7 +27,8 @@ pub fn Unbind(self: SSBO) void {
     self.mImpl.Unbind();
 }
 
-pub fn SetData(self: *SSBO, engine_context: *EngineContext, data: *anyopaque, size: usize, offset: u32) bool {
+/// Queued for the next upload flush of the renderer, true if the buffer grew and was replaced
+pub fn SetData(self: *SSBO, engine_context: *EngineContext, data: *const anyopaque, size: usize, offset: u32) !bool {
     return self.mImpl.SetData(engine_context, data, size, offset);
 }
 
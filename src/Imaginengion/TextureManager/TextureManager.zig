@@ -11,6 +11,10 @@ const Impl = switch (builtin.os.tag) {
     else => @compileError("Not supported platform"),
 };
 
+//handle packing and the atlas layout are plain math, kept off the platform switch
+//so the shaders and the cpu ray marcher can decode texture handles on any target
+const AtlasLayout = @import("backends/SGTextureManager.zig");
+
 _Impl: Impl = .{},
 
 pub fn Init(self: *TextureManager, engine_context: *EngineContext, vram_bytes_size: usize) !void {
@@ -34,7 +38,7 @@ pub fn Unregister(self: *TextureManager, texture_location: u32) void {
 }
 
 pub fn GetPixelOffsets(bin_index: usize, slot_index: usize) struct { usize, usize } {
-    return Impl.GetPixelOffsets(bin_index, slot_index);
+    return AtlasLayout.GetPixelOffsets(bin_index, slot_index);
 }
 
 pub fn GetTexture(self: TextureManager) *anyopaque {
@@ -45,17 +49,17 @@ pub fn GetSampler(self: TextureManager) *anyopaque {
 }
 
 pub fn GetSlotIndex(texture_handle: u32) usize {
-    return Impl.GetSlotIndex(texture_handle);
+    return AtlasLayout.GetSlotIndex(texture_handle);
 }
 
 pub fn GetLayerIndex(texture_handle: u32) usize {
-    return Impl.GetLayerIndex(texture_handle);
+    return AtlasLayout.GetLayerIndex(texture_handle);
 }
 
 pub fn GetBinIndex(texture_handle: u32) usize {
-    return Impl.GetBinIndex(texture_handle);
+    return AtlasLayout.GetBinIndex(texture_handle);
 }
 
 pub fn GetTextureUV(texture_handle: u32, local_uv: Vec2(f32)) Vec3(f32) {
-    return Impl.GetTextureUV(texture_handle, local_uv);
+    return AtlasLayout.GetTextureUV(texture_handle, local_uv);
 }